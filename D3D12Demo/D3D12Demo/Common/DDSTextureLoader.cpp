@@ -1229,7 +1229,6 @@ static HRESULT CreateD3DResources( _In_ ID3D11Device* d3dDevice,
 
 static HRESULT CreateD3DResources12(
 	ID3D12Device* device,
-	ID3D12GraphicsCommandList* cmdList,
 	_In_ uint32_t resDim,
 	_In_ size_t width,
 	_In_ size_t height,
@@ -1240,8 +1239,7 @@ static HRESULT CreateD3DResources12(
 	_In_ bool forceSRGB,
 	_In_ bool isCubeMap,
 	_In_reads_opt_(mipCount*arraySize) D3D12_SUBRESOURCE_DATA* initData,
-	ComPtr<ID3D12Resource>& texture,
-	ComPtr<ID3D12Resource>& textureUploadHeap
+	DDS_UPLOAD_JOB12& job
 	)
 {
 	if (device == nullptr)
@@ -1276,18 +1274,26 @@ static HRESULT CreateD3DResources12(
 			&texDesc,
 			D3D12_RESOURCE_STATE_COMMON,
 			nullptr,
-			IID_PPV_ARGS(&texture)
+			IID_PPV_ARGS(&job.texture)
 			);
 
 		if (FAILED(hr))
 		{
-			texture = nullptr;
+			job.texture = nullptr;
 			return hr;
 		}
 		else
 		{
 			const UINT num2DSubresources = texDesc.DepthOrArraySize * texDesc.MipLevels;
-			const UINT64 uploadBufferSize = GetRequiredIntermediateSize(texture.Get(), 0, num2DSubresources);
+
+			// The same footprints UpdateSubresources would use, but the rows are
+			// copied into the upload heap here so no command list is needed yet.
+			std::vector<UINT> numRows(num2DSubresources);
+			std::vector<UINT64> rowSizes(num2DSubresources);
+			UINT64 uploadBufferSize = 0;
+			job.footprints.resize(num2DSubresources);
+			device->GetCopyableFootprints(&texDesc, 0, num2DSubresources, 0,
+				job.footprints.data(), numRows.data(), rowSizes.data(), &uploadBufferSize);
 
             CD3DX12_HEAP_PROPERTIES HeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
             CD3DX12_RESOURCE_DESC ResourceDesc = CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize);
@@ -1297,23 +1303,32 @@ static HRESULT CreateD3DResources12(
 				&ResourceDesc,
 				D3D12_RESOURCE_STATE_GENERIC_READ,
 				nullptr,
-				IID_PPV_ARGS(&textureUploadHeap));
+				IID_PPV_ARGS(&job.textureUploadHeap));
 			if (FAILED(hr))
 			{
-				texture = nullptr;
+				job.texture = nullptr;
 				return hr;
 			}
-			else
-			{
-                CD3DX12_RESOURCE_BARRIER ResourceBarrier1 = CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST);
-				cmdList->ResourceBarrier(1, &ResourceBarrier1);
 
-				// Use Heap-allocating UpdateSubresources implementation for variable number of subresources (which is the case for textures).
-				UpdateSubresources(cmdList, texture.Get(), textureUploadHeap.Get(), 0, 0, num2DSubresources, initData);
+			BYTE* mappedData = nullptr;
+			hr = job.textureUploadHeap->Map(0, nullptr, reinterpret_cast<void**>(&mappedData));
+			if (FAILED(hr))
+			{
+				job.texture = nullptr;
+				job.textureUploadHeap = nullptr;
+				return hr;
+			}
 
-                CD3DX12_RESOURCE_BARRIER ResourceBarrier2 = CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-				cmdList->ResourceBarrier(1, &ResourceBarrier2);
+			for (UINT i = 0; i < num2DSubresources; ++i)
+			{
+				const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& footprint = job.footprints[i];
+				D3D12_MEMCPY_DEST destData = { mappedData + footprint.Offset, footprint.Footprint.RowPitch,
+					SIZE_T(footprint.Footprint.RowPitch) * numRows[i] };
+				MemcpySubresource(&destData, &initData[i], static_cast<SIZE_T>(rowSizes[i]), numRows[i],
+					footprint.Footprint.Depth);
 			}
+
+			job.textureUploadHeap->Unmap(0, nullptr);
 		}
 	} break;
 	}
@@ -1674,14 +1689,12 @@ static HRESULT CreateTextureFromDDS( _In_ ID3D11Device* d3dDevice,
 
 static HRESULT CreateTextureFromDDS12(
 	_In_ ID3D12Device* device,
-	_In_opt_ ID3D12GraphicsCommandList* cmdList,
 	_In_ const DDS_HEADER* header,
 	_In_reads_bytes_(bitSize) const uint8_t* bitData,
 	_In_ size_t bitSize,
 	_In_ size_t maxsize,
 	_In_ bool forceSRGB,
-	ComPtr<ID3D12Resource>& texture,
-	ComPtr<ID3D12Resource>& textureUploadHeap)
+	DDS_UPLOAD_JOB12& job)
 {
 	HRESULT hr = S_OK;
 
@@ -1861,7 +1874,7 @@ static HRESULT CreateTextureFromDDS12(
 	if (SUCCEEDED(hr))
 	{
 		hr = CreateD3DResources12(
-			device, cmdList,
+			device,
 			resDim, twidth, theight, tdepth,
 			mipCount - skipMip,
 			arraySize,
@@ -1869,8 +1882,7 @@ static HRESULT CreateTextureFromDDS12(
 			false, // forceSRGB
 			isCubeMap,
 			initData.get(),
-			texture, 
-			textureUploadHeap);
+			job);
 	}
 
 	return hr;
@@ -1973,20 +1985,23 @@ HRESULT DirectX::CreateDDSTextureFromMemory12(
 		+ sizeof(DDS_HEADER)
 		+ (bDXT10Header ? sizeof(DDS_HEADER_DXT10) : 0);
 
+	DDS_UPLOAD_JOB12 job;
 	HRESULT hr = CreateTextureFromDDS12(
 		device,
-		cmdList,
 		header,
 		ddsData + offset,
 		ddsDataSize - offset,
 		maxsize,
 		false,
-		texture,
-		textureUploadHeap
+		job
 		);
 
 	if (SUCCEEDED(hr))
 	{
+		RecordDDSTextureUpload12(cmdList, job);
+		texture = job.texture;
+		textureUploadHeap = job.textureUploadHeap;
+
 		if (alphaMode)
 			(*alphaMode) = GetAlphaMode(header);
 	}
@@ -2158,27 +2173,22 @@ HRESULT DirectX::CreateDDSTextureFromFile12(_In_ ID3D12Device* device,
 		*alphaMode = DDS_ALPHA_MODE_UNKNOWN;
 	}
 
-	if (!device || !szFileName)
+	if (!cmdList)
 	{
 		return E_INVALIDARG;
 	}
 
-	DDS_HEADER* header = nullptr;
-	uint8_t* bitData = nullptr;
-	size_t bitSize = 0;
-
-	std::unique_ptr<uint8_t[]> ddsData;
-	HRESULT hr = LoadTextureDataFromFile(szFileName, ddsData, &header, &bitData, &bitSize);
+	DDS_UPLOAD_JOB12 job;
+	HRESULT hr = PrepareDDSTextureUpload12(device, szFileName, job, maxsize);
 	if (FAILED(hr))
 	{
 		return hr;
 	}
 
-	hr = CreateTextureFromDDS12(device, cmdList, header,
-		bitData, bitSize, maxsize, false, texture, textureUploadHeap);
+	RecordDDSTextureUpload12(cmdList, job);
 
-	if (SUCCEEDED(hr))
-	{
+	texture = job.texture;
+	textureUploadHeap = job.textureUploadHeap;
 /*
 #if !defined(NO_D3D11_DEBUG_NAME) && ( defined(_DEBUG) || defined(PROFILE) )
 		if (texture != 0 || textureView != 0)
@@ -2224,13 +2234,70 @@ HRESULT DirectX::CreateDDSTextureFromFile12(_In_ ID3D12Device* device,
 		}
 #endif
 */
-		if (alphaMode)
-			*alphaMode = GetAlphaMode(header);
+	if (alphaMode)
+	{
+		*alphaMode = job.alphaMode;
 	}
 
 	return hr;
 }
 
+_Use_decl_annotations_
+HRESULT DirectX::PrepareDDSTextureUpload12(ID3D12Device* device,
+	const wchar_t* szFileName,
+	DDS_UPLOAD_JOB12& job,
+	size_t maxsize)
+{
+	job = DDS_UPLOAD_JOB12();
+
+	if (!device || !szFileName)
+	{
+		return E_INVALIDARG;
+	}
+
+	DDS_HEADER* header = nullptr;
+	uint8_t* bitData = nullptr;
+	size_t bitSize = 0;
+
+	std::unique_ptr<uint8_t[]> ddsData;
+	HRESULT hr = LoadTextureDataFromFile(szFileName, ddsData, &header, &bitData, &bitSize);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	hr = CreateTextureFromDDS12(device, header, bitData, bitSize, maxsize, false, job);
+	if (FAILED(hr))
+	{
+		job = DDS_UPLOAD_JOB12();
+		return hr;
+	}
+
+	job.alphaMode = GetAlphaMode(header);
+
+	return hr;
+}
+
+_Use_decl_annotations_
+void DirectX::RecordDDSTextureUpload12(ID3D12GraphicsCommandList* cmdList,
+	const DDS_UPLOAD_JOB12& job)
+{
+	CD3DX12_RESOURCE_BARRIER ResourceBarrier1 = CD3DX12_RESOURCE_BARRIER::Transition(job.texture.Get(),
+		D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST);
+	cmdList->ResourceBarrier(1, &ResourceBarrier1);
+
+	for (UINT i = 0; i < (UINT)job.footprints.size(); ++i)
+	{
+		CD3DX12_TEXTURE_COPY_LOCATION dst(job.texture.Get(), i);
+		CD3DX12_TEXTURE_COPY_LOCATION src(job.textureUploadHeap.Get(), job.footprints[i]);
+		cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+	}
+
+	CD3DX12_RESOURCE_BARRIER ResourceBarrier2 = CD3DX12_RESOURCE_BARRIER::Transition(job.texture.Get(),
+		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	cmdList->ResourceBarrier(1, &ResourceBarrier2);
+}
+
 _Use_decl_annotations_
 HRESULT DirectX::CreateDDSTextureFromFile( ID3D11Device* d3dDevice,
                                            ID3D11DeviceContext* d3dContext,
@@ -25,6 +25,7 @@
 #include <wrl.h>
 #include <d3d11_1.h>
 #include "d3dx12.h"
+#include <vector>
 
 #pragma warning(push)
 #pragma warning(disable : 4005)
@@ -92,6 +93,30 @@ namespace DirectX
 		                               _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr
 		                               );
 
+	// A texture whose upload heap has been filled but whose copy has not been recorded.
+	struct DDS_UPLOAD_JOB12
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> texture;
+		Microsoft::WRL::ComPtr<ID3D12Resource> textureUploadHeap;
+		std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> footprints;
+		DDS_ALPHA_MODE alphaMode = DDS_ALPHA_MODE_UNKNOWN;
+	};
+
+	// CreateDDSTextureFromFile12 in two halves.  PrepareDDSTextureUpload12 reads
+	// the file, creates the texture and its upload heap and copies the texels
+	// into the heap.  It only uses the device, so several can run at once on
+	// worker threads.  RecordDDSTextureUpload12 then records the copy into the
+	// texture and the transition to PIXEL_SHADER_RESOURCE on the command list.
+	HRESULT PrepareDDSTextureUpload12(_In_ ID3D12Device* device,
+		                              _In_z_ const wchar_t* szFileName,
+		                              _Out_ DDS_UPLOAD_JOB12& job,
+		                              _In_ size_t maxsize = 0
+		                              );
+
+	void RecordDDSTextureUpload12(_In_ ID3D12GraphicsCommandList* cmdList,
+		                          _In_ const DDS_UPLOAD_JOB12& job
+		                          );
+
     // Standard version with optional auto-gen mipmap support
     HRESULT CreateDDSTextureFromMemory( _In_ ID3D11Device* d3dDevice,
                                         _In_opt_ ID3D11DeviceContext* d3dContext,
@@ -0,0 +1,126 @@
+//***************************************************************************************
+// TextureArrayPacker.cpp
+//***************************************************************************************
+
+#include "TextureArrayPacker.h"
+
+using Microsoft::WRL::ComPtr;
+
+void TextureArrayPacker::Pack(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<Texture*>& textures)
+{
+	struct Group
+	{
+		D3D12_RESOURCE_DESC Desc;
+		std::vector<Texture*> Members;
+	};
+
+	std::vector<Group> groups;
+	for (Texture* tex : textures)
+	{
+		D3D12_RESOURCE_DESC desc = tex->Resource->GetDesc();
+
+		auto group = std::find_if(groups.begin(), groups.end(), [&desc](const Group& g)
+		{
+			return g.Desc.Format == desc.Format && g.Desc.Width == desc.Width && g.Desc.Height == desc.Height;
+		});
+
+		if (group == groups.end())
+		{
+			groups.push_back({ desc, {} });
+			group = groups.end() - 1;
+		}
+
+		group->Desc.MipLevels = std::min(group->Desc.MipLevels, desc.MipLevels);
+		group->Members.push_back(tex);
+	}
+
+	std::vector<D3D12_RESOURCE_BARRIER> barriers;
+	for (Texture* tex : textures)
+	{
+		barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(tex->Resource.Get(),
+			D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE));
+	}
+	cmdList->ResourceBarrier((UINT)barriers.size(), barriers.data());
+	barriers.clear();
+
+	for (const Group& group : groups)
+	{
+		UINT arrayIndex = (UINT)mArrays.size();
+		UINT sliceCount = (UINT)group.Members.size();
+		UINT mipLevels = group.Desc.MipLevels;
+
+		D3D12_RESOURCE_DESC arrayDesc = group.Desc;
+		arrayDesc.DepthOrArraySize = (UINT16)sliceCount;
+
+		ComPtr<ID3D12Resource> array;
+		CD3DX12_HEAP_PROPERTIES HeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+		ThrowIfFailed(device->CreateCommittedResource(
+			&HeapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&arrayDesc,
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			nullptr,
+			IID_PPV_ARGS(&array)));
+
+		for (UINT slice = 0; slice < sliceCount; ++slice)
+		{
+			Texture* tex = group.Members[slice];
+			UINT srcMipLevels = tex->Resource->GetDesc().MipLevels;
+
+			for (UINT mip = 0; mip < mipLevels; ++mip)
+			{
+				CD3DX12_TEXTURE_COPY_LOCATION dst(array.Get(), D3D12CalcSubresource(mip, slice, 0, mipLevels, sliceCount));
+				CD3DX12_TEXTURE_COPY_LOCATION src(tex->Resource.Get(), D3D12CalcSubresource(mip, 0, 0, srcMipLevels, 1));
+				cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+			}
+
+			mPackedTextures[tex->Name] = { arrayIndex, slice };
+
+			barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(tex->Resource.Get(),
+				D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+		}
+
+		barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(array.Get(),
+			D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+
+		mArrays.push_back(array);
+	}
+
+	cmdList->ResourceBarrier((UINT)barriers.size(), barriers.data());
+}
+
+UINT TextureArrayPacker::ArrayCount()const
+{
+	return (UINT)mArrays.size();
+}
+
+void TextureArrayPacker::CreateSrvs(ID3D12Device* device, CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor, UINT descriptorSize)const
+{
+	for (const ComPtr<ID3D12Resource>& array : mArrays)
+	{
+		D3D12_RESOURCE_DESC desc = array->GetDesc();
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Format = desc.Format;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MostDetailedMip = 0;
+		srvDesc.Texture2DArray.MipLevels = desc.MipLevels;
+		srvDesc.Texture2DArray.FirstArraySlice = 0;
+		srvDesc.Texture2DArray.ArraySize = desc.DepthOrArraySize;
+		srvDesc.Texture2DArray.PlaneSlice = 0;
+		srvDesc.Texture2DArray.ResourceMinLODClamp = 0.0f;
+		device->CreateShaderResourceView(array.Get(), &srvDesc, hDescriptor);
+
+		hDescriptor.Offset(1, descriptorSize);
+	}
+}
+
+void TextureArrayPacker::AssignDiffuseMap(Material& mat, const std::string& textureName)const
+{
+	const PackedTexture& packed = mPackedTextures.at(textureName);
+
+	mat.DiffuseSrvHeapIndex = packed.ArrayIndex;
+	mat.DiffuseMapSlice = packed.Slice;
+	mat.NumFrameDirty = gNumFrameResources;
+}
@@ -0,0 +1,49 @@
+//***************************************************************************************
+// TextureArrayPacker.h
+//
+// Packs textures that share a format and size into Texture2DArrays, so all of a
+// scene's textures fit in a handful of SRVs that are bound once per frame.  A
+// material then picks its texture by array and slice in its constants instead of
+// by switching descriptor tables per draw.
+//
+// Array slices, unlike atlas pages, keep wrap addressing and whole mip chains, so
+// texture coordinates and TexTransforms stay as they are.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+class TextureArrayPacker
+{
+public:
+	TextureArrayPacker() = default;
+	TextureArrayPacker(const TextureArrayPacker& rhs) = delete;
+	TextureArrayPacker& operator=(const TextureArrayPacker& rhs) = delete;
+
+	// Creates one array per format and size among textures and records GPU copies
+	// of each texture into a slice of its array.  Textures must be single 2D
+	// textures in the PIXEL_SHADER_RESOURCE state, as CreateDDSTextureFromFile12
+	// leaves them, and must stay alive until the copies have executed; after that
+	// they can be released.  An array keeps as many mips as the texture with the
+	// fewest in it.
+	void Pack(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<Texture*>& textures);
+
+	UINT ArrayCount()const;
+
+	// Creates the SRVs of the arrays in ArrayCount() consecutive descriptors.
+	void CreateSrvs(ID3D12Device* device, CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor, UINT descriptorSize)const;
+
+	// Points mat at the array and slice textureName was packed into.
+	void AssignDiffuseMap(Material& mat, const std::string& textureName)const;
+
+private:
+	struct PackedTexture
+	{
+		UINT ArrayIndex = 0;
+		UINT Slice = 0;
+	};
+
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> mArrays;
+	std::unordered_map<std::string, PackedTexture> mPackedTextures;
+};
@@ -0,0 +1,56 @@
+//***************************************************************************************
+// TextureBatchLoader.cpp
+//***************************************************************************************
+
+#include "TextureBatchLoader.h"
+
+using namespace DirectX;
+
+TextureBatchLoader::TextureBatchLoader(ThreadPool& threadPool)
+	: mThreadPool(threadPool)
+{
+}
+
+TextureBatchLoader::~TextureBatchLoader()
+{
+	// Jobs that were never recorded, for example after another one threw, still
+	// use the device.
+	for(PendingTexture& pending : mPending)
+	{
+		if(pending.Job.valid())
+			pending.Job.wait();
+	}
+}
+
+void TextureBatchLoader::Load(ID3D12Device* device, const std::vector<Texture*>& textures)
+{
+	for(Texture* tex : textures)
+	{
+		PendingTexture pending;
+		pending.Tex = tex;
+
+		std::wstring filename = tex->FileName;
+		pending.Job = mThreadPool.Submit([device, filename]()
+		{
+			DDS_UPLOAD_JOB12 job;
+			ThrowIfFailed(PrepareDDSTextureUpload12(device, filename.c_str(), job));
+			return job;
+		});
+
+		mPending.push_back(std::move(pending));
+	}
+}
+
+void TextureBatchLoader::RecordUploads(ID3D12GraphicsCommandList* cmdList)
+{
+	for(PendingTexture& pending : mPending)
+	{
+		DDS_UPLOAD_JOB12 job = pending.Job.get();
+		RecordDDSTextureUpload12(cmdList, job);
+
+		pending.Tex->Resource = job.texture;
+		pending.Tex->UploadHeap = job.textureUploadHeap;
+	}
+
+	mPending.clear();
+}
@@ -0,0 +1,41 @@
+//***************************************************************************************
+// TextureBatchLoader.h
+//
+// Loads a list of DDS textures with the file reads, header parsing and upload heap
+// fills spread over a thread pool (see PrepareDDSTextureUpload12).  Load returns
+// right away, so the app can build its geometry and shaders while the textures
+// are prepared; RecordUploads then records the copies on the render thread.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "DDSTextureLoader.h"
+#include "ThreadPool.h"
+
+class TextureBatchLoader
+{
+public:
+	explicit TextureBatchLoader(ThreadPool& threadPool = ThreadPool::Default());
+	TextureBatchLoader(const TextureBatchLoader& rhs) = delete;
+	TextureBatchLoader& operator=(const TextureBatchLoader& rhs) = delete;
+	~TextureBatchLoader();
+
+	// Starts preparing the file of every texture.  The textures must stay alive
+	// until RecordUploads fills in their Resource and UploadHeap.
+	void Load(ID3D12Device* device, const std::vector<Texture*>& textures);
+
+	// Waits for each queued texture in the order it was queued and records its
+	// upload.  Throws a DxException if any texture failed to load.
+	void RecordUploads(ID3D12GraphicsCommandList* cmdList);
+
+private:
+	struct PendingTexture
+	{
+		Texture* Tex = nullptr;
+		std::future<DirectX::DDS_UPLOAD_JOB12> Job;
+	};
+
+	ThreadPool& mThreadPool;
+	std::vector<PendingTexture> mPending;
+};
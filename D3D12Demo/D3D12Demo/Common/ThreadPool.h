@@ -0,0 +1,71 @@
+//***************************************************************************************
+// ThreadPool.h
+//
+// Fixed-size pool of worker threads used for data-parallel CPU work (animation,
+// culling, asset preparation).  The calling thread always participates in a
+// ParallelFor, so a pool created with zero workers degenerates to a serial loop.
+//***************************************************************************************
+
+#pragma once
+
+#include <windows.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	// workerCount == -1 picks hardware_concurrency()-1 workers (the caller is
+	// the remaining thread).
+	explicit ThreadPool(int workerCount = -1);
+	ThreadPool(const ThreadPool& rhs) = delete;
+	ThreadPool& operator=(const ThreadPool& rhs) = delete;
+	~ThreadPool();
+
+	// Number of threads that can execute ParallelFor chunks, including the caller.
+	// Per-thread scratch arrays should be sized with this.
+	UINT ThreadCount()const;
+
+	// Index in [0, ThreadCount()) of the calling thread.  Worker threads return
+	// [1, ThreadCount()); any thread that does not belong to this pool returns 0.
+	UINT CurrentThreadIndex()const;
+
+	// Splits [0, count) into chunks of grainSize elements and calls
+	// func(begin, end, threadIndex) for each chunk.  Blocks until every chunk is
+	// done.  Chunks are handed out in increasing order, but may finish in any order.
+	void ParallelFor(UINT count, UINT grainSize,
+		const std::function<void(UINT begin, UINT end, UINT threadIndex)>& func);
+
+	// Queues a single task and returns a future for its result.
+	template<typename F>
+	auto Submit(F f) -> std::future<decltype(f())>
+	{
+		typedef decltype(f()) R;
+		auto task = std::make_shared<std::packaged_task<R()>>(std::move(f));
+		std::future<R> result = task->get_future();
+		Enqueue([task]() { (*task)(); });
+		return result;
+	}
+
+	// Process-wide pool shared by the demo systems.
+	static ThreadPool& Default();
+
+private:
+	void Enqueue(std::function<void()> task);
+	void WorkerMain(UINT threadIndex);
+
+private:
+	std::vector<std::thread> mWorkers;
+
+	std::mutex mQueueMutex;
+	std::condition_variable mQueueCV;
+	std::deque<std::function<void()>> mQueue;
+	bool mQuit = false;
+};
@@ -178,6 +178,9 @@ struct Material
 
 	int DiffuseSrvHeapIndex = -1;
 
+	// Slice of the texture array at DiffuseSrvHeapIndex that holds the diffuse map.
+	UINT DiffuseMapSlice = 0;
+
 	int NormalSrvHeapIndex = -1;
 
 	int NumFrameDirty = gNumFrameResources;
@@ -195,6 +198,11 @@ struct MaterialConstants
 	DirectX::XMFLOAT3 FresnelR0 = { 0.01f, 0.01f, 0.01f };
 	float Roughness = .25f;
 	DirectX::XMFLOAT4X4 MatTransform = MathHelper::Identity4x4();
+
+	UINT DiffuseMapIndex = 0;
+	UINT DiffuseMapSlice = 0;
+	UINT MaterialPad0 = 0;
+	UINT MaterialPad1 = 0;
 };
 
 #define MaxLights 16
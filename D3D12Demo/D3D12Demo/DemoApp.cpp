@@ -18,11 +18,13 @@ bool DemoApp::Init()
 	ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), nullptr));
 
 	BuildTextures();
-	BuildRootSignature();
-	BuildDescriptorHeaps();
-
 	BuildGeometry();
 	BuildGeometryFromFile();
+
+	// The textures were loading on worker threads while the geometry was built.
+	PackTextures();
+	BuildRootSignature();
+	BuildDescriptorHeaps();
 	BuildMaterials();
 
 	BuildRenderItems();
@@ -39,6 +41,13 @@ bool DemoApp::Init()
 	// Wait until initialization is complete.
 	FlushCommandQueue();
 
+	// The textures have been copied into the packed arrays.
+	for (auto& e : mTextures)
+	{
+		e.second->Resource = nullptr;
+		e.second->UploadHeap = nullptr;
+	}
+
 	return true;
 }
 
@@ -128,6 +137,9 @@ void DemoApp::Draw(const GameTimer& gt)
 
 	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
 
+	// Every texture array at once; materials select an array and slice.
+	mCommandList->SetGraphicsRootDescriptorTable(0, mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+
 	//int passCbvIndex = mPassCbvOffset + mCurrFrameResourceIndex;
 	//auto passCbvHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(mCbvHeap->GetGPUDescriptorHandleForHeapStart());
 	//passCbvHandle.Offset(passCbvIndex, mCbvSrvUavDescriptorSize);
@@ -314,6 +326,8 @@ void DemoApp::UpdateMaterialCBs(const GameTimer& gt)
 			matConstants.DiffuseAlbedo = mat->DiffuseAlbedo;
 			matConstants.FresnelR0 = mat->FresnelR0;
 			matConstants.Roughness = mat->Roughness;
+			matConstants.DiffuseMapIndex = mat->DiffuseSrvHeapIndex;
+			matConstants.DiffuseMapSlice = mat->DiffuseMapSlice;
 
 			currMaterialCB->CopyData(mat->MatCBIndex, matConstants);
 
@@ -335,7 +349,7 @@ void DemoApp::BuildRootSignature()
 
 	//// Create a single descriptor table of CBVs.
 	CD3DX12_DESCRIPTOR_RANGE texTable;
-	texTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+	texTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, mTexturePacker.ArrayCount(), 0);
 
 	//CD3DX12_DESCRIPTOR_RANGE cbvTable2;
 	//cbvTable2.Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 1);
@@ -533,30 +547,45 @@ void DemoApp::BuildGeometryFromFile()
 
 void DemoApp::BuildTextures()
 {
-	auto bricksTex = std::make_unique<Texture>();
-	bricksTex->Name = "bricksTex";
-	bricksTex->FileName = L"Textures/WoodCrate01.dds";
-	DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(), mCommandList.Get(), bricksTex->FileName.c_str(), bricksTex->Resource, bricksTex->UploadHeap);
-
-	auto stoneTex = std::make_unique<Texture>();
-	stoneTex->Name = "stoneTex";
-	stoneTex->FileName = L"Textures/stone.dds";
-	DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(), mCommandList.Get(), stoneTex->FileName.c_str(), stoneTex->Resource, stoneTex->UploadHeap);
-
-	auto tileTex = std::make_unique<Texture>();
-	tileTex->Name = "tileTex";
-	tileTex->FileName = L"Textures/tile.dds";
-	DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(), mCommandList.Get(), tileTex->FileName.c_str(), tileTex->Resource, tileTex->UploadHeap);
-
-	auto mirrorTex = std::make_unique<Texture>();
-	mirrorTex->Name = "mirrorTex";
-	mirrorTex->FileName = L"Textures/ice.dds";
-	DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(), mCommandList.Get(), mirrorTex->FileName.c_str(), mirrorTex->Resource, mirrorTex->UploadHeap);
-
-	mTextures[bricksTex->Name] = std::move(bricksTex);
-	mTextures[stoneTex->Name] = std::move(stoneTex);
-	mTextures[tileTex->Name] = std::move(tileTex);
-	mTextures[mirrorTex->Name] = std::move(mirrorTex);
+	std::vector<std::string> texNames =
+	{
+		"bricksTex",
+		"stoneTex",
+		"tileTex",
+		"mirrorTex"
+	};
+
+	std::vector<std::wstring> texFileNames =
+	{
+		L"Textures/WoodCrate01.dds",
+		L"Textures/stone.dds",
+		L"Textures/tile.dds",
+		L"Textures/ice.dds"
+	};
+
+	std::vector<Texture*> textures;
+	for (int i = 0; i < (int)texNames.size(); ++i)
+	{
+		auto tex = std::make_unique<Texture>();
+		tex->Name = texNames[i];
+		tex->FileName = texFileNames[i];
+		textures.push_back(tex.get());
+
+		mTextures[tex->Name] = std::move(tex);
+	}
+
+	// Only queues the loads; PackTextures records the uploads once they are ready.
+	mTextureLoader.Load(md3dDevice.Get(), textures);
+}
+
+void DemoApp::PackTextures()
+{
+	mTextureLoader.RecordUploads(mCommandList.Get());
+
+	// Textures of the same format and size share an array, so the scene binds
+	// one SRV per array instead of one per texture.
+	mTexturePacker.Pack(md3dDevice.Get(), mCommandList.Get(),
+		{ mTextures["bricksTex"].get(), mTextures["stoneTex"].get(), mTextures["tileTex"].get(), mTextures["mirrorTex"].get() });
 }
 
 void DemoApp::BuildRenderItems()
@@ -803,7 +832,7 @@ void DemoApp::BuildConstantBuffers()
 void DemoApp::BuildDescriptorHeaps()
 {
 	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-	srvHeapDesc.NumDescriptors = 4;
+	srvHeapDesc.NumDescriptors = mTexturePacker.ArrayCount();
 	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
 	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 
@@ -811,40 +840,8 @@ void DemoApp::BuildDescriptorHeaps()
 
 	auto hDescriptor = CD3DX12_CPU_DESCRIPTOR_HANDLE(mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
 
-	auto bricksTex = mTextures["bricksTex"]->Resource;
-	auto stoneTex = mTextures["stoneTex"]->Resource;
-	auto tileTex = mTextures["tileTex"]->Resource;
-	auto mirrorTex = mTextures["mirrorTex"]->Resource;
-
-	// create shader resource view
-	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc.Format = bricksTex->GetDesc().Format;
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-	srvDesc.Texture2D.MipLevels = bricksTex->GetDesc().MipLevels;
-	srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-	md3dDevice->CreateShaderResourceView(bricksTex.Get(), &srvDesc, hDescriptor);
-
-	hDescriptor.Offset(1, mCbvSrvUavDescriptorSize);
-
-	srvDesc.Format = stoneTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = stoneTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(stoneTex.Get(), &srvDesc, hDescriptor);
-
-	hDescriptor.Offset(1, mCbvSrvUavDescriptorSize);
-
-	srvDesc.Format = tileTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = tileTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(tileTex.Get(), &srvDesc, hDescriptor);
-
-
-	hDescriptor.Offset(1, mCbvSrvUavDescriptorSize);
-
-	srvDesc.Format = tileTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = mirrorTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(mirrorTex.Get(), &srvDesc, hDescriptor);
-
+	// create shader resource views, one per texture array
+	mTexturePacker.CreateSrvs(md3dDevice.Get(), hDescriptor, mCbvSrvUavDescriptorSize);
 }
 
 void DemoApp::BuildMaterials()
@@ -852,7 +849,7 @@ void DemoApp::BuildMaterials()
 	auto bricks0 = std::make_unique<Material>();
 	bricks0->Name = "bricks0";
 	bricks0->MatCBIndex = 0;
-	bricks0->DiffuseSrvHeapIndex = 0;
+	mTexturePacker.AssignDiffuseMap(*bricks0, "bricksTex");
 	//bricks0->DiffuseAlbedo = XMFLOAT4(Colors::ForestGreen);
 	bricks0->FresnelR0 = XMFLOAT3(0.02f, 0.02f, 0.02f);
 	bricks0->Roughness = 0.1f;
@@ -860,7 +857,7 @@ void DemoApp::BuildMaterials()
 	auto stone0 = std::make_unique<Material>();
 	stone0->Name = "stone0";
 	stone0->MatCBIndex = 1;
-	stone0->DiffuseSrvHeapIndex = 1;
+	mTexturePacker.AssignDiffuseMap(*stone0, "stoneTex");
 	stone0->DiffuseAlbedo = XMFLOAT4(Colors::LightSteelBlue);
 	stone0->FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05f);
 	stone0->Roughness = 0.3f;
@@ -868,7 +865,7 @@ void DemoApp::BuildMaterials()
 	auto tile0 = std::make_unique<Material>();
 	tile0->Name = "tile0";
 	tile0->MatCBIndex = 2;
-	tile0->DiffuseSrvHeapIndex = 2;
+	mTexturePacker.AssignDiffuseMap(*tile0, "tileTex");
 	tile0->DiffuseAlbedo = XMFLOAT4(Colors::LightGray);
 	tile0->FresnelR0 = XMFLOAT3(0.02f, 0.02f, 0.02f);
 	tile0->Roughness = 0.2f;
@@ -876,7 +873,7 @@ void DemoApp::BuildMaterials()
 	auto skullMat = std::make_unique<Material>();
 	skullMat->Name = "skullMat";
 	skullMat->MatCBIndex = 3;
-	skullMat->DiffuseSrvHeapIndex = 2;
+	mTexturePacker.AssignDiffuseMap(*skullMat, "tileTex");
 	skullMat->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	skullMat->FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05);
 	skullMat->Roughness = 0.3f;
@@ -884,7 +881,7 @@ void DemoApp::BuildMaterials()
 	auto mirrorMat = std::make_unique<Material>();
 	mirrorMat->Name = "mirror";
 	mirrorMat->MatCBIndex = 4;
-	mirrorMat->DiffuseSrvHeapIndex = 3;
+	mTexturePacker.AssignDiffuseMap(*mirrorMat, "mirrorTex");
 	mirrorMat->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 0.3f);
 	mirrorMat->FresnelR0 = XMFLOAT3(0.1f, 0.1f, 0.1f);
 	mirrorMat->Roughness = 0.5f;
@@ -907,8 +904,16 @@ void DemoApp::BuildPSO()
 		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
 	};
 
-	mvsByteCode = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_0");
-	mpsByteCode = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "PS", "ps_5_0");
+	// Indexing the array of texture arrays needs shader model 5.1.
+	std::string numTextureArrays = std::to_string(mTexturePacker.ArrayCount());
+	const D3D_SHADER_MACRO defines[] =
+	{
+		"NUM_TEXTURE_ARRAYS", numTextureArrays.c_str(),
+		NULL, NULL
+	};
+
+	mvsByteCode = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", defines, "VS", "vs_5_1");
+	mpsByteCode = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", defines, "PS", "ps_5_1");
 
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc;
 	ZeroMemory(&psoDesc, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
@@ -1037,10 +1042,6 @@ void DemoApp::DrawRenderItems(const std::vector<RenderItem*>& ritems)
 		mCommandList->IASetIndexBuffer(&ibv);
 		mCommandList->IASetPrimitiveTopology(Ritem->PrimitiveType);
 
-		CD3DX12_GPU_DESCRIPTOR_HANDLE tex(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-		tex.Offset(Ritem->Mat->DiffuseSrvHeapIndex, mCbvSrvUavDescriptorSize);
-
-		mCommandList->SetGraphicsRootDescriptorTable(0, tex);
 		//UINT cbvIndex = mCurrFrameResourceIndex * objCount + (UINT)Ritem->ObjCBIndex;
 		//auto cbvHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(mCbvHeap->GetGPUDescriptorHandleForHeapStart());
 		//cbvHandle.Offset(cbvIndex, mCbvSrvUavDescriptorSize);
@@ -4,6 +4,8 @@
 #include "Common/UploadBuffer.h"
 #include "Common/FrameResource.h"
 #include "Common/GeometryGenerator.h"
+#include "Common/TextureArrayPacker.h"
+#include "Common/TextureBatchLoader.h"
 
 #include <DirectXColors.h>
 using namespace DirectX;
@@ -54,6 +56,7 @@ protected:
 
 	void BuildGeometry();
 	void BuildTextures();
+	void PackTextures();
 	void BuildGeometryFromFile();
 	void BuildConstantBuffers();
 	void BuildDescriptorHeaps();
@@ -82,6 +85,8 @@ protected:
 
 	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mMeshGeos;
 	std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures;
+	TextureArrayPacker mTexturePacker;
+	TextureBatchLoader mTextureLoader;
 	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> mPSOs;
 
 	ComPtr<ID3D12RootSignature> mRootSignature = nullptr;
@@ -10,9 +10,14 @@
   #define NUM_SPOT_LIGHTS 0
 #endif
 
+#ifndef NUM_TEXTURE_ARRAYS
+  #define NUM_TEXTURE_ARRAYS 1
+#endif
+
 #include "LightingUtil.hlsl"
 
-Texture2D gDiffuseMap : register(t0);
+// One array per texture format and size; a material picks an array and a slice.
+Texture2DArray gDiffuseMaps[NUM_TEXTURE_ARRAYS] : register(t0);
 
 SamplerState gsamPointWrap : register(s0);
 
@@ -28,6 +33,10 @@ cbuffer cbMaterial : register(b1)
 	float3 gFresnelR0;
 	float gRoughness;
 	float4x4 gMatTransform;
+	uint gDiffuseMapIndex;
+	uint gDiffuseMapSlice;
+	uint gMatPad0;
+	uint gMatPad1;
 };
 
 cbuffer cbPass : register(b2)
@@ -89,7 +98,7 @@ float4 PS(VertexOut pin) : SV_Target
 	if (pin.TexC.x < 0.00000001 && pin.TexC.y < 0.00000001)
 		diffuseAlbedo = gDiffuseAlbedo;
 	else
-		diffuseAlbedo = gDiffuseMap.Sample(gsamPointWrap, pin.TexC) * gDiffuseAlbedo;
+		diffuseAlbedo = gDiffuseMaps[gDiffuseMapIndex].Sample(gsamPointWrap, float3(pin.TexC, gDiffuseMapSlice)) * gDiffuseAlbedo;
 
 	pin.NormalW = normalize(pin.NormalW);
 
@@ -6,6 +6,7 @@
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
+#include "../../Common/OcclusionCuller.h"
 #include "FrameResource.h"
 
 using Microsoft::WRL::ComPtr;
@@ -49,6 +50,9 @@ struct RenderItem
     UINT IndexCount = 0;
     UINT StartIndexLocation = 0;
     int BaseVertexLocation = 0;
+
+	// Cleared when the item is hidden behind the occluders this frame.
+	bool Visible = true;
 };
 
 enum class RenderLayer : int
@@ -87,6 +91,7 @@ private:
 	void UpdateMaterialCBs(const GameTimer& gt);
 	void UpdateMainPassCB(const GameTimer& gt);
 	void UpdateReflectedPassCB(const GameTimer& gt);
+	void UpdateOcclusion(const GameTimer& gt);
 
 	void LoadTextures();
     void BuildRootSignature();
@@ -138,6 +143,12 @@ private:
 
 	XMFLOAT3 mSkullTranslation = { 0.0f, 1.0f, -5.0f };
 
+	// The walls are rasterized on the CPU each frame, and the skulls' bounds are
+	// tested against them.  The skull in front of the wall is never hidden, but
+	// its reflection is drawn behind the wall and only shows where the mirror is.
+	OcclusionCuller mOcclusionCuller;
+	bool mOcclusionCullingEnabled = true;
+
 	XMFLOAT3 mEyePos = { 0.0f, 0.0f, 0.0f };
 	XMFLOAT4X4 mView = MathHelper::Identity4x4();
 	XMFLOAT4X4 mProj = MathHelper::Identity4x4();
@@ -230,6 +241,7 @@ void StencilApp::Update(const GameTimer& gt)
 {
     OnKeyboardInput(gt);
 	UpdateCamera(gt);
+	UpdateOcclusion(gt);
 
     // Cycle through the circular frame resource array.
     mCurrFrameResourceIndex = (mCurrFrameResourceIndex + 1) % gNumFrameResources;
@@ -403,6 +415,12 @@ void StencilApp::OnKeyboardInput(const GameTimer& gt)
 	// Don't let user move below ground plane.
 	mSkullTranslation.y = MathHelper::Max(mSkullTranslation.y, 0.0f);
 
+	if(GetAsyncKeyState('1') & 0x8000)
+		mOcclusionCullingEnabled = true;
+
+	if(GetAsyncKeyState('2') & 0x8000)
+		mOcclusionCullingEnabled = false;
+
 	// Update the new world matrix.
 	XMMATRIX skullRotate = XMMatrixRotationY(0.5f*MathHelper::Pi);
 	XMMATRIX skullScale = XMMatrixScaling(0.45f, 0.45f, 0.45f);
@@ -554,6 +572,49 @@ void StencilApp::UpdateReflectedPassCB(const GameTimer& gt)
 	currPassCB->CopyData(1, mReflectedPassCB);
 }
 
+void StencilApp::UpdateOcclusion(const GameTimer& gt)
+{
+	RenderItem* occludees[] = { mSkullRitem, mReflectedSkullRitem };
+
+	if(!mOcclusionCullingEnabled)
+	{
+		for(auto ri : occludees)
+			ri->Visible = true;
+
+		mMainWndCaption = L"Stencil Demo    occlusion culling off";
+		return;
+	}
+
+	XMMATRIX view = XMLoadFloat4x4(&mView);
+	XMMATRIX proj = XMLoadFloat4x4(&mProj);
+
+	mOcclusionCuller.BeginFrame(XMMatrixMultiply(view, proj));
+
+	// Rasterize the walls straight from the CPU copies of the room buffers.  The
+	// mirror is a separate submesh, so the hole it leaves stays open.
+	auto roomGeo = mGeometries["roomGeo"].get();
+	const SubmeshGeometry& walls = roomGeo->DrawArgs["wall"];
+	auto vertices = reinterpret_cast<const Vertex*>(roomGeo->VertexBufferCPU->GetBufferPointer());
+	auto indices = reinterpret_cast<const std::uint16_t*>(roomGeo->IndexBufferCPU->GetBufferPointer());
+	mOcclusionCuller.RenderOccluder(&vertices[walls.BaseVertexLocation].Pos, sizeof(Vertex),
+		indices + walls.StartIndexLocation, walls.IndexCount, XMMatrixIdentity());
+
+	for(auto ri : occludees)
+	{
+		BoundingBox boundsW;
+		ri->Geo->DrawArgs["skull"].Bounds.Transform(boundsW, XMLoadFloat4x4(&ri->World));
+
+		ri->Visible = !mOcclusionCuller.IsOccluded(boundsW);
+	}
+
+	const OcclusionStats& stats = mOcclusionCuller.GetStats();
+
+	std::wostringstream outs;
+	outs << L"Stencil Demo    " << stats.OccludeesCulled <<
+		L" of " << stats.OccludeesTested << L" skulls occluded";
+	mMainWndCaption = outs.str();
+}
+
 void StencilApp::LoadTextures()
 {
 	auto bricksTex = std::make_unique<Texture>();
@@ -836,6 +897,12 @@ void StencilApp::BuildSkullGeometry()
 	fin >> ignore >> tcount;
 	fin >> ignore >> ignore >> ignore >> ignore;
 	
+	XMFLOAT3 vMinf3(+MathHelper::Infinity, +MathHelper::Infinity, +MathHelper::Infinity);
+	XMFLOAT3 vMaxf3(-MathHelper::Infinity, -MathHelper::Infinity, -MathHelper::Infinity);
+
+	XMVECTOR vMin = XMLoadFloat3(&vMinf3);
+	XMVECTOR vMax = XMLoadFloat3(&vMaxf3);
+
 	std::vector<Vertex> vertices(vcount);
 	for(UINT i = 0; i < vcount; ++i)
 	{
@@ -844,8 +911,16 @@ void StencilApp::BuildSkullGeometry()
 
 		// Model does not have texture coordinates, so just zero them out.
 		vertices[i].TexC = { 0.0f, 0.0f };
+
+		XMVECTOR P = XMLoadFloat3(&vertices[i].Pos);
+		vMin = XMVectorMin(vMin, P);
+		vMax = XMVectorMax(vMax, P);
 	}
 
+	BoundingBox bounds;
+	XMStoreFloat3(&bounds.Center, 0.5f*(vMin + vMax));
+	XMStoreFloat3(&bounds.Extents, 0.5f*(vMax - vMin));
+
 	fin >> ignore;
 	fin >> ignore;
 	fin >> ignore;
@@ -890,6 +965,7 @@ void StencilApp::BuildSkullGeometry()
 	submesh.IndexCount = (UINT)indices.size();
 	submesh.StartIndexLocation = 0;
 	submesh.BaseVertexLocation = 0;
+	submesh.Bounds = bounds;
 
 	geo->DrawArgs["skull"] = submesh;
 
@@ -1184,6 +1260,9 @@ void StencilApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::
     {
         auto ri = ritems[i];
 
+		if(!ri->Visible)
+			continue;
+
         cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
         cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
         cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
@@ -9,7 +9,7 @@ struct InstanceData
 	DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4();
 	DirectX::XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
 	UINT MaterialIndex;
-	UINT InstancePad0;
+	UINT LodIndex;
 	UINT InstancePad1;
 	UINT InstancePad2;
 };
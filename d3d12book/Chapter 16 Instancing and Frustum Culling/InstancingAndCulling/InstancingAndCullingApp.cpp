@@ -7,6 +7,9 @@
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
 #include "../../Common/Camera.h"
+#include "../../Common/InstanceCuller.h"
+#include "../../Common/ThreadPool.h"
+#include "../../Common/TextureBatchLoader.h"
 #include "FrameResource.h"
 
 using Microsoft::WRL::ComPtr;
@@ -18,6 +21,11 @@ using namespace DirectX::PackedVector;
 
 const int gNumFrameResources = 3;
 
+// An instance whose bounding sphere projects to fewer pixels than LodPixelRadii[i]
+// uses mesh LOD i + 1.  The skull only has one mesh, so for now the index is just
+// passed on to the shader.
+const float gLodPixelRadii[] = { 48.0f, 16.0f };
+
 // Lightweight structure stores parameters to draw a shape.  This will
 // vary from app-to-app.
 struct RenderItem
@@ -50,6 +58,10 @@ struct RenderItem
 	BoundingBox Bounds;
 	std::vector<InstanceData> Instances;
 
+	// World space bounds of Instances, for culling.  Call Culler.SetWorld when
+	// an instance moves.
+	InstanceCuller Culler;
+
     // DrawIndexedInstanced parameters.
     UINT IndexCount = 0;
 	UINT InstanceCount = 0;
@@ -113,6 +125,8 @@ private:
 	std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders;
 	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> mPSOs;
 
+	TextureBatchLoader mTextureLoader;
+
     std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
 
 	// List of all the render items.
@@ -125,6 +139,17 @@ private:
 
 	bool mFrustumCullingEnabled = true;
 
+	// Reuse the previous frame's cull results and instance data when neither the
+	// camera nor the instances moved.  The coherent path is serial, so frames
+	// where the camera moves go through CullParallel instead.
+	bool mCoherentCullingEnabled = true;
+	std::vector<UINT> mVisibleInstances;
+	CullFrustum mLastCullFrustum;
+
+	// Drop instances smaller than this many pixels in radius after frustum culling.
+	bool mScreenSizeCullingEnabled = true;
+	float mMinPixelRadius = 2.0f;
+
 	BoundingFrustum mCamFrustum;
 
     PassConstants mMainPassCB;
@@ -184,9 +209,13 @@ bool InstancingAndCullingApp::Initialize()
  
 	LoadTextures();
     BuildRootSignature();
-	BuildDescriptorHeaps();
     BuildShadersAndInputLayout();
 	BuildSkullGeometry();
+
+	// The textures were loading on worker threads while the shaders compiled.
+	mTextureLoader.RecordUploads(mCommandList.Get());
+
+	BuildDescriptorHeaps();
 	BuildMaterials();
     BuildRenderItems();
     BuildFrameResources();
@@ -355,6 +384,18 @@ void InstancingAndCullingApp::OnKeyboardInput(const GameTimer& gt)
 	if(GetAsyncKeyState('2') & 0x8000)
 		mFrustumCullingEnabled = false;
 
+	if(GetAsyncKeyState('3') & 0x8000)
+		mCoherentCullingEnabled = true;
+
+	if(GetAsyncKeyState('4') & 0x8000)
+		mCoherentCullingEnabled = false;
+
+	if(GetAsyncKeyState('5') & 0x8000)
+		mScreenSizeCullingEnabled = true;
+
+	if(GetAsyncKeyState('6') & 0x8000)
+		mScreenSizeCullingEnabled = false;
+
 	mCamera.UpdateViewMatrix();
 }
  
@@ -368,39 +409,98 @@ void InstancingAndCullingApp::UpdateInstanceData(const GameTimer& gt)
 	XMMATRIX view = mCamera.GetView();
 	XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
 
+	// Transform the camera frustum to world space once; the instance bounds are
+	// already in world space.
+	BoundingFrustum worldSpaceFrustum;
+	mCamFrustum.Transform(worldSpaceFrustum, invView);
+	CullFrustum cullFrustum(worldSpaceFrustum);
+
+	// The projected size also picks the LOD, so set it up even when the
+	// screen-size test itself is off.
+	cullFrustum.SetScreenSizeCulling(mCamera.GetPosition3f(), mCamera.GetLook3f(),
+		mCamera.GetProj4x4f()._22, (float)mClientHeight,
+		mScreenSizeCullingEnabled ? mMinPixelRadius : 0.0f);
+
+	// The coherence caches only pay off while the camera is still; a moving
+	// camera retests everything, which the parallel path does faster.
+	bool frustumChanged = memcmp(&cullFrustum, &mLastCullFrustum, sizeof(CullFrustum)) != 0;
+	bool useCoherentCulling = mFrustumCullingEnabled && mCoherentCullingEnabled && !frustumChanged;
+	mLastCullFrustum = cullFrustum;
+
+	ThreadPool& threadPool = ThreadPool::Default();
+
 	auto currInstanceBuffer = mCurrFrameResource->InstanceBuffer.get();
 	for(auto& e : mAllRitems)
 	{
 		const auto& instanceData = e->Instances;
 
-		int visibleInstanceCount = 0;
-
-		for(UINT i = 0; i < (UINT)instanceData.size(); ++i)
+		// Writes instance src to slot dst of the structured buffer.  Every slot
+		// is written by exactly one thread, so this runs on the workers.
+		auto writeInstance = [&](UINT src, UINT dst)
 		{
-			XMMATRIX world = XMLoadFloat4x4(&instanceData[i].World);
-			XMMATRIX texTransform = XMLoadFloat4x4(&instanceData[i].TexTransform);
+			XMMATRIX world = XMLoadFloat4x4(&instanceData[src].World);
+			XMMATRIX texTransform = XMLoadFloat4x4(&instanceData[src].TexTransform);
 
-			XMMATRIX invWorld = XMMatrixInverse(&XMMatrixDeterminant(world), world);
+			InstanceData data;
+			XMStoreFloat4x4(&data.World, XMMatrixTranspose(world));
+			XMStoreFloat4x4(&data.TexTransform, XMMatrixTranspose(texTransform));
+			data.MaterialIndex = instanceData[src].MaterialIndex;
 
-			// View space to the object's local space.
-			XMMATRIX viewToLocal = XMMatrixMultiply(invView, invWorld);
- 
-			// Transform the camera frustum from view space to the object's local space.
-			BoundingFrustum localSpaceFrustum;
-			mCamFrustum.Transform(localSpaceFrustum, viewToLocal);
+			float pixelRadius = e->Culler.GetPixelRadius(cullFrustum, src);
+			data.LodIndex = 0;
+			while(data.LodIndex < _countof(gLodPixelRadii) && pixelRadius < gLodPixelRadii[data.LodIndex])
+				++data.LodIndex;
+
+			currInstanceBuffer->CopyData(dst, data);
+		};
+
+		UINT visibleInstanceCount = 0;
+		if(useCoherentCulling)
+		{
+			mVisibleInstances.clear();
+			bool unchanged = e->Culler.CullCoherent(cullFrustum, mVisibleInstances);
+			visibleInstanceCount = (UINT)mVisibleInstances.size();
+
+			// Each frame resource has its own instance buffer, so a new result
+			// has to be written gNumFrameResources times before we can stop.
+			if(!unchanged)
+				e->NumFramesDirty = gNumFrameResources;
 
-			// Perform the box/frustum intersection test in local space.
-			if((localSpaceFrustum.Contains(e->Bounds) != DirectX::DISJOINT) || (mFrustumCullingEnabled==false))
+			if(e->NumFramesDirty > 0)
 			{
-				InstanceData data;
-				XMStoreFloat4x4(&data.World, XMMatrixTranspose(world));
-				XMStoreFloat4x4(&data.TexTransform, XMMatrixTranspose(texTransform));
-				data.MaterialIndex = instanceData[i].MaterialIndex;
+				threadPool.ParallelFor(visibleInstanceCount, 1024, [&](UINT begin, UINT end, UINT threadIndex)
+				{
+					for(UINT i = begin; i < end; ++i)
+						writeInstance(mVisibleInstances[i], i);
+				});
 
-				// Write the instance data to structured buffer for the visible objects.
-				currInstanceBuffer->CopyData(visibleInstanceCount++, data);
+				e->NumFramesDirty--;
 			}
 		}
+		else if(mFrustumCullingEnabled)
+		{
+			// Each chunk of survivors lands at its prefix-sum offset.
+			visibleInstanceCount = e->Culler.CullParallel(cullFrustum, threadPool,
+				[&](const UINT* indices, UINT count, UINT firstOutput)
+			{
+				for(UINT i = 0; i < count; ++i)
+					writeInstance(indices[i], firstOutput + i);
+			});
+		}
+		else
+		{
+			visibleInstanceCount = (UINT)instanceData.size();
+			threadPool.ParallelFor(visibleInstanceCount, 1024, [&](UINT begin, UINT end, UINT threadIndex)
+			{
+				for(UINT i = begin; i < end; ++i)
+					writeInstance(i, i);
+			});
+		}
+
+		// The buffers now disagree with the coherent cache; rewrite them all the
+		// next time it is used.
+		if(!useCoherentCulling)
+			e->NumFramesDirty = gNumFrameResources;
 
 		e->InstanceCount = visibleInstanceCount;
 
@@ -477,62 +577,41 @@ void InstancingAndCullingApp::UpdateMainPassCB(const GameTimer& gt)
 
 void InstancingAndCullingApp::LoadTextures()
 {
-	auto bricksTex = std::make_unique<Texture>();
-	bricksTex->Name = "bricksTex";
-	bricksTex->Filename = L"../../Textures/bricks.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), bricksTex->Filename.c_str(),
-		bricksTex->Resource, bricksTex->UploadHeap));
-
-	auto stoneTex = std::make_unique<Texture>();
-	stoneTex->Name = "stoneTex";
-	stoneTex->Filename = L"../../Textures/stone.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), stoneTex->Filename.c_str(),
-		stoneTex->Resource, stoneTex->UploadHeap));
-
-	auto tileTex = std::make_unique<Texture>();
-	tileTex->Name = "tileTex";
-	tileTex->Filename = L"../../Textures/tile.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), tileTex->Filename.c_str(),
-		tileTex->Resource, tileTex->UploadHeap));
-
-	auto crateTex = std::make_unique<Texture>();
-	crateTex->Name = "crateTex";
-	crateTex->Filename = L"../../Textures/WoodCrate01.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), crateTex->Filename.c_str(),
-		crateTex->Resource, crateTex->UploadHeap));
-
-	auto iceTex = std::make_unique<Texture>();
-	iceTex->Name = "iceTex";
-	iceTex->Filename = L"../../Textures/ice.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), iceTex->Filename.c_str(),
-		iceTex->Resource, iceTex->UploadHeap));
-
-	auto grassTex = std::make_unique<Texture>();
-	grassTex->Name = "grassTex";
-	grassTex->Filename = L"../../Textures/grass.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), grassTex->Filename.c_str(),
-		grassTex->Resource, grassTex->UploadHeap));
-
-	auto defaultTex = std::make_unique<Texture>();
-	defaultTex->Name = "defaultTex";
-	defaultTex->Filename = L"../../Textures/white1x1.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), defaultTex->Filename.c_str(),
-		defaultTex->Resource, defaultTex->UploadHeap));
-
-	mTextures[bricksTex->Name] = std::move(bricksTex);
-	mTextures[stoneTex->Name] = std::move(stoneTex);
-	mTextures[tileTex->Name] = std::move(tileTex);
-	mTextures[crateTex->Name] = std::move(crateTex);
-	mTextures[iceTex->Name] = std::move(iceTex);
-	mTextures[grassTex->Name] = std::move(grassTex);
-	mTextures[defaultTex->Name] = std::move(defaultTex);
+	std::vector<std::string> texNames =
+	{
+		"bricksTex",
+		"stoneTex",
+		"tileTex",
+		"crateTex",
+		"iceTex",
+		"grassTex",
+		"defaultTex"
+	};
+
+	std::vector<std::wstring> texFilenames =
+	{
+		L"../../Textures/bricks.dds",
+		L"../../Textures/stone.dds",
+		L"../../Textures/tile.dds",
+		L"../../Textures/WoodCrate01.dds",
+		L"../../Textures/ice.dds",
+		L"../../Textures/grass.dds",
+		L"../../Textures/white1x1.dds"
+	};
+
+	std::vector<Texture*> textures;
+	for(int i = 0; i < (int)texNames.size(); ++i)
+	{
+		auto texMap = std::make_unique<Texture>();
+		texMap->Name = texNames[i];
+		texMap->Filename = texFilenames[i];
+		textures.push_back(texMap.get());
+
+		mTextures[texMap->Name] = std::move(texMap);
+	}
+
+	// Only queues the loads; Initialize records the uploads once they are ready.
+	mTextureLoader.Load(md3dDevice.Get(), textures);
 }
 
 void InstancingAndCullingApp::BuildRootSignature()
@@ -939,6 +1018,13 @@ void InstancingAndCullingApp::BuildRenderItems()
 	}
 
 
+	for(auto& inst : skullRitem->Instances)
+		skullRitem->Culler.AddInstance(skullRitem->Bounds, XMLoadFloat4x4(&inst.World));
+
+	// The hierarchy keeps the cull cost proportional to what is on screen when
+	// the grid is made much larger.
+	skullRitem->Culler.BuildHierarchy();
+
 	mAllRitems.push_back(std::move(skullRitem));
 	
 	// All the render items are opaque.
@@ -23,7 +23,7 @@ struct InstanceData
 	float4x4 World;
 	float4x4 TexTransform;
 	uint     MaterialIndex;
-	uint     InstPad0;
+	uint     LodIndex;
 	uint     InstPad1;
 	uint     InstPad2;
 };
@@ -7,6 +7,7 @@
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
 #include "../../Common/Camera.h"
+#include "../../Common/SceneRayQuery.h"
 #include "FrameResource.h"
 
 using Microsoft::WRL::ComPtr;
@@ -100,6 +101,7 @@ private:
     void BuildRenderItems();
     void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
 	void Pick(int sx, int sy);
+	bool PickTriangleBruteForce(const RenderItem* ri, FXMVECTOR rayOrigin, FXMVECTOR rayDir, float& tmin, UINT& triangle);
 
 	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> GetStaticSamplers();
 
@@ -131,6 +133,10 @@ private:
 
 	RenderItem* mPickedRitem = nullptr;
 
+	// Pickable render items; RayHit::Instance indexes mRayQueryRitems.
+	SceneRayQuery mRayQuery;
+	std::vector<RenderItem*> mRayQueryRitems;
+
     PassConstants mMainPassCB;
 
 	Camera mCamera;
@@ -651,6 +657,10 @@ void PickingApp::BuildCarGeometry()
 
 	geo->DrawArgs["car"] = submesh;
 
+	geo->TriangleBvhs["car"].Build(geo->VertexBufferCPU->GetBufferPointer(), geo->VertexByteStride,
+		(std::uint32_t*)geo->IndexBufferCPU->GetBufferPointer(),
+		submesh.StartIndexLocation, submesh.IndexCount, submesh.BaseVertexLocation);
+
 	mGeometries[geo->Name] = std::move(geo);
 }
 
@@ -762,6 +772,9 @@ void PickingApp::BuildRenderItems()
 	carRitem->BaseVertexLocation = carRitem->Geo->DrawArgs["car"].BaseVertexLocation;
 	mRitemLayer[(int)RenderLayer::Opaque].push_back(carRitem.get());
 
+	mRayQuery.AddInstance(&carRitem->Geo->TriangleBvhs["car"], XMLoadFloat4x4(&carRitem->World));
+	mRayQueryRitems.push_back(carRitem.get());
+
 	auto pickedRitem = std::make_unique<RenderItem>();
 	pickedRitem->World = MathHelper::Identity4x4();
 	pickedRitem->TexTransform = MathHelper::Identity4x4();
@@ -886,79 +899,117 @@ void PickingApp::Pick(int sx, int sy)
 	// Assume nothing is picked to start, so the picked render-item is invisible.
 	mPickedRitem->Visible = false;
 
-	// Check if we picked an opaque render item.  A real app might keep a separate "picking list"
-	// of objects that can be selected.   
-	for(auto ri : mRitemLayer[(int)RenderLayer::Opaque])
-	{
-		auto geo = ri->Geo;
+	// The ray query takes the ray in world space and moves it into the local
+	// space of each object it may hit.
+	RayQuery query;
+	XMStoreFloat3(&query.Origin, XMVector3TransformCoord(rayOrigin, invView));
+	XMStoreFloat3(&query.Direction, XMVector3Normalize(XMVector3TransformNormal(rayDir, invView)));
 
-		// Skip invisible render-items.
-		if(ri->Visible == false)
-			continue;
+	// Time the query against testing every triangle of every object whose
+	// bounding box the ray hits, and show both in the window caption.
+	__int64 countsPerSec = 0;
+	__int64 t0 = 0, t1 = 0, t2 = 0;
+	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
+
+	QueryPerformanceCounter((LARGE_INTEGER*)&t0);
+
+	RayHit hit;
+	mRayQuery.ClosestHit(&query, 1, &hit, ThreadPool::Default());
 
+	QueryPerformanceCounter((LARGE_INTEGER*)&t1);
+
+	UINT triangleCount = 0;
+	for(auto ri : mRitemLayer[(int)RenderLayer::Opaque])
+	{
 		XMMATRIX W = XMLoadFloat4x4(&ri->World);
 		XMMATRIX invWorld = XMMatrixInverse(&XMMatrixDeterminant(W), W);
 
 		// Tranform ray to vi space of Mesh.
 		XMMATRIX toLocal = XMMatrixMultiply(invView, invWorld);
 
-		rayOrigin = XMVector3TransformCoord(rayOrigin, toLocal);
-		rayDir = XMVector3TransformNormal(rayDir, toLocal);
+		XMVECTOR localOrigin = XMVector3TransformCoord(rayOrigin, toLocal);
+		XMVECTOR localDir = XMVector3Normalize(XMVector3TransformNormal(rayDir, toLocal));
 
-		// Make the ray direction unit length for the intersection tests.
-		rayDir = XMVector3Normalize(rayDir);
-
-		// If we hit the bounding box of the Mesh, then we might have picked a Mesh triangle,
-		// so do the ray/triangle tests.
-		//
-		// If we did not hit the bounding box, then it is impossible that we hit 
-		// the Mesh, so do not waste effort doing ray/triangle tests.
 		float tmin = 0.0f;
-		if(ri->Bounds.Intersects(rayOrigin, rayDir, tmin))
+		if(ri->Bounds.Intersects(localOrigin, localDir, tmin))
 		{
-			// NOTE: For the demo, we know what to cast the vertex/index data to.  If we were mixing
-			// formats, some metadata would be needed to figure out what to cast it to.
-			auto vertices = (Vertex*)geo->VertexBufferCPU->GetBufferPointer();
-			auto indices = (std::uint32_t*)geo->IndexBufferCPU->GetBufferPointer();
-			UINT triCount = ri->IndexCount / 3;
-
-			// Find the nearest ray/triangle intersection.
-			tmin = MathHelper::Infinity;
-			for(UINT i = 0; i < triCount; ++i)
-			{
-				// Indices for this triangle.
-				UINT i0 = indices[i * 3 + 0];
-				UINT i1 = indices[i * 3 + 1];
-				UINT i2 = indices[i * 3 + 2];
-
-				// Vertices for this triangle.
-				XMVECTOR v0 = XMLoadFloat3(&vertices[i0].Pos);
-				XMVECTOR v1 = XMLoadFloat3(&vertices[i1].Pos);
-				XMVECTOR v2 = XMLoadFloat3(&vertices[i2].Pos);
-
-				// We have to iterate over all the triangles in order to find the nearest intersection.
-				float t = 0.0f;
-				if(TriangleTests::Intersects(rayOrigin, rayDir, v0, v1, v2, t))
-				{
-					if(t < tmin)
-					{
-						// This is the new nearest picked triangle.
-						tmin = t;
-						UINT pickedTriangle = i;
-
-						mPickedRitem->Visible = true;
-						mPickedRitem->IndexCount = 3;
-						mPickedRitem->BaseVertexLocation = 0;
-
-						// Picked render item needs same world matrix as object picked.
-						mPickedRitem->World = ri->World;
-						mPickedRitem->NumFramesDirty = gNumFrameResources;
-
-						// Offset to the picked triangle in the mesh index buffer.
-						mPickedRitem->StartIndexLocation = 3 * pickedTriangle;
-					}
-				}
-			}
+			UINT triangle = 0;
+			PickTriangleBruteForce(ri, localOrigin, localDir, tmin, triangle);
 		}
+
+		triangleCount += ri->IndexCount / 3;
 	}
+
+	QueryPerformanceCounter((LARGE_INTEGER*)&t2);
+
+	double microsecondsPerCount = 1000000.0 / (double)countsPerSec;
+
+	std::wostringstream outs;
+	outs.precision(3);
+	outs << L"Picking Demo" <<
+		L"    ray query: " << (t1 - t0)*microsecondsPerCount << L" us" <<
+		L"    brute force: " << (t2 - t1)*microsecondsPerCount << L" us" <<
+		L" (" << triangleCount << L" triangles)";
+	mMainWndCaption = outs.str();
+
+	if(hit.Instance != RayHit::NoHit)
+	{
+		RenderItem* ri = mRayQueryRitems[hit.Instance];
+
+		mPickedRitem->Visible = true;
+		mPickedRitem->IndexCount = 3;
+		mPickedRitem->BaseVertexLocation = 0;
+
+		// Picked render item needs same world matrix as object picked.
+		mPickedRitem->World = ri->World;
+		mPickedRitem->NumFramesDirty = gNumFrameResources;
+
+		// Offset to the picked triangle in the mesh index buffer.
+		mPickedRitem->StartIndexLocation = 3 * hit.Triangle;
+	}
+}
+
+bool PickingApp::PickTriangleBruteForce(const RenderItem* ri, FXMVECTOR rayOrigin, FXMVECTOR rayDir, float& tmin, UINT& triangle)
+{
+	auto geo = ri->Geo;
+
+	// NOTE: For the demo, we know what to cast the vertex/index data to.  If we were mixing
+	// formats, some metadata would be needed to figure out what to cast it to.
+	auto vertices = (Vertex*)geo->VertexBufferCPU->GetBufferPointer();
+	auto indices = (std::uint32_t*)geo->IndexBufferCPU->GetBufferPointer();
+	UINT triCount = ri->IndexCount / 3;
+
+	// Find the nearest ray/triangle intersection, testing four triangles at a time.
+	bool hit = false;
+	tmin = MathHelper::Infinity;
+	for(UINT first = 0; first < triCount; first += 4)
+	{
+		TrianglePacket packet;
+		packet.Clear();
+
+		UINT packetCount = MathHelper::Min(4u, triCount - first);
+		for(UINT lane = 0; lane < packetCount; ++lane)
+		{
+			// Indices for this triangle.
+			UINT i0 = indices[(first + lane) * 3 + 0];
+			UINT i1 = indices[(first + lane) * 3 + 1];
+			UINT i2 = indices[(first + lane) * 3 + 2];
+
+			packet.Set(lane,
+				XMLoadFloat3(&vertices[i0].Pos),
+				XMLoadFloat3(&vertices[i1].Pos),
+				XMLoadFloat3(&vertices[i2].Pos));
+		}
+
+		// We have to iterate over all the triangles in order to find the nearest intersection.
+		UINT lane = 0;
+		if(IntersectTrianglePacket(rayOrigin, rayDir, packet, tmin, lane))
+		{
+			// This is the new nearest picked triangle.
+			triangle = first + lane;
+			hit = true;
+		}
+	}
+
+	return hit;
 }
\ No newline at end of file
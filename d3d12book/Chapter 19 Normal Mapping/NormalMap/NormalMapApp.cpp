@@ -7,6 +7,7 @@
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
 #include "../../Common/Camera.h"
+#include "../../Common/TextureBatchLoader.h"
 #include "FrameResource.h"
 
 using Microsoft::WRL::ComPtr;
@@ -116,6 +117,8 @@ private:
 	std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders;
 	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> mPSOs;
 
+	TextureBatchLoader mTextureLoader;
+
     std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
  
 	// List of all the render items.
@@ -183,9 +186,13 @@ bool NormalMapApp::Initialize()
  
 	LoadTextures();
     BuildRootSignature();
-	BuildDescriptorHeaps();
     BuildShadersAndInputLayout();
     BuildShapeGeometry();
+
+	// The textures were loading on worker threads while the shaders compiled.
+	mTextureLoader.RecordUploads(mCommandList.Get());
+
+	BuildDescriptorHeaps();
 	BuildMaterials();
     BuildRenderItems();
     BuildFrameResources();
@@ -480,17 +487,19 @@ void NormalMapApp::LoadTextures()
 		L"../../Textures/snowcube1024.dds"
 	};
 	
+	std::vector<Texture*> textures;
 	for(int i = 0; i < (int)texNames.size(); ++i)
 	{
 		auto texMap = std::make_unique<Texture>();
 		texMap->Name = texNames[i];
 		texMap->Filename = texFilenames[i];
-		ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-			mCommandList.Get(), texMap->Filename.c_str(),
-			texMap->Resource, texMap->UploadHeap));
-			
+		textures.push_back(texMap.get());
+
 		mTextures[texMap->Name] = std::move(texMap);
-	}		
+	}
+
+	// Only queues the loads; Initialize records the uploads once they are ready.
+	mTextureLoader.Load(md3dDevice.Get(), textures);
 }
 
 void NormalMapApp::BuildRootSignature()
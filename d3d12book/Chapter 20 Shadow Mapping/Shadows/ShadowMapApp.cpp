@@ -7,6 +7,7 @@
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
 #include "../../Common/Camera.h"
+#include "../../Common/ShadowCasterCuller.h"
 #include "FrameResource.h"
 #include "ShadowMap.h"
 
@@ -49,6 +50,9 @@ struct RenderItem
     UINT IndexCount = 0;
     UINT StartIndexLocation = 0;
     int BaseVertexLocation = 0;
+
+	// Local space bounds, for shadow caster culling.
+	BoundingBox Bounds;
 };
 
 enum class RenderLayer : int
@@ -84,6 +88,7 @@ private:
 	void UpdateObjectCBs(const GameTimer& gt);
 	void UpdateMaterialBuffer(const GameTimer& gt);
     void UpdateShadowTransform(const GameTimer& gt);
+    void UpdateShadowCasters(const GameTimer& gt);
 	void UpdateMainPassCB(const GameTimer& gt);
     void UpdateShadowPassCB(const GameTimer& gt);
 
@@ -150,6 +155,11 @@ private:
     XMFLOAT4X4 mLightProj = MathHelper::Identity4x4();
     XMFLOAT4X4 mShadowTransform = MathHelper::Identity4x4();
 
+    // Opaque items that can shadow something the camera sees; only these are
+    // drawn into the shadow map.
+    ShadowCasterCuller mShadowCasterCuller;
+    std::vector<RenderItem*> mShadowCasters;
+
     float mLightRotationAngle = 0.0f;
     XMFLOAT3 mBaseLightDirections[3] = {
         XMFLOAT3(0.57735f, -0.57735f, 0.57735f),
@@ -300,6 +310,7 @@ void ShadowMapApp::Update(const GameTimer& gt)
 	UpdateObjectCBs(gt);
 	UpdateMaterialBuffer(gt);
     UpdateShadowTransform(gt);
+    UpdateShadowCasters(gt);
 	UpdateMainPassCB(gt);
     UpdateShadowPassCB(gt);
 }
@@ -541,6 +552,42 @@ void ShadowMapApp::UpdateShadowTransform(const GameTimer& gt)
     XMStoreFloat4x4(&mShadowTransform, S);
 }
 
+void ShadowMapApp::UpdateShadowCasters(const GameTimer& gt)
+{
+    XMMATRIX view = mCamera.GetView();
+    XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
+
+    BoundingFrustum cameraFrustumW;
+    BoundingFrustum::CreateFromMatrix(cameraFrustumW, mCamera.GetProj());
+    cameraFrustumW.Transform(cameraFrustumW, invView);
+
+    XMMATRIX lightView = XMLoadFloat4x4(&mLightView);
+    XMMATRIX lightProj = XMLoadFloat4x4(&mLightProj);
+    mShadowCasterCuller.BeginFrame(lightView, lightProj, cameraFrustumW);
+
+    // Every opaque item both receives and casts shadows.
+    const auto& opaque = mRitemLayer[(int)RenderLayer::Opaque];
+
+    std::vector<BoundingBox> boundsW(opaque.size());
+    for(size_t i = 0; i < opaque.size(); ++i)
+    {
+        opaque[i]->Bounds.Transform(boundsW[i], XMLoadFloat4x4(&opaque[i]->World));
+        mShadowCasterCuller.AddReceiver(boundsW[i]);
+    }
+
+    mShadowCasters.clear();
+    for(size_t i = 0; i < opaque.size(); ++i)
+    {
+        if(mShadowCasterCuller.IsCasterNeeded(boundsW[i]))
+            mShadowCasters.push_back(opaque[i]);
+    }
+
+    std::wostringstream outs;
+    outs << L"Shadows Demo    " << mShadowCasters.size() <<
+        L" of " << opaque.size() << L" shadow casters drawn";
+    mMainWndCaption = outs.str();
+}
+
 void ShadowMapApp::UpdateMainPassCB(const GameTimer& gt)
 {
 	XMMATRIX view = mCamera.GetView();
@@ -854,6 +901,12 @@ void ShadowMapApp::BuildShapeGeometry()
     quadSubmesh.StartIndexLocation = quadIndexOffset;
     quadSubmesh.BaseVertexLocation = quadVertexOffset;
 
+    const size_t stride = sizeof(GeometryGenerator::Vertex);
+    BoundingBox::CreateFromPoints(boxSubmesh.Bounds, box.Vertices.size(), &box.Vertices[0].Position, stride);
+    BoundingBox::CreateFromPoints(gridSubmesh.Bounds, grid.Vertices.size(), &grid.Vertices[0].Position, stride);
+    BoundingBox::CreateFromPoints(sphereSubmesh.Bounds, sphere.Vertices.size(), &sphere.Vertices[0].Position, stride);
+    BoundingBox::CreateFromPoints(cylinderSubmesh.Bounds, cylinder.Vertices.size(), &cylinder.Vertices[0].Position, stride);
+
 	//
 	// Extract the vertex elements we are interested in and pack the
 	// vertices of all the meshes into one vertex buffer.
@@ -1263,6 +1316,7 @@ void ShadowMapApp::BuildRenderItems()
 	boxRitem->IndexCount = boxRitem->Geo->DrawArgs["box"].IndexCount;
 	boxRitem->StartIndexLocation = boxRitem->Geo->DrawArgs["box"].StartIndexLocation;
 	boxRitem->BaseVertexLocation = boxRitem->Geo->DrawArgs["box"].BaseVertexLocation;
+	boxRitem->Bounds = boxRitem->Geo->DrawArgs["box"].Bounds;
 
 	mRitemLayer[(int)RenderLayer::Opaque].push_back(boxRitem.get());
 	mAllRitems.push_back(std::move(boxRitem));
@@ -1277,6 +1331,7 @@ void ShadowMapApp::BuildRenderItems()
     skullRitem->IndexCount = skullRitem->Geo->DrawArgs["skull"].IndexCount;
     skullRitem->StartIndexLocation = skullRitem->Geo->DrawArgs["skull"].StartIndexLocation;
     skullRitem->BaseVertexLocation = skullRitem->Geo->DrawArgs["skull"].BaseVertexLocation;
+    skullRitem->Bounds = skullRitem->Geo->DrawArgs["skull"].Bounds;
 
     mRitemLayer[(int)RenderLayer::Opaque].push_back(skullRitem.get());
     mAllRitems.push_back(std::move(skullRitem));
@@ -1291,6 +1346,7 @@ void ShadowMapApp::BuildRenderItems()
     gridRitem->IndexCount = gridRitem->Geo->DrawArgs["grid"].IndexCount;
     gridRitem->StartIndexLocation = gridRitem->Geo->DrawArgs["grid"].StartIndexLocation;
     gridRitem->BaseVertexLocation = gridRitem->Geo->DrawArgs["grid"].BaseVertexLocation;
+    gridRitem->Bounds = gridRitem->Geo->DrawArgs["grid"].Bounds;
 
 	mRitemLayer[(int)RenderLayer::Opaque].push_back(gridRitem.get());
 	mAllRitems.push_back(std::move(gridRitem));
@@ -1319,6 +1375,7 @@ void ShadowMapApp::BuildRenderItems()
 		leftCylRitem->IndexCount = leftCylRitem->Geo->DrawArgs["cylinder"].IndexCount;
 		leftCylRitem->StartIndexLocation = leftCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
 		leftCylRitem->BaseVertexLocation = leftCylRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
+		leftCylRitem->Bounds = leftCylRitem->Geo->DrawArgs["cylinder"].Bounds;
 
 		XMStoreFloat4x4(&rightCylRitem->World, leftCylWorld);
 		XMStoreFloat4x4(&rightCylRitem->TexTransform, brickTexTransform);
@@ -1329,6 +1386,7 @@ void ShadowMapApp::BuildRenderItems()
 		rightCylRitem->IndexCount = rightCylRitem->Geo->DrawArgs["cylinder"].IndexCount;
 		rightCylRitem->StartIndexLocation = rightCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
 		rightCylRitem->BaseVertexLocation = rightCylRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
+		rightCylRitem->Bounds = rightCylRitem->Geo->DrawArgs["cylinder"].Bounds;
 
 		XMStoreFloat4x4(&leftSphereRitem->World, leftSphereWorld);
 		leftSphereRitem->TexTransform = MathHelper::Identity4x4();
@@ -1339,6 +1397,7 @@ void ShadowMapApp::BuildRenderItems()
 		leftSphereRitem->IndexCount = leftSphereRitem->Geo->DrawArgs["sphere"].IndexCount;
 		leftSphereRitem->StartIndexLocation = leftSphereRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
 		leftSphereRitem->BaseVertexLocation = leftSphereRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
+		leftSphereRitem->Bounds = leftSphereRitem->Geo->DrawArgs["sphere"].Bounds;
 
 		XMStoreFloat4x4(&rightSphereRitem->World, rightSphereWorld);
 		rightSphereRitem->TexTransform = MathHelper::Identity4x4();
@@ -1349,6 +1408,7 @@ void ShadowMapApp::BuildRenderItems()
 		rightSphereRitem->IndexCount = rightSphereRitem->Geo->DrawArgs["sphere"].IndexCount;
 		rightSphereRitem->StartIndexLocation = rightSphereRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
 		rightSphereRitem->BaseVertexLocation = rightSphereRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
+		rightSphereRitem->Bounds = rightSphereRitem->Geo->DrawArgs["sphere"].Bounds;
 
 		mRitemLayer[(int)RenderLayer::Opaque].push_back(leftCylRitem.get());
 		mRitemLayer[(int)RenderLayer::Opaque].push_back(rightCylRitem.get());
@@ -1412,7 +1472,7 @@ void ShadowMapApp::DrawSceneToShadowMap()
 
     mCommandList->SetPipelineState(mPSOs["shadow_opaque"].Get());
 
-    DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
+    DrawRenderItems(mCommandList.Get(), mShadowCasters);
 
     // Change back to GENERIC_READ so we can read the texture in a shader.
     mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mShadowMap->Resource(),
@@ -0,0 +1,294 @@
+//***************************************************************************************
+// AnimationBenchmark.cpp
+//***************************************************************************************
+
+#include "AnimationBenchmark.h"
+#include "CrowdAnimator.h"
+#include "CpuSkinner.h"
+#include <chrono>
+#include "LoadM3d.h"
+
+namespace
+{
+	void BenchmarkCrowd(const SkinnedData& skinnedInfo, const std::string& clipName, std::ostream& out)
+	{
+		ThreadPool& pool = ThreadPool::Default();
+
+		out << "Crowd palette evaluation (" << skinnedInfo.BoneCount() << " bones, "
+			<< pool.ThreadCount() << " threads)" << std::endl;
+
+		const UINT crowdSizes[] = { 100, 1000, 10000 };
+		for(UINT instanceCount : crowdSizes)
+		{
+			// Keep the total work per run roughly constant.
+			UINT frameCount = MathHelper::Max(100000u / instanceCount, 1u);
+
+			double charsPerMs = CrowdAnimator::Benchmark(skinnedInfo, clipName, instanceCount, frameCount, &pool);
+
+			out << "  " << instanceCount << " instances: " << charsPerMs << " characters/ms" << std::endl;
+		}
+	}
+
+	void BenchmarkBakedClips(SkinnedData& skinnedInfo, const std::string& clipName, std::ostream& out)
+	{
+		const float sampleRate = 30.0f;
+		const std::size_t memoryBudget = 16 * 1024 * 1024;
+		const UINT boneCount = skinnedInfo.BoneCount();
+
+		// Reference poses from live sampling over a sweep of the clip.
+		std::vector<float> sweep;
+		float clipEnd = skinnedInfo.GetClipEndTime(clipName);
+		for(float t = 0.0f; t < clipEnd; t += 0.0123f)
+			sweep.push_back(t);
+
+		std::vector<BoneTransform3x4> live(sweep.size() * boneCount);
+		const AnimationClip* clip = skinnedInfo.FindClip(clipName);
+		for(std::size_t i = 0; i < sweep.size(); ++i)
+			skinnedInfo.GetFinalTransforms(*clip, sweep[i], &live[i*boneCount]);
+
+		std::size_t bytesUsed = skinnedInfo.BakeClips(sampleRate, memoryBudget);
+
+		out << "Baked pose tables (" << sampleRate << " Hz, " << bytesUsed / 1024 << " KB)" << std::endl;
+		if(!skinnedInfo.IsClipBaked(clipName))
+		{
+			out << "  " << clipName << " exceeds the budget; sampled live" << std::endl;
+			return;
+		}
+
+		std::vector<BoneTransform3x4> baked(boneCount);
+		float maxError = 0.0f;
+		for(std::size_t i = 0; i < sweep.size(); ++i)
+		{
+			skinnedInfo.GetFinalTransforms(*clip, sweep[i], baked.data());
+
+			for(UINT j = 0; j < boneCount; ++j)
+				for(int r = 0; r < 3; ++r)
+				{
+					const float* b = &baked[j].Rows[r].x;
+					const float* l = &live[i*boneCount + j].Rows[r].x;
+					for(int c = 0; c < 4; ++c)
+						maxError = MathHelper::Max(maxError, fabsf(b[c] - l[c]));
+				}
+		}
+		out << "  max abs error vs. live: " << maxError << std::endl;
+
+		ThreadPool& pool = ThreadPool::Default();
+		const UINT crowdSizes[] = { 100, 1000, 10000 };
+		for(UINT instanceCount : crowdSizes)
+		{
+			UINT frameCount = MathHelper::Max(100000u / instanceCount, 1u);
+
+			double charsPerMs = CrowdAnimator::Benchmark(skinnedInfo, clipName, instanceCount, frameCount, &pool);
+
+			out << "  " << instanceCount << " instances: " << charsPerMs << " characters/ms" << std::endl;
+		}
+
+		skinnedInfo.ClearBakedClips();
+	}
+
+	// Per-character cost of a two clip cross-fade, blended in local space,
+	// against a single clip and against two full evaluations.
+	void BenchmarkBlending(const SkinnedData& skinnedInfo, const std::string& clipName, std::ostream& out)
+	{
+		using namespace DirectX;
+
+		const UINT iterations = 2000;
+		const UINT boneCount = skinnedInfo.BoneCount();
+		const AnimationClip* clip = skinnedInfo.FindClip(clipName);
+		float clipEnd = skinnedInfo.GetClipEndTime(clipName);
+
+		std::vector<BoneTransform3x4> a(boneCount);
+		std::vector<BoneTransform3x4> b(boneCount);
+
+		auto timeUs = [&](const std::function<void(float t)>& evaluate)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			for(UINT i = 0; i < iterations; ++i)
+				evaluate(clipEnd * i / iterations);
+			auto stop = std::chrono::high_resolution_clock::now();
+			return std::chrono::duration<double, std::micro>(stop - start).count() / iterations;
+		};
+
+		double singleUs = timeUs([&](float t)
+		{
+			skinnedInfo.GetFinalTransforms(*clip, t, a.data());
+		});
+
+		// The sample has one clip, so fade between two phases of it.
+		AnimationLayer layers[2];
+		layers[0].Clip = clip;
+		layers[0].Weight = 0.5f;
+		layers[1].Clip = clip;
+		layers[1].Weight = 0.5f;
+
+		double blendedUs = timeUs([&](float t)
+		{
+			layers[0].TimePos = t;
+			layers[1].TimePos = fmodf(t + 0.5f*clipEnd, clipEnd);
+			skinnedInfo.GetBlendedFinalTransforms(layers, 2, a.data());
+		});
+
+		double twoPassUs = timeUs([&](float t)
+		{
+			skinnedInfo.GetFinalTransforms(*clip, t, a.data());
+			skinnedInfo.GetFinalTransforms(*clip, fmodf(t + 0.5f*clipEnd, clipEnd), b.data());
+			for(UINT j = 0; j < boneCount; ++j)
+			{
+				for(int r = 0; r < 3; ++r)
+				{
+					XMVECTOR ra = XMLoadFloat4(&a[j].Rows[r]);
+					XMVECTOR rb = XMLoadFloat4(&b[j].Rows[r]);
+					XMStoreFloat4(&a[j].Rows[r], XMVectorLerp(ra, rb, 0.5f));
+				}
+			}
+		});
+
+		out << "Clip blending (us per character)" << std::endl;
+		out << "  single clip: " << singleUs << std::endl;
+		out << "  cross-fade, local space blend: " << blendedUs << std::endl;
+		out << "  cross-fade, two evaluations + matrix lerp: " << twoPassUs << std::endl;
+	}
+
+	void BenchmarkAnimationLod(const SkinnedData& skinnedInfo, const std::string& clipName, std::ostream& out)
+	{
+		using namespace DirectX;
+
+		const UINT gridSize = 100;
+		const float spacing = 2.0f;
+		const UINT frameCount = 20;
+
+		// A 100x100 grid of characters in front of a camera at the origin looking
+		// down +z with a 90 degree field of view; roughly a quarter is off screen.
+		CrowdAnimator crowd(&skinnedInfo);
+		float clipEnd = skinnedInfo.GetClipEndTime(clipName);
+		for(UINT z = 0; z < gridSize; ++z)
+		{
+			for(UINT x = 0; x < gridSize; ++x)
+			{
+				UINT i = crowd.AddInstance(clipName, MathHelper::RandF(0.0f, clipEnd), 1.0f);
+
+				BoundingSphere bounds;
+				bounds.Center = XMFLOAT3((x - 0.5f*gridSize)*spacing, 1.0f, 2.0f + z*spacing);
+				bounds.Radius = 1.0f;
+				crowd.SetBounds(i, bounds);
+			}
+		}
+
+		AnimationLodView view;
+		XMMATRIX proj = XMMatrixPerspectiveFovLH(0.5f*MathHelper::Pi, 1.0f, 1.0f, 1000.0f);
+		BoundingFrustum::CreateFromMatrix(view.FrustumW, proj);
+		view.ProjScale = 0.5f*720.0f*1.0f;
+		crowd.SetLodView(view);
+
+		auto timeFrames = [&]()
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			for(UINT frame = 0; frame < frameCount; ++frame)
+				crowd.Update(1.0f / 60.0f);
+			auto stop = std::chrono::high_resolution_clock::now();
+			return std::chrono::duration<double, std::milli>(stop - start).count() / frameCount;
+		};
+
+		crowd.Update(0.0f);
+		double fullMs = timeFrames();
+
+		crowd.EnableLod(AnimationLodPolicy());
+		crowd.Update(0.0f);
+		double lodMs = timeFrames();
+
+		const AnimationLodStats& stats = crowd.GetLodStats();
+
+		out << "Animation LOD (" << crowd.InstanceCount() << " instances)" << std::endl;
+		out << "  no LOD: " << fullMs << " ms/frame, LOD: " << lodMs << " ms/frame" << std::endl;
+		for(int lod = 0; lod < AnimationLodCount; ++lod)
+		{
+			const AnimationLodCounters& c = stats.Lods[lod];
+			out << "  LOD " << lod << ": " << c.Instances << " instances, "
+				<< c.FullEvaluations << " evaluations, "
+				<< c.InterpolatedFrames << " interpolated, "
+				<< c.MaskedBones << " masked bones" << std::endl;
+		}
+		out << "  culled: " << stats.CulledInstances << " instances (time only)" << std::endl;
+	}
+
+	// Milliseconds per Skin() call, averaged over iterationCount calls.
+	double TimeSkinning(CpuSkinner& skinner, const std::vector<BoneTransform3x4>& palette,
+		bool skipCleanBones, UINT iterationCount, ThreadPool* threadPool)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		for(UINT i = 0; i < iterationCount; ++i)
+			skinner.Skin(palette.data(), skipCleanBones, threadPool);
+
+		auto stop = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::milli>(stop - start).count() / iterationCount;
+	}
+
+	void BenchmarkCpuSkinning(const SkinnedData& skinnedInfo, const std::string& clipName,
+		const std::vector<M3DLoader::SkinnedVertex>& vertices, std::ostream& out)
+	{
+		const UINT iterationCount = 200;
+
+		std::vector<BoneTransform3x4> palette(skinnedInfo.BoneCount());
+		skinnedInfo.GetFinalTransforms(clipName, 0.5f*skinnedInfo.GetClipEndTime(clipName), palette);
+
+		CpuSkinner skinner;
+		if(!skinner.Build(vertices.data(), (UINT)vertices.size(), skinnedInfo.BoneCount()))
+		{
+			out << "CPU skinning: the model weights bones it does not have" << std::endl;
+			return;
+		}
+
+		ThreadPool serial(0);
+		ThreadPool& pool = ThreadPool::Default();
+
+		double serialMs = TimeSkinning(skinner, palette, false, iterationCount, &serial);
+		double parallelMs = TimeSkinning(skinner, palette, false, iterationCount, &pool);
+
+		out << "CPU skinning (" << skinner.VertexCount() << " vertices, "
+			<< skinner.BlockCount() << " blocks)" << std::endl;
+		out << "  1 thread:  " << skinner.VertexCount() / (serialMs * 1000.0) << " Mverts/s" << std::endl;
+		out << "  " << pool.ThreadCount() << " threads: "
+			<< skinner.VertexCount() / (parallelMs * 1000.0) << " Mverts/s" << std::endl;
+
+		// Nudge the translation of the last bone only; blocks it does not
+		// influence are skipped.
+		palette.back().Rows[0].w += 0.01f;
+		skinner.Skin(palette.data(), true, &pool);
+		out << "  one dirty bone: " << skinner.LastSkinnedBlockCount() << "/"
+			<< skinner.BlockCount() << " blocks skinned" << std::endl;
+	}
+}
+
+bool RunAnimationBenchmarks(const std::string& modelFilename, const std::string& clipName, std::ostream& out)
+{
+	std::vector<M3DLoader::SkinnedVertex> vertices;
+	std::vector<USHORT> indices;
+	std::vector<M3DLoader::Subset> subsets;
+	std::vector<M3DLoader::M3dMaterial> mats;
+	SkinnedData skinnedInfo;
+
+	M3DLoader m3dLoader;
+	if(!m3dLoader.LoadM3d(modelFilename, vertices, indices, subsets, mats, skinnedInfo))
+	{
+		out << "Failed to load " << modelFilename << std::endl;
+		return false;
+	}
+
+	if(skinnedInfo.FindClip(clipName) == nullptr)
+	{
+		out << modelFilename << " has no clip named " << clipName << std::endl;
+		return false;
+	}
+
+	out << modelFilename << ": " << vertices.size() << " vertices, "
+		<< indices.size() / 3 << " triangles" << std::endl;
+
+	BenchmarkCrowd(skinnedInfo, clipName, out);
+	BenchmarkBlending(skinnedInfo, clipName, out);
+	BenchmarkAnimationLod(skinnedInfo, clipName, out);
+	BenchmarkBakedClips(skinnedInfo, clipName, out);
+	BenchmarkCpuSkinning(skinnedInfo, clipName, vertices, out);
+
+	return true;
+}
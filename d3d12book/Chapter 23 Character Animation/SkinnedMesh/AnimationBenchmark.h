@@ -0,0 +1,16 @@
+//***************************************************************************************
+// AnimationBenchmark.h
+//
+// Headless CPU animation benchmarks.  SkinnedMeshApp runs these instead of
+// creating a window when started with "-benchmark".
+//***************************************************************************************
+
+#pragma once
+
+#include <ostream>
+#include <string>
+
+// Loads the skinned model (no device required), runs every benchmark on the
+// given clip and writes a human readable report to out.  Returns false if the
+// model could not be loaded.
+bool RunAnimationBenchmarks(const std::string& modelFilename, const std::string& clipName, std::ostream& out);
@@ -0,0 +1,219 @@
+//***************************************************************************************
+// CpuSkinner.cpp
+//***************************************************************************************
+
+#include "CpuSkinner.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Blocks handed to a worker at a time.
+	const UINT BlocksPerChunk = 8;
+}
+
+bool CpuSkinner::Build(const M3DLoader::SkinnedVertex* vertices, UINT vertexCount, UINT boneCount)
+{
+	const bool supported = boneCount <= MaxBones;
+	if(!supported)
+	{
+		vertexCount = 0;
+		boneCount = 0;
+	}
+
+	mBoneCount = boneCount;
+
+	mBindPositions.resize(vertexCount);
+	mBindNormals.resize(vertexCount);
+	mWeights.resize(vertexCount);
+	mBoneIndices.resize(vertexCount);
+
+	const UINT blockCount = (vertexCount + BlockSize - 1) / BlockSize;
+	mBlockBoneMasks.assign(blockCount, std::array<std::uint64_t, MaxBones / 64>());
+
+	bool bonesInRange = true;
+	for(UINT i = 0; i < vertexCount; ++i)
+	{
+		const M3DLoader::SkinnedVertex& v = vertices[i];
+
+		mBindPositions[i] = v.Pos;
+		mBindNormals[i] = v.Normal;
+
+		float w3 = 1.0f - v.BoneWeights.x - v.BoneWeights.y - v.BoneWeights.z;
+		float w[4] = { v.BoneWeights.x, v.BoneWeights.y, v.BoneWeights.z, w3 };
+
+		auto& mask = mBlockBoneMasks[i / BlockSize];
+		for(int j = 0; j < 4; ++j)
+		{
+			// SkinBlock reads the palette entry of every index, weighted or not,
+			// so out of range ones are pointed at bone 0 with no weight.
+			BYTE bone = v.BoneIndices[j];
+			if(bone >= boneCount)
+			{
+				bonesInRange = bonesInRange && w[j] == 0.0f;
+				bone = 0;
+				w[j] = 0.0f;
+			}
+
+			mBoneIndices[i][j] = bone;
+
+			if(w[j] != 0.0f)
+				mask[bone / 64] |= 1ull << (bone % 64);
+		}
+
+		mWeights[i] = XMFLOAT4(w[0], w[1], w[2], w[3]);
+	}
+
+	mPositions.assign(vertexCount, XMFLOAT3(0.0f, 0.0f, 0.0f));
+	mNormals.assign(vertexCount, XMFLOAT3(0.0f, 0.0f, 0.0f));
+	mPrevTransforms.resize(boneCount);
+	mPalette.resize(boneCount);
+	mDirtyBlocks.reserve(blockCount);
+	mHasOutput = false;
+
+	return supported && bonesInRange;
+}
+
+void CpuSkinner::Skin(const BoneTransform3x4* finalTransforms, bool skipCleanBones, ThreadPool* threadPool)
+{
+	// Find the bones whose matrix changed since the previous call.
+	std::array<std::uint64_t, MaxBones / 64> dirtyBones = {};
+	for(UINT i = 0; i < mBoneCount; ++i)
+	{
+		if(!mHasOutput || memcmp(&finalTransforms[i], &mPrevTransforms[i], sizeof(BoneTransform3x4)) != 0)
+			dirtyBones[i / 64] |= 1ull << (i % 64);
+
+		// Unpack to a full matrix so vertices can be transformed as row vectors
+		// with splat/multiply-adds.
+		mPalette[i] = LoadBoneTransform(&finalTransforms[i]);
+	}
+	std::copy(finalTransforms, finalTransforms + mBoneCount, mPrevTransforms.begin());
+
+	mDirtyBlocks.clear();
+	for(UINT b = 0; b < BlockCount(); ++b)
+	{
+		bool dirty = !skipCleanBones || !mHasOutput;
+		for(UINT k = 0; k < MaxBones / 64 && !dirty; ++k)
+			dirty = (mBlockBoneMasks[b][k] & dirtyBones[k]) != 0;
+
+		if(dirty)
+			mDirtyBlocks.push_back(b);
+	}
+
+	threadPool->ParallelFor((UINT)mDirtyBlocks.size(), BlocksPerChunk,
+		[this](UINT begin, UINT end, UINT threadIndex)
+	{
+		for(UINT i = begin; i < end; ++i)
+			SkinBlock(mDirtyBlocks[i], mPalette.data());
+	});
+
+	mHasOutput = true;
+}
+
+void CpuSkinner::SkinBlock(UINT block, const XMMATRIX* palette)
+{
+	const UINT begin = block * BlockSize;
+	const UINT end = MathHelper::Min(begin + BlockSize, VertexCount());
+
+	for(UINT i = begin; i < end; ++i)
+	{
+		const std::array<BYTE, 4>& bones = mBoneIndices[i];
+		XMVECTOR weights = XMLoadFloat4(&mWeights[i]);
+
+		// Blend the four bone matrices first; transforming by the blended matrix
+		// is equivalent to blending the four transformed points.
+		XMVECTOR w = XMVectorSplatX(weights);
+		XMVECTOR r0 = XMVectorMultiply(w, palette[bones[0]].r[0]);
+		XMVECTOR r1 = XMVectorMultiply(w, palette[bones[0]].r[1]);
+		XMVECTOR r2 = XMVectorMultiply(w, palette[bones[0]].r[2]);
+		XMVECTOR r3 = XMVectorMultiply(w, palette[bones[0]].r[3]);
+
+		w = XMVectorSplatY(weights);
+		r0 = XMVectorMultiplyAdd(w, palette[bones[1]].r[0], r0);
+		r1 = XMVectorMultiplyAdd(w, palette[bones[1]].r[1], r1);
+		r2 = XMVectorMultiplyAdd(w, palette[bones[1]].r[2], r2);
+		r3 = XMVectorMultiplyAdd(w, palette[bones[1]].r[3], r3);
+
+		w = XMVectorSplatZ(weights);
+		r0 = XMVectorMultiplyAdd(w, palette[bones[2]].r[0], r0);
+		r1 = XMVectorMultiplyAdd(w, palette[bones[2]].r[1], r1);
+		r2 = XMVectorMultiplyAdd(w, palette[bones[2]].r[2], r2);
+		r3 = XMVectorMultiplyAdd(w, palette[bones[2]].r[3], r3);
+
+		w = XMVectorSplatW(weights);
+		r0 = XMVectorMultiplyAdd(w, palette[bones[3]].r[0], r0);
+		r1 = XMVectorMultiplyAdd(w, palette[bones[3]].r[1], r1);
+		r2 = XMVectorMultiplyAdd(w, palette[bones[3]].r[2], r2);
+		r3 = XMVectorMultiplyAdd(w, palette[bones[3]].r[3], r3);
+
+		// Assume no nonuniform scaling when transforming normals, so
+		// that we do not have to use the inverse-transpose.
+		XMVECTOR p = XMLoadFloat3(&mBindPositions[i]);
+		XMVECTOR n = XMLoadFloat3(&mBindNormals[i]);
+
+		XMVECTOR posL = XMVectorMultiplyAdd(XMVectorSplatX(p), r0,
+			XMVectorMultiplyAdd(XMVectorSplatY(p), r1,
+			XMVectorMultiplyAdd(XMVectorSplatZ(p), r2, r3)));
+
+		XMVECTOR normalL = XMVectorMultiplyAdd(XMVectorSplatX(n), r0,
+			XMVectorMultiplyAdd(XMVectorSplatY(n), r1,
+			XMVectorMultiply(XMVectorSplatZ(n), r2)));
+
+		XMStoreFloat3(&mPositions[i], posL);
+		XMStoreFloat3(&mNormals[i], normalL);
+	}
+}
+
+UINT CpuSkinner::VertexCount()const
+{
+	return (UINT)mBindPositions.size();
+}
+
+UINT CpuSkinner::BoneCount()const
+{
+	return mBoneCount;
+}
+
+UINT CpuSkinner::BlockCount()const
+{
+	return (UINT)mBlockBoneMasks.size();
+}
+
+UINT CpuSkinner::LastSkinnedBlockCount()const
+{
+	return (UINT)mDirtyBlocks.size();
+}
+
+const std::vector<XMFLOAT3>& CpuSkinner::Positions()const
+{
+	return mPositions;
+}
+
+const std::vector<XMFLOAT3>& CpuSkinner::Normals()const
+{
+	return mNormals;
+}
+
+bool CpuSkinner::Intersects(FXMVECTOR rayOrigin, FXMVECTOR rayDir,
+	const USHORT* indices, UINT triangleCount, float& tmin, UINT& triangleIndex)const
+{
+	bool hit = false;
+	tmin = MathHelper::Infinity;
+
+	for(UINT i = 0; i < triangleCount; ++i)
+	{
+		XMVECTOR v0 = XMLoadFloat3(&mPositions[indices[i * 3 + 0]]);
+		XMVECTOR v1 = XMLoadFloat3(&mPositions[indices[i * 3 + 1]]);
+		XMVECTOR v2 = XMLoadFloat3(&mPositions[indices[i * 3 + 2]]);
+
+		float t = 0.0f;
+		if(TriangleTests::Intersects(rayOrigin, rayDir, v0, v1, v2, t) && t < tmin)
+		{
+			tmin = t;
+			triangleIndex = i;
+			hit = true;
+		}
+	}
+
+	return hit;
+}
@@ -0,0 +1,86 @@
+//***************************************************************************************
+// CpuSkinner.h
+//
+// CPU linear-blend skinning of M3DLoader::SkinnedVertex data.  Produces the same
+// positions and normals as the SKINNED path of the vertex shader, which makes
+// skinned output testable without a GPU and lets us ray cast against animated
+// characters.
+//
+// Vertices are processed in fixed-size blocks spread over the thread pool.  Each
+// block remembers which bones influence it, so when only a few bones changed since
+// the previous Skin() call, blocks that do not reference those bones are skipped.
+//***************************************************************************************
+
+#pragma once
+
+#include "LoadM3d.h"
+#include "../../Common/ThreadPool.h"
+
+class CpuSkinner
+{
+public:
+	// Vertices per block; also the granularity of dirty-bone skipping.
+	static const UINT BlockSize = 64;
+	static const UINT MaxBones = 128;
+
+	CpuSkinner() = default;
+	CpuSkinner(const CpuSkinner& rhs) = delete;
+	CpuSkinner& operator=(const CpuSkinner& rhs) = delete;
+	~CpuSkinner() = default;
+
+	// Copies the bind pose and builds the per-block bone masks.  Bone indices
+	// come straight from the model file, so influences on bones boneCount and up
+	// are dropped, and false is returned if any of them had a nonzero weight.
+	// Returns false and builds nothing if boneCount is above MaxBones.
+	bool Build(const M3DLoader::SkinnedVertex* vertices, UINT vertexCount, UINT boneCount);
+
+	// finalTransforms are BoneCount() packed matrices as produced by
+	// SkinnedData::GetFinalTransforms.  If skipCleanBones is true, blocks whose
+	// bones all have the same matrix as in the previous call keep their
+	// previous output.
+	void Skin(const BoneTransform3x4* finalTransforms, bool skipCleanBones,
+		ThreadPool* threadPool = &ThreadPool::Default());
+
+	UINT VertexCount()const;
+	UINT BoneCount()const;
+	UINT BlockCount()const;
+
+	// Number of blocks recomputed by the last Skin() call.
+	UINT LastSkinnedBlockCount()const;
+
+	// Skinned model space data.  Like the shader, normals are not renormalized.
+	const std::vector<DirectX::XMFLOAT3>& Positions()const;
+	const std::vector<DirectX::XMFLOAT3>& Normals()const;
+
+	// Closest intersection of a model space ray with the skinned triangles.
+	// Returns false if nothing is hit; otherwise tmin and triangleIndex describe
+	// the nearest hit.
+	bool Intersects(DirectX::FXMVECTOR rayOrigin, DirectX::FXMVECTOR rayDir,
+		const USHORT* indices, UINT triangleCount, float& tmin, UINT& triangleIndex)const;
+
+private:
+	void SkinBlock(UINT block, const DirectX::XMMATRIX* palette);
+
+private:
+	UINT mBoneCount = 0;
+
+	// Bind pose inputs.  Weights are expanded to four with w3 = 1 - (w0+w1+w2).
+	std::vector<DirectX::XMFLOAT3> mBindPositions;
+	std::vector<DirectX::XMFLOAT3> mBindNormals;
+	std::vector<DirectX::XMFLOAT4> mWeights;
+	std::vector<std::array<BYTE, 4>> mBoneIndices;
+
+	// Bit i of mBlockBoneMasks[b] is set if bone i has a nonzero weight on any
+	// vertex of block b.
+	std::vector<std::array<std::uint64_t, MaxBones / 64>> mBlockBoneMasks;
+
+	// Palette of the previous Skin() call, used to find the dirty bones.
+	std::vector<BoneTransform3x4> mPrevTransforms;
+	bool mHasOutput = false;
+
+	std::vector<DirectX::XMMATRIX> mPalette;
+	std::vector<UINT> mDirtyBlocks;
+
+	std::vector<DirectX::XMFLOAT3> mPositions;
+	std::vector<DirectX::XMFLOAT3> mNormals;
+};
@@ -0,0 +1,364 @@
+//***************************************************************************************
+// CrowdAnimator.cpp
+//***************************************************************************************
+
+#include "CrowdAnimator.h"
+#include <cfloat>
+#include <chrono>
+
+using namespace DirectX;
+
+namespace
+{
+	// Evaluating one character is ~100 matrix products; a handful per chunk keeps
+	// scheduling overhead low while still balancing small crowds.
+	const UINT CrowdGrainSize = 8;
+}
+
+CrowdAnimator::CrowdAnimator(const SkinnedData* skinnedInfo, ThreadPool* threadPool)
+	: mSkinnedInfo(skinnedInfo), mThreadPool(threadPool)
+{
+	mSkinnedInfo->GetLeafBones(mLeafBones);
+	mLeafBoneCount = (UINT)std::count(mLeafBones.begin(), mLeafBones.end(), (BYTE)1);
+}
+
+UINT CrowdAnimator::AddInstance(const std::string& clipName, float timePos, float speed)
+{
+	Instance inst;
+	inst.Speed = speed;
+	mInstances.push_back(inst);
+
+	UINT index = (UINT)mInstances.size() - 1;
+	SetClip(index, clipName, timePos);
+
+	BoneTransform3x4 identity;
+	StoreBoneTransform(&identity, XMMatrixIdentity());
+	mPalettes.resize(mInstances.size() * BoneCount(), identity);
+
+	if(mLodEnabled)
+		mKeyPalettes.resize(2 * mPalettes.size(), identity);
+
+	return index;
+}
+
+void CrowdAnimator::Clear()
+{
+	mInstances.clear();
+	mPalettes.clear();
+	mKeyPalettes.clear();
+}
+
+void CrowdAnimator::SetClip(UINT instance, const std::string& clipName, float timePos)
+{
+	Instance& inst = mInstances[instance];
+	inst.Clip = mSkinnedInfo->FindClip(clipName);
+	assert(inst.Clip != nullptr);
+
+	inst.ClipEndTime = inst.Clip->GetClipEndTime();
+	inst.TimePos = timePos;
+
+	// The key poses belong to the old clip.
+	inst.Lod = -1;
+	inst.FadeClip = nullptr;
+}
+
+void CrowdAnimator::CrossFade(UINT instance, const std::string& clipName, float duration, float timePos)
+{
+	Instance& inst = mInstances[instance];
+	if(duration <= 0.0f)
+	{
+		SetClip(instance, clipName, timePos);
+		return;
+	}
+
+	// Fading again mid-fade drops the oldest clip; the pose pops slightly,
+	// but we never blend more than two clips.
+	const AnimationClip* fadeClip = inst.Clip;
+	float fadeClipEndTime = inst.ClipEndTime;
+	float fadeTimePos = inst.TimePos;
+
+	SetClip(instance, clipName, timePos);
+
+	inst.FadeClip = fadeClip;
+	inst.FadeClipEndTime = fadeClipEndTime;
+	inst.FadeTimePos = fadeTimePos;
+	inst.FadeElapsed = 0.0f;
+	inst.FadeDuration = duration;
+}
+
+void CrowdAnimator::SetSpeed(UINT instance, float speed)
+{
+	mInstances[instance].Speed = speed;
+}
+
+float CrowdAnimator::GetTimePos(UINT instance)const
+{
+	return mInstances[instance].TimePos;
+}
+
+void CrowdAnimator::SetBounds(UINT instance, const BoundingSphere& boundsW)
+{
+	mInstances[instance].BoundsW = boundsW;
+}
+
+void CrowdAnimator::EnableLod(const AnimationLodPolicy& policy)
+{
+	mLodEnabled = true;
+	mLodPolicy = policy;
+
+	BoneTransform3x4 identity;
+	StoreBoneTransform(&identity, XMMatrixIdentity());
+	mKeyPalettes.resize(2 * mPalettes.size(), identity);
+
+	for(auto& inst : mInstances)
+		inst.Lod = -1;
+}
+
+void CrowdAnimator::DisableLod()
+{
+	mLodEnabled = false;
+	mKeyPalettes.clear();
+	mKeyPalettes.shrink_to_fit();
+}
+
+void CrowdAnimator::SetLodView(const AnimationLodView& view)
+{
+	mLodView = view;
+}
+
+const AnimationLodStats& CrowdAnimator::GetLodStats()const
+{
+	return mLodStats;
+}
+
+UINT CrowdAnimator::InstanceCount()const
+{
+	return (UINT)mInstances.size();
+}
+
+UINT CrowdAnimator::BoneCount()const
+{
+	return mSkinnedInfo->BoneCount();
+}
+
+void CrowdAnimator::Update(float dt)
+{
+	const UINT boneCount = BoneCount();
+
+	if(!mLodEnabled)
+	{
+		mThreadPool->ParallelFor(InstanceCount(), CrowdGrainSize,
+			[&](UINT begin, UINT end, UINT threadIndex)
+		{
+			for(UINT i = begin; i < end; ++i)
+			{
+				Instance& inst = mInstances[i];
+
+				AdvanceTime(inst, dt);
+
+				EvaluatePose(inst, 0.0f, &mPalettes[i*boneCount], nullptr);
+			}
+		});
+
+		mLodStats = AnimationLodStats();
+		mLodStats.Lods[0].Instances = InstanceCount();
+		mLodStats.Lods[0].FullEvaluations = InstanceCount();
+		return;
+	}
+
+	// Each thread counts into its own slot; they are summed afterwards.
+	mThreadLodStats.assign(mThreadPool->ThreadCount(), AnimationLodStats());
+
+	mThreadPool->ParallelFor(InstanceCount(), CrowdGrainSize,
+		[&](UINT begin, UINT end, UINT threadIndex)
+	{
+		for(UINT i = begin; i < end; ++i)
+			UpdateInstanceLod(i, dt, mThreadLodStats[threadIndex]);
+	});
+
+	mLodStats = AnimationLodStats();
+	for(const auto& t : mThreadLodStats)
+	{
+		for(int lod = 0; lod < AnimationLodCount; ++lod)
+		{
+			mLodStats.Lods[lod].Instances += t.Lods[lod].Instances;
+			mLodStats.Lods[lod].FullEvaluations += t.Lods[lod].FullEvaluations;
+			mLodStats.Lods[lod].InterpolatedFrames += t.Lods[lod].InterpolatedFrames;
+			mLodStats.Lods[lod].MaskedBones += t.Lods[lod].MaskedBones;
+		}
+		mLodStats.CulledInstances += t.CulledInstances;
+	}
+}
+
+void CrowdAnimator::UpdateInstanceLod(UINT index, float dt, AnimationLodStats& stats)
+{
+	Instance& inst = mInstances[index];
+	const UINT boneCount = BoneCount();
+
+	AdvanceTime(inst, dt);
+
+	// Nobody sees this instance, so its palette can go stale.
+	if(mLodView.FrustumW.Contains(inst.BoundsW) == DISJOINT)
+	{
+		inst.Lod = -1;
+		stats.CulledInstances++;
+		return;
+	}
+
+	XMVECTOR center = XMLoadFloat3(&inst.BoundsW.Center);
+	XMVECTOR eyePos = XMLoadFloat3(&mLodView.EyePosW);
+	float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(center, eyePos)));
+
+	int lod = 0;
+	while(lod < AnimationLodCount - 1 && distance >= mLodPolicy.LodDistances[lod])
+		++lod;
+
+	// Projected radius in pixels.  Treat the eye being inside the sphere as large.
+	float pixels = distance > inst.BoundsW.Radius ? inst.BoundsW.Radius*mLodView.ProjScale / distance : FLT_MAX;
+	const BYTE* maskedBones = pixels < mLodPolicy.LeafBoneMaskPixels ? mLeafBones.data() : nullptr;
+
+	AnimationLodCounters& counters = stats.Lods[lod];
+	counters.Instances++;
+
+	// Masking only saves work on clips that are sampled live.
+	const UINT maskedPerEval = maskedBones != nullptr && !mSkinnedInfo->IsClipBaked(*inst.Clip) ? mLeafBoneCount : 0;
+
+	BoneTransform3x4* palette = &mPalettes[index*boneCount];
+
+	const UINT interval = mLodPolicy.UpdateIntervals[lod];
+	if(interval <= 1)
+	{
+		EvaluatePose(inst, 0.0f, palette, maskedBones);
+		counters.FullEvaluations++;
+		counters.MaskedBones += maskedPerEval;
+
+		inst.Lod = lod;
+		return;
+	}
+
+	BoneTransform3x4* prevKey = &mKeyPalettes[2*index*boneCount];
+	BoneTransform3x4* nextKey = prevKey + boneCount;
+
+	bool keyed = false;
+	if(inst.Lod != lod || inst.FramesSinceKey >= interval)
+	{
+		if(inst.Lod == lod)
+		{
+			// The pose evaluated ahead last time is where we are now.
+			std::copy(nextKey, nextKey + boneCount, prevKey);
+		}
+		else
+		{
+			EvaluatePose(inst, 0.0f, prevKey, maskedBones);
+			counters.FullEvaluations++;
+			counters.MaskedBones += maskedPerEval;
+		}
+
+		// Assume the frame time stays roughly constant until the next key.
+		EvaluatePose(inst, dt*interval, nextKey, maskedBones);
+		counters.FullEvaluations++;
+		counters.MaskedBones += maskedPerEval;
+
+		inst.Lod = lod;
+		inst.FramesSinceKey = 0;
+		keyed = true;
+	}
+
+	BlendPalettes(prevKey, nextKey, (float)inst.FramesSinceKey / interval, palette);
+	inst.FramesSinceKey++;
+
+	if(!keyed)
+		counters.InterpolatedFrames++;
+}
+
+void CrowdAnimator::BlendPalettes(const BoneTransform3x4* a, const BoneTransform3x4* b, float t, BoneTransform3x4* out)const
+{
+	for(UINT i = 0; i < BoneCount(); ++i)
+	{
+		for(int r = 0; r < 3; ++r)
+		{
+			XMVECTOR ra = XMLoadFloat4(&a[i].Rows[r]);
+			XMVECTOR rb = XMLoadFloat4(&b[i].Rows[r]);
+			XMStoreFloat4(&out[i].Rows[r], XMVectorLerp(ra, rb, t));
+		}
+	}
+}
+
+void CrowdAnimator::AdvanceTime(Instance& inst, float dt)
+{
+	inst.TimePos = WrapTime(inst.TimePos + inst.Speed*dt, inst.ClipEndTime);
+
+	if(inst.FadeClip != nullptr)
+	{
+		inst.FadeTimePos = WrapTime(inst.FadeTimePos + inst.Speed*dt, inst.FadeClipEndTime);
+		inst.FadeElapsed += dt;
+
+		if(inst.FadeElapsed >= inst.FadeDuration)
+			inst.FadeClip = nullptr;
+	}
+}
+
+void CrowdAnimator::EvaluatePose(const Instance& inst, float lookAhead, BoneTransform3x4* palette, const BYTE* maskedBones)const
+{
+	float timePos = WrapTime(inst.TimePos + inst.Speed*lookAhead, inst.ClipEndTime);
+
+	float fadeIn = inst.FadeClip != nullptr ? (inst.FadeElapsed + lookAhead) / inst.FadeDuration : 1.0f;
+	if(fadeIn >= 1.0f)
+	{
+		mSkinnedInfo->GetFinalTransforms(*inst.Clip, timePos, palette, maskedBones);
+		return;
+	}
+
+	AnimationLayer layers[2];
+	layers[0].Clip = inst.FadeClip;
+	layers[0].TimePos = WrapTime(inst.FadeTimePos + inst.Speed*lookAhead, inst.FadeClipEndTime);
+	layers[0].Weight = 1.0f - fadeIn;
+	layers[1].Clip = inst.Clip;
+	layers[1].TimePos = timePos;
+	layers[1].Weight = fadeIn;
+
+	mSkinnedInfo->GetBlendedFinalTransforms(layers, 2, palette, maskedBones);
+}
+
+float CrowdAnimator::WrapTime(float t, float clipEndTime)
+{
+	// A clip with no length has a single pose; fmodf would make it NaN.
+	if(clipEndTime <= 0.0f)
+		return 0.0f;
+
+	// Loop animation
+	return t > clipEndTime ? fmodf(t, clipEndTime) : t;
+}
+
+const BoneTransform3x4* CrowdAnimator::GetPalette(UINT instance)const
+{
+	return &mPalettes[instance*BoneCount()];
+}
+
+const BoneTransform3x4* CrowdAnimator::Palettes()const
+{
+	return mPalettes.data();
+}
+
+double CrowdAnimator::Benchmark(const SkinnedData& skinnedInfo, const std::string& clipName,
+	UINT instanceCount, UINT frameCount, ThreadPool* threadPool)
+{
+	CrowdAnimator crowd(&skinnedInfo, threadPool);
+
+	float clipEnd = skinnedInfo.GetClipEndTime(clipName);
+	for(UINT i = 0; i < instanceCount; ++i)
+		crowd.AddInstance(clipName, MathHelper::RandF(0.0f, clipEnd), MathHelper::RandF(0.8f, 1.2f));
+
+	// Warm up the per-thread scratch buffers.
+	crowd.Update(0.0f);
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	for(UINT frame = 0; frame < frameCount; ++frame)
+		crowd.Update(1.0f / 60.0f);
+
+	auto stop = std::chrono::high_resolution_clock::now();
+	double ms = std::chrono::duration<double, std::milli>(stop - start).count();
+
+	return ms > 0.0 ? (double)instanceCount*frameCount / ms : 0.0;
+}
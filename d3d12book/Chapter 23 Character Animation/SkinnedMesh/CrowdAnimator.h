@@ -0,0 +1,169 @@
+//***************************************************************************************
+// CrowdAnimator.h
+//
+// Animates many instances of one skinned model.  Every instance has its own clip,
+// time position and playback speed.  Update() advances all of them and evaluates
+// their bone palettes in parallel into one contiguous array (instance-major,
+// BoneCount() matrices per instance) that can be copied straight to an upload buffer.
+//
+// CrossFade() switches clips by blending the old and new clip in local space for
+// a while, which costs about one extra set of keyframe lookups per bone.
+//
+// With an animation LOD policy enabled, distant instances are fully evaluated only
+// every few frames and interpolated in between, instances outside the view frustum
+// only advance their time, and small instances freeze their leaf bones.
+//***************************************************************************************
+
+#pragma once
+
+#include "SkinnedData.h"
+#include "../../Common/ThreadPool.h"
+
+const int AnimationLodCount = 3;
+
+struct AnimationLodPolicy
+{
+	// Instances closer to the eye than LodDistances[i] use LOD i; the rest use
+	// the last LOD.
+	float LodDistances[AnimationLodCount - 1] = { 20.0f, 50.0f };
+
+	// Frames between full evaluations for each LOD.  Frames in between blend
+	// the last evaluated pose toward a pose evaluated ahead of time.
+	UINT UpdateIntervals[AnimationLodCount] = { 1, 2, 4 };
+
+	// Leaf bones (fingers, toes, ...) keep their bind pose when the projected
+	// bounding sphere radius is smaller than this many pixels.
+	float LeafBoneMaskPixels = 30.0f;
+};
+
+// Camera state the LOD decisions are based on.
+struct AnimationLodView
+{
+	DirectX::XMFLOAT3 EyePosW = { 0.0f, 0.0f, 0.0f };
+	DirectX::BoundingFrustum FrustumW;
+
+	// Converts radius/distance to pixels: 0.5 * viewport height * proj(1,1).
+	float ProjScale = 1.0f;
+};
+
+struct AnimationLodCounters
+{
+	UINT Instances = 0;
+	UINT FullEvaluations = 0;
+	UINT InterpolatedFrames = 0;
+	UINT MaskedBones = 0;
+};
+
+struct AnimationLodStats
+{
+	AnimationLodCounters Lods[AnimationLodCount];
+
+	// Outside the frustum: time advanced, palette not touched.
+	UINT CulledInstances = 0;
+};
+
+class CrowdAnimator
+{
+public:
+	CrowdAnimator(const SkinnedData* skinnedInfo, ThreadPool* threadPool = &ThreadPool::Default());
+	CrowdAnimator(const CrowdAnimator& rhs) = delete;
+	CrowdAnimator& operator=(const CrowdAnimator& rhs) = delete;
+	~CrowdAnimator() = default;
+
+	// Returns the index of the new instance.
+	UINT AddInstance(const std::string& clipName, float timePos = 0.0f, float speed = 1.0f);
+	void Clear();
+
+	void SetClip(UINT instance, const std::string& clipName, float timePos = 0.0f);
+	// Starts playing clipName at timePos, fading from whatever the instance
+	// played before over duration seconds.  The old clip keeps advancing
+	// during the fade.
+	void CrossFade(UINT instance, const std::string& clipName, float duration, float timePos = 0.0f);
+
+	void SetSpeed(UINT instance, float speed);
+	float GetTimePos(UINT instance)const;
+
+	// World space bounding sphere of an instance, used by the LOD policy.
+	void SetBounds(UINT instance, const DirectX::BoundingSphere& boundsW);
+
+	// Turns animation LOD on.  Until then every instance is fully evaluated
+	// every frame.
+	void EnableLod(const AnimationLodPolicy& policy);
+	void DisableLod();
+
+	// Must be called before Update() whenever the camera moves.
+	void SetLodView(const AnimationLodView& view);
+
+	// Counters of the last Update().
+	const AnimationLodStats& GetLodStats()const;
+
+	UINT InstanceCount()const;
+	UINT BoneCount()const;
+
+	// Advances every instance by speed*dt (looping at the clip end) and
+	// recomputes all bone palettes.
+	void Update(float dt);
+
+	// BoneCount() packed final transforms of one instance.
+	const BoneTransform3x4* GetPalette(UINT instance)const;
+
+	// All palettes back to back: InstanceCount()*BoneCount() matrices.
+	const BoneTransform3x4* Palettes()const;
+
+	// Evaluates a crowd of instanceCount characters playing clipName with random
+	// phases and speeds for the given number of frames, and returns the average
+	// throughput in characters per millisecond.
+	static double Benchmark(const SkinnedData& skinnedInfo, const std::string& clipName,
+		UINT instanceCount, UINT frameCount, ThreadPool* threadPool = &ThreadPool::Default());
+
+private:
+	struct Instance
+	{
+		const AnimationClip* Clip = nullptr;
+		float ClipEndTime = 0.0f;
+		float TimePos = 0.0f;
+		float Speed = 1.0f;
+
+		// Clip being faded out; nullptr when no cross-fade is in progress.
+		const AnimationClip* FadeClip = nullptr;
+		float FadeClipEndTime = 0.0f;
+		float FadeTimePos = 0.0f;
+		float FadeElapsed = 0.0f;
+		float FadeDuration = 0.0f;
+
+		DirectX::BoundingSphere BoundsW;
+
+		// LOD used by the last update, or -1 if the key poses are not valid.
+		int Lod = -1;
+		UINT FramesSinceKey = 0;
+	};
+
+	void UpdateInstanceLod(UINT index, float dt, AnimationLodStats& stats);
+	void AdvanceTime(Instance& inst, float dt);
+
+	// Pose of the instance lookAhead seconds (scaled by its speed) from now.
+	void EvaluatePose(const Instance& inst, float lookAhead, BoneTransform3x4* palette, const BYTE* maskedBones)const;
+
+	void BlendPalettes(const BoneTransform3x4* a, const BoneTransform3x4* b, float t, BoneTransform3x4* out)const;
+	static float WrapTime(float t, float clipEndTime);
+
+private:
+	const SkinnedData* mSkinnedInfo = nullptr;
+	ThreadPool* mThreadPool = nullptr;
+
+	std::vector<Instance> mInstances;
+	std::vector<BoneTransform3x4> mPalettes;
+
+	bool mLodEnabled = false;
+	AnimationLodPolicy mLodPolicy;
+	AnimationLodView mLodView;
+	AnimationLodStats mLodStats;
+	std::vector<AnimationLodStats> mThreadLodStats;
+
+	// Two key poses per instance (previous and upcoming) for interpolated LODs.
+	std::vector<BoneTransform3x4> mKeyPalettes;
+
+	// Nonzero for bones that are frozen on small instances.
+	std::vector<BYTE> mLeafBones;
+	UINT mLeafBoneCount = 0;
+};
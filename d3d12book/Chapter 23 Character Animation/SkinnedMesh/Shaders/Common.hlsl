@@ -64,7 +64,9 @@ cbuffer cbPerObject : register(b0)
 
 cbuffer cbSkinned : register(b1)
 {
-    float4x4 gBoneTransforms[96];
+    // Affine bone transforms packed as 3x4 (the transpose of the 4x3 part of
+    // the matrix), so each bone takes three registers instead of four.
+    row_major float3x4 gBoneTransforms[96];
 };
 
 // Constant data that varies per material.
@@ -63,9 +63,9 @@ VertexOut VS(VertexIn vin)
         // Assume no nonuniform scaling when transforming normals, so 
         // that we do not have to use the inverse-transpose.
 
-        posL += weights[i] * mul(float4(vin.PosL, 1.0f), gBoneTransforms[vin.BoneIndices[i]]).xyz;
-        normalL += weights[i] * mul(vin.NormalL, (float3x3)gBoneTransforms[vin.BoneIndices[i]]);
-        tangentL += weights[i] * mul(vin.TangentL.xyz, (float3x3)gBoneTransforms[vin.BoneIndices[i]]);
+        posL += weights[i] * mul(gBoneTransforms[vin.BoneIndices[i]], float4(vin.PosL, 1.0f));
+        normalL += weights[i] * mul((float3x3)gBoneTransforms[vin.BoneIndices[i]], vin.NormalL);
+        tangentL += weights[i] * mul((float3x3)gBoneTransforms[vin.BoneIndices[i]], vin.TangentL.xyz);
     }
 
     vin.PosL = posL;
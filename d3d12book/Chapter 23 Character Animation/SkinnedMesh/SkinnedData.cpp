@@ -2,6 +2,30 @@
 
 using namespace DirectX;
 
+namespace
+{
+	// A*B for affine matrices (row vector convention, last column (0,0,0,1)).
+	// The zero w components of A's first three rows let us skip B's last row.
+	XMMATRIX XM_CALLCONV AffineMultiply(FXMMATRIX A, CXMMATRIX B)
+	{
+		XMMATRIX R;
+		for(int i = 0; i < 3; ++i)
+		{
+			XMVECTOR a = A.r[i];
+			R.r[i] = XMVectorMultiplyAdd(XMVectorSplatX(a), B.r[0],
+				XMVectorMultiplyAdd(XMVectorSplatY(a), B.r[1],
+				XMVectorMultiply(XMVectorSplatZ(a), B.r[2])));
+		}
+
+		XMVECTOR a = A.r[3];
+		R.r[3] = XMVectorMultiplyAdd(XMVectorSplatX(a), B.r[0],
+			XMVectorMultiplyAdd(XMVectorSplatY(a), B.r[1],
+			XMVectorMultiplyAdd(XMVectorSplatZ(a), B.r[2], B.r[3])));
+
+		return R;
+	}
+}
+
 Keyframe::Keyframe()
 	: TimePos(0.0f),
 	Translation(0.0f, 0.0f, 0.0f),
@@ -29,24 +53,27 @@ float BoneAnimation::GetEndTime()const
 }
 
 void BoneAnimation::Interpolate(float t, XMFLOAT4X4& M)const
+{
+	XMVECTOR S, Q, P;
+	Interpolate(t, S, Q, P);
+
+	XMVECTOR zero = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+	XMStoreFloat4x4(&M, XMMatrixAffineTransformation(S, zero, Q, P));
+}
+
+void BoneAnimation::Interpolate(float t, XMVECTOR& S, XMVECTOR& Q, XMVECTOR& P)const
 {
 	if( t <= Keyframes.front().TimePos )
 	{
-		XMVECTOR S = XMLoadFloat3(&Keyframes.front().Scale);
-		XMVECTOR P = XMLoadFloat3(&Keyframes.front().Translation);
-		XMVECTOR Q = XMLoadFloat4(&Keyframes.front().RotationQuat);
-
-		XMVECTOR zero = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
-		XMStoreFloat4x4(&M, XMMatrixAffineTransformation(S, zero, Q, P));
+		S = XMLoadFloat3(&Keyframes.front().Scale);
+		P = XMLoadFloat3(&Keyframes.front().Translation);
+		Q = XMLoadFloat4(&Keyframes.front().RotationQuat);
 	}
 	else if( t >= Keyframes.back().TimePos )
 	{
-		XMVECTOR S = XMLoadFloat3(&Keyframes.back().Scale);
-		XMVECTOR P = XMLoadFloat3(&Keyframes.back().Translation);
-		XMVECTOR Q = XMLoadFloat4(&Keyframes.back().RotationQuat);
-
-		XMVECTOR zero = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
-		XMStoreFloat4x4(&M, XMMatrixAffineTransformation(S, zero, Q, P));
+		S = XMLoadFloat3(&Keyframes.back().Scale);
+		P = XMLoadFloat3(&Keyframes.back().Translation);
+		Q = XMLoadFloat4(&Keyframes.back().RotationQuat);
 	}
 	else
 	{
@@ -65,12 +92,9 @@ void BoneAnimation::Interpolate(float t, XMFLOAT4X4& M)const
 				XMVECTOR q0 = XMLoadFloat4(&Keyframes[i].RotationQuat);
 				XMVECTOR q1 = XMLoadFloat4(&Keyframes[i+1].RotationQuat);
 
-				XMVECTOR S = XMVectorLerp(s0, s1, lerpPercent);
-				XMVECTOR P = XMVectorLerp(p0, p1, lerpPercent);
-				XMVECTOR Q = XMQuaternionSlerp(q0, q1, lerpPercent);
-
-				XMVECTOR zero = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
-				XMStoreFloat4x4(&M, XMMatrixAffineTransformation(S, zero, Q, P));
+				S = XMVectorLerp(s0, s1, lerpPercent);
+				P = XMVectorLerp(p0, p1, lerpPercent);
+				Q = XMQuaternionSlerp(q0, q1, lerpPercent);
 
 				break;
 			}
@@ -122,6 +146,12 @@ float SkinnedData::GetClipEndTime(const std::string& clipName)const
 	return clip->second.GetClipEndTime();
 }
 
+const AnimationClip* SkinnedData::FindClip(const std::string& clipName)const
+{
+	auto clip = mAnimations.find(clipName);
+	return clip != mAnimations.end() ? &clip->second : nullptr;
+}
+
 UINT SkinnedData::BoneCount()const
 {
 	return mBoneHierarchy.size();
@@ -134,24 +164,295 @@ void SkinnedData::Set(std::vector<int>& boneHierarchy,
 	mBoneHierarchy = boneHierarchy;
 	mBoneOffsets   = boneOffsets;
 	mAnimations    = animations;
+
+	mBakedClips.clear();
+
+	// The offset transform is the inverse of the bind pose to-root transform,
+	// so toParent = inverse(offset[i]) * offset[parent].
+	mBindToParent.resize(mBoneOffsets.size());
+	for(UINT i = 0; i < mBoneOffsets.size(); ++i)
+	{
+		XMMATRIX offset = XMLoadFloat4x4(&mBoneOffsets[i]);
+		XMVECTOR det = XMMatrixDeterminant(offset);
+		XMMATRIX toRoot = XMMatrixInverse(&det, offset);
+
+		if(i == 0)
+		{
+			XMStoreFloat4x4(&mBindToParent[i], toRoot);
+			continue;
+		}
+
+		XMMATRIX parentOffset = XMLoadFloat4x4(&mBoneOffsets[mBoneHierarchy[i]]);
+		XMStoreFloat4x4(&mBindToParent[i], XMMatrixMultiply(toRoot, parentOffset));
+	}
+}
+
+void SkinnedData::GetLeafBones(std::vector<BYTE>& isLeaf)const
+{
+	isLeaf.assign(mBoneHierarchy.size(), 1);
+	for(UINT i = 1; i < mBoneHierarchy.size(); ++i)
+		isLeaf[mBoneHierarchy[i]] = 0;
 }
  
-void SkinnedData::GetFinalTransforms(const std::string& clipName, float timePos,  std::vector<XMFLOAT4X4>& finalTransforms)const
+void SkinnedData::GetFinalTransforms(const std::string& clipName, float timePos,  std::vector<BoneTransform3x4>& finalTransforms)const
+{
+	auto clip = mAnimations.find(clipName);
+	GetFinalTransforms(clip->second, timePos, finalTransforms.data());
+}
+
+void SkinnedData::GetFinalTransforms(const AnimationClip& clip, float timePos, BoneTransform3x4* finalTransforms,
+									 const BYTE* maskedBones)const
+{
+	auto baked = mBakedClips.find(&clip);
+	if(baked == mBakedClips.end())
+	{
+		GetLiveFinalTransforms(clip, timePos, finalTransforms, maskedBones);
+		return;
+	}
+
+	const BakedClip& table = baked->second;
+	const UINT numBones = BoneCount();
+
+	// Find the two samples that bound timePos.  The last interval ends at the
+	// clip end rather than a whole sample period after the one before it.
+	UINT i0 = 0;
+	float lerpPercent = 0.0f;
+	if(table.SampleCount > 1)
+	{
+		const UINT lastInterval = table.SampleCount - 2;
+		float f = MathHelper::Max((timePos - table.StartTime) * table.SampleRate, 0.0f);
+		if(f < (float)lastInterval)
+		{
+			i0 = (UINT)f;
+			lerpPercent = f - (float)i0;
+		}
+		else
+		{
+			float intervalStart = table.StartTime + (float)lastInterval / table.SampleRate;
+			float intervalLength = table.EndTime - intervalStart;
+			i0 = lastInterval;
+			lerpPercent = intervalLength > 0.0f ?
+				MathHelper::Clamp((timePos - intervalStart) / intervalLength, 0.0f, 1.0f) : 1.0f;
+		}
+	}
+	UINT i1 = MathHelper::Min(i0 + 1, table.SampleCount - 1);
+
+	const BoneTransform3x4* s0 = &table.Samples[i0*numBones];
+	const BoneTransform3x4* s1 = &table.Samples[i1*numBones];
+
+	// Adjacent samples are close enough that a component-wise lerp of the
+	// final matrices is indistinguishable from slerping the keyframes.
+	for(UINT i = 0; i < numBones; ++i)
+	{
+		for(int r = 0; r < 3; ++r)
+		{
+			XMVECTOR r0 = XMLoadFloat4(&s0[i].Rows[r]);
+			XMVECTOR r1 = XMLoadFloat4(&s1[i].Rows[r]);
+			XMStoreFloat4(&finalTransforms[i].Rows[r], XMVectorLerp(r0, r1, lerpPercent));
+		}
+	}
+}
+
+std::size_t SkinnedData::BakeClips(float sampleRate, std::size_t memoryBudget)
+{
+	mBakedClips.clear();
+
+	const UINT numBones = BoneCount();
+
+	// Bake the shortest clips first so the budget covers as many clips as possible.
+	std::vector<const AnimationClip*> clips;
+	for(auto& e : mAnimations)
+		clips.push_back(&e.second);
+
+	std::sort(clips.begin(), clips.end(), [](const AnimationClip* a, const AnimationClip* b)
+	{
+		return a->GetClipEndTime() - a->GetClipStartTime() < b->GetClipEndTime() - b->GetClipStartTime();
+	});
+
+	std::size_t bytesUsed = 0;
+	for(const AnimationClip* clip : clips)
+	{
+		float startTime = clip->GetClipStartTime();
+		float endTime = clip->GetClipEndTime();
+
+		UINT sampleCount = (UINT)ceilf((endTime - startTime) * sampleRate) + 1;
+		std::size_t byteSize = (std::size_t)sampleCount * numBones * sizeof(BoneTransform3x4);
+
+		// Too long for what is left of the budget; it falls back to live sampling.
+		if(bytesUsed + byteSize > memoryBudget)
+			continue;
+
+		BakedClip table;
+		table.StartTime = startTime;
+		table.EndTime = endTime;
+		table.SampleRate = sampleRate;
+		table.SampleCount = sampleCount;
+		table.Samples.resize((std::size_t)sampleCount * numBones);
+
+		for(UINT i = 0; i < sampleCount; ++i)
+		{
+			float t = MathHelper::Min(startTime + (float)i / sampleRate, endTime);
+			GetLiveFinalTransforms(*clip, t, &table.Samples[(std::size_t)i * numBones], nullptr);
+		}
+
+		mBakedClips[clip] = std::move(table);
+		bytesUsed += byteSize;
+	}
+
+	return bytesUsed;
+}
+
+void SkinnedData::ClearBakedClips()
+{
+	mBakedClips.clear();
+}
+
+bool SkinnedData::IsClipBaked(const std::string& clipName)const
+{
+	const AnimationClip* clip = FindClip(clipName);
+	return clip != nullptr && IsClipBaked(*clip);
+}
+
+bool SkinnedData::IsClipBaked(const AnimationClip& clip)const
+{
+	return mBakedClips.count(&clip) != 0;
+}
+
+void SkinnedData::GetLiveFinalTransforms(const AnimationClip& clip, float timePos, BoneTransform3x4* finalTransforms,
+										 const BYTE* maskedBones)const
 {
 	UINT numBones = mBoneOffsets.size();
 
-	std::vector<XMFLOAT4X4> toParentTransforms(numBones);
+	// Per-thread scratch space so that crowds can be evaluated in parallel
+	// without allocating every call.
+	thread_local std::vector<XMFLOAT4X4> toParentTransforms;
+	toParentTransforms.resize(numBones);
 
 	// Interpolate all the bones of this clip at the given time instance.
-	auto clip = mAnimations.find(clipName);
-	clip->second.Interpolate(timePos, toParentTransforms);
+	if(maskedBones == nullptr)
+	{
+		clip.Interpolate(timePos, toParentTransforms);
+	}
+	else
+	{
+		for(UINT i = 0; i < numBones; ++i)
+		{
+			if(maskedBones[i])
+				toParentTransforms[i] = mBindToParent[i];
+			else
+				clip.BoneAnimations[i].Interpolate(timePos, toParentTransforms[i]);
+		}
+	}
+
+	ComposeFinalTransforms(toParentTransforms, finalTransforms);
+}
+
+void SkinnedData::GetBlendedFinalTransforms(const AnimationLayer* layers, UINT layerCount,
+											BoneTransform3x4* finalTransforms, const BYTE* maskedBones)const
+{
+	UINT numBones = mBoneOffsets.size();
+
+	thread_local std::vector<XMFLOAT4X4> toParentTransforms;
+	toParentTransforms.resize(numBones);
+
+	float totalWeight = 0.0f;
+	for(UINT j = 0; j < layerCount; ++j)
+	{
+		if(!layers[j].Additive)
+			totalWeight += layers[j].Weight;
+	}
+	assert(totalWeight > 0.0f);
+	float invTotalWeight = 1.0f / totalWeight;
+
+	XMVECTOR zero = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+
+	for(UINT i = 0; i < numBones; ++i)
+	{
+		if(maskedBones != nullptr && maskedBones[i])
+		{
+			toParentTransforms[i] = mBindToParent[i];
+			continue;
+		}
+
+		// Weighted average of the regular layers.  Rotations are summed as
+		// quaternions on the same hemisphere and renormalized (nlerp), which is
+		// order independent and close to slerp for the small angles between
+		// poses that are blended.
+		XMVECTOR S = XMVectorZero();
+		XMVECTOR P = XMVectorZero();
+		XMVECTOR Q = XMVectorZero();
+		XMVECTOR firstQ = XMVectorZero();
+		bool haveFirst = false;
+
+		for(UINT j = 0; j < layerCount; ++j)
+		{
+			const AnimationLayer& layer = layers[j];
+			if(layer.Additive || layer.Weight <= 0.0f)
+				continue;
+
+			XMVECTOR s, q, p;
+			layer.Clip->BoneAnimations[i].Interpolate(layer.TimePos, s, q, p);
+
+			if(!haveFirst)
+			{
+				firstQ = q;
+				haveFirst = true;
+			}
+			else if(XMVectorGetX(XMQuaternionDot(firstQ, q)) < 0.0f)
+			{
+				q = XMVectorNegate(q);
+			}
+
+			float w = layer.Weight * invTotalWeight;
+			S = XMVectorMultiplyAdd(XMVectorReplicate(w), s, S);
+			P = XMVectorMultiplyAdd(XMVectorReplicate(w), p, P);
+			Q = XMVectorMultiplyAdd(XMVectorReplicate(w), q, Q);
+		}
+		Q = XMQuaternionNormalize(Q);
+
+		// Additive layers: scale the base by s/sRef, rotate it by the rotation
+		// from qRef to q, and offset it by p - pRef.
+		for(UINT j = 0; j < layerCount; ++j)
+		{
+			const AnimationLayer& layer = layers[j];
+			if(!layer.Additive || layer.Weight == 0.0f)
+				continue;
+
+			XMVECTOR s, q, p;
+			XMVECTOR sRef, qRef, pRef;
+			layer.Clip->BoneAnimations[i].Interpolate(layer.TimePos, s, q, p);
+			layer.Clip->BoneAnimations[i].Interpolate(layer.ReferenceTimePos, sRef, qRef, pRef);
+
+			XMVECTOR w = XMVectorReplicate(layer.Weight);
+			XMVECTOR one = XMVectorSplatOne();
+
+			XMVECTOR deltaS = XMVectorDivide(s, sRef);
+			XMVECTOR deltaQ = XMQuaternionMultiply(q, XMQuaternionConjugate(qRef));
+			deltaQ = XMQuaternionSlerp(XMQuaternionIdentity(), deltaQ, layer.Weight);
+
+			S = XMVectorMultiply(S, XMVectorLerpV(one, deltaS, w));
+			Q = XMQuaternionMultiply(deltaQ, Q);
+			P = XMVectorMultiplyAdd(w, XMVectorSubtract(p, pRef), P);
+		}
+
+		XMStoreFloat4x4(&toParentTransforms[i], XMMatrixAffineTransformation(S, zero, Q, P));
+	}
+
+	ComposeFinalTransforms(toParentTransforms, finalTransforms);
+}
+
+void SkinnedData::ComposeFinalTransforms(const std::vector<XMFLOAT4X4>& toParentTransforms,
+										 BoneTransform3x4* finalTransforms)const
+{
+	UINT numBones = mBoneOffsets.size();
+
+	thread_local std::vector<XMFLOAT4X4> toRootTransforms;
+	toRootTransforms.resize(numBones);
 
 	//
 	// Traverse the hierarchy and transform all the bones to the root space.
 	//
 
-	std::vector<XMFLOAT4X4> toRootTransforms(numBones);
-
 	// The root bone has index 0.  The root bone has no parent, so its toRootTransform
 	// is just its local bone transform.
 	toRootTransforms[0] = toParentTransforms[0];
@@ -164,7 +465,7 @@ void SkinnedData::GetFinalTransforms(const std::string& clipName, float timePos,
 		int parentIndex = mBoneHierarchy[i];
 		XMMATRIX parentToRoot = XMLoadFloat4x4(&toRootTransforms[parentIndex]);
 
-		XMMATRIX toRoot = XMMatrixMultiply(toParent, parentToRoot);
+		XMMATRIX toRoot = AffineMultiply(toParent, parentToRoot);
 
 		XMStoreFloat4x4(&toRootTransforms[i], toRoot);
 	}
@@ -174,7 +475,7 @@ void SkinnedData::GetFinalTransforms(const std::string& clipName, float timePos,
 	{
 		XMMATRIX offset = XMLoadFloat4x4(&mBoneOffsets[i]);
 		XMMATRIX toRoot = XMLoadFloat4x4(&toRootTransforms[i]);
-        XMMATRIX finalTransform = XMMatrixMultiply(offset, toRoot);
-		XMStoreFloat4x4(&finalTransforms[i], XMMatrixTranspose(finalTransform));
+        XMMATRIX finalTransform = AffineMultiply(offset, toRoot);
+		StoreBoneTransform(&finalTransforms[i], finalTransform);
 	}
 }
\ No newline at end of file
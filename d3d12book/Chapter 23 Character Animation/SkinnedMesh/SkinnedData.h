@@ -4,6 +4,36 @@
 #include "../../Common/d3dUtil.h"
 #include "../../Common/MathHelper.h"
 
+///<summary>
+/// Affine bone transform packed the way the shaders read it: the first three
+/// rows of the transposed 4x4 matrix (row-major 3x4, translation in the w
+/// components).  The dropped fourth row is always (0,0,0,1).
+///</summary>
+struct BoneTransform3x4
+{
+	DirectX::XMFLOAT4 Rows[3];
+};
+
+// Packs an affine matrix (row vector convention) into a BoneTransform3x4.
+inline void XM_CALLCONV StoreBoneTransform(BoneTransform3x4* dest, DirectX::FXMMATRIX M)
+{
+	DirectX::XMMATRIX T = DirectX::XMMatrixTranspose(M);
+	DirectX::XMStoreFloat4(&dest->Rows[0], T.r[0]);
+	DirectX::XMStoreFloat4(&dest->Rows[1], T.r[1]);
+	DirectX::XMStoreFloat4(&dest->Rows[2], T.r[2]);
+}
+
+// Unpacks a BoneTransform3x4 back to the affine 4x4 matrix.
+inline DirectX::XMMATRIX XM_CALLCONV LoadBoneTransform(const BoneTransform3x4* src)
+{
+	DirectX::XMMATRIX T(
+		DirectX::XMLoadFloat4(&src->Rows[0]),
+		DirectX::XMLoadFloat4(&src->Rows[1]),
+		DirectX::XMLoadFloat4(&src->Rows[2]),
+		DirectX::XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f));
+	return DirectX::XMMatrixTranspose(T);
+}
+
 ///<summary>
 /// A Keyframe defines the bone transformation at an instant in time.
 ///</summary>
@@ -32,6 +62,10 @@ struct BoneAnimation
 
     void Interpolate(float t, DirectX::XMFLOAT4X4& M)const;
 
+	// Same as above, but returns the local scale, rotation and translation
+	// instead of composing them into a matrix, so poses can be blended.
+	void Interpolate(float t, DirectX::XMVECTOR& S, DirectX::XMVECTOR& Q, DirectX::XMVECTOR& P)const;
+
 	std::vector<Keyframe> Keyframes; 	
 };
 
@@ -50,6 +84,23 @@ struct AnimationClip
     std::vector<BoneAnimation> BoneAnimations; 	
 };
 
+///<summary>
+/// One input of a blended pose.  Regular layers are averaged by weight (a
+/// cross-fade is two regular layers whose weights sum to one).  Additive layers
+/// are applied on top of that average: the difference between the clip at
+/// TimePos and the clip at ReferenceTimePos is added with the given weight,
+/// e.g. a lean or breathing layer over a walk.
+///</summary>
+struct AnimationLayer
+{
+	const AnimationClip* Clip = nullptr;
+	float TimePos = 0.0f;
+	float Weight = 1.0f;
+
+	bool Additive = false;
+	float ReferenceTimePos = 0.0f;
+};
+
 class SkinnedData
 {
 public:
@@ -59,6 +110,10 @@ public:
 	float GetClipStartTime(const std::string& clipName)const;
 	float GetClipEndTime(const std::string& clipName)const;
 
+	// Returns nullptr if there is no clip with the given name.  Callers that
+	// evaluate the same clip every frame should look it up once and keep the pointer.
+	const AnimationClip* FindClip(const std::string& clipName)const;
+
 	void Set(
 		std::vector<int>& boneHierarchy, 
 		std::vector<DirectX::XMFLOAT4X4>& boneOffsets,
@@ -68,15 +123,72 @@ public:
 	 // that you were calling this several times with the same clipName at 
 	 // the same timePos.
     void GetFinalTransforms(const std::string& clipName, float timePos, 
-		 std::vector<DirectX::XMFLOAT4X4>& finalTransforms)const;
+		 std::vector<BoneTransform3x4>& finalTransforms)const;
+
+	// Same as above, but writes BoneCount() matrices to finalTransforms and does
+	// not allocate.  Safe to call from several threads at once.  If maskedBones
+	// is given, bones with a nonzero entry skip keyframe interpolation and keep
+	// their bind pose relative to their parent (ignored for baked clips).
+	void GetFinalTransforms(const AnimationClip& clip, float timePos,
+		BoneTransform3x4* finalTransforms, const BYTE* maskedBones = nullptr)const;
+
+	// Samples every layer in local (scale/rotation/translation) space, blends
+	// them per bone, and walks the hierarchy once, so a blend of n clips costs n
+	// keyframe lookups but only one set of matrix products.  Baked tables are
+	// not used.  At least one regular layer must have a nonzero weight.  Safe
+	// to call from several threads at once.
+	void GetBlendedFinalTransforms(const AnimationLayer* layers, UINT layerCount,
+		BoneTransform3x4* finalTransforms, const BYTE* maskedBones = nullptr)const;
+
+	// isLeaf[i] is set to 1 if no other bone has bone i as its parent.
+	void GetLeafBones(std::vector<BYTE>& isLeaf)const;
+
+	// Optional: resamples clips at sampleRate Hz and stores the final transforms
+	// of every sample, so GetFinalTransforms for a baked clip is a table fetch
+	// plus one lerp between adjacent samples.  Clips are baked shortest first
+	// until memoryBudget bytes are used; the remaining clips keep being sampled
+	// live.  Returns the number of bytes used.
+	std::size_t BakeClips(float sampleRate, std::size_t memoryBudget);
+	void ClearBakedClips();
+	bool IsClipBaked(const std::string& clipName)const;
+	bool IsClipBaked(const AnimationClip& clip)const;
 
 private:
+	void GetLiveFinalTransforms(const AnimationClip& clip, float timePos,
+		BoneTransform3x4* finalTransforms, const BYTE* maskedBones)const;
+
+	// Concatenates to-parent transforms down the hierarchy and premultiplies
+	// the bone offsets.
+	void ComposeFinalTransforms(const std::vector<DirectX::XMFLOAT4X4>& toParentTransforms,
+		BoneTransform3x4* finalTransforms)const;
+
+private:
+	// Final transforms of one clip sampled at a fixed rate; sample i is at
+	// StartTime + i/SampleRate, except the last, which is at EndTime.  The last
+	// interval is shorter than the others when the clip length is not a multiple
+	// of 1/SampleRate.
+	struct BakedClip
+	{
+		float StartTime = 0.0f;
+		float EndTime = 0.0f;
+		float SampleRate = 30.0f;
+		UINT SampleCount = 0;
+		std::vector<BoneTransform3x4> Samples; // SampleCount*BoneCount()
+	};
+
     // Gives parentIndex of ith bone.
 	std::vector<int> mBoneHierarchy;
 
 	std::vector<DirectX::XMFLOAT4X4> mBoneOffsets;
+
+	// Bind pose to-parent transforms, derived from the bone offsets.  Used for
+	// masked bones.
+	std::vector<DirectX::XMFLOAT4X4> mBindToParent;
    
 	std::unordered_map<std::string, AnimationClip> mAnimations;
+
+	// Keyed by the address of the clip in mAnimations.
+	std::unordered_map<const AnimationClip*, BakedClip> mBakedClips;
 };
  
 #endif // SKINNEDDATA_H
\ No newline at end of file
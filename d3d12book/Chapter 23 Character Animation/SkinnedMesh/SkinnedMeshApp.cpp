@@ -12,6 +12,8 @@
 #include "Ssao.h"
 #include "SkinnedData.h"
 #include "LoadM3d.h"
+#include "CrowdAnimator.h"
+#include "AnimationBenchmark.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
@@ -21,26 +23,11 @@ const int gNumFrameResources = 3;
 
 struct SkinnedModelInstance
 {
-    SkinnedData* SkinnedInfo = nullptr;
-    std::vector<DirectX::XMFLOAT4X4> FinalTransforms;
-    std::string ClipName;
-    float TimePos = 0.0f;
-
-    // Called every frame and increments the time position, interpolates the 
-    // animations for each bone based on the current animation clip, and 
-    // generates the final transforms which are ultimately set to the effect
-    // for processing in the vertex shader.
-    void UpdateSkinnedAnimation(float dt)
-    {
-        TimePos += dt;
-
-        // Loop animation
-        if(TimePos > SkinnedInfo->GetClipEndTime(ClipName))
-            TimePos = 0.0f;
-
-        // Compute the final transforms for this time position.
-        SkinnedInfo->GetFinalTransforms(ClipName, TimePos, FinalTransforms);
-    }
+    // Slot of this character in the app's CrowdAnimator.  The crowd advances the
+    // time position, interpolates the animations for each bone based on the
+    // current animation clip, and generates the final transforms which are
+    // ultimately set to the effect for processing in the vertex shader.
+    UINT CrowdIndex = 0;
 };
 
 // Lightweight structure stores parameters to draw a shape.  This will
@@ -189,6 +176,8 @@ private:
     std::string mSkinnedModelFilename = "Models\\soldier.m3d";
     std::unique_ptr<SkinnedModelInstance> mSkinnedModelInst; 
     SkinnedData mSkinnedInfo;
+    std::unique_ptr<CrowdAnimator> mCrowd;
+    BoundingSphere mSkinnedBoundsL;
     std::vector<M3DLoader::Subset> mSkinnedSubsets;
     std::vector<M3DLoader::M3dMaterial> mSkinnedMats;
     std::vector<std::string> mSkinnedTextureNames;
@@ -227,6 +216,19 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
     _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 #endif
 
+    // Run the CPU animation benchmarks without creating a window.
+    if(strstr(cmdLine, "-benchmark") != nullptr)
+    {
+        std::ostringstream report;
+        bool ok = RunAnimationBenchmarks("Models\\soldier.m3d", "Take1", report);
+
+        std::ofstream fout("AnimationBenchmark.txt");
+        fout << report.str();
+        OutputDebugStringA(report.str().c_str());
+
+        return ok ? 0 : 1;
+    }
+
     try
     {
         SkinnedMeshApp theApp(hInstance);
@@ -592,16 +594,32 @@ void SkinnedMeshApp::UpdateSkinnedCBs(const GameTimer& gt)
 {
     auto currSkinnedCB = mCurrFrameResource->SkinnedCB.get();
    
-    // We only have one skinned model being animated.
-    mSkinnedModelInst->UpdateSkinnedAnimation(gt.DeltaTime());
-        
-    SkinnedConstants skinnedConstants;
-    std::copy(
-        std::begin(mSkinnedModelInst->FinalTransforms),
-        std::end(mSkinnedModelInst->FinalTransforms),
-        &skinnedConstants.BoneTransforms[0]);
-
-    currSkinnedCB->CopyData(0, skinnedConstants);
+    // Animation LOD is driven by the main camera.
+    XMMATRIX view = mCamera.GetView();
+    XMMATRIX proj = mCamera.GetProj();
+    XMVECTOR det = XMMatrixDeterminant(view);
+    XMMATRIX invView = XMMatrixInverse(&det, view);
+
+    AnimationLodView lodView;
+    lodView.EyePosW = mCamera.GetPosition3f();
+    BoundingFrustum::CreateFromMatrix(lodView.FrustumW, proj);
+    lodView.FrustumW.Transform(lodView.FrustumW, invView);
+    lodView.ProjScale = 0.5f*mClientHeight*mCamera.GetProj4x4f()(1, 1);
+    mCrowd->SetLodView(lodView);
+
+    // Evaluates every character's palette in parallel.
+    mCrowd->Update(gt.DeltaTime());
+
+    const UINT boneCount = mCrowd->BoneCount();
+    for(UINT i = 0; i < mCrowd->InstanceCount(); ++i)
+    {
+        const BoneTransform3x4* palette = mCrowd->GetPalette(i);
+
+        SkinnedConstants skinnedConstants;
+        std::copy(palette, palette + boneCount, &skinnedConstants.BoneTransforms[0]);
+
+        currSkinnedCB->CopyData(i, skinnedConstants);
+    }
 }
  
 void SkinnedMeshApp::UpdateMaterialBuffer(const GameTimer& gt)
@@ -1283,11 +1301,20 @@ void SkinnedMeshApp::LoadSkinnedModel()
 	m3dLoader.LoadM3d(mSkinnedModelFilename, vertices, indices, 
         mSkinnedSubsets, mSkinnedMats, mSkinnedInfo);
 
+    // Resample the clips into 30 Hz pose tables so the crowd update is a table
+    // fetch per bone.  Clips that do not fit in the budget are sampled live.
+    mSkinnedInfo.BakeClips(30.0f, 8 * 1024 * 1024);
+
+    mCrowd = std::make_unique<CrowdAnimator>(&mSkinnedInfo);
+
     mSkinnedModelInst = std::make_unique<SkinnedModelInstance>();
-    mSkinnedModelInst->SkinnedInfo = &mSkinnedInfo;
-    mSkinnedModelInst->FinalTransforms.resize(mSkinnedInfo.BoneCount());
-    mSkinnedModelInst->ClipName = "Take1";
-    mSkinnedModelInst->TimePos = 0.0f;
+    mSkinnedModelInst->CrowdIndex = mCrowd->AddInstance("Take1", 0.0f);
+    mCrowd->EnableLod(AnimationLodPolicy());
+
+    // Model space bounds; the world space sphere is given to the crowd once the
+    // render item is placed.
+    BoundingSphere::CreateFromPoints(mSkinnedBoundsL, vertices.size(),
+        &vertices[0].Pos, sizeof(M3DLoader::SkinnedVertex));
  
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(SkinnedVertex);
     const UINT ibByteSize = (UINT)indices.size()  * sizeof(std::uint16_t);
@@ -1540,7 +1567,7 @@ void SkinnedMeshApp::BuildFrameResources()
     {
         mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(),
             2, (UINT)mAllRitems.size(), 
-            1,
+            mCrowd->InstanceCount(),
             (UINT)mMaterials.size()));
     }
 }
@@ -1741,6 +1768,10 @@ void SkinnedMeshApp::BuildRenderItems()
         XMMATRIX modelOffset = XMMatrixTranslation(0.0f, 0.0f, -5.0f);
         XMStoreFloat4x4(&ritem->World, modelScale*modelRot*modelOffset);
 
+        BoundingSphere boundsW;
+        mSkinnedBoundsL.Transform(boundsW, modelScale*modelRot*modelOffset);
+        mCrowd->SetBounds(mSkinnedModelInst->CrowdIndex, boundsW);
+
         ritem->TexTransform = MathHelper::Identity4x4();
         ritem->ObjCBIndex = objCBIndex++;
         ritem->Mat = mMaterials[mSkinnedMats[i].Name].get();
@@ -1752,7 +1783,7 @@ void SkinnedMeshApp::BuildRenderItems()
 
         // All render items for this solider.m3d instance share
         // the same skinned model instance.
-        ritem->SkinnedCBIndex = 0;
+        ritem->SkinnedCBIndex = mSkinnedModelInst->CrowdIndex;
         ritem->SkinnedModelInst = mSkinnedModelInst.get();
 
         mRitemLayer[(int)RenderLayer::SkinnedOpaque].push_back(ritem.get());
@@ -6,6 +6,7 @@
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
+#include "../../Common/TextureStreamUploader.h"
 #include "FrameResource.h"
 
 using Microsoft::WRL::ComPtr;
@@ -76,6 +77,7 @@ private:
 	void UpdateObjectCBs(const GameTimer& gt);
 	void UpdateMaterialCBs(const GameTimer& gt);
 	void UpdateMainPassCB(const GameTimer& gt);
+	void UpdateTextureStreaming(const GameTimer& gt);
 
 	void LoadTextures();
     void BuildRootSignature();
@@ -104,9 +106,15 @@ private:
 
 	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeometries;
 	std::unordered_map<std::string, std::unique_ptr<Material>> mMaterials;
-	std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures;
 	std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders;
 
+	// The crate texture is streamed: only its mip tail is loaded at startup, and
+	// finer mips come in as the camera moves closer.
+	TextureCatalog mTextureCatalog;
+	std::unique_ptr<TextureStreamUploader> mTextureUploader;
+	std::unique_ptr<TextureStreamer> mTextureStreamer;
+	UINT mWoodCrateTex = 0;
+
     std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
 
     ComPtr<ID3D12PipelineState> mOpaquePSO = nullptr;
@@ -230,6 +238,7 @@ void CrateApp::Update(const GameTimer& gt)
 	UpdateObjectCBs(gt);
 	UpdateMaterialCBs(gt);
 	UpdateMainPassCB(gt);
+	UpdateTextureStreaming(gt);
 }
 
 void CrateApp::Draw(const GameTimer& gt)
@@ -244,6 +253,9 @@ void CrateApp::Draw(const GameTimer& gt)
     // Reusing the command list reuses memory.
     ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mOpaquePSO.Get()));
 
+	// Swap in any texture mips the streamer asked for.
+	mTextureUploader->RecordUploads(mCommandList.Get(), mCurrentFence + 1);
+
     mCommandList->RSSetViewports(1, &mScreenViewport);
     mCommandList->RSSetScissorRects(1, &mScissorRect);
 
@@ -339,6 +351,13 @@ void CrateApp::OnMouseMove(WPARAM btnState, int x, int y)
  
 void CrateApp::OnKeyboardInput(const GameTimer& gt)
 {
+	// '1' gives the streamer too little memory for the finer crate mips, '2'
+	// restores the default budget.
+	if(GetAsyncKeyState('1') & 0x8000)
+		mTextureStreamer->SetBudget(128 * 1024);
+
+	if(GetAsyncKeyState('2') & 0x8000)
+		mTextureStreamer->SetBudget(64 * 1024 * 1024);
 }
  
 void CrateApp::UpdateCamera(const GameTimer& gt)
@@ -447,16 +466,37 @@ void CrateApp::UpdateMainPassCB(const GameTimer& gt)
 	currPassCB->CopyData(0, mMainPassCB);
 }
 
+void CrateApp::UpdateTextureStreaming(const GameTimer& gt)
+{
+	// The frame resource wait above guarantees these frames are done.
+	mTextureUploader->ReleaseCompleted(mFence->GetCompletedValue());
+
+	// The box is at the origin and each face is one unit across.
+	float distance = mRadius;
+	float screenSize = mProj(1, 1) * 0.5f*mClientHeight / distance;
+	mTextureStreamer->RequestTexture(mWoodCrateTex, distance, screenSize);
+
+	mTextureStreamer->Update();
+
+	std::wostringstream outs;
+	outs << L"Crate Demo" <<
+		L"    mip: " << mTextureUploader->GetResidentMip(mWoodCrateTex) <<
+		L" (wants " << mTextureStreamer->GetWantedMip(mWoodCrateTex) << L")" <<
+		L"    resident: " << mTextureStreamer->GetResidentBytes() / 1024 << L" KB";
+	mMainWndCaption = outs.str();
+}
+
 void CrateApp::LoadTextures()
 {
-	auto woodCrateTex = std::make_unique<Texture>();
-	woodCrateTex->Name = "woodCrateTex";
-	woodCrateTex->Filename = L"../../Textures/WoodCrate01.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), woodCrateTex->Filename.c_str(),
-		woodCrateTex->Resource, woodCrateTex->UploadHeap));
- 
-	mTextures[woodCrateTex->Name] = std::move(woodCrateTex);
+	// The index is generated, so it is kept next to the executable rather than
+	// in the Textures directory, which is under source control.
+	wchar_t exeFilename[MAX_PATH];
+	DWORD length = GetModuleFileNameW(nullptr, exeFilename, MAX_PATH);
+	std::wstring indexFilename(exeFilename, length);
+	indexFilename = indexFilename.substr(0, indexFilename.find_last_of(L"\\/") + 1) + L"TextureCatalog.bin";
+
+	// Only the headers are read here; texel data is loaded by the streamer.
+	mTextureCatalog.LoadOrBuild(L"../../Textures", indexFilename);
 }
 
 void CrateApp::BuildRootSignature()
@@ -505,27 +545,27 @@ void CrateApp::BuildDescriptorHeaps()
 	// Create the SRV heap.
 	//
 	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-	srvHeapDesc.NumDescriptors = 1;
+	srvHeapDesc.NumDescriptors = TextureStreamUploader::SrvSlotsPerTexture();
 	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
 	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&mSrvDescriptorHeap)));
 
 	//
-	// Fill out the heap with actual descriptors.
+	// The uploader fills out the heap as the texture streams in.
 	//
-	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
+	const TextureCatalogEntry* woodCrateEntry = mTextureCatalog.Find(L"WoodCrate01.dds");
+	if(woodCrateEntry == nullptr)
+		ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
 
-	auto woodCrateTex = mTextures["woodCrateTex"]->Resource;
- 
-	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc.Format = woodCrateTex->GetDesc().Format;
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-	srvDesc.Texture2D.MipLevels = woodCrateTex->GetDesc().MipLevels;
-	srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-
-	md3dDevice->CreateShaderResourceView(woodCrateTex.Get(), &srvDesc, hDescriptor);
+	mTextureUploader = std::make_unique<TextureStreamUploader>(md3dDevice.Get(),
+		mTextureCatalog, mSrvDescriptorHeap.Get(), 0);
+	mTextureStreamer = std::make_unique<TextureStreamer>(*mTextureUploader, 64 * 1024 * 1024);
+
+	mTextureUploader->AddTexture(*woodCrateEntry);
+	mWoodCrateTex = mTextureStreamer->AddTexture(*woodCrateEntry);
+
+	// Record the mip tail upload with the other initialization commands.
+	mTextureUploader->RecordUploads(mCommandList.Get(), mCurrentFence + 1);
 }
 
 void CrateApp::BuildShadersAndInputLayout()
@@ -638,7 +678,7 @@ void CrateApp::BuildMaterials()
 	auto woodCrate = std::make_unique<Material>();
 	woodCrate->Name = "woodCrate";
 	woodCrate->MatCBIndex = 0;
-	woodCrate->DiffuseSrvHeapIndex = 0;
+	woodCrate->DiffuseSrvHeapIndex = mWoodCrateTex;
 	woodCrate->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	woodCrate->FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05f);
 	woodCrate->Roughness = 0.2f;
@@ -680,8 +720,9 @@ void CrateApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::ve
         cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
         cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
 
+		// DiffuseSrvHeapIndex is the streamed texture; its view moves between slots.
 		CD3DX12_GPU_DESCRIPTOR_HANDLE tex(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-		tex.Offset(ri->Mat->DiffuseSrvHeapIndex, mCbvSrvDescriptorSize);
+		tex.Offset(mTextureUploader->GetSrvIndex(ri->Mat->DiffuseSrvHeapIndex), mCbvSrvDescriptorSize);
 
         D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex*objCBByteSize;
 		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + ri->Mat->MatCBIndex*matCBByteSize;
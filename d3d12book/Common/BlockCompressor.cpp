@@ -0,0 +1,837 @@
+//***************************************************************************************
+// BlockCompressor.cpp
+//***************************************************************************************
+
+#include "BlockCompressor.h"
+#include "MathHelper.h"
+#include "ThreadPool.h"
+#include <cfloat>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+using namespace DirectX;
+
+namespace
+{
+	// Interpolation weights (out of 64) of the 4-bit BC7 indices.
+	const UINT Bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// Weight of e1 for each index of a four-color BC1 block, and of an eight-value
+	// BC4 block.
+	const float Bc1Weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	const float Bc4Weights[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+
+	// The 16 texels of a block in structure-of-arrays form: lane j of
+	// Channel[c][g] is channel c of texel 4g+j, as a float in [0, 255].
+	struct BlockTexels
+	{
+		XMVECTOR Channel[4][4];
+	};
+
+	void LoadBlock(const ImageRGBA8& image, UINT blockX, UINT blockY, BlockTexels& block)
+	{
+		float values[4][16];
+		for(UINT i = 0; i < 16; ++i)
+		{
+			UINT x = MathHelper::Min(blockX*4 + i % 4, image.Width - 1);
+			UINT y = MathHelper::Min(blockY*4 + i / 4, image.Height - 1);
+			const uint8_t* texel = &image.Texels[((size_t)y*image.Width + x)*4];
+
+			for(UINT c = 0; c < 4; ++c)
+				values[c][i] = texel[c];
+		}
+
+		for(UINT c = 0; c < 4; ++c)
+		{
+			for(UINT g = 0; g < 4; ++g)
+				block.Channel[c][g] = XMLoadFloat4((const XMFLOAT4*)&values[c][g*4]);
+		}
+	}
+
+	float HorizontalSum(FXMVECTOR v)
+	{
+		XMFLOAT4 f;
+		XMStoreFloat4(&f, v);
+		return f.x + f.y + f.z + f.w;
+	}
+
+	float HorizontalMin(FXMVECTOR v)
+	{
+		XMFLOAT4 f;
+		XMStoreFloat4(&f, v);
+		return MathHelper::Min(MathHelper::Min(f.x, f.y), MathHelper::Min(f.z, f.w));
+	}
+
+	float HorizontalMax(FXMVECTOR v)
+	{
+		XMFLOAT4 f;
+		XMStoreFloat4(&f, v);
+		return MathHelper::Max(MathHelper::Max(f.x, f.y), MathHelper::Max(f.z, f.w));
+	}
+
+	// Picks for every texel the palette entry nearest to it in channels
+	// [firstChannel, firstChannel + channelCount), where component c of an entry
+	// holds channel firstChannel + c.  Returns the summed squared error.  Texels
+	// flagged in transparent (BC1 only) must take entry transparentIndex, which
+	// no other texel may take; their color is lost, which is not counted as error.
+	float SelectIndices(const BlockTexels& block, UINT firstChannel, UINT channelCount,
+		const XMFLOAT4* palette, UINT paletteSize, UINT indices[16],
+		const XMVECTOR* transparent = nullptr, UINT transparentIndex = 0)
+	{
+		const XMVECTOR never = XMVectorReplicate(FLT_MAX);
+
+		float error = 0.0f;
+		for(UINT g = 0; g < 4; ++g)
+		{
+			XMVECTOR best = never;
+			XMVECTOR bestIndex = XMVectorZero();
+			for(UINT k = 0; k < paletteSize; ++k)
+			{
+				const float* entry = &palette[k].x;
+
+				XMVECTOR dist = XMVectorZero();
+				for(UINT c = 0; c < channelCount; ++c)
+				{
+					XMVECTOR diff = XMVectorSubtract(block.Channel[firstChannel + c][g], XMVectorReplicate(entry[c]));
+					dist = XMVectorMultiplyAdd(diff, diff, dist);
+				}
+
+				if(transparent != nullptr)
+				{
+					dist = k == transparentIndex ?
+						XMVectorSelect(never, XMVectorZero(), transparent[g]) :
+						XMVectorSelect(dist, never, transparent[g]);
+				}
+
+				XMVECTOR closer = XMVectorLess(dist, best);
+				best = XMVectorSelect(best, dist, closer);
+				bestIndex = XMVectorSelect(bestIndex, XMVectorReplicate((float)k), closer);
+			}
+
+			error += HorizontalSum(best);
+
+			XMFLOAT4 index;
+			XMStoreFloat4(&index, bestIndex);
+			indices[g*4 + 0] = (UINT)index.x;
+			indices[g*4 + 1] = (UINT)index.y;
+			indices[g*4 + 2] = (UINT)index.z;
+			indices[g*4 + 3] = (UINT)index.w;
+		}
+
+		return error;
+	}
+
+	// Finds the line through the texels (those with a nonzero include lane) that
+	// best fits channels [0, channelCount), and the extent of the texels along
+	// it.  The block's endpoints start at the two ends.
+	void FitLine(const BlockTexels& block, UINT channelCount, const XMVECTOR* include,
+		float e0[4], float e1[4])
+	{
+		XMVECTOR weight[4];
+		float count = 0.0f;
+		for(UINT g = 0; g < 4; ++g)
+		{
+			weight[g] = include != nullptr ?
+				XMVectorSelect(XMVectorZero(), XMVectorReplicate(1.0f), include[g]) :
+				XMVectorReplicate(1.0f);
+			count += HorizontalSum(weight[g]);
+		}
+
+		float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		if(count > 0.0f)
+		{
+			for(UINT c = 0; c < channelCount; ++c)
+			{
+				XMVECTOR sum = XMVectorZero();
+				for(UINT g = 0; g < 4; ++g)
+					sum = XMVectorMultiplyAdd(block.Channel[c][g], weight[g], sum);
+				mean[c] = HorizontalSum(sum) / count;
+			}
+		}
+
+		XMVECTOR centered[4][4];
+		for(UINT c = 0; c < channelCount; ++c)
+		{
+			for(UINT g = 0; g < 4; ++g)
+				centered[c][g] = XMVectorMultiply(XMVectorSubtract(block.Channel[c][g], XMVectorReplicate(mean[c])), weight[g]);
+		}
+
+		float cov[4][4] = {};
+		for(UINT i = 0; i < channelCount; ++i)
+		{
+			for(UINT j = i; j < channelCount; ++j)
+			{
+				XMVECTOR sum = XMVectorZero();
+				for(UINT g = 0; g < 4; ++g)
+					sum = XMVectorMultiplyAdd(centered[i][g], centered[j][g], sum);
+				cov[i][j] = cov[j][i] = HorizontalSum(sum);
+			}
+		}
+
+		// Power iteration, starting from the row of the covariance with the largest
+		// diagonal so a start orthogonal to the answer is unlikely.
+		UINT start = 0;
+		for(UINT c = 1; c < channelCount; ++c)
+		{
+			if(cov[c][c] > cov[start][start])
+				start = c;
+		}
+
+		float axis[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for(UINT c = 0; c < channelCount; ++c)
+			axis[c] = cov[start][c];
+
+		bool found = false;
+		for(UINT iter = 0; iter < 8; ++iter)
+		{
+			float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			float lengthSq = 0.0f;
+			for(UINT i = 0; i < channelCount; ++i)
+			{
+				for(UINT j = 0; j < channelCount; ++j)
+					next[i] += cov[i][j]*axis[j];
+				lengthSq += next[i]*next[i];
+			}
+
+			if(lengthSq < 1e-12f)
+				break;
+
+			float invLength = 1.0f / sqrtf(lengthSq);
+			for(UINT c = 0; c < channelCount; ++c)
+				axis[c] = next[c]*invLength;
+			found = true;
+		}
+
+		// A block of one color has no spread; any direction will do.
+		if(!found)
+		{
+			for(UINT c = 0; c < channelCount; ++c)
+				axis[c] = 1.0f / sqrtf((float)channelCount);
+		}
+
+		XMVECTOR tMin = XMVectorReplicate(FLT_MAX);
+		XMVECTOR tMax = XMVectorReplicate(-FLT_MAX);
+		for(UINT g = 0; g < 4; ++g)
+		{
+			XMVECTOR t = XMVectorZero();
+			for(UINT c = 0; c < channelCount; ++c)
+				t = XMVectorMultiplyAdd(XMVectorSubtract(block.Channel[c][g], XMVectorReplicate(mean[c])), XMVectorReplicate(axis[c]), t);
+
+			XMVECTOR counted = include != nullptr ? include[g] : XMVectorTrueInt();
+			tMin = XMVectorMin(tMin, XMVectorSelect(XMVectorReplicate(FLT_MAX), t, counted));
+			tMax = XMVectorMax(tMax, XMVectorSelect(XMVectorReplicate(-FLT_MAX), t, counted));
+		}
+
+		float lo = count > 0.0f ? HorizontalMin(tMin) : 0.0f;
+		float hi = count > 0.0f ? HorizontalMax(tMax) : 0.0f;
+		for(UINT c = 0; c < 4; ++c)
+		{
+			e0[c] = MathHelper::Clamp(mean[c] + lo*axis[c], 0.0f, 255.0f);
+			e1[c] = MathHelper::Clamp(mean[c] + hi*axis[c], 0.0f, 255.0f);
+		}
+	}
+
+	// Least-squares endpoints for texels that sit at weights[i] of the way from e0
+	// to e1.  Texels with a negative weight are left out.  Returns false if the
+	// weights do not pin down both endpoints.
+	bool FitEndpoints(const BlockTexels& block, UINT firstChannel, UINT channelCount,
+		const float weights[16], float e0[4], float e1[4])
+	{
+		XMVECTOR a[4], b[4];
+		XMVECTOR aa = XMVectorZero();
+		XMVECTOR ab = XMVectorZero();
+		XMVECTOR bb = XMVectorZero();
+		for(UINT g = 0; g < 4; ++g)
+		{
+			XMVECTOR w = XMLoadFloat4((const XMFLOAT4*)&weights[g*4]);
+			XMVECTOR used = XMVectorGreaterOrEqual(w, XMVectorZero());
+			b[g] = XMVectorSelect(XMVectorZero(), w, used);
+			a[g] = XMVectorSelect(XMVectorZero(), XMVectorSubtract(XMVectorReplicate(1.0f), w), used);
+
+			aa = XMVectorMultiplyAdd(a[g], a[g], aa);
+			ab = XMVectorMultiplyAdd(a[g], b[g], ab);
+			bb = XMVectorMultiplyAdd(b[g], b[g], bb);
+		}
+
+		float sumAA = HorizontalSum(aa);
+		float sumAB = HorizontalSum(ab);
+		float sumBB = HorizontalSum(bb);
+		float det = sumAA*sumBB - sumAB*sumAB;
+		if(fabsf(det) < 1e-6f)
+			return false;
+
+		float invDet = 1.0f / det;
+		for(UINT c = 0; c < channelCount; ++c)
+		{
+			XMVECTOR ax = XMVectorZero();
+			XMVECTOR bx = XMVectorZero();
+			for(UINT g = 0; g < 4; ++g)
+			{
+				ax = XMVectorMultiplyAdd(a[g], block.Channel[firstChannel + c][g], ax);
+				bx = XMVectorMultiplyAdd(b[g], block.Channel[firstChannel + c][g], bx);
+			}
+
+			float sumAX = HorizontalSum(ax);
+			float sumBX = HorizontalSum(bx);
+			e0[c] = MathHelper::Clamp((sumBB*sumAX - sumAB*sumBX)*invDet, 0.0f, 255.0f);
+			e1[c] = MathHelper::Clamp((sumAA*sumBX - sumAB*sumAX)*invDet, 0.0f, 255.0f);
+		}
+
+		return true;
+	}
+
+	uint16_t PackRgb565(const float c[3])
+	{
+		UINT r = (UINT)MathHelper::Clamp(c[0]*31.0f/255.0f + 0.5f, 0.0f, 31.0f);
+		UINT g = (UINT)MathHelper::Clamp(c[1]*63.0f/255.0f + 0.5f, 0.0f, 63.0f);
+		UINT b = (UINT)MathHelper::Clamp(c[2]*31.0f/255.0f + 0.5f, 0.0f, 31.0f);
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	void UnpackRgb565(uint16_t v, UINT c[3])
+	{
+		UINT r = (v >> 11) & 31;
+		UINT g = (v >> 5) & 63;
+		UINT b = v & 31;
+		c[0] = (r << 3) | (r >> 2);
+		c[1] = (g << 2) | (g >> 4);
+		c[2] = (b << 3) | (b >> 2);
+	}
+
+	// The colors a BC1 color block decodes to.  Entry 3 of a three-color block is
+	// transparent black.
+	void Bc1Palette(uint16_t color0, uint16_t color1, bool fourColor, XMFLOAT4 palette[4])
+	{
+		UINT c0[3], c1[3];
+		UnpackRgb565(color0, c0);
+		UnpackRgb565(color1, c1);
+
+		for(UINT c = 0; c < 3; ++c)
+		{
+			float* entry[4] = { &palette[0].x + c, &palette[1].x + c, &palette[2].x + c, &palette[3].x + c };
+			*entry[0] = (float)c0[c];
+			*entry[1] = (float)c1[c];
+			if(fourColor)
+			{
+				*entry[2] = (float)((2*c0[c] + c1[c] + 1) / 3);
+				*entry[3] = (float)((c0[c] + 2*c1[c] + 1) / 3);
+			}
+			else
+			{
+				*entry[2] = (float)((c0[c] + c1[c] + 1) / 2);
+				*entry[3] = 0.0f;
+			}
+		}
+	}
+
+	// Encodes the RGB of block as a BC1 color block.  For BC1 itself (not the color
+	// half of BC3), blocks with texels whose alpha is below 128 use the three-color
+	// mode, which makes those texels transparent.  If opaqueCount is given, it is
+	// set to the number of texels that keep their color, and so count as error.
+	float EncodeColorBlock(const BlockTexels& block, bool allowTransparent, uint8_t* out,
+		UINT* opaqueCount = nullptr)
+	{
+		XMVECTOR transparent[4];
+		XMVECTOR opaque[4];
+		XMVECTOR anyTransparent = XMVectorFalseInt();
+		float opaqueTexels = 0.0f;
+		for(UINT g = 0; g < 4; ++g)
+		{
+			transparent[g] = allowTransparent ?
+				XMVectorLess(block.Channel[3][g], XMVectorReplicate(127.5f)) :
+				XMVectorFalseInt();
+			opaque[g] = XMVectorNotEqualInt(transparent[g], XMVectorTrueInt());
+			anyTransparent = XMVectorOrInt(anyTransparent, transparent[g]);
+			opaqueTexels += HorizontalSum(XMVectorSelect(XMVectorSplatOne(), XMVectorZero(), transparent[g]));
+		}
+
+		if(opaqueCount != nullptr)
+			*opaqueCount = (UINT)opaqueTexels;
+
+		const bool fourColor = !XMVector4NotEqualInt(anyTransparent, XMVectorFalseInt());
+
+		float e0[4], e1[4];
+		FitLine(block, 3, opaque, e0, e1);
+
+		float bestError = FLT_MAX;
+		uint16_t bestColor0 = 0;
+		uint16_t bestColor1 = 0;
+		UINT bestIndices[16] = {};
+		for(UINT iter = 0; iter < 3; ++iter)
+		{
+			uint16_t color0 = PackRgb565(e1);
+			uint16_t color1 = PackRgb565(e0);
+
+			XMFLOAT4 palette[4];
+			Bc1Palette(color0, color1, fourColor, palette);
+
+			UINT indices[16];
+			float error = SelectIndices(block, 0, 3, palette, 4, indices,
+				fourColor ? nullptr : transparent, 3);
+
+			if(error < bestError)
+			{
+				bestError = error;
+				bestColor0 = color0;
+				bestColor1 = color1;
+				std::copy(indices, indices + 16, bestIndices);
+			}
+
+			// Refit the endpoints to the texels each palette entry took.  e1 went
+			// into color0, which is entry 0.
+			float weights[16];
+			for(UINT i = 0; i < 16; ++i)
+			{
+				if(fourColor)
+					weights[i] = 1.0f - Bc1Weights[indices[i]];
+				else
+					weights[i] = indices[i] == 3 ? -1.0f : (indices[i] == 2 ? 0.5f : 1.0f - (float)indices[i]);
+			}
+
+			if(!FitEndpoints(block, 0, 3, weights, e0, e1))
+				break;
+		}
+
+		// The order of the endpoints selects the mode.
+		if(fourColor)
+		{
+			if(bestColor0 < bestColor1)
+			{
+				std::swap(bestColor0, bestColor1);
+				for(UINT i = 0; i < 16; ++i)
+					bestIndices[i] ^= 1;
+			}
+			else if(bestColor0 == bestColor1)
+			{
+				// Decodes in three-color mode, where only entry 0 is the same color.
+				std::fill(bestIndices, bestIndices + 16, 0);
+			}
+		}
+		else if(bestColor0 > bestColor1)
+		{
+			std::swap(bestColor0, bestColor1);
+			for(UINT i = 0; i < 16; ++i)
+			{
+				if(bestIndices[i] < 2)
+					bestIndices[i] ^= 1;
+			}
+		}
+
+		uint32_t indexBits = 0;
+		for(UINT i = 0; i < 16; ++i)
+			indexBits |= bestIndices[i] << (2*i);
+
+		out[0] = (uint8_t)(bestColor0 & 0xff);
+		out[1] = (uint8_t)(bestColor0 >> 8);
+		out[2] = (uint8_t)(bestColor1 & 0xff);
+		out[3] = (uint8_t)(bestColor1 >> 8);
+		for(UINT i = 0; i < 4; ++i)
+			out[4 + i] = (uint8_t)(indexBits >> (8*i));
+
+		return bestError;
+	}
+
+	// The values a BC4 block decodes to.  a0 > a1 selects eight interpolated
+	// values; otherwise there are six, plus 0 and 255.
+	void Bc4Palette(UINT a0, UINT a1, XMFLOAT4 palette[8])
+	{
+		palette[0].x = (float)a0;
+		palette[1].x = (float)a1;
+		if(a0 > a1)
+		{
+			for(UINT i = 1; i < 7; ++i)
+				palette[i + 1].x = (float)(((7 - i)*a0 + i*a1 + 3) / 7);
+		}
+		else
+		{
+			for(UINT i = 1; i < 5; ++i)
+				palette[i + 1].x = (float)(((5 - i)*a0 + i*a1 + 2) / 5);
+			palette[6].x = 0.0f;
+			palette[7].x = 255.0f;
+		}
+	}
+
+	UINT RoundToByte(float v)
+	{
+		return (UINT)MathHelper::Clamp(v + 0.5f, 0.0f, 255.0f);
+	}
+
+	// Encodes one channel of block as a BC4 block, which is also the alpha half
+	// of BC3 and each half of BC5.
+	float EncodeBc4Block(const BlockTexels& block, UINT channel, uint8_t* out)
+	{
+		XMVECTOR lo = XMVectorReplicate(FLT_MAX);
+		XMVECTOR hi = XMVectorReplicate(-FLT_MAX);
+		XMVECTOR innerLo = XMVectorReplicate(FLT_MAX);
+		XMVECTOR innerHi = XMVectorReplicate(-FLT_MAX);
+		for(UINT g = 0; g < 4; ++g)
+		{
+			XMVECTOR v = block.Channel[channel][g];
+			lo = XMVectorMin(lo, v);
+			hi = XMVectorMax(hi, v);
+
+			// The six-value mode has 0 and 255 for free, so its endpoints only
+			// need to span the other values.
+			XMVECTOR inner = XMVectorAndInt(XMVectorGreater(v, XMVectorZero()), XMVectorLess(v, XMVectorReplicate(255.0f)));
+			innerLo = XMVectorMin(innerLo, XMVectorSelect(XMVectorReplicate(FLT_MAX), v, inner));
+			innerHi = XMVectorMax(innerHi, XMVectorSelect(XMVectorReplicate(-FLT_MAX), v, inner));
+		}
+
+		float bestError = FLT_MAX;
+		UINT bestA0 = 0;
+		UINT bestA1 = 0;
+		UINT bestIndices[16] = {};
+
+		auto tryEndpoints = [&](UINT a0, UINT a1, UINT indices[16])
+		{
+			XMFLOAT4 palette[8];
+			Bc4Palette(a0, a1, palette);
+
+			float error = SelectIndices(block, channel, 1, palette, 8, indices);
+			if(error < bestError)
+			{
+				bestError = error;
+				bestA0 = a0;
+				bestA1 = a1;
+				std::copy(indices, indices + 16, bestIndices);
+			}
+		};
+
+		// Eight-value mode over the full range, then refit once.
+		UINT a0 = RoundToByte(HorizontalMax(hi));
+		UINT a1 = RoundToByte(HorizontalMin(lo));
+		UINT indices[16];
+		tryEndpoints(a0, a1, indices);
+
+		if(a0 > a1)
+		{
+			float weights[16];
+			for(UINT i = 0; i < 16; ++i)
+				weights[i] = Bc4Weights[indices[i]];
+
+			float e0[4], e1[4];
+			if(FitEndpoints(block, channel, 1, weights, e0, e1))
+			{
+				UINT fit0 = RoundToByte(e0[0]);
+				UINT fit1 = RoundToByte(e1[0]);
+				if(fit0 != fit1)
+					tryEndpoints(MathHelper::Max(fit0, fit1), MathHelper::Min(fit0, fit1), indices);
+			}
+		}
+
+		// Six-value mode, when some values are not 0 or 255.
+		float innerMin = HorizontalMin(innerLo);
+		float innerMax = HorizontalMax(innerHi);
+		if(innerMin <= innerMax)
+			tryEndpoints(RoundToByte(innerMin), RoundToByte(innerMax), indices);
+		else
+			tryEndpoints(0, 255, indices);
+
+		uint64_t indexBits = 0;
+		for(UINT i = 0; i < 16; ++i)
+			indexBits |= (uint64_t)bestIndices[i] << (3*i);
+
+		out[0] = (uint8_t)bestA0;
+		out[1] = (uint8_t)bestA1;
+		for(UINT i = 0; i < 6; ++i)
+			out[2 + i] = (uint8_t)(indexBits >> (8*i));
+
+		return bestError;
+	}
+
+	// Appends bits to a 128-bit BC7 block, least significant first.
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(uint8_t* out) : mOut(out)
+		{
+			std::fill(mOut, mOut + 16, (uint8_t)0);
+		}
+
+		void Write(UINT value, UINT bitCount)
+		{
+			for(UINT i = 0; i < bitCount; ++i, ++mPos)
+			{
+				if(value & (1u << i))
+					mOut[mPos / 8] |= (uint8_t)(1u << (mPos % 8));
+			}
+		}
+
+	private:
+		uint8_t* mOut = nullptr;
+		UINT mPos = 0;
+	};
+
+	// Encodes block as a BC7 mode 6 block.
+	float EncodeBc7Block(const BlockTexels& block, uint8_t* out)
+	{
+		float e0[4], e1[4];
+		FitLine(block, 4, nullptr, e0, e1);
+
+		float bestError = FLT_MAX;
+		UINT bestQ0[4] = {}, bestQ1[4] = {};
+		UINT bestP0 = 0, bestP1 = 0;
+		UINT bestIndices[16] = {};
+		for(UINT iter = 0; iter < 3; ++iter)
+		{
+			float iterError = FLT_MAX;
+			UINT iterIndices[16] = {};
+
+			// Each endpoint is 7 bits per channel plus a p-bit shared by its
+			// channels; try every pair of p-bits.
+			for(UINT p = 0; p < 4; ++p)
+			{
+				UINT p0 = p & 1;
+				UINT p1 = p >> 1;
+
+				UINT q0[4], q1[4], v0[4], v1[4];
+				for(UINT c = 0; c < 4; ++c)
+				{
+					q0[c] = (UINT)MathHelper::Clamp((e0[c] - p0)*0.5f + 0.5f, 0.0f, 127.0f);
+					q1[c] = (UINT)MathHelper::Clamp((e1[c] - p1)*0.5f + 0.5f, 0.0f, 127.0f);
+					v0[c] = (q0[c] << 1) | p0;
+					v1[c] = (q1[c] << 1) | p1;
+				}
+
+				XMFLOAT4 palette[16];
+				for(UINT k = 0; k < 16; ++k)
+				{
+					float* entry = &palette[k].x;
+					for(UINT c = 0; c < 4; ++c)
+						entry[c] = (float)(((64 - Bc7Weights4[k])*v0[c] + Bc7Weights4[k]*v1[c] + 32) >> 6);
+				}
+
+				UINT indices[16];
+				float error = SelectIndices(block, 0, 4, palette, 16, indices);
+				if(error < iterError)
+				{
+					iterError = error;
+					std::copy(indices, indices + 16, iterIndices);
+				}
+
+				if(error < bestError)
+				{
+					bestError = error;
+					std::copy(q0, q0 + 4, bestQ0);
+					std::copy(q1, q1 + 4, bestQ1);
+					bestP0 = p0;
+					bestP1 = p1;
+					std::copy(indices, indices + 16, bestIndices);
+				}
+			}
+
+			float weights[16];
+			for(UINT i = 0; i < 16; ++i)
+				weights[i] = Bc7Weights4[iterIndices[i]] / 64.0f;
+
+			if(!FitEndpoints(block, 0, 4, weights, e0, e1))
+				break;
+		}
+
+		// The first index is stored with its top bit implied to be zero.
+		if(bestIndices[0] >= 8)
+		{
+			std::swap(bestQ0, bestQ1);
+			std::swap(bestP0, bestP1);
+			for(UINT i = 0; i < 16; ++i)
+				bestIndices[i] = 15 - bestIndices[i];
+		}
+
+		BitWriter bits(out);
+		bits.Write(1 << 6, 7);
+		for(UINT c = 0; c < 4; ++c)
+		{
+			bits.Write(bestQ0[c], 7);
+			bits.Write(bestQ1[c], 7);
+		}
+		bits.Write(bestP0, 1);
+		bits.Write(bestP1, 1);
+		bits.Write(bestIndices[0], 3);
+		for(UINT i = 1; i < 16; ++i)
+			bits.Write(bestIndices[i], 4);
+
+		return bestError;
+	}
+
+	UINT StoredChannelCount(DXGI_FORMAT format)
+	{
+		switch(format)
+		{
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+			return 3;
+
+		case DXGI_FORMAT_BC4_UNORM:
+			return 1;
+
+		case DXGI_FORMAT_BC5_UNORM:
+			return 2;
+
+		default:
+			return 4;
+		}
+	}
+
+	// Returns the summed squared error of the block, and in samples the number of
+	// channel values it was summed over.
+	float EncodeBlock(DXGI_FORMAT format, const BlockTexels& block, uint8_t* out, UINT& samples)
+	{
+		UINT texels = 16;
+		float error = 0.0f;
+		switch(format)
+		{
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+			error = EncodeColorBlock(block, true, out, &texels);
+			break;
+
+		case DXGI_FORMAT_BC3_UNORM:
+		case DXGI_FORMAT_BC3_UNORM_SRGB:
+			error = EncodeBc4Block(block, 3, out) + EncodeColorBlock(block, false, out + 8);
+			break;
+
+		case DXGI_FORMAT_BC4_UNORM:
+			error = EncodeBc4Block(block, 0, out);
+			break;
+
+		case DXGI_FORMAT_BC5_UNORM:
+			error = EncodeBc4Block(block, 0, out) + EncodeBc4Block(block, 1, out + 8);
+			break;
+
+		default:
+			error = EncodeBc7Block(block, out);
+			break;
+		}
+
+		samples = texels*StoredChannelCount(format);
+		return error;
+	}
+}
+
+bool BlockCompressor::IsSupported(DXGI_FORMAT format)
+{
+	switch(format)
+	{
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+bool BlockCompressor::Compress(const ImageRGBA8& image, DXGI_FORMAT format, std::vector<uint8_t>& blocks,
+	ThreadPool& threadPool, BlockCompressionStats* stats)
+{
+	if(!IsSupported(format) || image.Width == 0 || image.Height == 0 ||
+		image.Texels.size() < (size_t)image.Width*image.Height*4)
+	{
+		return false;
+	}
+
+	const UINT blockBytes = (UINT)BitsPerPixel(format)*2;
+	const UINT blocksWide = (image.Width + 3) / 4;
+	const UINT blocksHigh = (image.Height + 3) / 4;
+	blocks.resize((size_t)blocksWide*blocksHigh*blockBytes);
+
+	__int64 countsPerSec = 0;
+	__int64 start = 0;
+	__int64 stop = 0;
+	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
+	QueryPerformanceCounter((LARGE_INTEGER*)&start);
+
+	// One squared error sum, and count of the values summed, per row of blocks,
+	// so the threads never share one.
+	std::vector<double> rowErrors(blocksHigh, 0.0);
+	std::vector<UINT64> rowSamples(blocksHigh, 0);
+	threadPool.ParallelFor(blocksHigh, 1, [&](UINT begin, UINT end, UINT threadIndex)
+	{
+		BlockTexels block;
+		for(UINT by = begin; by < end; ++by)
+		{
+			double error = 0.0;
+			UINT64 samples = 0;
+			for(UINT bx = 0; bx < blocksWide; ++bx)
+			{
+				LoadBlock(image, bx, by, block);
+
+				UINT blockSamples = 0;
+				error += EncodeBlock(format, block, &blocks[((size_t)by*blocksWide + bx)*blockBytes], blockSamples);
+				samples += blockSamples;
+			}
+			rowErrors[by] = error;
+			rowSamples[by] = samples;
+		}
+	});
+
+	QueryPerformanceCounter((LARGE_INTEGER*)&stop);
+
+	if(stats != nullptr)
+	{
+		double error = 0.0;
+		UINT64 samples = 0;
+		for(UINT by = 0; by < blocksHigh; ++by)
+		{
+			error += rowErrors[by];
+			samples += rowSamples[by];
+		}
+
+		// Padding texels of edge blocks are counted too; they repeat real ones.
+		// An image BC1 makes entirely transparent has nothing to lose.
+		double mse = samples > 0 ? error / samples : 0.0;
+
+		stats->Psnr = mse > 0.0 ? 10.0*log10(255.0*255.0 / mse) : std::numeric_limits<double>::infinity();
+		stats->Seconds = (double)(stop - start) / (double)countsPerSec;
+		stats->MPixelsPerSecond = stats->Seconds > 0.0 ?
+			(double)image.Width*image.Height / stats->Seconds / 1000000.0 : 0.0;
+	}
+
+	return true;
+}
+
+bool BlockCompressor::SaveDDSTexture(const std::wstring& filename, DXGI_FORMAT format,
+	UINT width, UINT height, const std::vector<std::vector<uint8_t>>& mips)
+{
+	DDS_TEXTURE_DESC desc = {};
+	desc.dimension = DDS_DIMENSION_TEXTURE2D;
+	desc.width = width;
+	desc.height = height;
+	desc.depth = 1;
+	desc.arraySize = 1;
+	desc.mipCount = (uint32_t)mips.size();
+	desc.format = format;
+	desc.isCubeMap = false;
+	desc.alphaMode = DDS_ALPHA_MODE_UNKNOWN;
+
+	std::vector<DDS_SUBRESOURCE_LAYOUT> layouts;
+	GetDDSSubresourceLayouts(desc, layouts);
+	if(mips.empty())
+		return false;
+
+	for(size_t i = 0; i < mips.size(); ++i)
+	{
+		if(mips[i].size() != layouts[i].slicePitch)
+			return false;
+	}
+
+	uint8_t header[DDS_MAX_HEADER_SIZE];
+	size_t headerSize = WriteDDSHeader(desc, header);
+
+	std::ofstream fout(filename, std::ios::binary);
+	if(!fout)
+		return false;
+
+	fout.write((const char*)header, headerSize);
+	for(const std::vector<uint8_t>& mip : mips)
+		fout.write((const char*)mip.data(), mip.size());
+
+	return fout.good();
+}
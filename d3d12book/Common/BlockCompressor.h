@@ -0,0 +1,64 @@
+//***************************************************************************************
+// BlockCompressor.h
+//
+// CPU encoder for the block-compressed formats: BC1 and BC3 for color (BC3 adds a
+// separate alpha block), BC4 for one channel, BC5 for two (tangent-space normal
+// maps keep x and y in red and green), and BC7 for higher quality color.  The
+// endpoints of each 4x4 block start on the principal axis of its texels and are
+// then refined by least squares; texels are processed four at a time in XMVECTOR
+// lanes.  Rows of blocks are spread over a ThreadPool.
+//
+// BC7 blocks are always written in mode 6: one subset, RGBA endpoints with
+// p-bits and 4-bit indices.  The partitioned modes, which help blocks that hold
+// two distinct colors, are not searched.
+//***************************************************************************************
+
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include <vector>
+#include "DDSFormat.h"
+
+class ThreadPool;
+
+// Width*Height texels of 8-bit RGBA, row by row with no padding.
+struct ImageRGBA8
+{
+	UINT Width = 0;
+	UINT Height = 0;
+	std::vector<uint8_t> Texels;
+};
+
+struct BlockCompressionStats
+{
+	// Peak signal-to-noise ratio of the encoded image, in dB, over the channels
+	// the format stores (RGB for BC1, R for BC4, RG for BC5, RGBA otherwise).
+	// Texels BC1 makes transparent do not count.  Infinite if nothing was lost.
+	double Psnr = 0.0;
+
+	double Seconds = 0.0;
+	double MPixelsPerSecond = 0.0;
+};
+
+class BlockCompressor
+{
+public:
+	// BC1, BC3 and BC7 in UNORM and UNORM_SRGB, BC4_UNORM and BC5_UNORM.  sRGB
+	// formats are encoded the same way; the texels are taken as already in sRGB.
+	static bool IsSupported(DXGI_FORMAT format);
+
+	// Encodes image, writing the blocks row by row.  Blocks that stick out past
+	// the right or bottom edge repeat the last column or row.  BC1 makes texels
+	// with alpha below 128 transparent.  Returns false if format is not supported.
+	static bool Compress(const ImageRGBA8& image, DXGI_FORMAT format, std::vector<uint8_t>& blocks,
+		ThreadPool& threadPool, BlockCompressionStats* stats = nullptr);
+
+	// Writes a 2D texture with mips.size() levels to a DDS file that
+	// CreateDDSTextureFromFile12 reads.  mips[i] holds level i, packed as
+	// GetDDSSubresourceLayouts lays it out, so either compressed blocks or
+	// uncompressed rows with no padding.  Returns false if a level has the wrong
+	// size or the file cannot be written.
+	static bool SaveDDSTexture(const std::wstring& filename, DXGI_FORMAT format,
+		UINT width, UINT height, const std::vector<std::vector<uint8_t>>& mips);
+};
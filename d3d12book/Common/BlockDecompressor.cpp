@@ -0,0 +1,914 @@
+//***************************************************************************************
+// BlockDecompressor.cpp
+//***************************************************************************************
+
+#include "BlockDecompressor.h"
+#include "MathHelper.h"
+#include "ThreadPool.h"
+#include <DirectXPackedVector.h>
+#include <algorithm>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	// Blocks along each side of the tiles handed to a thread at a time.
+	const UINT TileBlocks = 16;
+
+	// Interpolation weights (out of 64) of the 2-, 3- and 4-bit BC6H and BC7 indices.
+	const UINT Weights2[4] = { 0, 21, 43, 64 };
+	const UINT Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+	const UINT Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// The two-subset partitions of BC6H and BC7: bit i is set if texel i is in
+	// subset 1.  BC6H uses the first 32.
+	const uint16_t Partitions2[64] =
+	{
+		0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+		0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+		0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+		0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+		0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+		0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+		0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+		0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+	};
+
+	// The three-subset partitions of BC7: the subset of each texel.  Mode 0 uses
+	// the first 16.
+	const uint8_t Partitions3[64][16] =
+	{
+		{ 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 1, 2, 2, 2, 2 },
+		{ 0, 0, 0, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 2, 1 },
+		{ 0, 0, 0, 0, 2, 0, 0, 1, 2, 2, 1, 1, 2, 2, 1, 1 },
+		{ 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 1, 0, 1, 1, 1 },
+		{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2 },
+		{ 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 2, 2 },
+		{ 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1 },
+		{ 0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1 },
+		{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2 },
+		{ 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2 },
+		{ 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2 },
+		{ 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2 },
+		{ 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2 },
+		{ 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2 },
+		{ 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2, 1, 2, 2, 2 },
+		{ 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0, 2, 2, 2, 0 },
+		{ 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2 },
+		{ 0, 1, 1, 1, 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0 },
+		{ 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2 },
+		{ 0, 0, 2, 2, 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1 },
+		{ 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2, 0, 2, 2, 2 },
+		{ 0, 0, 0, 1, 0, 0, 0, 1, 2, 2, 2, 1, 2, 2, 2, 1 },
+		{ 0, 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2 },
+		{ 0, 0, 0, 0, 1, 1, 0, 0, 2, 2, 1, 0, 2, 2, 1, 0 },
+		{ 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1, 0, 0, 0, 0 },
+		{ 0, 0, 1, 2, 0, 0, 1, 2, 1, 1, 2, 2, 2, 2, 2, 2 },
+		{ 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1, 0, 1, 1, 0 },
+		{ 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1 },
+		{ 0, 0, 2, 2, 1, 1, 0, 2, 1, 1, 0, 2, 0, 0, 2, 2 },
+		{ 0, 1, 1, 0, 0, 1, 1, 0, 2, 0, 0, 2, 2, 2, 2, 2 },
+		{ 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1 },
+		{ 0, 0, 0, 0, 2, 0, 0, 0, 2, 2, 1, 1, 2, 2, 2, 1 },
+		{ 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 2, 2, 2 },
+		{ 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 2, 0, 0, 1, 1 },
+		{ 0, 0, 1, 1, 0, 0, 1, 2, 0, 0, 2, 2, 0, 2, 2, 2 },
+		{ 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0 },
+		{ 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0 },
+		{ 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0 },
+		{ 0, 1, 2, 0, 2, 0, 1, 2, 1, 2, 0, 1, 0, 1, 2, 0 },
+		{ 0, 0, 1, 1, 2, 2, 0, 0, 1, 1, 2, 2, 0, 0, 1, 1 },
+		{ 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0, 1, 1 },
+		{ 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2 },
+		{ 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1 },
+		{ 0, 0, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2, 1, 1, 2, 2 },
+		{ 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 1, 1 },
+		{ 0, 2, 2, 0, 1, 2, 2, 1, 0, 2, 2, 0, 1, 2, 2, 1 },
+		{ 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 0, 1, 0, 1 },
+		{ 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1 },
+		{ 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2 },
+		{ 0, 2, 2, 2, 0, 1, 1, 1, 0, 2, 2, 2, 0, 1, 1, 1 },
+		{ 0, 0, 0, 2, 1, 1, 1, 2, 0, 0, 0, 2, 1, 1, 1, 2 },
+		{ 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2 },
+		{ 0, 2, 2, 2, 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2 },
+		{ 0, 0, 0, 2, 1, 1, 1, 2, 1, 1, 1, 2, 0, 0, 0, 2 },
+		{ 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2 },
+		{ 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2 },
+		{ 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2, 2, 2, 2, 2 },
+		{ 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2 },
+		{ 0, 0, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2 },
+		{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2 },
+		{ 0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 1 },
+		{ 0, 2, 2, 2, 1, 2, 2, 2, 0, 2, 2, 2, 1, 2, 2, 2 },
+		{ 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2 },
+		{ 0, 1, 1, 1, 2, 0, 1, 1, 2, 2, 0, 1, 2, 2, 2, 0 }
+	};
+
+	// The anchor texel of each subset but the first, whose first is texel 0.  An
+	// anchor's index is stored without its top bit, which is always 0.
+	const uint8_t Anchors2[64] =
+	{
+		15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+		15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+		15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+		6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15
+	};
+
+	const uint8_t Anchors3Second[64] =
+	{
+		3, 3, 15, 15, 8, 3, 15, 15, 8, 8, 6, 6, 6, 5, 3, 3,
+		3, 3, 8, 15, 3, 3, 6, 10, 5, 8, 8, 6, 8, 5, 15, 15,
+		8, 15, 3, 5, 6, 10, 8, 15, 15, 3, 15, 5, 15, 15, 15, 15,
+		3, 15, 5, 5, 5, 8, 5, 10, 5, 10, 8, 13, 15, 12, 3, 3
+	};
+
+	const uint8_t Anchors3Third[64] =
+	{
+		15, 8, 8, 3, 15, 15, 3, 8, 15, 15, 15, 15, 15, 15, 15, 8,
+		15, 8, 15, 3, 15, 8, 15, 8, 3, 15, 6, 10, 15, 15, 10, 8,
+		15, 3, 15, 10, 10, 8, 9, 10, 6, 15, 8, 15, 3, 6, 6, 8,
+		15, 3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3, 15, 15, 8
+	};
+
+	struct Bc7Mode
+	{
+		UINT SubsetCount;
+		UINT PartitionBits;
+		UINT RotationBits;
+		UINT IndexSelectionBits;
+		UINT ColorBits;
+		UINT AlphaBits;
+		UINT EndpointPBits; // One p-bit per endpoint
+		UINT SharedPBits;   // One p-bit per subset
+		UINT IndexBits;
+		UINT SecondaryIndexBits;
+	};
+
+	const Bc7Mode Bc7Modes[8] =
+	{
+		{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+		{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+		{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+		{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+		{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+		{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+		{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+		{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 }
+	};
+
+	// A run of header bits of a BC6H block that holds bits [Shift, Shift + Count)
+	// of one channel of one endpoint.  Endpoints 0 and 1 belong to region 0, 2 and
+	// 3 to region 1.
+	struct Bc6hField
+	{
+		uint8_t Endpoint;
+		uint8_t Channel;
+		uint8_t Shift;
+		uint8_t Count;
+	};
+
+	// Endpoint 0 is stored with EndpointBits bits per channel.  When Transformed,
+	// the other endpoints are stored as signed offsets from it of DeltaBits bits;
+	// otherwise as is, with DeltaBits equal to EndpointBits.
+	struct Bc6hMode
+	{
+		UINT Value;
+		UINT RegionCount;
+		bool Transformed;
+		UINT EndpointBits;
+		UINT DeltaBits[3];
+		Bc6hField Fields[24]; // In the order they are stored, ended by Count == 0
+	};
+
+	const Bc6hMode Bc6hModes[14] =
+	{
+		{ 0x00, 2, true, 10, { 5, 5, 5 }, {
+			{ 2, 1, 4, 1 }, { 2, 2, 4, 1 }, { 3, 2, 4, 1 }, { 0, 0, 0, 10 }, { 0, 1, 0, 10 },
+			{ 0, 2, 0, 10 }, { 1, 0, 0, 5 }, { 3, 1, 4, 1 }, { 2, 1, 0, 4 }, { 1, 1, 0, 5 }, { 3, 2, 0, 1 },
+			{ 3, 1, 0, 4 }, { 1, 2, 0, 5 }, { 3, 2, 1, 1 }, { 2, 2, 0, 4 }, { 2, 0, 0, 5 }, { 3, 2, 2, 1 },
+			{ 3, 0, 0, 5 }, { 3, 2, 3, 1 }
+		} },
+		{ 0x01, 2, true, 7, { 6, 6, 6 }, {
+			{ 2, 1, 5, 1 }, { 3, 1, 4, 2 }, { 0, 0, 0, 7 }, { 3, 2, 0, 2 }, { 2, 2, 4, 1 }, { 0, 1, 0, 7 },
+			{ 2, 2, 5, 1 }, { 3, 2, 2, 1 }, { 2, 1, 4, 1 }, { 0, 2, 0, 7 }, { 3, 2, 3, 1 }, { 3, 2, 5, 1 },
+			{ 3, 2, 4, 1 }, { 1, 0, 0, 6 }, { 2, 1, 0, 4 }, { 1, 1, 0, 6 }, { 3, 1, 0, 4 }, { 1, 2, 0, 6 },
+			{ 2, 2, 0, 4 }, { 2, 0, 0, 6 }, { 3, 0, 0, 6 }
+		} },
+		{ 0x02, 2, true, 11, { 5, 4, 4 }, {
+			{ 0, 0, 0, 10 }, { 0, 1, 0, 10 }, { 0, 2, 0, 10 }, { 1, 0, 0, 5 }, { 0, 0, 10, 1 },
+			{ 2, 1, 0, 4 }, { 1, 1, 0, 4 }, { 0, 1, 10, 1 }, { 3, 2, 0, 1 }, { 3, 1, 0, 4 }, { 1, 2, 0, 4 },
+			{ 0, 2, 10, 1 }, { 3, 2, 1, 1 }, { 2, 2, 0, 4 }, { 2, 0, 0, 5 }, { 3, 2, 2, 1 }, { 3, 0, 0, 5 },
+			{ 3, 2, 3, 1 }
+		} },
+		{ 0x06, 2, true, 11, { 4, 5, 4 }, {
+			{ 0, 0, 0, 10 }, { 0, 1, 0, 10 }, { 0, 2, 0, 10 }, { 1, 0, 0, 4 }, { 0, 0, 10, 1 },
+			{ 3, 1, 4, 1 }, { 2, 1, 0, 4 }, { 1, 1, 0, 5 }, { 0, 1, 10, 1 }, { 3, 1, 0, 4 }, { 1, 2, 0, 4 },
+			{ 0, 2, 10, 1 }, { 3, 2, 1, 1 }, { 2, 2, 0, 4 }, { 2, 0, 0, 4 }, { 3, 2, 0, 1 }, { 3, 2, 2, 1 },
+			{ 3, 0, 0, 4 }, { 2, 1, 4, 1 }, { 3, 2, 3, 1 }
+		} },
+		{ 0x0A, 2, true, 11, { 4, 4, 5 }, {
+			{ 0, 0, 0, 10 }, { 0, 1, 0, 10 }, { 0, 2, 0, 10 }, { 1, 0, 0, 4 }, { 0, 0, 10, 1 },
+			{ 2, 2, 4, 1 }, { 2, 1, 0, 4 }, { 1, 1, 0, 4 }, { 0, 1, 10, 1 }, { 3, 2, 0, 1 }, { 3, 1, 0, 4 },
+			{ 1, 2, 0, 5 }, { 0, 2, 10, 1 }, { 2, 2, 0, 4 }, { 2, 0, 0, 4 }, { 3, 2, 1, 2 }, { 3, 0, 0, 4 },
+			{ 3, 2, 4, 1 }, { 3, 2, 3, 1 }
+		} },
+		{ 0x0E, 2, true, 9, { 5, 5, 5 }, {
+			{ 0, 0, 0, 9 }, { 2, 2, 4, 1 }, { 0, 1, 0, 9 }, { 2, 1, 4, 1 }, { 0, 2, 0, 9 }, { 3, 2, 4, 1 },
+			{ 1, 0, 0, 5 }, { 3, 1, 4, 1 }, { 2, 1, 0, 4 }, { 1, 1, 0, 5 }, { 3, 2, 0, 1 }, { 3, 1, 0, 4 },
+			{ 1, 2, 0, 5 }, { 3, 2, 1, 1 }, { 2, 2, 0, 4 }, { 2, 0, 0, 5 }, { 3, 2, 2, 1 }, { 3, 0, 0, 5 },
+			{ 3, 2, 3, 1 }
+		} },
+		{ 0x12, 2, true, 8, { 6, 5, 5 }, {
+			{ 0, 0, 0, 8 }, { 3, 1, 4, 1 }, { 2, 2, 4, 1 }, { 0, 1, 0, 8 }, { 3, 2, 2, 1 }, { 2, 1, 4, 1 },
+			{ 0, 2, 0, 8 }, { 3, 2, 3, 2 }, { 1, 0, 0, 6 }, { 2, 1, 0, 4 }, { 1, 1, 0, 5 }, { 3, 2, 0, 1 },
+			{ 3, 1, 0, 4 }, { 1, 2, 0, 5 }, { 3, 2, 1, 1 }, { 2, 2, 0, 4 }, { 2, 0, 0, 6 }, { 3, 0, 0, 6 }
+		} },
+		{ 0x16, 2, true, 8, { 5, 6, 5 }, {
+			{ 0, 0, 0, 8 }, { 3, 2, 0, 1 }, { 2, 2, 4, 1 }, { 0, 1, 0, 8 }, { 2, 1, 5, 1 }, { 2, 1, 4, 1 },
+			{ 0, 2, 0, 8 }, { 3, 1, 5, 1 }, { 3, 2, 4, 1 }, { 1, 0, 0, 5 }, { 3, 1, 4, 1 }, { 2, 1, 0, 4 },
+			{ 1, 1, 0, 6 }, { 3, 1, 0, 4 }, { 1, 2, 0, 5 }, { 3, 2, 1, 1 }, { 2, 2, 0, 4 }, { 2, 0, 0, 5 },
+			{ 3, 2, 2, 1 }, { 3, 0, 0, 5 }, { 3, 2, 3, 1 }
+		} },
+		{ 0x1A, 2, true, 8, { 5, 5, 6 }, {
+			{ 0, 0, 0, 8 }, { 3, 2, 1, 1 }, { 2, 2, 4, 1 }, { 0, 1, 0, 8 }, { 2, 2, 5, 1 }, { 2, 1, 4, 1 },
+			{ 0, 2, 0, 8 }, { 3, 2, 5, 1 }, { 3, 2, 4, 1 }, { 1, 0, 0, 5 }, { 3, 1, 4, 1 }, { 2, 1, 0, 4 },
+			{ 1, 1, 0, 5 }, { 3, 2, 0, 1 }, { 3, 1, 0, 4 }, { 1, 2, 0, 6 }, { 2, 2, 0, 4 }, { 2, 0, 0, 5 },
+			{ 3, 2, 2, 1 }, { 3, 0, 0, 5 }, { 3, 2, 3, 1 }
+		} },
+		{ 0x1E, 2, false, 6, { 6, 6, 6 }, {
+			{ 0, 0, 0, 6 }, { 3, 1, 4, 1 }, { 3, 2, 0, 2 }, { 2, 2, 4, 1 }, { 0, 1, 0, 6 }, { 2, 1, 5, 1 },
+			{ 2, 2, 5, 1 }, { 3, 2, 2, 1 }, { 2, 1, 4, 1 }, { 0, 2, 0, 6 }, { 3, 1, 5, 1 }, { 3, 2, 3, 1 },
+			{ 3, 2, 5, 1 }, { 3, 2, 4, 1 }, { 1, 0, 0, 6 }, { 2, 1, 0, 4 }, { 1, 1, 0, 6 }, { 3, 1, 0, 4 },
+			{ 1, 2, 0, 6 }, { 2, 2, 0, 4 }, { 2, 0, 0, 6 }, { 3, 0, 0, 6 }
+		} },
+		{ 0x03, 1, false, 10, { 10, 10, 10 }, {
+			{ 0, 0, 0, 10 }, { 0, 1, 0, 10 }, { 0, 2, 0, 10 }, { 1, 0, 0, 10 }, { 1, 1, 0, 10 },
+			{ 1, 2, 0, 10 }
+		} },
+		{ 0x07, 1, true, 11, { 9, 9, 9 }, {
+			{ 0, 0, 0, 10 }, { 0, 1, 0, 10 }, { 0, 2, 0, 10 }, { 1, 0, 0, 9 }, { 0, 0, 10, 1 },
+			{ 1, 1, 0, 9 }, { 0, 1, 10, 1 }, { 1, 2, 0, 9 }, { 0, 2, 10, 1 }
+		} },
+		{ 0x0B, 1, true, 12, { 8, 8, 8 }, {
+			{ 0, 0, 0, 10 }, { 0, 1, 0, 10 }, { 0, 2, 0, 10 }, { 1, 0, 0, 8 }, { 0, 0, 11, 1 },
+			{ 0, 0, 10, 1 }, { 1, 1, 0, 8 }, { 0, 1, 11, 1 }, { 0, 1, 10, 1 }, { 1, 2, 0, 8 },
+			{ 0, 2, 11, 1 }, { 0, 2, 10, 1 }
+		} },
+		{ 0x0F, 1, true, 16, { 4, 4, 4 }, {
+			{ 0, 0, 0, 10 }, { 0, 1, 0, 10 }, { 0, 2, 0, 10 }, { 1, 0, 0, 4 }, { 0, 0, 15, 1 },
+			{ 0, 0, 14, 1 }, { 0, 0, 13, 1 }, { 0, 0, 12, 1 }, { 0, 0, 11, 1 }, { 0, 0, 10, 1 },
+			{ 1, 1, 0, 4 }, { 0, 1, 15, 1 }, { 0, 1, 14, 1 }, { 0, 1, 13, 1 }, { 0, 1, 12, 1 },
+			{ 0, 1, 11, 1 }, { 0, 1, 10, 1 }, { 1, 2, 0, 4 }, { 0, 2, 15, 1 }, { 0, 2, 14, 1 },
+			{ 0, 2, 13, 1 }, { 0, 2, 12, 1 }, { 0, 2, 11, 1 }, { 0, 2, 10, 1 }
+		} }
+	};
+
+	const UINT* IndexWeights(UINT indexBits)
+	{
+		switch(indexBits)
+		{
+		case 2:
+			return Weights2;
+
+		case 3:
+			return Weights3;
+
+		default:
+			return Weights4;
+		}
+	}
+
+	UINT Subset(UINT subsetCount, UINT partition, UINT texel)
+	{
+		switch(subsetCount)
+		{
+		case 2:
+			return (Partitions2[partition] >> texel) & 1;
+
+		case 3:
+			return Partitions3[partition][texel];
+
+		default:
+			return 0;
+		}
+	}
+
+	bool IsAnchor(UINT subsetCount, UINT partition, UINT texel)
+	{
+		if(texel == 0)
+			return true;
+
+		switch(subsetCount)
+		{
+		case 2:
+			return texel == Anchors2[partition];
+
+		case 3:
+			return texel == Anchors3Second[partition] || texel == Anchors3Third[partition];
+
+		default:
+			return false;
+		}
+	}
+
+	// Reads the fields of a 16-byte BC6H or BC7 block, which are packed from the
+	// least significant bit of the first byte up.
+	class BitReader
+	{
+	public:
+		explicit BitReader(const uint8_t* block)
+		{
+			for(UINT i = 0; i < 8; ++i)
+			{
+				mLow |= (uint64_t)block[i] << (8*i);
+				mHigh |= (uint64_t)block[8 + i] << (8*i);
+			}
+		}
+
+		// count is at most 16.
+		UINT Read(UINT count)
+		{
+			uint64_t bits;
+			if(mPosition >= 64)
+				bits = mHigh >> (mPosition - 64);
+			else if(mPosition + count <= 64)
+				bits = mLow >> mPosition;
+			else
+				bits = (mLow >> mPosition) | (mHigh << (64 - mPosition));
+
+			mPosition += count;
+			return (UINT)bits & ((1u << count) - 1);
+		}
+
+	private:
+		uint64_t mLow = 0;
+		uint64_t mHigh = 0;
+		UINT mPosition = 0;
+	};
+
+	// Weights are out of 64, as BC6H and BC7 store them; the result is rounded
+	// the same way the integer formula ((64 - w)*e0 + w*e1 + 32) >> 6 rounds it,
+	// exactly, since every intermediate value fits a float's mantissa.
+	XMVECTOR InterpolateEndpoints(FXMVECTOR e0, FXMVECTOR e1, FXMVECTOR weight)
+	{
+		XMVECTOR sum = XMVectorMultiplyAdd(e0, XMVectorReplicate(64.0f), XMVectorReplicate(32.0f));
+		sum = XMVectorMultiplyAdd(weight, XMVectorSubtract(e1, e0), sum);
+		return XMVectorFloor(XMVectorScale(sum, 1.0f / 64.0f));
+	}
+
+	XMVECTOR Unpack565(UINT color)
+	{
+		return XMVectorSet(
+			(float)(color >> 11) / 31.0f,
+			(float)((color >> 5) & 63) / 63.0f,
+			(float)(color & 31) / 31.0f,
+			1.0f);
+	}
+
+	// Decodes the 8-byte color block of BC1, BC2 and BC3.  Only BC1 blocks switch
+	// to three colors and transparent black when color0 <= color1.
+	void DecodeColorBlock(const uint8_t* block, bool allowThreeColors, XMFLOAT4 texels[16])
+	{
+		UINT color0 = block[0] | (block[1] << 8);
+		UINT color1 = block[2] | (block[3] << 8);
+		UINT indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((UINT)block[7] << 24);
+
+		XMVECTOR palette[4];
+		palette[0] = Unpack565(color0);
+		palette[1] = Unpack565(color1);
+		if(color0 > color1 || !allowThreeColors)
+		{
+			palette[2] = XMVectorLerp(palette[0], palette[1], 1.0f / 3.0f);
+			palette[3] = XMVectorLerp(palette[0], palette[1], 2.0f / 3.0f);
+		}
+		else
+		{
+			palette[2] = XMVectorLerp(palette[0], palette[1], 0.5f);
+			palette[3] = XMVectorZero();
+		}
+
+		for(UINT i = 0; i < 16; ++i)
+			XMStoreFloat4(&texels[i], palette[(indices >> (2*i)) & 3]);
+	}
+
+	// Decodes an 8-byte BC4 block, which BC3 also uses for alpha and BC5 for each
+	// of its channels.
+	void DecodeChannelBlock(const uint8_t* block, bool isSigned, float values[16])
+	{
+		float palette[8];
+		bool eightValues;
+		if(isSigned)
+		{
+			// -128 and -127 both stand for -1.
+			palette[0] = MathHelper::Max((float)(int8_t)block[0], -127.0f) / 127.0f;
+			palette[1] = MathHelper::Max((float)(int8_t)block[1], -127.0f) / 127.0f;
+			eightValues = (int8_t)block[0] > (int8_t)block[1];
+		}
+		else
+		{
+			palette[0] = (float)block[0] / 255.0f;
+			palette[1] = (float)block[1] / 255.0f;
+			eightValues = block[0] > block[1];
+		}
+
+		if(eightValues)
+		{
+			for(UINT i = 1; i < 7; ++i)
+				palette[i + 1] = (palette[0]*(7 - i) + palette[1]*i) / 7.0f;
+		}
+		else
+		{
+			for(UINT i = 1; i < 5; ++i)
+				palette[i + 1] = (palette[0]*(5 - i) + palette[1]*i) / 5.0f;
+
+			palette[6] = isSigned ? -1.0f : 0.0f;
+			palette[7] = 1.0f;
+		}
+
+		uint64_t indices = 0;
+		for(UINT i = 0; i < 6; ++i)
+			indices |= (uint64_t)block[2 + i] << (8*i);
+
+		for(UINT i = 0; i < 16; ++i)
+			values[i] = palette[(indices >> (3*i)) & 7];
+	}
+
+	// Expands a component with the given number of bits to 8 by repeating its top
+	// bits below it.
+	UINT ExpandBc7Component(UINT value, UINT bits)
+	{
+		value <<= 8 - bits;
+		return value | (value >> bits);
+	}
+
+	void DecodeBc7(const uint8_t* block, XMFLOAT4 texels[16])
+	{
+		// The mode is the number of zero bits before the first set one.
+		UINT modeIndex = 0;
+		while(modeIndex < 8 && (block[0] & (1 << modeIndex)) == 0)
+			++modeIndex;
+
+		if(modeIndex == 8)
+		{
+			// Reserved; decodes as transparent black.
+			std::fill(texels, texels + 16, XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f));
+			return;
+		}
+
+		const Bc7Mode& mode = Bc7Modes[modeIndex];
+
+		BitReader bits(block);
+		bits.Read(modeIndex + 1);
+
+		UINT partition = bits.Read(mode.PartitionBits);
+		UINT rotation = bits.Read(mode.RotationBits);
+		UINT indexSelection = bits.Read(mode.IndexSelectionBits);
+
+		// endpoints[2*s] and endpoints[2*s + 1] are the endpoints of subset s. Each
+		// channel is stored for all endpoints before the next channel.
+		const UINT endpointCount = mode.SubsetCount*2;
+		UINT endpoints[6][4];
+		for(UINT c = 0; c < 4; ++c)
+		{
+			UINT channelBits = c < 3 ? mode.ColorBits : mode.AlphaBits;
+			for(UINT e = 0; e < endpointCount; ++e)
+				endpoints[e][c] = bits.Read(channelBits);
+		}
+
+		UINT colorBits = mode.ColorBits;
+		UINT alphaBits = mode.AlphaBits;
+		if(mode.EndpointPBits != 0 || mode.SharedPBits != 0)
+		{
+			UINT pBits[6];
+			for(UINT e = 0; e < endpointCount; ++e)
+			{
+				if(mode.EndpointPBits != 0 || e % 2 == 0)
+					pBits[e] = bits.Read(1);
+				else
+					pBits[e] = pBits[e - 1];
+			}
+
+			for(UINT e = 0; e < endpointCount; ++e)
+			{
+				for(UINT c = 0; c < 4; ++c)
+					endpoints[e][c] = (endpoints[e][c] << 1) | pBits[e];
+			}
+
+			++colorBits;
+			if(alphaBits != 0)
+				++alphaBits;
+		}
+
+		XMVECTOR e0[3];
+		XMVECTOR e1[3];
+		for(UINT s = 0; s < mode.SubsetCount; ++s)
+		{
+			float channels[2][4];
+			for(UINT e = 0; e < 2; ++e)
+			{
+				const UINT* endpoint = endpoints[2*s + e];
+				for(UINT c = 0; c < 3; ++c)
+					channels[e][c] = (float)ExpandBc7Component(endpoint[c], colorBits);
+
+				channels[e][3] = alphaBits != 0 ? (float)ExpandBc7Component(endpoint[3], alphaBits) : 255.0f;
+			}
+
+			e0[s] = XMVectorSet(channels[0][0], channels[0][1], channels[0][2], channels[0][3]);
+			e1[s] = XMVectorSet(channels[1][0], channels[1][1], channels[1][2], channels[1][3]);
+		}
+
+		UINT indices[16];
+		for(UINT i = 0; i < 16; ++i)
+			indices[i] = bits.Read(mode.IndexBits - (IsAnchor(mode.SubsetCount, partition, i) ? 1 : 0));
+
+		// Modes 4 and 5 interpolate color and alpha with separate indices; in mode 4
+		// the index selection bit swaps which set goes with which.
+		const UINT* colorIndices = indices;
+		const UINT* alphaIndices = indices;
+		UINT colorIndexBits = mode.IndexBits;
+		UINT alphaIndexBits = mode.IndexBits;
+
+		UINT secondaryIndices[16];
+		if(mode.SecondaryIndexBits != 0)
+		{
+			for(UINT i = 0; i < 16; ++i)
+				secondaryIndices[i] = bits.Read(mode.SecondaryIndexBits - (i == 0 ? 1 : 0));
+
+			alphaIndices = secondaryIndices;
+			alphaIndexBits = mode.SecondaryIndexBits;
+			if(indexSelection != 0)
+			{
+				std::swap(colorIndices, alphaIndices);
+				std::swap(colorIndexBits, alphaIndexBits);
+			}
+		}
+
+		const UINT* colorWeights = IndexWeights(colorIndexBits);
+		const UINT* alphaWeights = IndexWeights(alphaIndexBits);
+
+		for(UINT i = 0; i < 16; ++i)
+		{
+			UINT s = Subset(mode.SubsetCount, partition, i);
+			float colorWeight = (float)colorWeights[colorIndices[i]];
+			float alphaWeight = (float)alphaWeights[alphaIndices[i]];
+
+			XMVECTOR weight = XMVectorSet(colorWeight, colorWeight, colorWeight, alphaWeight);
+			XMStoreFloat4(&texels[i], XMVectorScale(InterpolateEndpoints(e0[s], e1[s], weight), 1.0f / 255.0f));
+
+			// Rotation swaps alpha with one color channel, so that channel gets the
+			// separate indices.
+			switch(rotation)
+			{
+			case 1:
+				std::swap(texels[i].w, texels[i].x);
+				break;
+
+			case 2:
+				std::swap(texels[i].w, texels[i].y);
+				break;
+
+			case 3:
+				std::swap(texels[i].w, texels[i].z);
+				break;
+			}
+		}
+	}
+
+	int SignExtend(UINT value, UINT bits)
+	{
+		UINT sign = 1u << (bits - 1);
+		return (int)(value ^ sign) - (int)sign;
+	}
+
+	// Scales an endpoint component of the given number of bits to 16 bits (15 and
+	// a sign for BC6H_SF16), mapping the largest value to the largest.
+	int UnquantizeBc6hComponent(int value, UINT bits, bool isSigned)
+	{
+		if(!isSigned)
+		{
+			if(bits >= 15 || value == 0)
+				return value;
+
+			if(value == (1 << bits) - 1)
+				return 0xFFFF;
+
+			return ((value << 16) + 0x8000) >> bits;
+		}
+
+		if(bits >= 16)
+			return value;
+
+		int magnitude = value < 0 ? -value : value;
+		int result = 0;
+		if(magnitude >= (1 << (bits - 1)) - 1)
+			result = 0x7FFF;
+		else if(magnitude != 0)
+			result = ((magnitude << 15) + 0x4000) >> (bits - 1);
+
+		return value < 0 ? -result : result;
+	}
+
+	void DecodeBc6h(const uint8_t* block, bool isSigned, XMFLOAT4 texels[16])
+	{
+		BitReader bits(block);
+
+		// Modes 0 and 1 are told apart by two bits, the others by five.
+		UINT modeValue = bits.Read(2);
+		if(modeValue > 1)
+			modeValue |= bits.Read(3) << 2;
+
+		const Bc6hMode* mode = nullptr;
+		for(const Bc6hMode& m : Bc6hModes)
+		{
+			if(m.Value == modeValue)
+				mode = &m;
+		}
+
+		if(mode == nullptr)
+		{
+			// Reserved; decodes as black.
+			std::fill(texels, texels + 16, XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
+			return;
+		}
+
+		UINT stored[4][3] = {};
+		for(const Bc6hField& field : mode->Fields)
+		{
+			if(field.Count == 0)
+				break;
+
+			stored[field.Endpoint][field.Channel] |= bits.Read(field.Count) << field.Shift;
+		}
+
+		UINT partition = mode->RegionCount == 2 ? bits.Read(5) : 0;
+
+		const UINT endpointCount = mode->RegionCount*2;
+		const UINT endpointMask = (1u << mode->EndpointBits) - 1;
+		float endpoints[4][4] = {};
+		for(UINT c = 0; c < 3; ++c)
+		{
+			for(UINT e = 0; e < endpointCount; ++e)
+			{
+				UINT value = stored[e][c];
+				if(e > 0 && mode->Transformed)
+					value = (stored[0][c] + SignExtend(value, mode->DeltaBits[c])) & endpointMask;
+
+				int component = isSigned ? SignExtend(value, mode->EndpointBits) : (int)value;
+				endpoints[e][c] = (float)UnquantizeBc6hComponent(component, mode->EndpointBits, isSigned);
+			}
+		}
+
+		XMVECTOR e0[2];
+		XMVECTOR e1[2];
+		for(UINT r = 0; r < mode->RegionCount; ++r)
+		{
+			e0[r] = XMLoadFloat4((const XMFLOAT4*)endpoints[2*r]);
+			e1[r] = XMLoadFloat4((const XMFLOAT4*)endpoints[2*r + 1]);
+		}
+
+		const UINT indexBits = mode->RegionCount == 2 ? 3 : 4;
+		const UINT* weights = IndexWeights(indexBits);
+
+		// The interpolated value times 31/64 (31/32 signed) is the bit pattern of
+		// a half, with the sign kept apart.
+		const float halfScale = isSigned ? 31.0f / 32.0f : 31.0f / 64.0f;
+
+		for(UINT i = 0; i < 16; ++i)
+		{
+			UINT r = Subset(mode->RegionCount, partition, i);
+			UINT index = bits.Read(indexBits - (IsAnchor(mode->RegionCount, partition, i) ? 1 : 0));
+
+			XMVECTOR value = InterpolateEndpoints(e0[r], e1[r], XMVectorReplicate((float)weights[index]));
+			value = XMVectorTruncate(XMVectorScale(value, halfScale));
+
+			XMFLOAT4 halfBits;
+			XMStoreFloat4(&halfBits, value);
+
+			float* channels[3] = { &halfBits.x, &halfBits.y, &halfBits.z };
+			for(float* channel : channels)
+			{
+				int h = (int)*channel;
+				*channel = XMConvertHalfToFloat((HALF)(h < 0 ? 0x8000 | -h : h));
+			}
+
+			texels[i] = XMFLOAT4(halfBits.x, halfBits.y, halfBits.z, 1.0f);
+		}
+	}
+
+	// Decodes every block of the subresources, passing each to storeBlock along
+	// with the index of its subresource, the position of its top left texel in the
+	// image and how many of its columns and rows lie inside the image.  Tiles of
+	// TileBlocks x TileBlocks blocks from all the subresources go to the threads.
+	template<typename StoreBlock>
+	void DecodeTiles(DXGI_FORMAT format, const uint8_t* bitData,
+		const std::vector<DDS_SUBRESOURCE_LAYOUT>& layouts, ThreadPool& threadPool, StoreBlock storeBlock)
+	{
+		struct Tile
+		{
+			UINT Subresource;
+			UINT Slice;
+			UINT BlockX;
+			UINT BlockY;
+		};
+
+		std::vector<Tile> tiles;
+		for(UINT i = 0; i < (UINT)layouts.size(); ++i)
+		{
+			const DDS_SUBRESOURCE_LAYOUT& layout = layouts[i];
+			UINT blocksWide = (layout.width + 3) / 4;
+
+			for(UINT z = 0; z < layout.depth; ++z)
+			{
+				for(UINT by = 0; by < layout.numRows; by += TileBlocks)
+				{
+					for(UINT bx = 0; bx < blocksWide; bx += TileBlocks)
+						tiles.push_back({ i, z, bx, by });
+				}
+			}
+		}
+
+		const UINT blockBytes = (UINT)BitsPerPixel(format)*2;
+
+		threadPool.ParallelFor((UINT)tiles.size(), 1, [&](UINT begin, UINT end, UINT threadIndex)
+		{
+			XMFLOAT4 texels[16];
+			for(UINT t = begin; t < end; ++t)
+			{
+				const Tile& tile = tiles[t];
+				const DDS_SUBRESOURCE_LAYOUT& layout = layouts[tile.Subresource];
+				const uint8_t* slice = bitData + layout.offset + (size_t)tile.Slice*layout.slicePitch;
+
+				UINT blocksWide = (layout.width + 3) / 4;
+				UINT endX = MathHelper::Min(tile.BlockX + TileBlocks, blocksWide);
+				UINT endY = MathHelper::Min(tile.BlockY + TileBlocks, layout.numRows);
+
+				for(UINT by = tile.BlockY; by < endY; ++by)
+				{
+					for(UINT bx = tile.BlockX; bx < endX; ++bx)
+					{
+						BlockDecompressor::DecodeBlock(format, slice + (size_t)by*layout.rowPitch + (size_t)bx*blockBytes, texels);
+
+						UINT x = bx*4;
+						UINT y = by*4;
+						storeBlock(tile.Subresource, x, tile.Slice*layout.height + y, texels,
+							MathHelper::Min(4u, layout.width - x), MathHelper::Min(4u, layout.height - y));
+					}
+				}
+			}
+		});
+	}
+
+	// Sizes an image per layout, with room for all its depth slices.
+	template<typename Image>
+	void AllocateImages(const std::vector<DDS_SUBRESOURCE_LAYOUT>& layouts, std::vector<Image>& images, UINT channelCount)
+	{
+		images.resize(layouts.size());
+		for(size_t i = 0; i < layouts.size(); ++i)
+		{
+			images[i].Width = layouts[i].width;
+			images[i].Height = layouts[i].height*layouts[i].depth;
+			images[i].Texels.resize((size_t)images[i].Width*images[i].Height*channelCount);
+		}
+	}
+}
+
+bool BlockDecompressor::IsSupported(DXGI_FORMAT format)
+{
+	switch(format)
+	{
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_UF16:
+	case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+void BlockDecompressor::DecodeBlock(DXGI_FORMAT format, const uint8_t* block, XMFLOAT4 texels[16])
+{
+	float red[16];
+	float green[16];
+
+	switch(format)
+	{
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+		DecodeColorBlock(block, true, texels);
+		break;
+
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+		DecodeColorBlock(block + 8, false, texels);
+		for(UINT i = 0; i < 16; ++i)
+			texels[i].w = (float)((block[i / 2] >> (4*(i % 2))) & 15) / 15.0f;
+		break;
+
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+		DecodeColorBlock(block + 8, false, texels);
+		DecodeChannelBlock(block, false, red);
+		for(UINT i = 0; i < 16; ++i)
+			texels[i].w = red[i];
+		break;
+
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		DecodeChannelBlock(block, format == DXGI_FORMAT_BC4_SNORM, red);
+		for(UINT i = 0; i < 16; ++i)
+			texels[i] = XMFLOAT4(red[i], 0.0f, 0.0f, 1.0f);
+		break;
+
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+		DecodeChannelBlock(block, format == DXGI_FORMAT_BC5_SNORM, red);
+		DecodeChannelBlock(block + 8, format == DXGI_FORMAT_BC5_SNORM, green);
+		for(UINT i = 0; i < 16; ++i)
+			texels[i] = XMFLOAT4(red[i], green[i], 0.0f, 1.0f);
+		break;
+
+	case DXGI_FORMAT_BC6H_UF16:
+	case DXGI_FORMAT_BC6H_SF16:
+		DecodeBc6h(block, format == DXGI_FORMAT_BC6H_SF16, texels);
+		break;
+
+	default:
+		DecodeBc7(block, texels);
+		break;
+	}
+}
+
+bool BlockDecompressor::Decode(DXGI_FORMAT format, const uint8_t* bitData,
+	const std::vector<DDS_SUBRESOURCE_LAYOUT>& layouts,
+	std::vector<ImageRGBA32F>& images, ThreadPool& threadPool)
+{
+	if(!IsSupported(format))
+		return false;
+
+	AllocateImages(layouts, images, 1);
+
+	DecodeTiles(format, bitData, layouts, threadPool,
+		[&images](UINT subresource, UINT x, UINT y, const XMFLOAT4* texels, UINT columns, UINT rows)
+	{
+		ImageRGBA32F& image = images[subresource];
+		for(UINT j = 0; j < rows; ++j)
+			std::copy(texels + j*4, texels + j*4 + columns, &image.Texels[(size_t)(y + j)*image.Width + x]);
+	});
+
+	return true;
+}
+
+bool BlockDecompressor::Decode(DXGI_FORMAT format, const uint8_t* bitData,
+	const std::vector<DDS_SUBRESOURCE_LAYOUT>& layouts,
+	std::vector<ImageRGBA8>& images, ThreadPool& threadPool)
+{
+	switch(format)
+	{
+	case DXGI_FORMAT_BC4_SNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_UF16:
+	case DXGI_FORMAT_BC6H_SF16:
+		return false;
+
+	default:
+		if(!IsSupported(format))
+			return false;
+	}
+
+	AllocateImages(layouts, images, 4);
+
+	DecodeTiles(format, bitData, layouts, threadPool,
+		[&images](UINT subresource, UINT x, UINT y, const XMFLOAT4* texels, UINT columns, UINT rows)
+	{
+		ImageRGBA8& image = images[subresource];
+		for(UINT j = 0; j < rows; ++j)
+		{
+			uint8_t* out = &image.Texels[((size_t)(y + j)*image.Width + x)*4];
+			for(UINT i = 0; i < columns; ++i, out += 4)
+			{
+				XMFLOAT4 texel;
+				XMStoreFloat4(&texel, XMVectorRound(XMVectorScale(XMLoadFloat4(&texels[j*4 + i]), 255.0f)));
+
+				out[0] = (uint8_t)texel.x;
+				out[1] = (uint8_t)texel.y;
+				out[2] = (uint8_t)texel.z;
+				out[3] = (uint8_t)texel.w;
+			}
+		}
+	});
+
+	return true;
+}
@@ -0,0 +1,55 @@
+//***************************************************************************************
+// BlockDecompressor.h
+//
+// CPU decoder for all the block-compressed formats, BC1 to BC7, for checking what
+// BlockCompressor or an offline tool wrote and for reading compressed textures
+// where no GPU is at hand.  The color palettes of BC1 to BC3, BC6H and BC7 are
+// interpolated on four-channel XMVECTOR texels; the single-channel palettes of
+// BC3 alpha, BC4 and BC5, and the indices of every format, are decoded in scalar
+// code.
+//
+// Decode takes bit data laid out as GetDDSSubresourceLayouts describes it, the same
+// layout FillInitData12 hands to Direct3D, so a DDS file's bit data can be decoded
+// as read.  All subresources are cut into tiles of blocks that are spread over a
+// ThreadPool together, so small mips do not leave threads idle.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include "BlockCompressor.h"
+
+// Width*Height texels of float RGBA, row by row with no padding.
+struct ImageRGBA32F
+{
+	UINT Width = 0;
+	UINT Height = 0;
+	std::vector<DirectX::XMFLOAT4> Texels;
+};
+
+class BlockDecompressor
+{
+public:
+	// BC1, BC2, BC3 and BC7 in UNORM and UNORM_SRGB, BC4 and BC5 in UNORM and
+	// SNORM, and BC6H_UF16 and BC6H_SF16.
+	static bool IsSupported(DXGI_FORMAT format);
+
+	// Decodes one block into its 16 texels, row by row.  Channels the format does
+	// not store decode as 0, and alpha as 1.  SNORM formats decode to [-1, 1] and
+	// BC6H to the half-float values it stores; sRGB formats are not converted to
+	// linear.  format must be supported.
+	static void DecodeBlock(DXGI_FORMAT format, const uint8_t* block, DirectX::XMFLOAT4 texels[16]);
+
+	// Decodes subresource i of bitData, which lies where layouts[i] says, into
+	// images[i].  The depth slices of a volume texture are stacked top to bottom.
+	// Returns false if format is not supported.
+	static bool Decode(DXGI_FORMAT format, const uint8_t* bitData,
+		const std::vector<DirectX::DDS_SUBRESOURCE_LAYOUT>& layouts,
+		std::vector<ImageRGBA32F>& images, ThreadPool& threadPool);
+
+	// The same, rounded to 8 bits per channel.  Only for the formats that decode
+	// to [0, 1]: the UNORM and UNORM_SRGB ones.
+	static bool Decode(DXGI_FORMAT format, const uint8_t* bitData,
+		const std::vector<DirectX::DDS_SUBRESOURCE_LAYOUT>& layouts,
+		std::vector<ImageRGBA8>& images, ThreadPool& threadPool);
+};
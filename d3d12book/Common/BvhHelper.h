@@ -0,0 +1,96 @@
+//***************************************************************************************
+// BvhHelper.h
+//
+// Pieces shared by the bounding volume hierarchies in Common: the ray-box slab
+// test their traversals use, and the median split InstanceCuller and
+// SceneRayQuery build their trees with.
+//***************************************************************************************
+
+#pragma once
+
+#include "MathHelper.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+class BvhHelper
+{
+public:
+	// Deeper than a median split tree over 2^32 items can get.
+	static const UINT MedianSplitMaxDepth = 64;
+
+	// Slab test; returns the distance at which the ray enters the box, or
+	// infinity if it misses the box or only reaches it at maxDist or beyond.
+	static float EnterBox(const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax,
+		const DirectX::XMFLOAT3& o, const DirectX::XMFLOAT3& invDir, float maxDist)
+	{
+		float tx0, tx1, ty0, ty1, tz0, tz1;
+		SlabInterval(boundsMin.x, boundsMax.x, o.x, invDir.x, tx0, tx1);
+		SlabInterval(boundsMin.y, boundsMax.y, o.y, invDir.y, ty0, ty1);
+		SlabInterval(boundsMin.z, boundsMax.z, o.z, invDir.z, tz0, tz1);
+
+		float tNear = MathHelper::Max(MathHelper::Max(tx0, ty0), MathHelper::Max(tz0, 0.0f));
+		float tFar = MathHelper::Min(MathHelper::Min(tx1, ty1), tz1);
+
+		return (tNear <= tFar && tNear < maxDist) ? tNear : MathHelper::Infinity;
+	}
+
+	// Where the ray enters (t0) and leaves (t1) the slab between two planes.  A
+	// ray parallel to the planes that starts on one of them gives 0*inf = NaN;
+	// it stays on that face, so the slab puts no bound on it.
+	static void SlabInterval(float slabMin, float slabMax, float o, float invDir, float& t0, float& t1)
+	{
+		t0 = (slabMin - o) * invDir;
+		t1 = (slabMax - o) * invDir;
+		if(std::isnan(t0) || std::isnan(t1))
+		{
+			t0 = -MathHelper::Infinity;
+			t1 = MathHelper::Infinity;
+		}
+		else if(t0 > t1)
+		{
+			std::swap(t0, t1);
+		}
+	}
+
+	// SlabInterval for four rays at once, as the packet traversals use it.
+	static void XM_CALLCONV SlabInterval(DirectX::FXMVECTOR slabMin, DirectX::FXMVECTOR slabMax,
+		DirectX::FXMVECTOR o, DirectX::GXMVECTOR invDir, DirectX::XMVECTOR& t0, DirectX::XMVECTOR& t1)
+	{
+		using namespace DirectX;
+
+		XMVECTOR a = XMVectorMultiply(XMVectorSubtract(slabMin, o), invDir);
+		XMVECTOR b = XMVectorMultiply(XMVectorSubtract(slabMax, o), invDir);
+		XMVECTOR unbounded = XMVectorOrInt(XMVectorIsNaN(a), XMVectorIsNaN(b));
+
+		t0 = XMVectorSelect(XMVectorMin(a, b), XMVectorReplicate(-MathHelper::Infinity), unbounded);
+		t1 = XMVectorSelect(XMVectorMax(a, b), XMVectorReplicate(MathHelper::Infinity), unbounded);
+	}
+
+	// Index (0 = x, 1 = y, 2 = z) of the largest component of extent.
+	static int LongestAxis(const DirectX::XMFLOAT3& extent)
+	{
+		int axis = 0;
+		if(extent.y > extent.x)
+			axis = 1;
+		if(extent.z > MathHelper::Max(extent.x, extent.y))
+			axis = 2;
+		return axis;
+	}
+
+	// Reorders items[first, first + count) so the count/2 with the smallest
+	// key(item) come first, and returns count/2.  Nodes are split this way at
+	// the median center along the LongestAxis of their center bounds.
+	template<typename KeyFn>
+	static UINT MedianSplit(std::vector<UINT>& items, UINT first, UINT count, KeyFn key)
+	{
+		UINT leftCount = count / 2;
+		std::nth_element(
+			items.begin() + first,
+			items.begin() + first + leftCount,
+			items.begin() + first + count,
+			[&key](UINT a, UINT b) { return key(a) < key(b); });
+
+		return leftCount;
+	}
+};
@@ -0,0 +1,79 @@
+//***************************************************************************************
+// CubeFaceCuller.cpp
+//***************************************************************************************
+
+#include "CubeFaceCuller.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Plane distances (unnormalized) relative to the center d:
+	//   bit 0: dx+dy   bit 1: dx-dy   bit 2: dx+dz   bit 3: dx-dz   bit 4: dy+dz   bit 5: dy-dz
+	// A face is visible if the listed distances are >= -k (Above) and <= +k
+	// (Below), where k is the sphere radius times sqrt(2).  For example +X needs
+	// dx >= |dy| and dx >= |dz|, give or take the radius.
+	struct FaceTest
+	{
+		std::uint8_t Above;
+		std::uint8_t Below;
+	};
+
+	const FaceTest FaceTests[6] =
+	{
+		{ 0x0f, 0x00 }, // +X
+		{ 0x00, 0x0f }, // -X
+		{ 0x31, 0x02 }, // +Y
+		{ 0x02, 0x31 }, // -Y
+		{ 0x14, 0x28 }, // +Z
+		{ 0x28, 0x14 }  // -Z
+	};
+}
+
+CubeFaceCuller::CubeFaceCuller(const XMFLOAT3& center)
+{
+	SetCenter(center);
+}
+
+void CubeFaceCuller::SetCenter(const XMFLOAT3& center)
+{
+	mCenter = center;
+}
+
+std::uint8_t CubeFaceCuller::ComputeFaceMask(const BoundingSphere& sphereW)const
+{
+	const XMVECTOR signs0 = XMVectorSet(1.0f, -1.0f, 1.0f, -1.0f);
+	const XMVECTOR signs1 = XMVectorSet(1.0f, -1.0f, 0.0f, 0.0f);
+
+	XMVECTOR d = XMVectorSubtract(XMLoadFloat3(&sphereW.Center), XMLoadFloat3(&mCenter));
+
+	// q0 = (dx+dy, dx-dy, dx+dz, dx-dz), q1 = (dy+dz, dy-dz, dy, dy)
+	XMVECTOR q0 = XMVectorMultiplyAdd(XMVectorSwizzle<1, 1, 2, 2>(d), signs0, XMVectorSplatX(d));
+	XMVECTOR q1 = XMVectorMultiplyAdd(XMVectorSplatZ(d), signs1, XMVectorSplatY(d));
+
+	XMVECTOR k = XMVectorReplicate(sphereW.Radius*1.41421356f);
+	XMVECTOR negK = XMVectorNegate(k);
+
+	uint32_t above0[4], above1[4], below0[4], below1[4];
+	XMStoreInt4(above0, XMVectorGreaterOrEqual(q0, negK));
+	XMStoreInt4(above1, XMVectorGreaterOrEqual(q1, negK));
+	XMStoreInt4(below0, XMVectorLessOrEqual(q0, k));
+	XMStoreInt4(below1, XMVectorLessOrEqual(q1, k));
+
+	std::uint8_t above = (std::uint8_t)(
+		(above0[0] & 0x01) | (above0[1] & 0x02) | (above0[2] & 0x04) | (above0[3] & 0x08) |
+		(above1[0] & 0x10) | (above1[1] & 0x20));
+	std::uint8_t below = (std::uint8_t)(
+		(below0[0] & 0x01) | (below0[1] & 0x02) | (below0[2] & 0x04) | (below0[3] & 0x08) |
+		(below1[0] & 0x10) | (below1[1] & 0x20));
+
+	std::uint8_t mask = 0;
+	for(int face = 0; face < 6; ++face)
+	{
+		if((above & FaceTests[face].Above) == FaceTests[face].Above &&
+		   (below & FaceTests[face].Below) == FaceTests[face].Below)
+			mask |= 1 << face;
+	}
+
+	return mask;
+}
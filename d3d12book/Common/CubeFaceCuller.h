@@ -0,0 +1,34 @@
+//***************************************************************************************
+// CubeFaceCuller.h
+//
+// Decides which faces of a dynamic cube map an object can appear in, so each
+// face's draw loop only submits what it can see.  The six 90 degree face frusta
+// around the cube map center are bounded by only twelve distinct side planes,
+// of the form a + b and a - b for each pair of axes, so one sphere is tested
+// against all six faces with two vectors of plane distances and four compares.
+//
+// The near and far planes are ignored; the result is conservative.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+class CubeFaceCuller
+{
+public:
+	// Face bits follow the cube map face order: +X, -X, +Y, -Y, +Z, -Z.
+	static const std::uint8_t AllFaces = 0x3f;
+
+	CubeFaceCuller() = default;
+	explicit CubeFaceCuller(const DirectX::XMFLOAT3& center);
+
+	void SetCenter(const DirectX::XMFLOAT3& center);
+
+	// Returns a mask with bit i set if the world space sphere may be visible in
+	// face i.  A sphere around the center is visible in all of them.
+	std::uint8_t ComputeFaceMask(const DirectX::BoundingSphere& sphereW)const;
+
+private:
+	DirectX::XMFLOAT3 mCenter = { 0.0f, 0.0f, 0.0f };
+};
@@ -0,0 +1,223 @@
+//--------------------------------------------------------------------------------------
+// File: DDSFormat.h
+//
+// DDS file structures, and the header and layout queries the texture loader uses,
+// split out of DDSTextureLoader so they can be used without a Direct3D device.  It
+// only depends on the DXGI_FORMAT enumeration, so tools can read DDS metadata,
+// such as the sizes of every subresource, from the headers alone.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <dxgiformat.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+//--------------------------------------------------------------------------------------
+// Macros
+//--------------------------------------------------------------------------------------
+#ifndef MAKEFOURCC
+    #define MAKEFOURCC(ch0, ch1, ch2, ch3)                              \
+                ((uint32_t)(uint8_t)(ch0) | ((uint32_t)(uint8_t)(ch1) << 8) |       \
+                ((uint32_t)(uint8_t)(ch2) << 16) | ((uint32_t)(uint8_t)(ch3) << 24 ))
+#endif /* defined(MAKEFOURCC) */
+
+//--------------------------------------------------------------------------------------
+// DDS file structure definitions
+//
+// See DDS.h in the 'Texconv' sample and the 'DirectXTex' library
+//--------------------------------------------------------------------------------------
+#pragma pack(push,1)
+
+const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+
+struct DDS_PIXELFORMAT
+{
+    uint32_t    size;
+    uint32_t    flags;
+    uint32_t    fourCC;
+    uint32_t    RGBBitCount;
+    uint32_t    RBitMask;
+    uint32_t    GBitMask;
+    uint32_t    BBitMask;
+    uint32_t    ABitMask;
+};
+
+#define DDS_FOURCC      0x00000004  // DDPF_FOURCC
+#define DDS_RGB         0x00000040  // DDPF_RGB
+#define DDS_LUMINANCE   0x00020000  // DDPF_LUMINANCE
+#define DDS_ALPHA       0x00000002  // DDPF_ALPHA
+
+#define DDS_HEADER_FLAGS_TEXTURE        0x00001007  // DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT
+#define DDS_HEADER_FLAGS_MIPMAP         0x00020000  // DDSD_MIPMAPCOUNT
+#define DDS_HEADER_FLAGS_VOLUME         0x00800000  // DDSD_DEPTH
+#define DDS_HEADER_FLAGS_PITCH          0x00000008  // DDSD_PITCH
+#define DDS_HEADER_FLAGS_LINEARSIZE     0x00080000  // DDSD_LINEARSIZE
+
+#define DDS_SURFACE_FLAGS_TEXTURE 0x00001000 // DDSCAPS_TEXTURE
+#define DDS_SURFACE_FLAGS_MIPMAP  0x00400008 // DDSCAPS_COMPLEX | DDSCAPS_MIPMAP
+#define DDS_SURFACE_FLAGS_CUBEMAP 0x00000008 // DDSCAPS_COMPLEX
+
+#define DDS_HEIGHT 0x00000002 // DDSD_HEIGHT
+#define DDS_WIDTH  0x00000004 // DDSD_WIDTH
+
+#define DDS_CUBEMAP_POSITIVEX 0x00000600 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEX
+#define DDS_CUBEMAP_NEGATIVEX 0x00000a00 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEX
+#define DDS_CUBEMAP_POSITIVEY 0x00001200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEY
+#define DDS_CUBEMAP_NEGATIVEY 0x00002200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEY
+#define DDS_CUBEMAP_POSITIVEZ 0x00004200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEZ
+#define DDS_CUBEMAP_NEGATIVEZ 0x00008200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEZ
+
+#define DDS_CUBEMAP_ALLFACES ( DDS_CUBEMAP_POSITIVEX | DDS_CUBEMAP_NEGATIVEX |\
+                               DDS_CUBEMAP_POSITIVEY | DDS_CUBEMAP_NEGATIVEY |\
+                               DDS_CUBEMAP_POSITIVEZ | DDS_CUBEMAP_NEGATIVEZ )
+
+#define DDS_CUBEMAP 0x00000200 // DDSCAPS2_CUBEMAP
+
+#define DDS_FLAGS_VOLUME 0x00200000 // DDSCAPS2_VOLUME
+
+#define DDS_RESOURCE_MISC_TEXTURECUBE 0x00000004 // D3D11_RESOURCE_MISC_TEXTURECUBE
+
+enum DDS_MISC_FLAGS2
+{
+    DDS_MISC_FLAGS2_ALPHA_MODE_MASK = 0x7L,
+};
+
+struct DDS_HEADER
+{
+    uint32_t        size;
+    uint32_t        flags;
+    uint32_t        height;
+    uint32_t        width;
+    uint32_t        pitchOrLinearSize;
+    uint32_t        depth; // only if DDS_HEADER_FLAGS_VOLUME is set in flags
+    uint32_t        mipMapCount;
+    uint32_t        reserved1[11];
+    DDS_PIXELFORMAT ddspf;
+    uint32_t        caps;
+    uint32_t        caps2;
+    uint32_t        caps3;
+    uint32_t        caps4;
+    uint32_t        reserved2;
+};
+
+struct DDS_HEADER_DXT10
+{
+    DXGI_FORMAT     dxgiFormat;
+    uint32_t        resourceDimension;
+    uint32_t        miscFlag; // see D3D11_RESOURCE_MISC_FLAG
+    uint32_t        arraySize;
+    uint32_t        miscFlags2;
+};
+
+#pragma pack(pop)
+
+
+// Largest header a DDS file can have: magic number, DDS_HEADER and DDS_HEADER_DXT10.
+const size_t DDS_MAX_HEADER_SIZE = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
+
+namespace DirectX
+{
+    enum DDS_ALPHA_MODE
+    {
+        DDS_ALPHA_MODE_UNKNOWN       = 0,
+        DDS_ALPHA_MODE_STRAIGHT      = 1,
+        DDS_ALPHA_MODE_PREMULTIPLIED = 2,
+        DDS_ALPHA_MODE_OPAQUE        = 3,
+        DDS_ALPHA_MODE_CUSTOM        = 4,
+    };
+
+    enum DDS_RESULT
+    {
+        DDS_RESULT_OK            = 0,
+        DDS_RESULT_INVALID_DATA  = 1, // Truncated file or inconsistent header
+        DDS_RESULT_NOT_SUPPORTED = 2, // Valid DDS that no Direct3D texture can hold
+    };
+
+    // Same values as D3D11_RESOURCE_DIMENSION and D3D12_RESOURCE_DIMENSION
+    enum DDS_DIMENSION
+    {
+        DDS_DIMENSION_UNKNOWN   = 0,
+        DDS_DIMENSION_TEXTURE1D = 2,
+        DDS_DIMENSION_TEXTURE2D = 3,
+        DDS_DIMENSION_TEXTURE3D = 4,
+    };
+
+    struct DDS_TEXTURE_DESC
+    {
+        DDS_DIMENSION   dimension;
+        uint32_t        width;
+        uint32_t        height;
+        uint32_t        depth;
+        uint32_t        arraySize; // Six per cube for cube maps
+        uint32_t        mipCount;
+        DXGI_FORMAT     format;
+        bool            isCubeMap;
+        DDS_ALPHA_MODE  alphaMode;
+    };
+
+    // Where one mip level of one array slice lies in the bit data
+    struct DDS_SUBRESOURCE_LAYOUT
+    {
+        uint64_t        offset; // From the start of the bit data
+        uint32_t        width;
+        uint32_t        height;
+        uint32_t        depth;
+        uint32_t        rowPitch;
+        uint32_t        slicePitch;
+        uint32_t        numRows;
+    };
+
+    size_t BitsPerPixel( DXGI_FORMAT fmt );
+
+    void GetSurfaceInfo( size_t width,
+                         size_t height,
+                         DXGI_FORMAT fmt,
+                         size_t* outNumBytes,
+                         size_t* outRowBytes,
+                         size_t* outNumRows );
+
+    // The sRGB variant of format, or format itself if it has none
+    DXGI_FORMAT MakeSRGB( DXGI_FORMAT format );
+
+    DXGI_FORMAT GetDXGIFormat( const DDS_PIXELFORMAT& ddpf );
+
+    DDS_ALPHA_MODE GetAlphaMode( const DDS_HEADER* header );
+
+    // Validates the magic number and headers at the start of ddsData.  ddsData only
+    // needs to hold the headers, so a reader can pass the first DDS_MAX_HEADER_SIZE
+    // bytes of a file; bitOffset receives the offset of the bit data in the file.
+    DDS_RESULT ParseDDSHeader( const uint8_t* ddsData,
+                               size_t ddsDataSize,
+                               const DDS_HEADER** header,
+                               size_t* bitOffset );
+
+    // Works out the texture a header returned by ParseDDSHeader describes.  Only
+    // the layout is checked; the Direct3D size limits are left to the caller.
+    DDS_RESULT GetDDSTextureDesc( const DDS_HEADER* header,
+                                  DDS_TEXTURE_DESC* desc );
+
+    // Fills layouts with one entry per subresource, in Direct3D subresource order
+    // (mip levels of slice 0, then slice 1, ...), and returns the number of bytes
+    // of bit data they span.
+    uint64_t GetDDSSubresourceLayouts( const DDS_TEXTURE_DESC& desc,
+                                       std::vector<DDS_SUBRESOURCE_LAYOUT>& layouts );
+
+    // The reverse of ParseDDSHeader and GetDDSTextureDesc: fills header, which must
+    // hold DDS_MAX_HEADER_SIZE bytes, with the magic number, DDS_HEADER and
+    // DDS_HEADER_DXT10 that describe desc, and returns the number of bytes used.
+    // The bit data follows in the layout GetDDSSubresourceLayouts gives.
+    size_t WriteDDSHeader( const DDS_TEXTURE_DESC& desc,
+                           uint8_t* header );
+}
@@ -0,0 +1,656 @@
+//***************************************************************************************
+// InstanceCuller.cpp
+//***************************************************************************************
+
+#include "InstanceCuller.h"
+#include "BvhHelper.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Instances per hierarchy leaf.
+	const UINT BvhLeafSize = 4;
+
+	// Instances per CullParallel chunk without a hierarchy (a multiple of four).
+	const UINT FlatChunkSize = 1024;
+
+	// With a hierarchy, aim for this many subtrees per thread so uneven
+	// visibility still balances.
+	const UINT SubtreesPerThread = 8;
+}
+
+CullFrustum::CullFrustum(const BoundingFrustum& frustumW)
+{
+	// GetPlanes returns normalized planes facing away from the volume.
+	XMVECTOR planes[6];
+	frustumW.GetPlanes(&planes[0], &planes[1], &planes[2], &planes[3], &planes[4], &planes[5]);
+
+	for(int i = 0; i < 6; ++i)
+		XMStoreFloat4(&Planes[i], planes[i]);
+}
+
+void CullFrustum::SetScreenSizeCulling(const XMFLOAT3& eyePosW, const XMFLOAT3& lookW,
+	float proj11, float viewportHeight, float minPixelRadius)
+{
+	float eyeDepth = lookW.x*eyePosW.x + lookW.y*eyePosW.y + lookW.z*eyePosW.z;
+	ViewAxis = XMFLOAT4(lookW.x, lookW.y, lookW.z, -eyeDepth);
+
+	// A sphere of radius r at depth z spans r*proj11/z in NDC, which is half the
+	// viewport height.
+	PixelScale = proj11 * viewportHeight * 0.5f;
+	MinPixelRadius = minPixelRadius;
+}
+
+UINT InstanceCuller::AddInstance(const BoundingBox& localBounds, FXMMATRIX world, bool isStatic)
+{
+	UINT index = mInstanceCount++;
+	mLocalBounds.push_back(localBounds);
+	mIsStatic.push_back(isStatic ? 1 : 0);
+	mLastRejectPlane.push_back(0);
+
+	mPartitionDirty = true;
+	mHasCoherentResult = false;
+
+	mBvhNodes.clear();
+
+	// Keep the arrays a multiple of four long so the last group can be loaded
+	// with a full vector.
+	size_t paddedCount = (mInstanceCount + 3) & ~3u;
+	mCenterX.resize(paddedCount, 0.0f);
+	mCenterY.resize(paddedCount, 0.0f);
+	mCenterZ.resize(paddedCount, 0.0f);
+	mRadius.resize(paddedCount, 0.0f);
+	mExtentX.resize(paddedCount, 0.0f);
+	mExtentY.resize(paddedCount, 0.0f);
+	mExtentZ.resize(paddedCount, 0.0f);
+
+	UpdateWorldBounds(index, world);
+
+	return index;
+}
+
+void InstanceCuller::Clear()
+{
+	mInstanceCount = 0;
+	mLocalBounds.clear();
+	mCenterX.clear();
+	mCenterY.clear();
+	mCenterZ.clear();
+	mRadius.clear();
+	mExtentX.clear();
+	mExtentY.clear();
+	mExtentZ.clear();
+
+	mBvhNodes.clear();
+	mBvhInstances.clear();
+	mInstanceLeaf.clear();
+
+	mIsStatic.clear();
+	mLastRejectPlane.clear();
+	mPartitionDirty = true;
+	mHasCoherentResult = false;
+}
+
+void InstanceCuller::SetWorld(UINT instance, FXMMATRIX world)
+{
+	UpdateWorldBounds(instance, world);
+
+	if(mIsStatic[instance])
+		mStaticMoved = true;
+	else
+		mDynamicMoved = true;
+
+	if(!HasHierarchy())
+		return;
+
+	// Refit the leaf and its ancestors.
+	UINT node = mInstanceLeaf[instance];
+	for(;;)
+	{
+		FitNode(node);
+		if(node == 0)
+			break;
+		node = mBvhNodes[node].Parent;
+	}
+}
+
+void InstanceCuller::BuildHierarchy()
+{
+	mBvhNodes.clear();
+	mBvhInstances.resize(mInstanceCount);
+	mInstanceLeaf.assign(mInstanceCount, 0);
+
+	if(mInstanceCount == 0)
+		return;
+
+	for(UINT i = 0; i < mInstanceCount; ++i)
+		mBvhInstances[i] = i;
+
+	mBvhNodes.reserve(2 * (mInstanceCount / BvhLeafSize + 1));
+	mBvhNodes.emplace_back();
+	BuildNode(0, 0, mInstanceCount);
+}
+
+bool InstanceCuller::HasHierarchy()const
+{
+	return !mBvhNodes.empty();
+}
+
+void InstanceCuller::BuildNode(UINT node, UINT first, UINT count)
+{
+	mBvhNodes[node].First = first;
+	mBvhNodes[node].Count = count;
+
+	if(count <= BvhLeafSize)
+	{
+		for(UINT i = first; i < first + count; ++i)
+			mInstanceLeaf[mBvhInstances[i]] = node;
+
+		FitNode(node);
+		return;
+	}
+
+	XMFLOAT3 vMin(+MathHelper::Infinity, +MathHelper::Infinity, +MathHelper::Infinity);
+	XMFLOAT3 vMax(-MathHelper::Infinity, -MathHelper::Infinity, -MathHelper::Infinity);
+	for(UINT i = first; i < first + count; ++i)
+	{
+		UINT k = mBvhInstances[i];
+		vMin.x = MathHelper::Min(vMin.x, mCenterX[k]);
+		vMin.y = MathHelper::Min(vMin.y, mCenterY[k]);
+		vMin.z = MathHelper::Min(vMin.z, mCenterZ[k]);
+		vMax.x = MathHelper::Max(vMax.x, mCenterX[k]);
+		vMax.y = MathHelper::Max(vMax.y, mCenterY[k]);
+		vMax.z = MathHelper::Max(vMax.z, mCenterZ[k]);
+	}
+
+	const std::vector<float>* centers[3] = { &mCenterX, &mCenterY, &mCenterZ };
+	const std::vector<float>* axis = centers[BvhHelper::LongestAxis(
+		XMFLOAT3(vMax.x - vMin.x, vMax.y - vMin.y, vMax.z - vMin.z))];
+
+	UINT leftCount = BvhHelper::MedianSplit(mBvhInstances, first, count,
+		[axis](UINT instance) { return (*axis)[instance]; });
+
+	// Siblings are allocated together.
+	UINT left = (UINT)mBvhNodes.size();
+	mBvhNodes.emplace_back();
+	mBvhNodes.emplace_back();
+	mBvhNodes[left].Parent = node;
+	mBvhNodes[left + 1].Parent = node;
+	mBvhNodes[node].Left = left;
+
+	BuildNode(left, first, leftCount);
+	BuildNode(left + 1, first + leftCount, count - leftCount);
+
+	FitNode(node);
+}
+
+void InstanceCuller::FitNode(UINT node)
+{
+	BvhNode& n = mBvhNodes[node];
+
+	XMVECTOR vMin = XMVectorReplicate(+MathHelper::Infinity);
+	XMVECTOR vMax = XMVectorReplicate(-MathHelper::Infinity);
+
+	if(n.Left == 0)
+	{
+		for(UINT i = n.First; i < n.First + n.Count; ++i)
+		{
+			UINT k = mBvhInstances[i];
+			XMVECTOR c = XMVectorSet(mCenterX[k], mCenterY[k], mCenterZ[k], 0.0f);
+			XMVECTOR e = XMVectorSet(mExtentX[k], mExtentY[k], mExtentZ[k], 0.0f);
+			vMin = XMVectorMin(vMin, XMVectorSubtract(c, e));
+			vMax = XMVectorMax(vMax, XMVectorAdd(c, e));
+		}
+	}
+	else
+	{
+		for(UINT child = n.Left; child <= n.Left + 1; ++child)
+		{
+			XMVECTOR c = XMLoadFloat3(&mBvhNodes[child].Center);
+			XMVECTOR e = XMLoadFloat3(&mBvhNodes[child].Extents);
+			vMin = XMVectorMin(vMin, XMVectorSubtract(c, e));
+			vMax = XMVectorMax(vMax, XMVectorAdd(c, e));
+		}
+	}
+
+	XMStoreFloat3(&n.Center, XMVectorScale(XMVectorAdd(vMin, vMax), 0.5f));
+	XMStoreFloat3(&n.Extents, XMVectorScale(XMVectorSubtract(vMax, vMin), 0.5f));
+}
+
+UINT InstanceCuller::InstanceCount()const
+{
+	return mInstanceCount;
+}
+
+BoundingSphere InstanceCuller::GetWorldSphere(UINT instance)const
+{
+	return BoundingSphere(
+		XMFLOAT3(mCenterX[instance], mCenterY[instance], mCenterZ[instance]),
+		mRadius[instance]);
+}
+
+BoundingBox InstanceCuller::GetWorldBox(UINT instance)const
+{
+	return BoundingBox(
+		XMFLOAT3(mCenterX[instance], mCenterY[instance], mCenterZ[instance]),
+		XMFLOAT3(mExtentX[instance], mExtentY[instance], mExtentZ[instance]));
+}
+
+float InstanceCuller::GetPixelRadius(const CullFrustum& frustum, UINT instance)const
+{
+	const XMFLOAT4& axis = frustum.ViewAxis;
+	float r = mRadius[instance];
+	float nearDepth = axis.x*mCenterX[instance] + axis.y*mCenterY[instance] + axis.z*mCenterZ[instance] + axis.w - r;
+
+	if(nearDepth <= 0.0f)
+		return MathHelper::Infinity;
+
+	return r * frustum.PixelScale / nearDepth;
+}
+
+bool InstanceCuller::IsTooSmall(const CullFrustum& frustum, UINT instance)const
+{
+	// GetPixelRadius() < MinPixelRadius without the divide; an instance that
+	// reaches the eye has nearDepth <= 0 and is never too small.
+	const XMFLOAT4& axis = frustum.ViewAxis;
+	float r = mRadius[instance];
+	float nearDepth = axis.x*mCenterX[instance] + axis.y*mCenterY[instance] + axis.z*mCenterZ[instance] + axis.w - r;
+
+	return frustum.MinPixelRadius * nearDepth > r * frustum.PixelScale;
+}
+
+void InstanceCuller::UpdateWorldBounds(UINT instance, FXMMATRIX world)
+{
+	const BoundingBox& box = mLocalBounds[instance];
+
+	XMVECTOR center = XMVector3TransformCoord(XMLoadFloat3(&box.Center), world);
+
+	// World extents of the transformed box: each world axis picks up the absolute
+	// contribution of every local axis (row vector convention, so row i is the
+	// image of local axis i).
+	XMVECTOR extents = XMVectorZero();
+	extents = XMVectorMultiplyAdd(XMVectorReplicate(box.Extents.x), XMVectorAbs(world.r[0]), extents);
+	extents = XMVectorMultiplyAdd(XMVectorReplicate(box.Extents.y), XMVectorAbs(world.r[1]), extents);
+	extents = XMVectorMultiplyAdd(XMVectorReplicate(box.Extents.z), XMVectorAbs(world.r[2]), extents);
+
+	// Sphere around the local box, scaled by the largest axis scale.
+	float maxScaleSq = MathHelper::Max(
+		XMVectorGetX(XMVector3LengthSq(world.r[0])), MathHelper::Max(
+		XMVectorGetX(XMVector3LengthSq(world.r[1])),
+		XMVectorGetX(XMVector3LengthSq(world.r[2]))));
+	float radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&box.Extents))) * sqrtf(maxScaleSq);
+
+	mCenterX[instance] = XMVectorGetX(center);
+	mCenterY[instance] = XMVectorGetY(center);
+	mCenterZ[instance] = XMVectorGetZ(center);
+	mRadius[instance] = radius;
+	mExtentX[instance] = XMVectorGetX(extents);
+	mExtentY[instance] = XMVectorGetY(extents);
+	mExtentZ[instance] = XMVectorGetZ(extents);
+}
+
+void InstanceCuller::Cull(const CullFrustum& frustum, std::vector<UINT>& visible, CullStats* stats)const
+{
+	if(HasHierarchy())
+		CullHierarchy(frustum, 0, visible, stats);
+	else
+		CullFlat(frustum, 0, mInstanceCount, visible, stats);
+}
+
+bool InstanceCuller::CullCoherent(const CullFrustum& frustum, std::vector<UINT>& visible, CullStats* stats)
+{
+	bool frustumChanged = !mHasCoherentResult ||
+		memcmp(&frustum, &mLastFrustum, sizeof(CullFrustum)) != 0;
+
+	// Nothing moved: the previous answer still holds.
+	if(!frustumChanged && !mStaticMoved && !mDynamicMoved)
+	{
+		visible.insert(visible.end(), mCoherentVisible.begin(), mCoherentVisible.end());
+		if(stats != nullptr)
+			stats->StaticInstancesSkipped += (UINT)mStaticInstances.size();
+		return true;
+	}
+
+	if(mPartitionDirty)
+	{
+		mStaticInstances.clear();
+		mDynamicInstances.clear();
+		for(UINT i = 0; i < mInstanceCount; ++i)
+		{
+			if(mIsStatic[i])
+				mStaticInstances.push_back(i);
+			else
+				mDynamicInstances.push_back(i);
+		}
+		mPartitionDirty = false;
+		mStaticMoved = true;
+	}
+
+	UINT planeTests = 0;
+	UINT instancesTested = 0;
+
+	if(frustumChanged || mStaticMoved)
+	{
+		mStaticVisible.clear();
+		for(UINT i : mStaticInstances)
+		{
+			if(TestCoherent(frustum, i, planeTests))
+				mStaticVisible.push_back(i);
+		}
+		instancesTested += (UINT)mStaticInstances.size();
+	}
+	else if(stats != nullptr)
+	{
+		stats->StaticInstancesSkipped += (UINT)mStaticInstances.size();
+	}
+
+	mDynamicVisible.clear();
+	for(UINT i : mDynamicInstances)
+	{
+		if(TestCoherent(frustum, i, planeTests))
+			mDynamicVisible.push_back(i);
+	}
+	instancesTested += (UINT)mDynamicInstances.size();
+
+	// Both lists are sorted, so merging keeps the output in increasing order.
+	mCoherentVisible.resize(mStaticVisible.size() + mDynamicVisible.size());
+	std::merge(mStaticVisible.begin(), mStaticVisible.end(),
+		mDynamicVisible.begin(), mDynamicVisible.end(), mCoherentVisible.begin());
+
+	visible.insert(visible.end(), mCoherentVisible.begin(), mCoherentVisible.end());
+
+	mLastFrustum = frustum;
+	mHasCoherentResult = true;
+	mStaticMoved = false;
+	mDynamicMoved = false;
+
+	if(stats != nullptr)
+	{
+		stats->PlaneTests += planeTests;
+		stats->InstancesTested += instancesTested;
+	}
+
+	return false;
+}
+
+bool InstanceCuller::TestCoherent(const CullFrustum& frustum, UINT instance, UINT& planeTests)
+{
+	const float cx = mCenterX[instance];
+	const float cy = mCenterY[instance];
+	const float cz = mCenterZ[instance];
+	const float r = mRadius[instance];
+	const float ex = mExtentX[instance];
+	const float ey = mExtentY[instance];
+	const float ez = mExtentZ[instance];
+
+	// Start with the plane that rejected the instance last time; an instance
+	// that stays outside is usually rejected by the same plane again.
+	const UINT first = mLastRejectPlane[instance];
+	for(UINT k = 0; k < 6; ++k)
+	{
+		UINT p = (first + k) % 6;
+		const XMFLOAT4& pl = frustum.Planes[p];
+		++planeTests;
+
+		float dist = pl.x*cx + pl.y*cy + pl.z*cz + pl.w;
+		float boxRadius = fabsf(pl.x)*ex + fabsf(pl.y)*ey + fabsf(pl.z)*ez;
+		if(dist > MathHelper::Min(r, boxRadius))
+		{
+			mLastRejectPlane[instance] = (BYTE)p;
+			return false;
+		}
+	}
+
+	return !IsTooSmall(frustum, instance);
+}
+
+UINT InstanceCuller::CullParallel(const CullFrustum& frustum, ThreadPool& threadPool, const VisibleWriter& write)
+{
+	// Pick the chunks.  Subtrees are collected left to right so that
+	// concatenating their results gives the same order as a full traversal.
+	mChunkRoots.clear();
+	if(HasHierarchy())
+	{
+		UINT targetCount = MathHelper::Max(mInstanceCount / (threadPool.ThreadCount() * SubtreesPerThread), FlatChunkSize);
+
+		UINT stack[BvhHelper::MedianSplitMaxDepth];
+		UINT stackSize = 0;
+		stack[stackSize++] = 0;
+		while(stackSize > 0)
+		{
+			UINT node = stack[--stackSize];
+			if(mBvhNodes[node].Left == 0 || mBvhNodes[node].Count <= targetCount)
+			{
+				mChunkRoots.push_back(node);
+				continue;
+			}
+
+			stack[stackSize++] = mBvhNodes[node].Left + 1;
+			stack[stackSize++] = mBvhNodes[node].Left;
+		}
+	}
+	else
+	{
+		for(UINT begin = 0; begin < mInstanceCount; begin += FlatChunkSize)
+			mChunkRoots.push_back(begin);
+	}
+
+	const UINT chunkCount = (UINT)mChunkRoots.size();
+	if(mChunkVisible.size() < chunkCount)
+		mChunkVisible.resize(chunkCount);
+	mChunkOffsets.resize(chunkCount + 1);
+
+	threadPool.ParallelFor(chunkCount, 1, [&](UINT begin, UINT end, UINT threadIndex)
+	{
+		for(UINT i = begin; i < end; ++i)
+		{
+			mChunkVisible[i].clear();
+			if(HasHierarchy())
+			{
+				CullHierarchy(frustum, mChunkRoots[i], mChunkVisible[i], nullptr);
+			}
+			else
+			{
+				UINT first = mChunkRoots[i];
+				CullFlat(frustum, first, MathHelper::Min(first + FlatChunkSize, mInstanceCount), mChunkVisible[i], nullptr);
+			}
+		}
+	});
+
+	// Exclusive scan of the survivor counts.  There are at most a few thousand
+	// chunks, so this is negligible next to the culling itself.
+	mChunkOffsets[0] = 0;
+	for(UINT i = 0; i < chunkCount; ++i)
+		mChunkOffsets[i + 1] = mChunkOffsets[i] + (UINT)mChunkVisible[i].size();
+
+	threadPool.ParallelFor(chunkCount, 1, [&](UINT begin, UINT end, UINT threadIndex)
+	{
+		for(UINT i = begin; i < end; ++i)
+		{
+			if(!mChunkVisible[i].empty())
+				write(mChunkVisible[i].data(), (UINT)mChunkVisible[i].size(), mChunkOffsets[i]);
+		}
+	});
+
+	return mChunkOffsets[chunkCount];
+}
+
+void InstanceCuller::CullFlat(const CullFrustum& frustum, UINT begin, UINT end, std::vector<UINT>& visible, CullStats* stats)const
+{
+	// Splat every plane once: normal components, their absolute values (for the
+	// box's projected radius) and the plane distance.
+	XMVECTOR nx[6], ny[6], nz[6], ax[6], ay[6], az[6], d[6];
+	for(int p = 0; p < 6; ++p)
+	{
+		XMVECTOR plane = XMLoadFloat4(&frustum.Planes[p]);
+		nx[p] = XMVectorSplatX(plane);
+		ny[p] = XMVectorSplatY(plane);
+		nz[p] = XMVectorSplatZ(plane);
+		d[p] = XMVectorSplatW(plane);
+		ax[p] = XMVectorAbs(nx[p]);
+		ay[p] = XMVectorAbs(ny[p]);
+		az[p] = XMVectorAbs(nz[p]);
+	}
+
+	// Screen-size test, same as IsTooSmall().  With MinPixelRadius = 0 it
+	// compares 0 > 0 and never rejects, so there is no separate path for it.
+	XMVECTOR axis = XMLoadFloat4(&frustum.ViewAxis);
+	XMVECTOR vx = XMVectorSplatX(axis);
+	XMVECTOR vy = XMVectorSplatY(axis);
+	XMVECTOR vz = XMVectorSplatZ(axis);
+	XMVECTOR vw = XMVectorSplatW(axis);
+	XMVECTOR pixelScale = XMVectorReplicate(frustum.PixelScale);
+	XMVECTOR minPixelRadius = XMVectorReplicate(frustum.MinPixelRadius);
+
+	for(UINT base = begin; base < end; base += 4)
+	{
+		XMVECTOR cx = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mCenterX[base]));
+		XMVECTOR cy = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mCenterY[base]));
+		XMVECTOR cz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mCenterZ[base]));
+		XMVECTOR r = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mRadius[base]));
+		XMVECTOR ex = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mExtentX[base]));
+		XMVECTOR ey = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mExtentY[base]));
+		XMVECTOR ez = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mExtentZ[base]));
+
+		XMVECTOR outside = XMVectorFalseInt();
+		for(int p = 0; p < 6; ++p)
+		{
+			XMVECTOR dist = XMVectorMultiplyAdd(cx, nx[p],
+				XMVectorMultiplyAdd(cy, ny[p],
+				XMVectorMultiplyAdd(cz, nz[p], d[p])));
+
+			// Both volumes bound the instance, so the tighter one decides.
+			XMVECTOR boxRadius = XMVectorMultiplyAdd(ex, ax[p],
+				XMVectorMultiplyAdd(ey, ay[p],
+				XMVectorMultiply(ez, az[p])));
+
+			outside = XMVectorOrInt(outside, XMVectorGreater(dist, XMVectorMin(r, boxRadius)));
+		}
+
+		XMVECTOR nearDepth = XMVectorSubtract(
+			XMVectorMultiplyAdd(cx, vx,
+			XMVectorMultiplyAdd(cy, vy,
+			XMVectorMultiplyAdd(cz, vz, vw))), r);
+		outside = XMVectorOrInt(outside,
+			XMVectorGreater(XMVectorMultiply(minPixelRadius, nearDepth), XMVectorMultiply(r, pixelScale)));
+
+		uint32_t mask[4];
+		XMStoreInt4(mask, outside);
+
+		UINT laneCount = MathHelper::Min(4u, end - base);
+		for(UINT lane = 0; lane < laneCount; ++lane)
+		{
+			if(mask[lane] == 0)
+				visible.push_back(base + lane);
+		}
+	}
+
+	if(stats != nullptr)
+		stats->InstancesTested += end - begin;
+}
+
+void InstanceCuller::CullHierarchy(const CullFrustum& frustum, UINT root, std::vector<UINT>& visible, CullStats* stats)const
+{
+	const XMFLOAT4* planes = frustum.Planes;
+
+	// Bit p of a plane mask is set if the node straddles plane p.  Children only
+	// test the planes their parent straddles.
+	struct StackEntry
+	{
+		UINT Node;
+		UINT PlaneMask;
+	};
+	StackEntry stack[BvhHelper::MedianSplitMaxDepth];
+	UINT stackSize = 0;
+	stack[stackSize++] = { root, 0x3f };
+
+	UINT nodesVisited = 0;
+	UINT instancesTested = 0;
+	UINT instancesAccepted = 0;
+
+	while(stackSize > 0)
+	{
+		StackEntry entry = stack[--stackSize];
+		const BvhNode& node = mBvhNodes[entry.Node];
+		++nodesVisited;
+
+		bool outside = false;
+		UINT planeMask = entry.PlaneMask;
+		for(int p = 0; p < 6 && !outside; ++p)
+		{
+			if((planeMask & (1u << p)) == 0)
+				continue;
+
+			const XMFLOAT4& pl = planes[p];
+			float dist = pl.x*node.Center.x + pl.y*node.Center.y + pl.z*node.Center.z + pl.w;
+			float radius = fabsf(pl.x)*node.Extents.x + fabsf(pl.y)*node.Extents.y + fabsf(pl.z)*node.Extents.z;
+
+			if(dist > radius)
+				outside = true;
+			else if(dist < -radius)
+				planeMask &= ~(1u << p);
+		}
+
+		if(outside)
+			continue;
+
+		// Completely inside: take the whole subtree without further plane tests.
+		if(planeMask == 0)
+		{
+			if(frustum.MinPixelRadius > 0.0f)
+			{
+				for(UINT i = node.First; i < node.First + node.Count; ++i)
+				{
+					if(!IsTooSmall(frustum, mBvhInstances[i]))
+						visible.push_back(mBvhInstances[i]);
+				}
+			}
+			else
+			{
+				visible.insert(visible.end(),
+					mBvhInstances.begin() + node.First,
+					mBvhInstances.begin() + node.First + node.Count);
+			}
+			instancesAccepted += node.Count;
+			continue;
+		}
+
+		if(node.Left != 0)
+		{
+			// Visit the left child first so the output follows leaf order.
+			stack[stackSize++] = { node.Left + 1, planeMask };
+			stack[stackSize++] = { node.Left, planeMask };
+			continue;
+		}
+
+		for(UINT i = node.First; i < node.First + node.Count; ++i)
+		{
+			UINT k = mBvhInstances[i];
+			++instancesTested;
+
+			bool instanceOutside = false;
+			for(int p = 0; p < 6 && !instanceOutside; ++p)
+			{
+				if((planeMask & (1u << p)) == 0)
+					continue;
+
+				const XMFLOAT4& pl = planes[p];
+				float dist = pl.x*mCenterX[k] + pl.y*mCenterY[k] + pl.z*mCenterZ[k] + pl.w;
+				float boxRadius = fabsf(pl.x)*mExtentX[k] + fabsf(pl.y)*mExtentY[k] + fabsf(pl.z)*mExtentZ[k];
+
+				instanceOutside = dist > MathHelper::Min(mRadius[k], boxRadius);
+			}
+
+			if(!instanceOutside && !IsTooSmall(frustum, k))
+				visible.push_back(k);
+		}
+	}
+
+	if(stats != nullptr)
+	{
+		stats->NodesVisited += nodesVisited;
+		stats->InstancesTested += instancesTested;
+		stats->InstancesAccepted += instancesAccepted;
+	}
+}
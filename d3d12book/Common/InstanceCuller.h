@@ -0,0 +1,190 @@
+//***************************************************************************************
+// InstanceCuller.h
+//
+// Frustum culling for large numbers of instances.  World space bounds (a sphere
+// and an axis-aligned box around the same center) are stored as structure of
+// arrays and only recomputed when an instance moves.  A cull then tests four
+// instances at a time against the six world space frustum planes, which is a
+// handful of multiply-adds per plane instead of a matrix inverse and a frustum
+// transform per instance.
+//
+// For large scenes, BuildHierarchy() builds a bounding volume hierarchy over the
+// instances.  Culling then rejects or accepts whole subtrees, so its cost follows
+// the number of visible instances rather than the total.  Moving instances refit
+// the nodes above them; rebuild after large changes to keep the tree tight.
+//
+// CullParallel() splits the work over a thread pool and hands each chunk's
+// survivors to a callback together with its final output offset, so visible
+// instance data can be written straight into a mapped upload buffer.
+//
+// CullCoherent() exploits frame-to-frame coherence instead: every instance
+// remembers the plane that rejected it last time and tests it first, static
+// instances are not retested while the frustum stays the same, and when nothing
+// moved at all the previous result is returned as is.
+//
+// All of them can also drop instances that would cover only a few pixels; see
+// CullFrustum::SetScreenSizeCulling.  GetPixelRadius() returns the same measure
+// for choosing a mesh LOD.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "ThreadPool.h"
+
+// The six planes of a world space view volume.  Plane normals point out of the
+// volume, so a point p is outside plane i if dot(Planes[i].xyz, p) + Planes[i].w > 0.
+struct CullFrustum
+{
+	CullFrustum() = default;
+	explicit CullFrustum(const DirectX::BoundingFrustum& frustumW);
+
+	// Also rejects instances whose bounding sphere projects to a radius below
+	// minPixelRadius pixels.  lookW is the unit view direction, proj11 the (1,1)
+	// entry of the projection matrix and viewportHeight is in pixels.
+	void SetScreenSizeCulling(const DirectX::XMFLOAT3& eyePosW, const DirectX::XMFLOAT3& lookW,
+		float proj11, float viewportHeight, float minPixelRadius);
+
+	DirectX::XMFLOAT4 Planes[6];
+
+	// View depth of a world point p is dot(ViewAxis.xyz, p) + ViewAxis.w, and a
+	// sphere of radius r whose nearest point is at depth z covers about
+	// r*PixelScale/z pixels.  MinPixelRadius = 0 disables the test.
+	DirectX::XMFLOAT4 ViewAxis = { 0.0f, 0.0f, 0.0f, 0.0f };
+	float PixelScale = 0.0f;
+	float MinPixelRadius = 0.0f;
+};
+
+struct CullStats
+{
+	UINT NodesVisited = 0;
+	UINT InstancesTested = 0;
+	UINT InstancesAccepted = 0;
+
+	// CullCoherent only.
+	UINT PlaneTests = 0;
+	UINT StaticInstancesSkipped = 0;
+};
+
+class InstanceCuller
+{
+public:
+	InstanceCuller() = default;
+	InstanceCuller(const InstanceCuller& rhs) = delete;
+	InstanceCuller& operator=(const InstanceCuller& rhs) = delete;
+	~InstanceCuller() = default;
+
+	// Returns the index of the new instance.  Drops the hierarchy, if any.
+	// Static instances may still move, but each move invalidates the cached
+	// static results of CullCoherent, so give anything that moves often
+	// isStatic = false.
+	UINT AddInstance(const DirectX::BoundingBox& localBounds, DirectX::FXMMATRIX world, bool isStatic = true);
+	void Clear();
+
+	// Recomputes the world bounds of an instance that moved, and refits the
+	// hierarchy nodes above it.
+	void SetWorld(UINT instance, DirectX::FXMMATRIX world);
+
+	// Builds the hierarchy over the current instances (median split along the
+	// longest axis).  O(n log n); call after adding instances.
+	void BuildHierarchy();
+	bool HasHierarchy()const;
+
+	UINT InstanceCount()const;
+
+	DirectX::BoundingSphere GetWorldSphere(UINT instance)const;
+	DirectX::BoundingBox GetWorldBox(UINT instance)const;
+
+	// Projected radius in pixels that the screen-size test compares against
+	// frustum.MinPixelRadius; infinite if the instance reaches the eye.
+	float GetPixelRadius(const CullFrustum& frustum, UINT instance)const;
+
+	// Appends the indices of the instances that are not completely outside the
+	// frustum (and not too small, if enabled) to visible.  Conservative: an
+	// instance is only rejected if its sphere or its box is outside one of the
+	// planes.  The order is increasing without a hierarchy and hierarchy order
+	// with one; both are deterministic.
+	void Cull(const CullFrustum& frustum, std::vector<UINT>& visible, CullStats* stats = nullptr)const;
+
+	// Same visible set as Cull(), in increasing order, using the coherence
+	// caches described above.  Returns true if the result and the bounds of
+	// every instance are unchanged since the previous call, in which case
+	// buffers filled from the previous result are still valid.
+	bool CullCoherent(const CullFrustum& frustum, std::vector<UINT>& visible, CullStats* stats = nullptr);
+
+	// Same result as Cull(), computed on threadPool.  Each chunk collects its
+	// survivors locally; an exclusive scan over the chunk counts gives every
+	// chunk its output offset, and write(indices, count, firstOutput) is then
+	// called for each chunk in parallel.  The offsets follow Cull()'s order, so
+	// the output is the same every run regardless of scheduling.  Returns the
+	// number of visible instances.
+	typedef std::function<void(const UINT* indices, UINT count, UINT firstOutput)> VisibleWriter;
+	UINT CullParallel(const CullFrustum& frustum, ThreadPool& threadPool, const VisibleWriter& write);
+
+private:
+	// Children of an inner node are Left and Left+1.  Every node covers the
+	// contiguous range [First, First+Count) of mBvhInstances, so accepting a
+	// subtree is a copy.
+	struct BvhNode
+	{
+		DirectX::XMFLOAT3 Center;
+		DirectX::XMFLOAT3 Extents;
+		UINT Parent = 0;
+		UINT Left = 0; // 0 for leaves (the root is never a child)
+		UINT First = 0;
+		UINT Count = 0;
+	};
+
+	void UpdateWorldBounds(UINT instance, DirectX::FXMMATRIX world);
+
+	// [begin, end) must start on a multiple of four.
+	void CullFlat(const CullFrustum& frustum, UINT begin, UINT end, std::vector<UINT>& visible, CullStats* stats)const;
+	void CullHierarchy(const CullFrustum& frustum, UINT root, std::vector<UINT>& visible, CullStats* stats)const;
+
+	// Plane-cached test of one instance for CullCoherent.
+	bool TestCoherent(const CullFrustum& frustum, UINT instance, UINT& planeTests);
+
+	// Screen-size test of one instance; always false when it is disabled.
+	bool IsTooSmall(const CullFrustum& frustum, UINT instance)const;
+
+	void BuildNode(UINT node, UINT first, UINT count);
+	void FitNode(UINT node);
+
+private:
+	UINT mInstanceCount = 0;
+
+	std::vector<DirectX::BoundingBox> mLocalBounds;
+
+	// World space bounds, padded to a multiple of four entries.
+	std::vector<float> mCenterX;
+	std::vector<float> mCenterY;
+	std::vector<float> mCenterZ;
+	std::vector<float> mRadius;
+	std::vector<float> mExtentX;
+	std::vector<float> mExtentY;
+	std::vector<float> mExtentZ;
+
+	std::vector<BvhNode> mBvhNodes;
+	std::vector<UINT> mBvhInstances;    // instance indices in leaf order
+	std::vector<UINT> mInstanceLeaf;    // leaf node of each instance
+
+	// CullParallel scratch: subtrees or instance ranges culled as one chunk,
+	// their survivors and their output offsets.
+	std::vector<UINT> mChunkRoots;
+	std::vector<std::vector<UINT>> mChunkVisible;
+	std::vector<UINT> mChunkOffsets;
+
+	// CullCoherent state.
+	std::vector<BYTE> mIsStatic;
+	std::vector<BYTE> mLastRejectPlane;
+	std::vector<UINT> mStaticInstances;
+	std::vector<UINT> mDynamicInstances;
+	std::vector<UINT> mStaticVisible;
+	std::vector<UINT> mDynamicVisible;
+	std::vector<UINT> mCoherentVisible;
+	CullFrustum mLastFrustum;
+	bool mHasCoherentResult = false;
+	bool mPartitionDirty = true;
+	bool mStaticMoved = true;
+	bool mDynamicMoved = true;
+};
@@ -0,0 +1,370 @@
+//***************************************************************************************
+// MipGenerator.cpp
+//***************************************************************************************
+
+#include "MipGenerator.h"
+#include "BlockDecompressor.h"
+#include "MathHelper.h"
+#include "ThreadPool.h"
+#include <cmath>
+#include <fstream>
+
+using namespace DirectX;
+
+namespace
+{
+	// Rows of texels handed to a thread at a time.
+	const UINT RowGrainSize = 16;
+
+	// Kaiser filter radius, in texels of the smaller level, and window shape.
+	const float KaiserRadius = 3.0f;
+	const float KaiserAlpha = 4.0f;
+
+	struct FilterTap
+	{
+		UINT Source = 0;
+		float Weight = 0.0f;
+	};
+
+	// The taps of every texel of the smaller level along one axis: texel i reads
+	// Taps[First[i]] to Taps[First[i + 1] - 1].
+	struct FilterTable
+	{
+		std::vector<UINT> First;
+		std::vector<FilterTap> Taps;
+	};
+
+	// Zeroth order modified Bessel function of the first kind.
+	float BesselI0(float x)
+	{
+		float sum = 1.0f;
+		float term = 1.0f;
+		float halfX = 0.5f*x;
+		for(UINT k = 1; k < 32 && term > 1e-7f*sum; ++k)
+		{
+			term *= (halfX / k)*(halfX / k);
+			sum += term;
+		}
+
+		return sum;
+	}
+
+	float KaiserSinc(float t)
+	{
+		if(fabsf(t) >= KaiserRadius)
+			return 0.0f;
+
+		float sinc = 1.0f;
+		if(t != 0.0f)
+		{
+			float x = XM_PI*t;
+			sinc = sinf(x) / x;
+		}
+
+		float r = t / KaiserRadius;
+		return sinc*BesselI0(KaiserAlpha*sqrtf(1.0f - r*r)) / BesselI0(KaiserAlpha);
+	}
+
+	FilterTable BuildFilterTable(UINT srcSize, UINT dstSize, MipFilter filter)
+	{
+		FilterTable table;
+		table.First.reserve(dstSize + 1);
+
+		const float scale = (float)srcSize / dstSize;
+		for(UINT i = 0; i < dstSize; ++i)
+		{
+			UINT first = (UINT)table.Taps.size();
+			table.First.push_back(first);
+
+			// Positions are in source texels, with texel s covering [s, s + 1).
+			float center = (i + 0.5f)*scale;
+			if(filter == MipFilter::Box)
+			{
+				float lo = center - 0.5f*scale;
+				float hi = center + 0.5f*scale;
+				for(int s = (int)floorf(lo); s < (int)ceilf(hi); ++s)
+				{
+					FilterTap tap;
+					tap.Source = (UINT)MathHelper::Min(s, (int)srcSize - 1);
+					tap.Weight = MathHelper::Min(hi, s + 1.0f) - MathHelper::Max(lo, (float)s);
+					if(tap.Weight > 0.0f)
+						table.Taps.push_back(tap);
+				}
+			}
+			else
+			{
+				float radius = KaiserRadius*scale;
+				for(int s = (int)floorf(center - radius); s <= (int)ceilf(center + radius); ++s)
+				{
+					FilterTap tap;
+					tap.Source = (UINT)MathHelper::Clamp(s, 0, (int)srcSize - 1);
+					tap.Weight = KaiserSinc((s + 0.5f - center) / scale);
+					if(tap.Weight != 0.0f)
+						table.Taps.push_back(tap);
+				}
+			}
+
+			float sum = 0.0f;
+			for(UINT t = first; t < (UINT)table.Taps.size(); ++t)
+				sum += table.Taps[t].Weight;
+			for(UINT t = first; t < (UINT)table.Taps.size(); ++t)
+				table.Taps[t].Weight /= sum;
+		}
+
+		table.First.push_back((UINT)table.Taps.size());
+		return table;
+	}
+
+	// A level in floating point, linear if the texture is sRGB.
+	struct FloatImage
+	{
+		UINT Width = 0;
+		UINT Height = 0;
+		std::vector<XMFLOAT4> Texels;
+	};
+
+	void ToFloatImage(const ImageRGBA8& image, bool srgb, FloatImage& result, ThreadPool& threadPool)
+	{
+		result.Width = image.Width;
+		result.Height = image.Height;
+		result.Texels.resize((size_t)image.Width*image.Height);
+
+		threadPool.ParallelFor(image.Height, RowGrainSize, [&](UINT begin, UINT end, UINT threadIndex)
+		{
+			const XMVECTOR toUnit = XMVectorReplicate(1.0f / 255.0f);
+			for(size_t i = (size_t)begin*image.Width; i < (size_t)end*image.Width; ++i)
+			{
+				const uint8_t* texel = &image.Texels[i*4];
+				XMVECTOR v = XMVectorMultiply(XMVectorSet(texel[0], texel[1], texel[2], texel[3]), toUnit);
+				if(srgb)
+					v = XMColorSRGBToRGB(v);
+				XMStoreFloat4(&result.Texels[i], v);
+			}
+		});
+	}
+
+	void ToImage(const FloatImage& image, bool srgb, ImageRGBA8& result, ThreadPool& threadPool)
+	{
+		result.Width = image.Width;
+		result.Height = image.Height;
+		result.Texels.resize((size_t)image.Width*image.Height*4);
+
+		threadPool.ParallelFor(image.Height, RowGrainSize, [&](UINT begin, UINT end, UINT threadIndex)
+		{
+			const XMVECTOR toByte = XMVectorReplicate(255.0f);
+			const XMVECTOR half = XMVectorReplicate(0.5f);
+			for(size_t i = (size_t)begin*image.Width; i < (size_t)end*image.Width; ++i)
+			{
+				// The Kaiser filter's negative lobes can overshoot [0, 1].
+				XMVECTOR v = XMVectorSaturate(XMLoadFloat4(&image.Texels[i]));
+				if(srgb)
+					v = XMColorRGBToSRGB(v);
+
+				XMFLOAT4 f;
+				XMStoreFloat4(&f, XMVectorMultiplyAdd(v, toByte, half));
+
+				uint8_t* texel = &result.Texels[i*4];
+				texel[0] = (uint8_t)f.x;
+				texel[1] = (uint8_t)f.y;
+				texel[2] = (uint8_t)f.z;
+				texel[3] = (uint8_t)f.w;
+			}
+		});
+	}
+
+	// Filters src down to dst.Width x dst.Height, first along rows and then along
+	// columns.
+	void Downsample(const FloatImage& src, FloatImage& dst, MipFilter filter, ThreadPool& threadPool)
+	{
+		FilterTable columns = BuildFilterTable(src.Width, dst.Width, filter);
+		FilterTable rows = BuildFilterTable(src.Height, dst.Height, filter);
+
+		std::vector<XMFLOAT4> narrow((size_t)dst.Width*src.Height);
+		threadPool.ParallelFor(src.Height, RowGrainSize, [&](UINT begin, UINT end, UINT threadIndex)
+		{
+			for(UINT y = begin; y < end; ++y)
+			{
+				const XMFLOAT4* in = &src.Texels[(size_t)y*src.Width];
+				XMFLOAT4* out = &narrow[(size_t)y*dst.Width];
+				for(UINT x = 0; x < dst.Width; ++x)
+				{
+					XMVECTOR sum = XMVectorZero();
+					for(UINT t = columns.First[x]; t < columns.First[x + 1]; ++t)
+					{
+						const FilterTap& tap = columns.Taps[t];
+						sum = XMVectorMultiplyAdd(XMLoadFloat4(&in[tap.Source]), XMVectorReplicate(tap.Weight), sum);
+					}
+					XMStoreFloat4(&out[x], sum);
+				}
+			}
+		});
+
+		dst.Texels.resize((size_t)dst.Width*dst.Height);
+		threadPool.ParallelFor(dst.Height, RowGrainSize, [&](UINT begin, UINT end, UINT threadIndex)
+		{
+			for(UINT y = begin; y < end; ++y)
+			{
+				XMFLOAT4* out = &dst.Texels[(size_t)y*dst.Width];
+				std::fill(out, out + dst.Width, XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f));
+
+				// Whole rows at a time, so the reads stay sequential.
+				for(UINT t = rows.First[y]; t < rows.First[y + 1]; ++t)
+				{
+					const FilterTap& tap = rows.Taps[t];
+					const XMFLOAT4* in = &narrow[(size_t)tap.Source*dst.Width];
+					XMVECTOR weight = XMVectorReplicate(tap.Weight);
+					for(UINT x = 0; x < dst.Width; ++x)
+						XMStoreFloat4(&out[x], XMVectorMultiplyAdd(XMLoadFloat4(&in[x]), weight, XMLoadFloat4(&out[x])));
+				}
+			}
+		});
+	}
+}
+
+bool MipGenerator::LoadDDSImage(const std::wstring& filename, ImageRGBA8& image, DXGI_FORMAT* format)
+{
+	std::ifstream fin(filename, std::ios::binary);
+	if(!fin)
+		return false;
+
+	uint8_t headerData[DDS_MAX_HEADER_SIZE];
+	fin.read((char*)headerData, sizeof(headerData));
+	size_t headerDataSize = (size_t)fin.gcount();
+
+	const DDS_HEADER* header = nullptr;
+	size_t bitOffset = 0;
+	DDS_TEXTURE_DESC desc;
+	if(ParseDDSHeader(headerData, headerDataSize, &header, &bitOffset) != DDS_RESULT_OK ||
+		GetDDSTextureDesc(header, &desc) != DDS_RESULT_OK)
+	{
+		return false;
+	}
+
+	if(desc.dimension != DDS_DIMENSION_TEXTURE2D || desc.arraySize != 1)
+		return false;
+
+	bool bgr = false;
+	bool opaque = false;
+	switch(desc.format)
+	{
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+		break;
+
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+		bgr = true;
+		break;
+
+	case DXGI_FORMAT_B8G8R8X8_UNORM:
+	case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+		bgr = true;
+		opaque = true;
+		break;
+
+	default:
+		if(!BlockDecompressor::IsSupported(desc.format))
+			return false;
+		break;
+	}
+
+	std::vector<DDS_SUBRESOURCE_LAYOUT> layouts;
+	GetDDSSubresourceLayouts(desc, layouts);
+	layouts.resize(1);
+	const DDS_SUBRESOURCE_LAYOUT& top = layouts[0];
+
+	std::vector<uint8_t> bitData((size_t)top.slicePitch);
+
+	// The header read may have run into the end of a small file.
+	fin.clear();
+	fin.seekg(bitOffset + top.offset);
+	fin.read((char*)bitData.data(), top.slicePitch);
+	if((size_t)fin.gcount() != top.slicePitch)
+		return false;
+
+	if(BlockDecompressor::IsSupported(desc.format))
+	{
+		// Decode reads the layout's offset from the start of bitData.
+		layouts[0].offset = 0;
+
+		std::vector<ImageRGBA8> images;
+		if(!BlockDecompressor::Decode(desc.format, bitData.data(), layouts, images, ThreadPool::Default()))
+			return false;
+
+		image = std::move(images[0]);
+	}
+	else
+	{
+		image.Width = top.width;
+		image.Height = top.height;
+		image.Texels = std::move(bitData);
+	}
+
+	if(bgr)
+	{
+		for(size_t i = 0; i < image.Texels.size(); i += 4)
+		{
+			std::swap(image.Texels[i], image.Texels[i + 2]);
+			if(opaque)
+				image.Texels[i + 3] = 255;
+		}
+	}
+
+	if(format != nullptr)
+		*format = desc.format;
+
+	return true;
+}
+
+void MipGenerator::GenerateMips(const ImageRGBA8& image, MipFilter filter, bool srgb,
+	std::vector<ImageRGBA8>& mips, ThreadPool& threadPool)
+{
+	mips.clear();
+	mips.push_back(image);
+
+	FloatImage level;
+	ToFloatImage(image, srgb, level, threadPool);
+
+	while(level.Width > 1 || level.Height > 1)
+	{
+		FloatImage next;
+		next.Width = MathHelper::Max(level.Width / 2, 1u);
+		next.Height = MathHelper::Max(level.Height / 2, 1u);
+		Downsample(level, next, filter, threadPool);
+
+		ImageRGBA8 mip;
+		ToImage(next, srgb, mip, threadPool);
+		mips.push_back(std::move(mip));
+
+		level = std::move(next);
+	}
+}
+
+bool MipGenerator::SaveDDSTexture(const std::wstring& filename, const std::vector<ImageRGBA8>& mips,
+	DXGI_FORMAT format, bool srgb, ThreadPool& threadPool)
+{
+	if(mips.empty())
+		return false;
+
+	std::vector<std::vector<uint8_t>> data(mips.size());
+	if(BlockCompressor::IsSupported(format))
+	{
+		for(size_t i = 0; i < mips.size(); ++i)
+		{
+			if(!BlockCompressor::Compress(mips[i], format, data[i], threadPool))
+				return false;
+		}
+	}
+	else if(format == DXGI_FORMAT_R8G8B8A8_UNORM || format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB)
+	{
+		for(size_t i = 0; i < mips.size(); ++i)
+			data[i] = mips[i].Texels;
+	}
+	else
+	{
+		return false;
+	}
+
+	return BlockCompressor::SaveDDSTexture(filename, srgb ? MakeSRGB(format) : format,
+		mips[0].Width, mips[0].Height, data);
+}
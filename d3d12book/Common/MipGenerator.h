@@ -0,0 +1,49 @@
+//***************************************************************************************
+// MipGenerator.h
+//
+// Builds full mip chains on the CPU for textures authored without them.  Each level
+// is filtered from the one above it, kept in floating point between levels, with
+// a separable filter applied to four-channel XMVECTOR texels; rows are spread over
+// a ThreadPool.  sRGB textures are filtered in linear light so that bright and dark
+// texels average the way they look on screen.
+//
+// The chain can be written out uncompressed or handed to BlockCompressor.
+//***************************************************************************************
+
+#pragma once
+
+#include "BlockCompressor.h"
+
+enum class MipFilter
+{
+	// Averages the texels each texel of the next level covers.  Cheap, but
+	// blurs and lets some aliasing through.
+	Box,
+
+	// Kaiser-windowed sinc over three texels of the next level on either side.
+	// Keeps more detail, at the cost of slight ringing at hard edges.
+	Kaiser
+};
+
+class MipGenerator
+{
+public:
+	// Reads the top mip of a 2D DDS texture stored as R8G8B8A8, B8G8R8A8 or
+	// B8G8R8X8 (UNORM or UNORM_SRGB) into image, in RGBA order.  Files in a UNORM
+	// block-compressed format are decoded by BlockDecompressor, so a chain can be
+	// rebuilt from one.  format receives the file's format.  Returns false for any
+	// other file.
+	static bool LoadDDSImage(const std::wstring& filename, ImageRGBA8& image, DXGI_FORMAT* format = nullptr);
+
+	// Fills mips with the full chain of image down to 1x1; mips[0] is image itself.
+	// With srgb the color channels are converted to linear before filtering and
+	// back after; alpha is always filtered as is.
+	static void GenerateMips(const ImageRGBA8& image, MipFilter filter, bool srgb,
+		std::vector<ImageRGBA8>& mips, ThreadPool& threadPool);
+
+	// Writes mips to a DDS file as format, which is R8G8B8A8_UNORM or a format
+	// BlockCompressor supports.  With srgb the file is tagged with
+	// MakeSRGB(format) so the texels are read back as sRGB.
+	static bool SaveDDSTexture(const std::wstring& filename, const std::vector<ImageRGBA8>& mips,
+		DXGI_FORMAT format, bool srgb, ThreadPool& threadPool);
+};
@@ -0,0 +1,298 @@
+//***************************************************************************************
+// OcclusionCuller.cpp
+//***************************************************************************************
+
+#include "OcclusionCuller.h"
+
+using namespace DirectX;
+
+OcclusionCuller::OcclusionCuller(UINT width, UINT height)
+{
+	mWidth = (width + TileSize - 1) / TileSize * TileSize;
+	mHeight = (height + TileSize - 1) / TileSize * TileSize;
+	mTilesX = mWidth / TileSize;
+	mTilesY = mHeight / TileSize;
+
+	mDepth.assign(mWidth*mHeight, 1.0f);
+	mTileMaxDepth.assign(mTilesX*mTilesY, 1.0f);
+}
+
+UINT OcclusionCuller::Width()const
+{
+	return mWidth;
+}
+
+UINT OcclusionCuller::Height()const
+{
+	return mHeight;
+}
+
+void OcclusionCuller::BeginFrame(FXMMATRIX viewProj)
+{
+	XMStoreFloat4x4(&mViewProj, viewProj);
+
+	std::fill(mDepth.begin(), mDepth.end(), 1.0f);
+	std::fill(mTileMaxDepth.begin(), mTileMaxDepth.end(), 1.0f);
+	mTilesDirty = false;
+
+	mStats = OcclusionStats();
+}
+
+void OcclusionCuller::RenderOccluder(const XMFLOAT3* positions, UINT stride,
+	const std::uint16_t* indices, UINT indexCount, FXMMATRIX world, bool twoSided)
+{
+	RenderTriangles(positions, stride, indices, indexCount, world, twoSided);
+}
+
+void OcclusionCuller::RenderOccluder(const XMFLOAT3* positions, UINT stride,
+	const std::uint32_t* indices, UINT indexCount, FXMMATRIX world, bool twoSided)
+{
+	RenderTriangles(positions, stride, indices, indexCount, world, twoSided);
+}
+
+template<typename Index>
+void OcclusionCuller::RenderTriangles(const XMFLOAT3* positions, UINT stride,
+	const Index* indices, UINT indexCount, FXMMATRIX world, bool twoSided)
+{
+	XMMATRIX worldViewProj = XMMatrixMultiply(world, XMLoadFloat4x4(&mViewProj));
+
+	const BYTE* base = reinterpret_cast<const BYTE*>(positions);
+	auto position = [&](Index i)
+	{
+		return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(base + (size_t)i*stride));
+	};
+
+	for(UINT i = 0; i + 2 < indexCount; i += 3)
+	{
+		XMVECTOR c0 = XMVector4Transform(XMVectorSetW(position(indices[i + 0]), 1.0f), worldViewProj);
+		XMVECTOR c1 = XMVector4Transform(XMVectorSetW(position(indices[i + 1]), 1.0f), worldViewProj);
+		XMVECTOR c2 = XMVector4Transform(XMVectorSetW(position(indices[i + 2]), 1.0f), worldViewProj);
+
+		RasterizeTriangle(c0, c1, c2, twoSided);
+	}
+
+	mTilesDirty = true;
+}
+
+void OcclusionCuller::RasterizeTriangle(FXMVECTOR c0, FXMVECTOR c1, FXMVECTOR c2, bool twoSided)
+{
+	// Skipping triangles that reach behind the near plane only makes the
+	// occluders smaller, which keeps the test conservative.
+	if(XMVectorGetZ(c0) < 0.0f || XMVectorGetZ(c1) < 0.0f || XMVectorGetZ(c2) < 0.0f)
+		return;
+
+	// Clip space to pixels (y down) and depth.
+	XMFLOAT3 v[3];
+	const XMVECTOR clip[3] = { c0, c1, c2 };
+	for(int k = 0; k < 3; ++k)
+	{
+		float invW = 1.0f / XMVectorGetW(clip[k]);
+		v[k].x = (XMVectorGetX(clip[k])*invW*0.5f + 0.5f) * mWidth;
+		v[k].y = (0.5f - XMVectorGetY(clip[k])*invW*0.5f) * mHeight;
+		v[k].z = MathHelper::Clamp(XMVectorGetZ(clip[k])*invW, 0.0f, 1.0f);
+	}
+
+	// Positive for clockwise triangles on screen, which are front faces.
+	float area = (v[1].x - v[0].x)*(v[2].y - v[0].y) - (v[1].y - v[0].y)*(v[2].x - v[0].x);
+	if(area < 0.0f)
+	{
+		if(!twoSided)
+			return;
+
+		std::swap(v[1], v[2]);
+		area = -area;
+	}
+
+	if(area < 1e-8f)
+		return;
+
+	++mStats.OccluderTriangles;
+
+	// Pixel bounds of the triangle.
+	float minX = MathHelper::Min(v[0].x, MathHelper::Min(v[1].x, v[2].x));
+	float maxX = MathHelper::Max(v[0].x, MathHelper::Max(v[1].x, v[2].x));
+	float minY = MathHelper::Min(v[0].y, MathHelper::Min(v[1].y, v[2].y));
+	float maxY = MathHelper::Max(v[0].y, MathHelper::Max(v[1].y, v[2].y));
+
+	int x0 = MathHelper::Max((int)floorf(minX), 0) & ~3;
+	int x1 = MathHelper::Min((int)ceilf(maxX), (int)mWidth - 1);
+	int y0 = MathHelper::Max((int)floorf(minY), 0);
+	int y1 = MathHelper::Min((int)ceilf(maxY), (int)mHeight - 1);
+	if(x0 > x1 || y0 > y1)
+		return;
+
+	// Edge functions E(p) = A*p.x + B*p.y + C, nonnegative inside.  Edge k is
+	// opposite vertex k, so E_k(p)/area is the barycentric weight of vertex k.
+	// C is taken relative to the same end point whichever way round the edge
+	// is walked, so the two triangles sharing an edge compute exactly negated
+	// values and pixel centers on the edge are not lost to rounding.
+	float A[3], B[3], C[3];
+	for(int k = 0; k < 3; ++k)
+	{
+		const XMFLOAT3& a = v[(k + 1) % 3];
+		const XMFLOAT3& b = v[(k + 2) % 3];
+		const XMFLOAT3& o = (a.x < b.x || (a.x == b.x && a.y < b.y)) ? a : b;
+		A[k] = a.y - b.y;
+		B[k] = b.x - a.x;
+		C[k] = -(A[k]*o.x + B[k]*o.y);
+	}
+
+	// Depth is affine in screen space: z(p) = zA*p.x + zB*p.y + zC.
+	float invArea = 1.0f / area;
+	float zA = (A[0]*v[0].z + A[1]*v[1].z + A[2]*v[2].z) * invArea;
+	float zB = (B[0]*v[0].z + B[1]*v[1].z + B[2]*v[2].z) * invArea;
+	float zC = (C[0]*v[0].z + C[1]*v[1].z + C[2]*v[2].z) * invArea;
+
+	const XMVECTOR laneOffsets = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+	const XMVECTOR zero = XMVectorZero();
+	const XMVECTOR one = XMVectorSplatOne();
+
+	XMVECTOR edgeA[3], edgeB[3], edgeC[3];
+	for(int k = 0; k < 3; ++k)
+	{
+		edgeA[k] = XMVectorReplicate(A[k]);
+		edgeB[k] = XMVectorReplicate(B[k]);
+		edgeC[k] = XMVectorReplicate(C[k]);
+	}
+	XMVECTOR depthA = XMVectorReplicate(zA);
+	XMVECTOR depthB = XMVectorReplicate(zB);
+	XMVECTOR depthC = XMVectorReplicate(zC);
+
+	// Four pixels of a row per iteration; the buffer width is a multiple of
+	// four, so the last group never runs past the row.
+	for(int y = y0; y <= y1; ++y)
+	{
+		XMVECTOR py = XMVectorReplicate(y + 0.5f);
+		float* row = &mDepth[y*mWidth];
+
+		for(int x = x0; x <= x1; x += 4)
+		{
+			XMVECTOR px = XMVectorAdd(XMVectorReplicate((float)x), laneOffsets);
+
+			XMVECTOR inside = XMVectorTrueInt();
+			for(int k = 0; k < 3; ++k)
+			{
+				XMVECTOR e = XMVectorMultiplyAdd(edgeA[k], px, XMVectorMultiplyAdd(edgeB[k], py, edgeC[k]));
+				inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(e, zero));
+			}
+
+			XMVECTOR z = XMVectorMultiplyAdd(depthA, px, XMVectorMultiplyAdd(depthB, py, depthC));
+			z = XMVectorMin(XMVectorMax(z, zero), one);
+
+			XMVECTOR old = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&row[x]));
+			XMVECTOR result = XMVectorSelect(old, XMVectorMin(old, z), inside);
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&row[x]), result);
+		}
+	}
+}
+
+void OcclusionCuller::UpdateTiles()
+{
+	for(UINT ty = 0; ty < mTilesY; ++ty)
+	{
+		for(UINT tx = 0; tx < mTilesX; ++tx)
+		{
+			XMVECTOR maxDepth = XMVectorZero();
+			for(UINT y = ty*TileSize; y < (ty + 1)*TileSize; ++y)
+			{
+				const float* row = &mDepth[y*mWidth + tx*TileSize];
+				for(UINT x = 0; x < TileSize; x += 4)
+					maxDepth = XMVectorMax(maxDepth, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&row[x])));
+			}
+
+			float m[4];
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(m), maxDepth);
+			mTileMaxDepth[ty*mTilesX + tx] = MathHelper::Max(MathHelper::Max(m[0], m[1]), MathHelper::Max(m[2], m[3]));
+		}
+	}
+
+	mTilesDirty = false;
+}
+
+bool OcclusionCuller::IsOccluded(const BoundingBox& boxW)
+{
+	++mStats.OccludeesTested;
+
+	if(mTilesDirty)
+		UpdateTiles();
+
+	XMMATRIX viewProj = XMLoadFloat4x4(&mViewProj);
+
+	XMFLOAT3 corners[BoundingBox::CORNER_COUNT];
+	boxW.GetCorners(corners);
+
+	float minX = +MathHelper::Infinity;
+	float maxX = -MathHelper::Infinity;
+	float minY = +MathHelper::Infinity;
+	float maxY = -MathHelper::Infinity;
+	float minZ = +MathHelper::Infinity;
+	for(UINT k = 0; k < BoundingBox::CORNER_COUNT; ++k)
+	{
+		XMVECTOR c = XMVector4Transform(XMVectorSetW(XMLoadFloat3(&corners[k]), 1.0f), viewProj);
+
+		// Reaches behind the near plane; we cannot bound its projection.
+		if(XMVectorGetZ(c) < 0.0f)
+			return false;
+
+		float invW = 1.0f / XMVectorGetW(c);
+		float x = (XMVectorGetX(c)*invW*0.5f + 0.5f) * mWidth;
+		float y = (0.5f - XMVectorGetY(c)*invW*0.5f) * mHeight;
+		minX = MathHelper::Min(minX, x);
+		maxX = MathHelper::Max(maxX, x);
+		minY = MathHelper::Min(minY, y);
+		maxY = MathHelper::Max(maxY, y);
+		minZ = MathHelper::Min(minZ, XMVectorGetZ(c)*invW);
+	}
+
+	// Every pixel the box touches, including partially covered ones.
+	int x0 = MathHelper::Max((int)floorf(minX), 0);
+	int x1 = MathHelper::Min((int)floorf(maxX), (int)mWidth - 1);
+	int y0 = MathHelper::Max((int)floorf(minY), 0);
+	int y1 = MathHelper::Min((int)floorf(maxY), (int)mHeight - 1);
+	if(x0 > x1 || y0 > y1)
+		return false;
+
+	for(int ty = y0 / TileSize; ty <= y1 / (int)TileSize; ++ty)
+	{
+		for(int tx = x0 / TileSize; tx <= x1 / (int)TileSize; ++tx)
+		{
+			// Everything in the tile is nearer than the box.
+			if(minZ > mTileMaxDepth[ty*mTilesX + tx])
+				continue;
+
+			int px0 = MathHelper::Max(x0, tx*(int)TileSize);
+			int px1 = MathHelper::Min(x1, (tx + 1)*(int)TileSize - 1);
+			int py0 = MathHelper::Max(y0, ty*(int)TileSize);
+			int py1 = MathHelper::Min(y1, (ty + 1)*(int)TileSize - 1);
+			for(int y = py0; y <= py1; ++y)
+			{
+				for(int x = px0; x <= px1; ++x)
+				{
+					if(minZ <= mDepth[y*mWidth + x])
+						return false;
+				}
+			}
+		}
+	}
+
+	++mStats.OccludeesCulled;
+	return true;
+}
+
+const OcclusionStats& OcclusionCuller::GetStats()const
+{
+	return mStats;
+}
+
+const std::vector<float>& OcclusionCuller::GetDepthBuffer()const
+{
+	return mDepth;
+}
+
+const std::vector<float>& OcclusionCuller::GetTileMaxDepths()
+{
+	if(mTilesDirty)
+		UpdateTiles();
+
+	return mTileMaxDepth;
+}
@@ -0,0 +1,96 @@
+//***************************************************************************************
+// OcclusionCuller.h
+//
+// CPU software occlusion culling.  A few large occluder meshes (walls, floors,
+// terrain) are rasterized into a small depth buffer, four pixels at a time, and
+// a coarse level holding the farthest depth of every 8x8 tile is built on top.
+// Bounding boxes of other objects are then projected and tested against it;
+// a box whose nearest point is behind every covered pixel cannot be seen and
+// its render item does not need to be submitted.
+//
+// The test is conservative with respect to the occluders that were rendered:
+// triangles crossing the near plane are skipped and boxes crossing it are
+// always reported visible.  Coverage is sampled at pixel centers, though, so
+// along an occluder's silhouette the result is only accurate to one pixel of
+// the (low resolution) buffer.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+struct OcclusionStats
+{
+	UINT OccluderTriangles = 0;
+	UINT OccludeesTested = 0;
+	UINT OccludeesCulled = 0;
+};
+
+class OcclusionCuller
+{
+public:
+	static const UINT TileSize = 8;
+
+	// width and height are rounded up to multiples of TileSize.
+	OcclusionCuller(UINT width = 256, UINT height = 128);
+	OcclusionCuller(const OcclusionCuller& rhs) = delete;
+	OcclusionCuller& operator=(const OcclusionCuller& rhs) = delete;
+	~OcclusionCuller() = default;
+
+	UINT Width()const;
+	UINT Height()const;
+
+	// Clears the depth buffer and the statistics, and sets the view-projection
+	// matrix used by the following calls.
+	void BeginFrame(DirectX::FXMMATRIX viewProj);
+
+	// Rasterizes a triangle list.  Positions are read every stride bytes, so
+	// vertex arrays can be passed as they are.  Only front faces (clockwise, as
+	// with D3D12_CULL_MODE_BACK) occlude unless twoSided is true, so that a wall
+	// the GPU does not draw from behind does not hide anything either.
+	void RenderOccluder(const DirectX::XMFLOAT3* positions, UINT stride,
+		const std::uint16_t* indices, UINT indexCount, DirectX::FXMMATRIX world, bool twoSided = false);
+	void RenderOccluder(const DirectX::XMFLOAT3* positions, UINT stride,
+		const std::uint32_t* indices, UINT indexCount, DirectX::FXMMATRIX world, bool twoSided = false);
+
+	// Returns true if the world space box is completely hidden by the occluders
+	// rendered since BeginFrame.  Boxes that are off screen are not occluded;
+	// leave those to frustum culling.
+	bool IsOccluded(const DirectX::BoundingBox& boxW);
+
+	const OcclusionStats& GetStats()const;
+
+	// Width()*Height() depths in [0,1], row-major from the top; 1 where no
+	// occluder was drawn.
+	const std::vector<float>& GetDepthBuffer()const;
+
+	// (Width()/TileSize)*(Height()/TileSize) farthest depths of the 8x8 tiles,
+	// row-major from the top.  Rebuilt first if occluders were drawn since.
+	const std::vector<float>& GetTileMaxDepths();
+
+private:
+	template<typename Index>
+	void RenderTriangles(const DirectX::XMFLOAT3* positions, UINT stride,
+		const Index* indices, UINT indexCount, DirectX::FXMMATRIX world, bool twoSided);
+
+	// Vertices are in clip space.
+	void RasterizeTriangle(DirectX::FXMVECTOR c0, DirectX::FXMVECTOR c1, DirectX::FXMVECTOR c2, bool twoSided);
+
+	void UpdateTiles();
+
+private:
+	UINT mWidth = 0;
+	UINT mHeight = 0;
+	UINT mTilesX = 0;
+	UINT mTilesY = 0;
+
+	DirectX::XMFLOAT4X4 mViewProj = MathHelper::Identity4x4();
+
+	std::vector<float> mDepth;
+
+	// Farthest depth in each tile; rebuilt lazily after occluders were drawn.
+	std::vector<float> mTileMaxDepth;
+	bool mTilesDirty = true;
+
+	OcclusionStats mStats;
+};
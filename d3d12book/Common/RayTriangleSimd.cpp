@@ -0,0 +1,188 @@
+//***************************************************************************************
+// RayTriangleSimd.cpp
+//***************************************************************************************
+
+#include "RayTriangleSimd.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Same threshold as TriangleTests::Intersects for rays parallel to the plane.
+	const float RayEpsilon = 1e-20f;
+
+	struct SoaRays
+	{
+		XMVECTOR OX, OY, OZ;
+		XMVECTOR DX, DY, DZ;
+	};
+
+	struct SoaTriangles
+	{
+		XMVECTOR V0X, V0Y, V0Z;
+		XMVECTOR E1X, E1Y, E1Z;
+		XMVECTOR E2X, E2Y, E2Z;
+	};
+
+	// Returns the lanes where the ray hits the triangle, and the distances in t.
+	XMVECTOR IntersectLanes(const SoaRays& r, const SoaTriangles& tri, XMVECTOR& t)
+	{
+		// p = dir x e2, det = e1 . p
+		XMVECTOR px = XMVectorSubtract(XMVectorMultiply(r.DY, tri.E2Z), XMVectorMultiply(r.DZ, tri.E2Y));
+		XMVECTOR py = XMVectorSubtract(XMVectorMultiply(r.DZ, tri.E2X), XMVectorMultiply(r.DX, tri.E2Z));
+		XMVECTOR pz = XMVectorSubtract(XMVectorMultiply(r.DX, tri.E2Y), XMVectorMultiply(r.DY, tri.E2X));
+		XMVECTOR det = XMVectorMultiplyAdd(tri.E1X, px, XMVectorMultiplyAdd(tri.E1Y, py, XMVectorMultiply(tri.E1Z, pz)));
+
+		// s = origin - v0, u = s . p
+		XMVECTOR sx = XMVectorSubtract(r.OX, tri.V0X);
+		XMVECTOR sy = XMVectorSubtract(r.OY, tri.V0Y);
+		XMVECTOR sz = XMVectorSubtract(r.OZ, tri.V0Z);
+		XMVECTOR u = XMVectorMultiplyAdd(sx, px, XMVectorMultiplyAdd(sy, py, XMVectorMultiply(sz, pz)));
+
+		// q = s x e1, v = dir . q, t = e2 . q
+		XMVECTOR qx = XMVectorSubtract(XMVectorMultiply(sy, tri.E1Z), XMVectorMultiply(sz, tri.E1Y));
+		XMVECTOR qy = XMVectorSubtract(XMVectorMultiply(sz, tri.E1X), XMVectorMultiply(sx, tri.E1Z));
+		XMVECTOR qz = XMVectorSubtract(XMVectorMultiply(sx, tri.E1Y), XMVectorMultiply(sy, tri.E1X));
+		XMVECTOR v = XMVectorMultiplyAdd(r.DX, qx, XMVectorMultiplyAdd(r.DY, qy, XMVectorMultiply(r.DZ, qz)));
+		XMVECTOR tNum = XMVectorMultiplyAdd(tri.E2X, qx, XMVectorMultiplyAdd(tri.E2Y, qy, XMVectorMultiply(tri.E2Z, qz)));
+
+		// TriangleTests::Intersects has mirrored branches for front and back
+		// facing triangles; flipping the signs of u, v and t by the sign of det
+		// folds them into one set of compares with the same boundaries.
+		XMVECTOR sign = XMVectorAndInt(det, XMVectorSplatSignMask());
+		XMVECTOR absDet = XMVectorAbs(det);
+		XMVECTOR su = XMVectorXorInt(u, sign);
+		XMVECTOR sv = XMVectorXorInt(v, sign);
+		XMVECTOR st = XMVectorXorInt(tNum, sign);
+
+		XMVECTOR zero = XMVectorZero();
+		XMVECTOR hit = XMVectorGreaterOrEqual(absDet, XMVectorReplicate(RayEpsilon));
+		hit = XMVectorAndInt(hit, XMVectorGreaterOrEqual(su, zero));
+		hit = XMVectorAndInt(hit, XMVectorLessOrEqual(su, absDet));
+		hit = XMVectorAndInt(hit, XMVectorGreaterOrEqual(sv, zero));
+		hit = XMVectorAndInt(hit, XMVectorLessOrEqual(XMVectorAdd(su, sv), absDet));
+		hit = XMVectorAndInt(hit, XMVectorGreaterOrEqual(st, zero));
+
+		t = XMVectorMultiply(tNum, XMVectorReciprocal(det));
+		return hit;
+	}
+}
+
+void TrianglePacket::Clear()
+{
+	V0X = V0Y = V0Z = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+	E1X = E1Y = E1Z = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+	E2X = E2Y = E2Z = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+}
+
+void TrianglePacket::Set(UINT lane, FXMVECTOR v0, FXMVECTOR v1, FXMVECTOR v2)
+{
+	XMFLOAT3 p0, e1, e2;
+	XMStoreFloat3(&p0, v0);
+	XMStoreFloat3(&e1, XMVectorSubtract(v1, v0));
+	XMStoreFloat3(&e2, XMVectorSubtract(v2, v0));
+
+	(&V0X.x)[lane] = p0.x;
+	(&V0Y.x)[lane] = p0.y;
+	(&V0Z.x)[lane] = p0.z;
+	(&E1X.x)[lane] = e1.x;
+	(&E1Y.x)[lane] = e1.y;
+	(&E1Z.x)[lane] = e1.z;
+	(&E2X.x)[lane] = e2.x;
+	(&E2Y.x)[lane] = e2.y;
+	(&E2Z.x)[lane] = e2.z;
+}
+
+void RayPacket::Set(UINT lane, FXMVECTOR origin, FXMVECTOR dir)
+{
+	XMFLOAT3 o, d;
+	XMStoreFloat3(&o, origin);
+	XMStoreFloat3(&d, dir);
+
+	(&OriginX.x)[lane] = o.x;
+	(&OriginY.x)[lane] = o.y;
+	(&OriginZ.x)[lane] = o.z;
+	(&DirX.x)[lane] = d.x;
+	(&DirY.x)[lane] = d.y;
+	(&DirZ.x)[lane] = d.z;
+}
+
+bool IntersectTrianglePacket(FXMVECTOR origin, FXMVECTOR dir,
+	const TrianglePacket& tris, float& dist, UINT& lane)
+{
+	SoaRays r;
+	r.OX = XMVectorSplatX(origin);
+	r.OY = XMVectorSplatY(origin);
+	r.OZ = XMVectorSplatZ(origin);
+	r.DX = XMVectorSplatX(dir);
+	r.DY = XMVectorSplatY(dir);
+	r.DZ = XMVectorSplatZ(dir);
+
+	SoaTriangles tri;
+	tri.V0X = XMLoadFloat4(&tris.V0X);
+	tri.V0Y = XMLoadFloat4(&tris.V0Y);
+	tri.V0Z = XMLoadFloat4(&tris.V0Z);
+	tri.E1X = XMLoadFloat4(&tris.E1X);
+	tri.E1Y = XMLoadFloat4(&tris.E1Y);
+	tri.E1Z = XMLoadFloat4(&tris.E1Z);
+	tri.E2X = XMLoadFloat4(&tris.E2X);
+	tri.E2Y = XMLoadFloat4(&tris.E2Y);
+	tri.E2Z = XMLoadFloat4(&tris.E2Z);
+
+	XMVECTOR t;
+	XMVECTOR hit = IntersectLanes(r, tri, t);
+	hit = XMVectorAndInt(hit, XMVectorLess(t, XMVectorReplicate(dist)));
+
+	uint32_t mask[4];
+	XMStoreInt4(mask, hit);
+	if((mask[0] | mask[1] | mask[2] | mask[3]) == 0)
+		return false;
+
+	XMFLOAT4 tLanes;
+	XMStoreFloat4(&tLanes, t);
+
+	// Lowest lane wins ties, like a loop over the triangles in order.
+	for(UINT i = 0; i < 4; ++i)
+	{
+		if(mask[i] != 0 && (&tLanes.x)[i] < dist)
+		{
+			dist = (&tLanes.x)[i];
+			lane = i;
+		}
+	}
+
+	return true;
+}
+
+UINT IntersectRayPacket(const RayPacket& rays, const TrianglePacket& tris, UINT lane, XMFLOAT4& dist)
+{
+	SoaRays r;
+	r.OX = XMLoadFloat4(&rays.OriginX);
+	r.OY = XMLoadFloat4(&rays.OriginY);
+	r.OZ = XMLoadFloat4(&rays.OriginZ);
+	r.DX = XMLoadFloat4(&rays.DirX);
+	r.DY = XMLoadFloat4(&rays.DirY);
+	r.DZ = XMLoadFloat4(&rays.DirZ);
+
+	SoaTriangles tri;
+	tri.V0X = XMVectorReplicate((&tris.V0X.x)[lane]);
+	tri.V0Y = XMVectorReplicate((&tris.V0Y.x)[lane]);
+	tri.V0Z = XMVectorReplicate((&tris.V0Z.x)[lane]);
+	tri.E1X = XMVectorReplicate((&tris.E1X.x)[lane]);
+	tri.E1Y = XMVectorReplicate((&tris.E1Y.x)[lane]);
+	tri.E1Z = XMVectorReplicate((&tris.E1Z.x)[lane]);
+	tri.E2X = XMVectorReplicate((&tris.E2X.x)[lane]);
+	tri.E2Y = XMVectorReplicate((&tris.E2Y.x)[lane]);
+	tri.E2Z = XMVectorReplicate((&tris.E2Z.x)[lane]);
+
+	XMVECTOR t;
+	XMVECTOR oldDist = XMLoadFloat4(&dist);
+	XMVECTOR hit = IntersectLanes(r, tri, t);
+	hit = XMVectorAndInt(hit, XMVectorLess(t, oldDist));
+
+	XMStoreFloat4(&dist, XMVectorSelect(oldDist, t, hit));
+
+	uint32_t mask[4];
+	XMStoreInt4(mask, hit);
+	return (mask[0] & 1) | (mask[1] & 2) | (mask[2] & 4) | (mask[3] & 8);
+}
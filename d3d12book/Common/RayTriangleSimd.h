@@ -0,0 +1,49 @@
+//***************************************************************************************
+// RayTriangleSimd.h
+//
+// Moller-Trumbore ray/triangle tests four at a time, with the data in
+// structure-of-arrays form so each XMVECTOR lane handles one triangle (or one
+// ray).  The arithmetic and the edge rules follow TriangleTests::Intersects, so
+// the hits are the same and the distances agree to within rounding.
+//
+// IntersectTrianglePacket tests one ray against four triangles; it is what BVH
+// leaves and brute force loops use.  IntersectRayPacket tests four coherent
+// rays against one triangle of a packet.
+//***************************************************************************************
+
+#pragma once
+
+#include "MathHelper.h"
+
+// Four triangles; lane i of every member belongs to triangle i.  Edges are
+// stored instead of the other two vertices because the test needs them.
+struct TrianglePacket
+{
+	DirectX::XMFLOAT4 V0X, V0Y, V0Z;
+	DirectX::XMFLOAT4 E1X, E1Y, E1Z;
+	DirectX::XMFLOAT4 E2X, E2Y, E2Z;
+
+	// Makes every lane a degenerate triangle, which is never hit.
+	void Clear();
+
+	void Set(UINT lane, DirectX::FXMVECTOR v0, DirectX::FXMVECTOR v1, DirectX::FXMVECTOR v2);
+};
+
+// Four rays; lane i of every member belongs to ray i.  Directions need not be
+// unit length; distances are in units of their length.
+struct RayPacket
+{
+	DirectX::XMFLOAT4 OriginX, OriginY, OriginZ;
+	DirectX::XMFLOAT4 DirX, DirY, DirZ;
+
+	void Set(UINT lane, DirectX::FXMVECTOR origin, DirectX::FXMVECTOR dir);
+};
+
+// Returns true if the ray hits one of the triangles nearer than dist, in which
+// case dist becomes the nearest distance and lane the triangle that has it.
+bool IntersectTrianglePacket(DirectX::FXMVECTOR origin, DirectX::FXMVECTOR dir,
+	const TrianglePacket& tris, float& dist, UINT& lane);
+
+// Returns a mask with bit i set if ray i hits triangle lane of tris nearer than
+// dist[i], and updates dist for those rays.
+UINT IntersectRayPacket(const RayPacket& rays, const TrianglePacket& tris, UINT lane, DirectX::XMFLOAT4& dist);
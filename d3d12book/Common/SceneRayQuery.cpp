@@ -0,0 +1,284 @@
+//***************************************************************************************
+// SceneRayQuery.cpp
+//***************************************************************************************
+
+#include "SceneRayQuery.h"
+#include "BvhHelper.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Instances per top-level leaf.
+	const UINT LeafSize = 2;
+
+	// Rays per ThreadPool chunk.
+	const UINT RayBatchGrain = 64;
+}
+
+UINT SceneRayQuery::AddInstance(const TriangleBvh* bvh, FXMMATRIX world)
+{
+	mInstances.emplace_back();
+	mInstances.back().Bvh = bvh;
+
+	UINT index = (UINT)mInstances.size() - 1;
+	SetWorld(index, world);
+
+	return index;
+}
+
+void SceneRayQuery::SetWorld(UINT instance, FXMMATRIX world)
+{
+	Instance& inst = mInstances[instance];
+
+	XMVECTOR det = XMMatrixDeterminant(world);
+	XMStoreFloat4x4(&inst.WorldToLocal, XMMatrixInverse(&det, world));
+
+	BoundingBox boundsW;
+	inst.Bvh->GetBounds().Transform(boundsW, world);
+
+	XMVECTOR center = XMLoadFloat3(&boundsW.Center);
+	XMVECTOR extents = XMLoadFloat3(&boundsW.Extents);
+	XMStoreFloat3(&inst.BoundsMin, XMVectorSubtract(center, extents));
+	XMStoreFloat3(&inst.BoundsMax, XMVectorAdd(center, extents));
+
+	mHierarchyDirty = true;
+}
+
+void SceneRayQuery::Clear()
+{
+	mInstances.clear();
+	mNodes.clear();
+	mNodeInstances.clear();
+	mHierarchyDirty = true;
+}
+
+UINT SceneRayQuery::InstanceCount()const
+{
+	return (UINT)mInstances.size();
+}
+
+void SceneRayQuery::ClosestHit(const RayQuery* rays, UINT count, RayHit* hits, ThreadPool& threadPool)
+{
+	UpdateHierarchy();
+
+	threadPool.ParallelFor(count, RayBatchGrain, [&](UINT begin, UINT end, UINT threadIndex)
+	{
+		for(UINT i = begin; i < end; ++i)
+			hits[i] = TraceClosest(rays[i]);
+	});
+}
+
+void SceneRayQuery::AnyHit(const RayQuery* rays, UINT count, std::uint8_t* occluded, ThreadPool& threadPool)
+{
+	UpdateHierarchy();
+
+	threadPool.ParallelFor(count, RayBatchGrain, [&](UINT begin, UINT end, UINT threadIndex)
+	{
+		for(UINT i = begin; i < end; ++i)
+			occluded[i] = TraceAny(rays[i]) ? 1 : 0;
+	});
+}
+
+void SceneRayQuery::UpdateHierarchy()
+{
+	if(!mHierarchyDirty)
+		return;
+
+	const UINT instanceCount = (UINT)mInstances.size();
+
+	mNodes.clear();
+	mNodeInstances.resize(instanceCount);
+	for(UINT i = 0; i < instanceCount; ++i)
+		mNodeInstances[i] = i;
+
+	if(instanceCount > 0)
+	{
+		mNodes.reserve(2 * instanceCount);
+		mNodes.emplace_back();
+		BuildNode(0, 0, instanceCount);
+	}
+
+	mHierarchyDirty = false;
+}
+
+void SceneRayQuery::BuildNode(UINT node, UINT first, UINT count)
+{
+	XMVECTOR vMin = XMVectorReplicate(+MathHelper::Infinity);
+	XMVECTOR vMax = XMVectorReplicate(-MathHelper::Infinity);
+	XMVECTOR cMin = vMin;
+	XMVECTOR cMax = vMax;
+	for(UINT i = first; i < first + count; ++i)
+	{
+		const Instance& inst = mInstances[mNodeInstances[i]];
+		XMVECTOR bMin = XMLoadFloat3(&inst.BoundsMin);
+		XMVECTOR bMax = XMLoadFloat3(&inst.BoundsMax);
+		XMVECTOR c = XMVectorScale(XMVectorAdd(bMin, bMax), 0.5f);
+
+		vMin = XMVectorMin(vMin, bMin);
+		vMax = XMVectorMax(vMax, bMax);
+		cMin = XMVectorMin(cMin, c);
+		cMax = XMVectorMax(cMax, c);
+	}
+
+	XMStoreFloat3(&mNodes[node].BoundsMin, vMin);
+	XMStoreFloat3(&mNodes[node].BoundsMax, vMax);
+
+	if(count <= LeafSize)
+	{
+		mNodes[node].First = first;
+		mNodes[node].Count = count;
+		return;
+	}
+
+	XMFLOAT3 extent;
+	XMStoreFloat3(&extent, XMVectorSubtract(cMax, cMin));
+	int axis = BvhHelper::LongestAxis(extent);
+
+	// Twice the center, which orders the same.
+	UINT leftCount = BvhHelper::MedianSplit(mNodeInstances, first, count, [this, axis](UINT instance)
+	{
+		const Instance& inst = mInstances[instance];
+		const float* bMin = &inst.BoundsMin.x;
+		const float* bMax = &inst.BoundsMax.x;
+		return bMin[axis] + bMax[axis];
+	});
+
+	// Siblings are allocated together.
+	UINT left = (UINT)mNodes.size();
+	mNodes.emplace_back();
+	mNodes.emplace_back();
+	mNodes[node].First = left;
+	mNodes[node].Count = 0;
+
+	BuildNode(left, first, leftCount);
+	BuildNode(left + 1, first + leftCount, count - leftCount);
+}
+
+RayHit SceneRayQuery::TraceClosest(const RayQuery& ray)const
+{
+	RayHit hit;
+	hit.Distance = ray.MaxDistance;
+
+	if(mNodes.empty())
+		return hit;
+
+	XMVECTOR origin = XMVectorSet(ray.Origin.x, ray.Origin.y, ray.Origin.z, 1.0f);
+	XMVECTOR dir = XMVectorSet(ray.Direction.x, ray.Direction.y, ray.Direction.z, 0.0f);
+
+	XMFLOAT3 invDir;
+	XMStoreFloat3(&invDir, XMVectorReciprocal(dir));
+
+	struct StackEntry
+	{
+		UINT Node;
+		float Distance;
+	};
+	StackEntry stack[BvhHelper::MedianSplitMaxDepth + 1];
+	UINT stackSize = 0;
+
+	float rootDistance = BvhHelper::EnterBox(mNodes[0].BoundsMin, mNodes[0].BoundsMax, ray.Origin, invDir, hit.Distance);
+	if(rootDistance < MathHelper::Infinity)
+		stack[stackSize++] = { 0, rootDistance };
+
+	while(stackSize > 0)
+	{
+		StackEntry entry = stack[--stackSize];
+		if(entry.Distance >= hit.Distance)
+			continue;
+
+		const Node& node = mNodes[entry.Node];
+		if(node.Count == 0)
+		{
+			UINT nearChild = node.First;
+			UINT farChild = node.First + 1;
+			float nearDistance = BvhHelper::EnterBox(mNodes[nearChild].BoundsMin, mNodes[nearChild].BoundsMax, ray.Origin, invDir, hit.Distance);
+			float farDistance = BvhHelper::EnterBox(mNodes[farChild].BoundsMin, mNodes[farChild].BoundsMax, ray.Origin, invDir, hit.Distance);
+			if(farDistance < nearDistance)
+			{
+				std::swap(nearChild, farChild);
+				std::swap(nearDistance, farDistance);
+			}
+
+			if(farDistance < MathHelper::Infinity)
+				stack[stackSize++] = { farChild, farDistance };
+			if(nearDistance < MathHelper::Infinity)
+				stack[stackSize++] = { nearChild, nearDistance };
+			continue;
+		}
+
+		for(UINT i = node.First; i < node.First + node.Count; ++i)
+		{
+			UINT instance = mNodeInstances[i];
+			const Instance& inst = mInstances[instance];
+
+			if(BvhHelper::EnterBox(inst.BoundsMin, inst.BoundsMax, ray.Origin, invDir, hit.Distance) == MathHelper::Infinity)
+				continue;
+
+			XMMATRIX toLocal = XMLoadFloat4x4(&inst.WorldToLocal);
+			XMVECTOR localOrigin = XMVector3TransformCoord(origin, toLocal);
+			XMVECTOR localDir = XMVector3TransformNormal(dir, toLocal);
+
+			UINT triangle = 0;
+			if(inst.Bvh->Intersects(localOrigin, localDir, hit.Distance, triangle))
+			{
+				hit.Instance = instance;
+				hit.Triangle = triangle;
+			}
+		}
+	}
+
+	if(hit.Instance == RayHit::NoHit)
+		hit.Distance = MathHelper::Infinity;
+
+	return hit;
+}
+
+bool SceneRayQuery::TraceAny(const RayQuery& ray)const
+{
+	if(mNodes.empty())
+		return false;
+
+	XMVECTOR origin = XMVectorSet(ray.Origin.x, ray.Origin.y, ray.Origin.z, 1.0f);
+	XMVECTOR dir = XMVectorSet(ray.Direction.x, ray.Direction.y, ray.Direction.z, 0.0f);
+
+	XMFLOAT3 invDir;
+	XMStoreFloat3(&invDir, XMVectorReciprocal(dir));
+
+	UINT stack[BvhHelper::MedianSplitMaxDepth + 1];
+	UINT stackSize = 0;
+
+	if(BvhHelper::EnterBox(mNodes[0].BoundsMin, mNodes[0].BoundsMax, ray.Origin, invDir, ray.MaxDistance) < MathHelper::Infinity)
+		stack[stackSize++] = 0;
+
+	while(stackSize > 0)
+	{
+		const Node& node = mNodes[stack[--stackSize]];
+		if(node.Count == 0)
+		{
+			for(UINT child = node.First; child <= node.First + 1; ++child)
+			{
+				if(BvhHelper::EnterBox(mNodes[child].BoundsMin, mNodes[child].BoundsMax, ray.Origin, invDir, ray.MaxDistance) < MathHelper::Infinity)
+					stack[stackSize++] = child;
+			}
+			continue;
+		}
+
+		for(UINT i = node.First; i < node.First + node.Count; ++i)
+		{
+			const Instance& inst = mInstances[mNodeInstances[i]];
+
+			if(BvhHelper::EnterBox(inst.BoundsMin, inst.BoundsMax, ray.Origin, invDir, ray.MaxDistance) == MathHelper::Infinity)
+				continue;
+
+			XMMATRIX toLocal = XMLoadFloat4x4(&inst.WorldToLocal);
+			XMVECTOR localOrigin = XMVector3TransformCoord(origin, toLocal);
+			XMVECTOR localDir = XMVector3TransformNormal(dir, toLocal);
+
+			if(inst.Bvh->IntersectsAny(localOrigin, localDir, ray.MaxDistance))
+				return true;
+		}
+	}
+
+	return false;
+}
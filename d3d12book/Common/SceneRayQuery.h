@@ -0,0 +1,99 @@
+//***************************************************************************************
+// SceneRayQuery.h
+//
+// Casts batches of world space rays against every mesh instance in a scene,
+// for picking, line of sight and ground probes.  Each instance is a
+// TriangleBvh (shared between instances of the same mesh) and a world matrix.
+// A small top-level hierarchy over the instances' world boxes finds the
+// candidates; a ray is then moved into an instance's local space and traced
+// through its TriangleBvh.  Directions are not renormalized there, so hit
+// distances are the same in both spaces.
+//
+// Rays in a batch are independent and are split across a ThreadPool; every
+// result only depends on its own ray, so the output is deterministic.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "ThreadPool.h"
+
+// A ray from Origin along Direction, out to MaxDistance in units of Direction's
+// length.  For a line of sight test from A to B use Direction = B - A and
+// MaxDistance = 1.
+struct RayQuery
+{
+	DirectX::XMFLOAT3 Origin = { 0.0f, 0.0f, 0.0f };
+	float MaxDistance = MathHelper::Infinity;
+	DirectX::XMFLOAT3 Direction = { 0.0f, 0.0f, 1.0f };
+};
+
+struct RayHit
+{
+	static const UINT NoHit = 0xffffffff;
+
+	// Index returned by SceneRayQuery::AddInstance, or NoHit.
+	UINT Instance = NoHit;
+
+	// Triangle in the instance mesh's index buffer; its first index is at 3*Triangle.
+	UINT Triangle = 0;
+
+	float Distance = MathHelper::Infinity;
+};
+
+class SceneRayQuery
+{
+public:
+	SceneRayQuery() = default;
+	SceneRayQuery(const SceneRayQuery& rhs) = delete;
+	SceneRayQuery& operator=(const SceneRayQuery& rhs) = delete;
+	~SceneRayQuery() = default;
+
+	// Adds an instance of bvh placed by world and returns its index.  The BVH
+	// must outlive the instance.
+	UINT AddInstance(const TriangleBvh* bvh, DirectX::FXMMATRIX world);
+	void SetWorld(UINT instance, DirectX::FXMMATRIX world);
+	void Clear();
+
+	UINT InstanceCount()const;
+
+	// Finds the nearest hit of every ray; hits[i] gets the result for rays[i].
+	void ClosestHit(const RayQuery* rays, UINT count, RayHit* hits, ThreadPool& threadPool);
+
+	// Sets occluded[i] to 1 if rays[i] hits anything within its MaxDistance and
+	// to 0 otherwise.  Stops at the first hit, so it is cheaper than ClosestHit.
+	void AnyHit(const RayQuery* rays, UINT count, std::uint8_t* occluded, ThreadPool& threadPool);
+
+private:
+	struct Instance
+	{
+		const TriangleBvh* Bvh = nullptr;
+		DirectX::XMFLOAT4X4 WorldToLocal = MathHelper::Identity4x4();
+		DirectX::XMFLOAT3 BoundsMin;
+		DirectX::XMFLOAT3 BoundsMax;
+	};
+
+	// Same layout as TriangleBvh's nodes: Count = 0 marks an interior node with
+	// children First and First + 1, and a leaf holds mNodeInstances[First, First + Count).
+	struct Node
+	{
+		DirectX::XMFLOAT3 BoundsMin;
+		UINT First = 0;
+		DirectX::XMFLOAT3 BoundsMax;
+		UINT Count = 0;
+	};
+
+	// Rebuilds the top-level hierarchy if instances were added or moved.
+	void UpdateHierarchy();
+	void BuildNode(UINT node, UINT first, UINT count);
+
+	RayHit TraceClosest(const RayQuery& ray)const;
+	bool TraceAny(const RayQuery& ray)const;
+
+private:
+	std::vector<Instance> mInstances;
+
+	std::vector<Node> mNodes;
+	std::vector<UINT> mNodeInstances;
+	bool mHierarchyDirty = true;
+};
@@ -0,0 +1,112 @@
+//***************************************************************************************
+// ShadowCasterCuller.cpp
+//***************************************************************************************
+
+#include "ShadowCasterCuller.h"
+
+using namespace DirectX;
+
+void ShadowCasterCuller::BeginFrame(FXMMATRIX lightView, CXMMATRIX lightProj, const BoundingFrustum& cameraFrustumW)
+{
+	XMStoreFloat4x4(&mLightView, lightView);
+	mCameraFrustumW = cameraFrustumW;
+
+	// The orthographic volume in light space: unproject the corners of the
+	// NDC box [-1,1]x[-1,1]x[0,1].
+	XMVECTOR det = XMMatrixDeterminant(lightProj);
+	XMMATRIX invProj = XMMatrixInverse(&det, lightProj);
+
+	XMVECTOR volumeMin = XMVector3TransformCoord(XMVectorSet(-1.0f, -1.0f, 0.0f, 1.0f), invProj);
+	XMVECTOR volumeMax = XMVector3TransformCoord(XMVectorSet(+1.0f, +1.0f, 1.0f, 1.0f), invProj);
+	XMVECTOR v0 = XMVectorMin(volumeMin, volumeMax);
+	XMVECTOR v1 = XMVectorMax(volumeMin, volumeMax);
+
+	// Clip it to the box around the camera frustum.
+	XMFLOAT3 corners[BoundingFrustum::CORNER_COUNT];
+	cameraFrustumW.GetCorners(corners);
+
+	XMVECTOR frustumMin = XMVectorReplicate(+MathHelper::Infinity);
+	XMVECTOR frustumMax = XMVectorReplicate(-MathHelper::Infinity);
+	for(UINT i = 0; i < BoundingFrustum::CORNER_COUNT; ++i)
+	{
+		XMVECTOR P = XMVector3TransformCoord(XMLoadFloat3(&corners[i]), lightView);
+		frustumMin = XMVectorMin(frustumMin, P);
+		frustumMax = XMVectorMax(frustumMax, P);
+	}
+
+	XMStoreFloat3(&mVolumeMin, XMVectorMax(v0, frustumMin));
+	XMStoreFloat3(&mVolumeMax, XMVectorMin(v1, frustumMax));
+
+	// The near side of the volume stays at the light, so casters outside the
+	// camera view can still shadow what is inside it.
+	mVolumeMin.z = XMVectorGetZ(v0);
+
+	mReceiverMin = XMFLOAT3(+MathHelper::Infinity, +MathHelper::Infinity, +MathHelper::Infinity);
+	mReceiverMax = XMFLOAT3(-MathHelper::Infinity, -MathHelper::Infinity, -MathHelper::Infinity);
+
+	mStats = ShadowCullStats();
+}
+
+bool ShadowCasterCuller::AddReceiver(const BoundingBox& boundsW)
+{
+	++mStats.ReceiversTested;
+
+	if(mCameraFrustumW.Contains(boundsW) == DirectX::DISJOINT)
+		return false;
+
+	XMVECTOR vMin, vMax;
+	ToLightSpace(boundsW, vMin, vMax);
+
+	vMin = XMVectorMax(vMin, XMLoadFloat3(&mVolumeMin));
+	vMax = XMVectorMin(vMax, XMLoadFloat3(&mVolumeMax));
+
+	// Visible, but nowhere the shadow map covers.
+	if(!XMVector3LessOrEqual(vMin, vMax))
+		return false;
+
+	XMStoreFloat3(&mReceiverMin, XMVectorMin(XMLoadFloat3(&mReceiverMin), vMin));
+	XMStoreFloat3(&mReceiverMax, XMVectorMax(XMLoadFloat3(&mReceiverMax), vMax));
+
+	++mStats.ReceiversVisible;
+	return true;
+}
+
+bool ShadowCasterCuller::IsCasterNeeded(const BoundingBox& boundsW)
+{
+	++mStats.CastersTested;
+
+	XMFLOAT3 cMin, cMax;
+	XMVECTOR vMin, vMax;
+	ToLightSpace(boundsW, vMin, vMax);
+	XMStoreFloat3(&cMin, vMin);
+	XMStoreFloat3(&cMax, vMax);
+
+	// Overlaps the receivers as seen from the light...
+	if(cMin.x > mReceiverMax.x || cMax.x < mReceiverMin.x ||
+	   cMin.y > mReceiverMax.y || cMax.y < mReceiverMin.y)
+		return false;
+
+	// ...is not entirely behind the farthest receiver, and not entirely in
+	// front of the near plane, where the shadow pass would clip it anyway.
+	if(cMin.z > mReceiverMax.z || cMax.z < mVolumeMin.z)
+		return false;
+
+	++mStats.CastersAccepted;
+	return true;
+}
+
+const ShadowCullStats& ShadowCasterCuller::GetStats()const
+{
+	return mStats;
+}
+
+void ShadowCasterCuller::ToLightSpace(const BoundingBox& boundsW, XMVECTOR& vMin, XMVECTOR& vMax)const
+{
+	BoundingBox boundsL;
+	boundsW.Transform(boundsL, XMLoadFloat4x4(&mLightView));
+
+	XMVECTOR center = XMLoadFloat3(&boundsL.Center);
+	XMVECTOR extents = XMLoadFloat3(&boundsL.Extents);
+	vMin = XMVectorSubtract(center, extents);
+	vMax = XMVectorAdd(center, extents);
+}
@@ -0,0 +1,70 @@
+//***************************************************************************************
+// ShadowCasterCuller.h
+//
+// Picks the render items worth drawing into a directional light's shadow map.
+// Everything is done in light space, where the light looks down +z:
+//
+//   1. The receiver region is the light's orthographic volume, clipped to the
+//      light space box around the camera frustum and to the union of the
+//      receivers the camera can actually see.
+//   2. A caster is needed if its light space box overlaps the region in x and
+//      y, and some part of it lies nearer the light than the farthest visible
+//      receiver.  Casters between the light and the region may lie outside the
+//      camera view and are still kept.
+//
+// Boxes are used throughout, so the result is conservative.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+struct ShadowCullStats
+{
+	UINT ReceiversTested = 0;
+	UINT ReceiversVisible = 0;
+	UINT CastersTested = 0;
+	UINT CastersAccepted = 0;
+};
+
+class ShadowCasterCuller
+{
+public:
+	ShadowCasterCuller() = default;
+	ShadowCasterCuller(const ShadowCasterCuller& rhs) = delete;
+	ShadowCasterCuller& operator=(const ShadowCasterCuller& rhs) = delete;
+	~ShadowCasterCuller() = default;
+
+	// lightView maps world space to light space and lightProj is the shadow
+	// map's orthographic projection.  cameraFrustumW is the camera's view
+	// volume in world space.  Resets the receivers and statistics.
+	void BeginFrame(DirectX::FXMMATRIX lightView, DirectX::CXMMATRIX lightProj,
+		const DirectX::BoundingFrustum& cameraFrustumW);
+
+	// Adds a receiver if the camera can see it, and returns whether it could.
+	// Add all receivers before testing casters.
+	bool AddReceiver(const DirectX::BoundingBox& boundsW);
+
+	// Returns true if the world space box may cast a shadow onto a visible receiver.
+	bool IsCasterNeeded(const DirectX::BoundingBox& boundsW);
+
+	const ShadowCullStats& GetStats()const;
+
+private:
+	void ToLightSpace(const DirectX::BoundingBox& boundsW, DirectX::XMVECTOR& vMin, DirectX::XMVECTOR& vMax)const;
+
+private:
+	DirectX::XMFLOAT4X4 mLightView = MathHelper::Identity4x4();
+	DirectX::BoundingFrustum mCameraFrustumW;
+
+	// Light volume clipped to the camera frustum, in light space.
+	DirectX::XMFLOAT3 mVolumeMin;
+	DirectX::XMFLOAT3 mVolumeMax;
+
+	// Union of the visible receivers, clipped to the volume; empty (min > max)
+	// until a visible receiver is added.
+	DirectX::XMFLOAT3 mReceiverMin;
+	DirectX::XMFLOAT3 mReceiverMax;
+
+	ShadowCullStats mStats;
+};
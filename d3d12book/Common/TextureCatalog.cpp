@@ -0,0 +1,286 @@
+//***************************************************************************************
+// TextureCatalog.cpp
+//***************************************************************************************
+
+#include "TextureCatalog.h"
+#include <algorithm>
+#include <fstream>
+
+using namespace DirectX;
+
+namespace
+{
+	const uint32_t CatalogMagic = MAKEFOURCC('T', 'C', 'A', 'T');
+
+	// Bump whenever TextureCatalogEntry, DDS_TEXTURE_DESC or DDS_SUBRESOURCE_LAYOUT change.
+	const uint32_t CatalogVersion = 1;
+
+	struct CatalogFileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t EntryCount;
+	};
+
+	struct DirectoryFile
+	{
+		std::wstring Name;
+		UINT64 FileSize;
+		UINT64 LastWriteTime;
+	};
+
+	// Lists the .dds files in directory, sorted by name.  Only the directory is
+	// read; none of the files are opened.
+	std::vector<DirectoryFile> ListDdsFiles(const std::wstring& directory)
+	{
+		std::vector<DirectoryFile> files;
+
+		WIN32_FIND_DATAW findData;
+		HANDLE find = FindFirstFileW((directory + L"\\*.dds").c_str(), &findData);
+		if(find == INVALID_HANDLE_VALUE)
+			return files;
+
+		do
+		{
+			if(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+				continue;
+
+			DirectoryFile file;
+			file.Name = findData.cFileName;
+			file.FileSize = ((UINT64)findData.nFileSizeHigh << 32) | findData.nFileSizeLow;
+			file.LastWriteTime = ((UINT64)findData.ftLastWriteTime.dwHighDateTime << 32) |
+				findData.ftLastWriteTime.dwLowDateTime;
+			files.push_back(file);
+		}
+		while(FindNextFileW(find, &findData));
+
+		FindClose(find);
+
+		std::sort(files.begin(), files.end(),
+			[](const DirectoryFile& a, const DirectoryFile& b) { return a.Name < b.Name; });
+
+		return files;
+	}
+
+	template<typename T>
+	void WriteValue(std::ofstream& fout, const T& value)
+	{
+		fout.write((const char*)&value, sizeof(T));
+	}
+
+	template<typename T>
+	bool ReadValue(std::ifstream& fin, T& value)
+	{
+		fin.read((char*)&value, sizeof(T));
+		return fin.good();
+	}
+
+	// Bytes between the read position and fileSize.  Counts read from the index
+	// are checked against this before anything is allocated for them, so a
+	// truncated or corrupt index fails to load instead of throwing bad_alloc.
+	UINT64 BytesLeft(std::ifstream& fin, UINT64 fileSize)
+	{
+		UINT64 position = (UINT64)fin.tellg();
+		return position < fileSize ? fileSize - position : 0;
+	}
+
+	// Smallest an entry can be: a name and subresource count, both zero, and the
+	// fixed fields between them.
+	const UINT64 MinEntrySize = 2*sizeof(uint32_t) + 2*sizeof(UINT64) + sizeof(DDS_TEXTURE_DESC);
+}
+
+UINT64 TextureCatalogEntry::DataSize()const
+{
+	if(Subresources.empty())
+		return 0;
+
+	const DDS_SUBRESOURCE_LAYOUT& last = Subresources.back();
+	return last.offset + (UINT64)last.slicePitch * last.depth - Subresources.front().offset;
+}
+
+UINT TextureCatalog::Build(const std::wstring& directory)
+{
+	mDirectory = directory;
+	mEntries.clear();
+
+	for(const DirectoryFile& file : ListDdsFiles(directory))
+	{
+		// The headers are all that is read from each file.
+		std::wstring filename = mDirectory + L"\\" + file.Name;
+		std::ifstream fin(filename, std::ios::binary);
+
+		uint8_t headerData[DDS_MAX_HEADER_SIZE];
+		fin.read((char*)headerData, sizeof(headerData));
+		size_t headerDataSize = (size_t)fin.gcount();
+
+		const DDS_HEADER* header = nullptr;
+		size_t bitOffset = 0;
+		if(ParseDDSHeader(headerData, headerDataSize, &header, &bitOffset) != DDS_RESULT_OK)
+			continue;
+
+		TextureCatalogEntry entry;
+		if(GetDDSTextureDesc(header, &entry.Desc) != DDS_RESULT_OK)
+			continue;
+
+		UINT64 dataSize = GetDDSSubresourceLayouts(entry.Desc, entry.Subresources);
+		if(bitOffset + dataSize > file.FileSize)
+			continue;
+
+		for(DDS_SUBRESOURCE_LAYOUT& layout : entry.Subresources)
+			layout.offset += bitOffset;
+
+		entry.Name = file.Name;
+		entry.FileSize = file.FileSize;
+		entry.LastWriteTime = file.LastWriteTime;
+		mEntries.push_back(std::move(entry));
+	}
+
+	return (UINT)mEntries.size();
+}
+
+bool TextureCatalog::Save(const std::wstring& indexFilename)const
+{
+	std::ofstream fout(indexFilename, std::ios::binary);
+	if(!fout)
+		return false;
+
+	CatalogFileHeader fileHeader;
+	fileHeader.Magic = CatalogMagic;
+	fileHeader.Version = CatalogVersion;
+	fileHeader.EntryCount = (uint32_t)mEntries.size();
+	WriteValue(fout, fileHeader);
+
+	for(const TextureCatalogEntry& entry : mEntries)
+	{
+		WriteValue(fout, (uint32_t)entry.Name.size());
+		fout.write((const char*)entry.Name.data(), entry.Name.size() * sizeof(wchar_t));
+
+		WriteValue(fout, entry.FileSize);
+		WriteValue(fout, entry.LastWriteTime);
+		WriteValue(fout, entry.Desc);
+
+		WriteValue(fout, (uint32_t)entry.Subresources.size());
+		fout.write((const char*)entry.Subresources.data(),
+			entry.Subresources.size() * sizeof(DDS_SUBRESOURCE_LAYOUT));
+	}
+
+	return fout.good();
+}
+
+bool TextureCatalog::Load(const std::wstring& directory, const std::wstring& indexFilename)
+{
+	mDirectory = directory;
+	mEntries.clear();
+
+	std::ifstream fin(indexFilename, std::ios::binary | std::ios::ate);
+	if(!fin)
+		return false;
+
+	UINT64 fileSize = (UINT64)fin.tellg();
+	fin.seekg(0);
+
+	CatalogFileHeader fileHeader;
+	if(!ReadValue(fin, fileHeader) ||
+		fileHeader.Magic != CatalogMagic ||
+		fileHeader.Version != CatalogVersion ||
+		fileHeader.EntryCount > BytesLeft(fin, fileSize) / MinEntrySize)
+	{
+		return false;
+	}
+
+	mEntries.resize(fileHeader.EntryCount);
+	for(TextureCatalogEntry& entry : mEntries)
+	{
+		uint32_t nameLength = 0;
+		if(!ReadValue(fin, nameLength) || nameLength > MAX_PATH ||
+			(UINT64)nameLength * sizeof(wchar_t) > BytesLeft(fin, fileSize))
+		{
+			mEntries.clear();
+			return false;
+		}
+
+		entry.Name.resize(nameLength);
+		fin.read((char*)&entry.Name[0], nameLength * sizeof(wchar_t));
+
+		uint32_t subresourceCount = 0;
+		ReadValue(fin, entry.FileSize);
+		ReadValue(fin, entry.LastWriteTime);
+		ReadValue(fin, entry.Desc);
+		if(!ReadValue(fin, subresourceCount) ||
+			subresourceCount != (UINT64)entry.Desc.arraySize * entry.Desc.mipCount ||
+			(UINT64)subresourceCount * sizeof(DDS_SUBRESOURCE_LAYOUT) > BytesLeft(fin, fileSize))
+		{
+			mEntries.clear();
+			return false;
+		}
+
+		entry.Subresources.resize(subresourceCount);
+		fin.read((char*)entry.Subresources.data(), subresourceCount * sizeof(DDS_SUBRESOURCE_LAYOUT));
+		if(!fin.good())
+		{
+			mEntries.clear();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+UINT TextureCatalog::LoadOrBuild(const std::wstring& directory, const std::wstring& indexFilename)
+{
+	if(Load(directory, indexFilename) && IsUpToDate())
+		return (UINT)mEntries.size();
+
+	UINT count = Build(directory);
+	Save(indexFilename);
+
+	return count;
+}
+
+const TextureCatalogEntry* TextureCatalog::Find(const std::wstring& name)const
+{
+	auto it = std::lower_bound(mEntries.begin(), mEntries.end(), name,
+		[](const TextureCatalogEntry& entry, const std::wstring& n) { return entry.Name < n; });
+
+	return (it != mEntries.end() && it->Name == name) ? &*it : nullptr;
+}
+
+const std::wstring& TextureCatalog::Directory()const
+{
+	return mDirectory;
+}
+
+const std::vector<TextureCatalogEntry>& TextureCatalog::Entries()const
+{
+	return mEntries;
+}
+
+UINT64 TextureCatalog::TotalDataSize()const
+{
+	UINT64 total = 0;
+	for(const TextureCatalogEntry& entry : mEntries)
+		total += entry.DataSize();
+
+	return total;
+}
+
+bool TextureCatalog::IsUpToDate()const
+{
+	// Files Build skipped are not in the index, so they show up as added files
+	// here and force a rebuild; they are rare and a rebuild only reads headers.
+	std::vector<DirectoryFile> files = ListDdsFiles(mDirectory);
+	if(files.size() != mEntries.size())
+		return false;
+
+	for(size_t i = 0; i < files.size(); ++i)
+	{
+		if(files[i].Name != mEntries[i].Name ||
+			files[i].FileSize != mEntries[i].FileSize ||
+			files[i].LastWriteTime != mEntries[i].LastWriteTime)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
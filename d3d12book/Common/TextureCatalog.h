@@ -0,0 +1,78 @@
+//***************************************************************************************
+// TextureCatalog.h
+//
+// Index of the DDS textures in a directory, built from their headers alone.  For
+// every file it records the texture description and where each subresource lies
+// in the file, so an app can size its heaps and order its uploads at startup
+// without reading any texel data.  The index can be saved, next to the executable
+// say, and loaded instead of reopening every file.
+//***************************************************************************************
+
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include <vector>
+#include "DDSFormat.h"
+
+struct TextureCatalogEntry
+{
+	// File name relative to the catalog directory.
+	std::wstring Name;
+
+	// Size and last write time (a FILETIME) of the file when it was indexed.
+	UINT64 FileSize = 0;
+	UINT64 LastWriteTime = 0;
+
+	DirectX::DDS_TEXTURE_DESC Desc = {};
+
+	// One entry per subresource in Direct3D subresource order.  Offsets are from
+	// the start of the file, so a subresource can be read without the header.
+	std::vector<DirectX::DDS_SUBRESOURCE_LAYOUT> Subresources;
+
+	// Bytes of texel data in the file, from the first subresource to the end of the last.
+	UINT64 DataSize()const;
+};
+
+class TextureCatalog
+{
+public:
+	TextureCatalog() = default;
+	TextureCatalog(const TextureCatalog& rhs) = delete;
+	TextureCatalog& operator=(const TextureCatalog& rhs) = delete;
+	~TextureCatalog() = default;
+
+	// Reads the header of every .dds file in directory.  Files that are not DDS
+	// textures, or are shorter than their header says, are left out.  Returns
+	// the number of textures indexed.
+	UINT Build(const std::wstring& directory);
+
+	// The index file is binary and only meant to be read back by the same build.
+	// Load returns false, leaving the catalog empty, if the file is missing or
+	// was written by a different version.
+	bool Save(const std::wstring& indexFilename)const;
+	bool Load(const std::wstring& directory, const std::wstring& indexFilename);
+
+	// Loads the index if every file in it is unchanged and no file was added or
+	// removed, which only needs a directory listing; otherwise rebuilds it from
+	// the headers and saves it.
+	UINT LoadOrBuild(const std::wstring& directory, const std::wstring& indexFilename);
+
+	// Returns null if name is not in the catalog.
+	const TextureCatalogEntry* Find(const std::wstring& name)const;
+
+	const std::wstring& Directory()const;
+	const std::vector<TextureCatalogEntry>& Entries()const;
+
+	// Sum of DataSize() over all entries.
+	UINT64 TotalDataSize()const;
+
+private:
+	bool IsUpToDate()const;
+
+private:
+	std::wstring mDirectory;
+
+	// Sorted by name.
+	std::vector<TextureCatalogEntry> mEntries;
+};
@@ -0,0 +1,298 @@
+//***************************************************************************************
+// TextureStreamUploader.cpp
+//***************************************************************************************
+
+#include "TextureStreamUploader.h"
+#include "ThreadPool.h"
+
+using Microsoft::WRL::ComPtr;
+using namespace DirectX;
+
+TextureStreamUploader::TextureStreamUploader(ID3D12Device* device, const TextureCatalog& catalog,
+	ID3D12DescriptorHeap* srvHeap, UINT firstSrvIndex)
+	: md3dDevice(device), mCatalog(catalog), mSrvHeap(srvHeap), mFirstSrvIndex(firstSrvIndex)
+{
+	mCbvSrvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+TextureStreamUploader::~TextureStreamUploader()
+{
+	// The reads refer to the catalog entries, so let them finish.
+	for(StreamedTexture& tex : mTextures)
+	{
+		if(tex.Reading)
+			tex.PendingRead.wait();
+	}
+}
+
+UINT TextureStreamUploader::SrvSlotsPerTexture()
+{
+	// When a frame records new views, the frames before it that can still be in
+	// flight each hold one of the others.
+	return (UINT)gNumFrameResources;
+}
+
+UINT TextureStreamUploader::AddTexture(const TextureCatalogEntry& entry)
+{
+	if(entry.Desc.dimension != DDS_DIMENSION_TEXTURE2D)
+		ThrowIfFailed(E_INVALIDARG);
+
+	StreamedTexture tex;
+	tex.Entry = &entry;
+	tex.ResidentMip = entry.Desc.mipCount;
+	tex.TargetMip = entry.Desc.mipCount;
+	mTextures.push_back(std::move(tex));
+
+	return (UINT)mTextures.size() - 1;
+}
+
+void TextureStreamUploader::SetResidentMips(UINT texture, UINT firstMip)
+{
+	mTextures[texture].TargetMip = firstMip;
+}
+
+void TextureStreamUploader::RecordUploads(ID3D12GraphicsCommandList* cmdList, UINT64 frameFence)
+{
+	for(UINT i = 0; i < (UINT)mTextures.size(); ++i)
+	{
+		StreamedTexture& tex = mTextures[i];
+		const UINT mipCount = tex.Entry->Desc.mipCount;
+		const std::wstring filename = mCatalog.Directory() + L"\\" + tex.Entry->Name;
+
+		MipData data;
+		if(tex.Reading)
+		{
+			if(tex.PendingRead.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+				continue;
+
+			data = tex.PendingRead.get();
+			tex.Reading = false;
+		}
+		else if(tex.Resource == nullptr)
+		{
+			// Nothing to draw with yet, so the first mips are read right away.
+			if(tex.TargetMip >= mipCount)
+				continue;
+
+			data = ReadMips(filename, *tex.Entry, tex.TargetMip, mipCount);
+		}
+
+		// The mips that can be resident after this frame without waiting on a read.
+		UINT firstAvailable = tex.ResidentMip;
+		if(data.EndMip == tex.ResidentMip && data.FirstMip < data.EndMip)
+			firstAvailable = data.FirstMip;
+
+		UINT firstMip = MathHelper::Max(tex.TargetMip, firstAvailable);
+		if(firstMip != tex.ResidentMip)
+			Rebuild(cmdList, frameFence, i, firstMip, data);
+
+		if(tex.TargetMip < tex.ResidentMip)
+		{
+			const TextureCatalogEntry* entry = tex.Entry;
+			UINT readFirst = tex.TargetMip;
+			UINT readEnd = tex.ResidentMip;
+			tex.PendingRead = ThreadPool::Default().Submit([filename, entry, readFirst, readEnd]()
+			{
+				return ReadMips(filename, *entry, readFirst, readEnd);
+			});
+			tex.Reading = true;
+		}
+	}
+}
+
+void TextureStreamUploader::ReleaseCompleted(UINT64 completedFence)
+{
+	mRetired.erase(std::remove_if(mRetired.begin(), mRetired.end(),
+		[completedFence](const RetiredResource& r) { return r.Fence <= completedFence; }),
+		mRetired.end());
+}
+
+UINT TextureStreamUploader::GetSrvIndex(UINT texture)const
+{
+	return mFirstSrvIndex + texture*SrvSlotsPerTexture() + mTextures[texture].SrvSlot;
+}
+
+UINT TextureStreamUploader::GetResidentMip(UINT texture)const
+{
+	return mTextures[texture].ResidentMip;
+}
+
+TextureStreamUploader::MipData TextureStreamUploader::ReadMips(const std::wstring& filename,
+	const TextureCatalogEntry& entry, UINT firstMip, UINT endMip)
+{
+	MipData data;
+	data.FirstMip = firstMip;
+	data.EndMip = endMip;
+
+	std::ifstream fin(filename, std::ios::binary);
+	if(!fin)
+		ThrowIfFailed(E_FAIL);
+
+	// The mips of one slice are consecutive in the file, so each slice is one read.
+	const UINT mipCount = entry.Desc.mipCount;
+	for(UINT slice = 0; slice < entry.Desc.arraySize; ++slice)
+	{
+		const DDS_SUBRESOURCE_LAYOUT& first = entry.Subresources[slice*mipCount + firstMip];
+		const DDS_SUBRESOURCE_LAYOUT& last = entry.Subresources[slice*mipCount + endMip - 1];
+		UINT64 byteSize = last.offset + (UINT64)last.slicePitch*last.depth - first.offset;
+
+		size_t start = data.Bytes.size();
+		data.Bytes.resize(start + (size_t)byteSize);
+
+		fin.seekg((std::streamoff)first.offset);
+		fin.read((char*)&data.Bytes[start], (std::streamsize)byteSize);
+		if(!fin)
+			ThrowIfFailed(E_FAIL);
+	}
+
+	return data;
+}
+
+void TextureStreamUploader::Rebuild(ID3D12GraphicsCommandList* cmdList, UINT64 frameFence, UINT texture,
+	UINT firstMip, const MipData& data)
+{
+	StreamedTexture& tex = mTextures[texture];
+	const TextureCatalogEntry& entry = *tex.Entry;
+	const UINT mipCount = entry.Desc.mipCount;
+	const UINT arraySize = entry.Desc.arraySize;
+
+	const DDS_SUBRESOURCE_LAYOUT& top = entry.Subresources[firstMip];
+	const UINT mipLevels = mipCount - firstMip;
+
+	ComPtr<ID3D12Resource> resource;
+	ThrowIfFailed(md3dDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Tex2D(entry.Desc.format, top.width, top.height, (UINT16)arraySize, (UINT16)mipLevels),
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(resource.GetAddressOf())));
+
+	// Mips [firstMip, uploadEnd) come from the file, the rest from the old resource.
+	const UINT oldMip = tex.ResidentMip;
+	const UINT oldLevels = mipCount - oldMip;
+	const UINT uploadEnd = MathHelper::Min(oldMip, mipCount);
+
+	if(firstMip < uploadEnd)
+	{
+		assert(data.FirstMip <= firstMip && data.EndMip >= uploadEnd);
+
+		const UINT uploadLevels = uploadEnd - firstMip;
+
+		// Each slice is a separate run of subresources in the new resource, so
+		// each gets its own aligned region of the upload buffer.
+		std::vector<UINT64> uploadOffsets(arraySize);
+		UINT64 uploadSize = 0;
+		for(UINT slice = 0; slice < arraySize; ++slice)
+		{
+			uploadOffsets[slice] = uploadSize;
+			uploadSize += GetRequiredIntermediateSize(resource.Get(), slice*mipLevels, uploadLevels);
+			uploadSize = (uploadSize + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1) &
+				~(UINT64)(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1);
+		}
+
+		ComPtr<ID3D12Resource> uploadBuffer;
+		ThrowIfFailed(md3dDevice->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(uploadSize),
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(uploadBuffer.GetAddressOf())));
+
+		std::vector<D3D12_SUBRESOURCE_DATA> subresourceData(uploadLevels);
+		const uint8_t* src = data.Bytes.data();
+		for(UINT slice = 0; slice < arraySize; ++slice)
+		{
+			for(UINT mip = data.FirstMip; mip < data.EndMip; ++mip)
+			{
+				const DDS_SUBRESOURCE_LAYOUT& layout = entry.Subresources[slice*mipCount + mip];
+				if(mip >= firstMip && mip < uploadEnd)
+				{
+					D3D12_SUBRESOURCE_DATA& initData = subresourceData[mip - firstMip];
+					initData.pData = src;
+					initData.RowPitch = layout.rowPitch;
+					initData.SlicePitch = layout.slicePitch;
+				}
+
+				src += (size_t)layout.slicePitch*layout.depth;
+			}
+
+			UpdateSubresources(cmdList, resource.Get(), uploadBuffer.Get(), uploadOffsets[slice],
+				slice*mipLevels, uploadLevels, subresourceData.data());
+		}
+
+		// The copy has not run yet, so the upload buffer lives until this frame completes.
+		mRetired.push_back({ uploadBuffer, frameFence });
+	}
+
+	if(tex.Resource != nullptr)
+	{
+		const UINT copyFirst = MathHelper::Max(firstMip, oldMip);
+		if(copyFirst < mipCount)
+		{
+			cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(tex.Resource.Get(),
+				D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE));
+
+			for(UINT slice = 0; slice < arraySize; ++slice)
+			{
+				for(UINT mip = copyFirst; mip < mipCount; ++mip)
+				{
+					CD3DX12_TEXTURE_COPY_LOCATION dst(resource.Get(), slice*mipLevels + mip - firstMip);
+					CD3DX12_TEXTURE_COPY_LOCATION src(tex.Resource.Get(), slice*oldLevels + mip - oldMip);
+					cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+				}
+			}
+		}
+
+		// Frames in flight may still sample the old resource.
+		mRetired.push_back({ tex.Resource, frameFence });
+	}
+
+	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(resource.Get(),
+		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+
+	tex.Resource = resource;
+	tex.ResidentMip = firstMip;
+	tex.SrvSlot = (tex.SrvSlot + 1) % SrvSlotsPerTexture();
+
+	CreateSrv(texture);
+}
+
+void TextureStreamUploader::CreateSrv(UINT texture)
+{
+	const StreamedTexture& tex = mTextures[texture];
+	const DDS_TEXTURE_DESC& desc = tex.Entry->Desc;
+	const UINT mipLevels = desc.mipCount - tex.ResidentMip;
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Format = desc.format;
+	if(desc.isCubeMap && desc.arraySize > 6)
+	{
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBEARRAY;
+		srvDesc.TextureCubeArray.MipLevels = mipLevels;
+		srvDesc.TextureCubeArray.NumCubes = desc.arraySize / 6;
+	}
+	else if(desc.isCubeMap)
+	{
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
+		srvDesc.TextureCube.MipLevels = mipLevels;
+	}
+	else if(desc.arraySize > 1)
+	{
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MipLevels = mipLevels;
+		srvDesc.Texture2DArray.ArraySize = desc.arraySize;
+	}
+	else
+	{
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MipLevels = mipLevels;
+	}
+
+	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(mSrvHeap->GetCPUDescriptorHandleForHeapStart());
+	hDescriptor.Offset(GetSrvIndex(texture), mCbvSrvDescriptorSize);
+
+	md3dDevice->CreateShaderResourceView(tex.Resource.Get(), &srvDesc, hDescriptor);
+}
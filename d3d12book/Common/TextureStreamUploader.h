@@ -0,0 +1,105 @@
+//***************************************************************************************
+// TextureStreamUploader.h
+//
+// The Direct3D 12 side of TextureStreamer.  Each streamed texture lives in a
+// committed resource holding only its resident mips; when the resident range
+// changes a new resource is created, the mips it shares with the old one are
+// copied over on the GPU and the new ones are uploaded from the file.  File reads
+// for finer mips run on the thread pool, so a texture gets its new mips a frame
+// or two after the streamer asks for them.  The first upload of each texture,
+// its mip tail, is read right away so it can be drawn in the frame it was added.
+//
+// Every texture owns a few consecutive SRV slots in the app's heap that are used
+// in turn, so a frame still in flight keeps the view it was recorded with.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "TextureStreamer.h"
+#include <future>
+
+class TextureStreamUploader : public TextureUploadSink
+{
+public:
+	// The SRV slots of texture i start at firstSrvIndex + i*SrvSlotsPerTexture().
+	TextureStreamUploader(ID3D12Device* device, const TextureCatalog& catalog,
+		ID3D12DescriptorHeap* srvHeap, UINT firstSrvIndex);
+	TextureStreamUploader(const TextureStreamUploader& rhs) = delete;
+	TextureStreamUploader& operator=(const TextureStreamUploader& rhs) = delete;
+	~TextureStreamUploader();
+
+	static UINT SrvSlotsPerTexture();
+
+	// Textures must be added here in the same order, and before, they are added
+	// to the streamer, so both give a texture the same index.  Only 2D textures
+	// (including arrays and cube maps) can be streamed.
+	UINT AddTexture(const TextureCatalogEntry& entry);
+
+	virtual void SetResidentMips(UINT texture, UINT firstMip)override;
+
+	// Records the copies and uploads for every texture whose resident mips are
+	// ready to change, and updates its SRV.  Call once per frame, after waiting
+	// on the frame resource, with the fence value that frame will signal.
+	void RecordUploads(ID3D12GraphicsCommandList* cmdList, UINT64 frameFence);
+
+	// Frees resources replaced by frames up to completedFence.
+	void ReleaseCompleted(UINT64 completedFence);
+
+	// Heap index of the SRV to draw texture with this frame.
+	UINT GetSrvIndex(UINT texture)const;
+
+	// Resident mips as of the commands recorded so far, which can lag the streamer.
+	UINT GetResidentMip(UINT texture)const;
+
+private:
+	// Texel data for mips [FirstMip, EndMip) of every array slice, in
+	// subresource order, packed as they are in the file.
+	struct MipData
+	{
+		UINT FirstMip = 0;
+		UINT EndMip = 0;
+		std::vector<uint8_t> Bytes;
+	};
+
+	struct StreamedTexture
+	{
+		const TextureCatalogEntry* Entry = nullptr;
+
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource = nullptr;
+		UINT ResidentMip = 0;
+		UINT TargetMip = 0;
+
+		std::future<MipData> PendingRead;
+		bool Reading = false;
+
+		UINT SrvSlot = 0;
+	};
+
+	struct RetiredResource
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		UINT64 Fence = 0;
+	};
+
+	static MipData ReadMips(const std::wstring& filename, const TextureCatalogEntry& entry,
+		UINT firstMip, UINT endMip);
+
+	// Replaces the resource of tex with one holding mips [firstMip, mip count),
+	// taking mips from data where it has them and from the old resource otherwise.
+	void Rebuild(ID3D12GraphicsCommandList* cmdList, UINT64 frameFence, UINT texture,
+		UINT firstMip, const MipData& data);
+
+	void CreateSrv(UINT texture);
+
+private:
+	ID3D12Device* md3dDevice = nullptr;
+	const TextureCatalog& mCatalog;
+
+	ID3D12DescriptorHeap* mSrvHeap = nullptr;
+	UINT mFirstSrvIndex = 0;
+	UINT mCbvSrvDescriptorSize = 0;
+
+	std::vector<StreamedTexture> mTextures;
+	std::vector<RetiredResource> mRetired;
+};
@@ -0,0 +1,248 @@
+//***************************************************************************************
+// TextureStreamer.cpp
+//***************************************************************************************
+
+#include "TextureStreamer.h"
+#include "MathHelper.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// A block-compressed texture can only start at a mip whose width and height
+	// are multiples of the 4x4 block size.
+	bool CanBeFirstMip(const DDS_SUBRESOURCE_LAYOUT& layout)
+	{
+		if(layout.numRows == layout.height)
+			return true;
+
+		return layout.numRows*4 == layout.height && layout.width % 4 == 0;
+	}
+}
+
+TextureStreamer::TextureStreamer(TextureUploadSink& sink, UINT64 budgetBytes, UINT mipTailSize)
+	: mSink(sink), mBudget(budgetBytes), mMipTailSize(mipTailSize)
+{
+}
+
+UINT TextureStreamer::AddTexture(const TextureCatalogEntry& entry)
+{
+	StreamingTexture tex;
+	tex.Entry = &entry;
+
+	const UINT mipCount = entry.Desc.mipCount;
+	tex.MipBytes.assign(mipCount, 0);
+	for(UINT slice = 0; slice < entry.Desc.arraySize; ++slice)
+	{
+		for(UINT mip = 0; mip < mipCount; ++mip)
+		{
+			const DDS_SUBRESOURCE_LAYOUT& layout = entry.Subresources[slice*mipCount + mip];
+			tex.MipBytes[mip] += (UINT64)layout.slicePitch * layout.depth;
+		}
+	}
+
+	// The tail starts at the first mip that fits in mMipTailSize, or is just the
+	// last mip if none does.  Every mip above it must be able to start a resource,
+	// so a texture that halves to a size that cannot stays resident from there.
+	tex.TailMip = mipCount - 1;
+	for(UINT mip = 0; mip < mipCount; ++mip)
+	{
+		const DDS_SUBRESOURCE_LAYOUT& layout = entry.Subresources[mip];
+		if(layout.width <= mMipTailSize && layout.height <= mMipTailSize)
+		{
+			tex.TailMip = mip;
+			break;
+		}
+
+		if(mip + 1 < mipCount && !CanBeFirstMip(entry.Subresources[mip + 1]))
+		{
+			tex.TailMip = mip;
+			break;
+		}
+	}
+
+	tex.ResidentMip = tex.TailMip;
+	tex.WantedMip = tex.TailMip;
+
+	for(UINT mip = tex.TailMip; mip < mipCount; ++mip)
+		mResidentBytes += tex.MipBytes[mip];
+
+	UINT index = (UINT)mTextures.size();
+	mTextures.push_back(std::move(tex));
+
+	mSink.SetResidentMips(index, mTextures[index].ResidentMip);
+
+	return index;
+}
+
+void TextureStreamer::SetBudget(UINT64 budgetBytes)
+{
+	mBudget = budgetBytes;
+}
+
+UINT64 TextureStreamer::GetBudget()const
+{
+	return mBudget;
+}
+
+void TextureStreamer::SetUploadLimit(UINT64 bytesPerUpdate)
+{
+	mUploadLimit = bytesPerUpdate;
+}
+
+void TextureStreamer::RequestTexture(UINT texture, float distance, float screenSize)
+{
+	StreamingTexture& tex = mTextures[texture];
+	if(tex.LastUsedFrame != mFrame)
+	{
+		tex.Distance = distance;
+		tex.ScreenSize = screenSize;
+		tex.LastUsedFrame = mFrame;
+	}
+	else
+	{
+		tex.Distance = MathHelper::Min(tex.Distance, distance);
+		tex.ScreenSize = MathHelper::Max(tex.ScreenSize, screenSize);
+	}
+}
+
+void TextureStreamer::Update()
+{
+	std::vector<UINT> startMips(mTextures.size());
+	for(size_t i = 0; i < mTextures.size(); ++i)
+		startMips[i] = mTextures[i].ResidentMip;
+
+	// The budget may have shrunk since the last frame.
+	while(mResidentBytes > mBudget)
+	{
+		int victim = FindEvictionVictim(-1);
+		if(victim < 0)
+			break;
+
+		EvictFinestMip(mTextures[victim]);
+	}
+
+	// Work out how much detail each texture used this frame can show: the mip
+	// whose width is closest to, but not below, the screen size it covers.
+	std::vector<UINT> candidates;
+	for(UINT i = 0; i < (UINT)mTextures.size(); ++i)
+	{
+		StreamingTexture& tex = mTextures[i];
+		if(tex.LastUsedFrame != mFrame)
+			continue;
+
+		const DDS_TEXTURE_DESC& desc = tex.Entry->Desc;
+		float texels = (float)MathHelper::Max(desc.width, desc.height);
+		float screenSize = MathHelper::Max(tex.ScreenSize, 1.0f);
+
+		float mip = floorf(log2f(MathHelper::Max(texels / screenSize, 1.0f)));
+		tex.WantedMip = MathHelper::Min((UINT)mip, tex.TailMip);
+
+		if(tex.WantedMip < tex.ResidentMip)
+		{
+			tex.Priority = (tex.ResidentMip - tex.WantedMip) * tex.ScreenSize / (1.0f + tex.Distance);
+			candidates.push_back(i);
+		}
+	}
+
+	std::stable_sort(candidates.begin(), candidates.end(),
+		[this](UINT a, UINT b) { return mTextures[a].Priority > mTextures[b].Priority; });
+
+	UINT64 uploadBytes = 0;
+	for(UINT i : candidates)
+	{
+		StreamingTexture& tex = mTextures[i];
+
+		UINT mip = tex.ResidentMip - 1;
+		UINT64 bytes = tex.MipBytes[mip];
+
+		// Always let one mip through, so a limit below the size of a mip can
+		// only slow streaming down, not stop it.
+		if(uploadBytes > 0 && uploadBytes + bytes > mUploadLimit)
+			break;
+
+		bool fits = true;
+		while(mResidentBytes + bytes > mBudget)
+		{
+			int victim = FindEvictionVictim((int)i);
+			if(victim < 0)
+			{
+				fits = false;
+				break;
+			}
+
+			EvictFinestMip(mTextures[victim]);
+		}
+
+		// Smaller mips further down the list may still fit.
+		if(!fits)
+			continue;
+
+		tex.ResidentMip = mip;
+		mResidentBytes += bytes;
+		uploadBytes += bytes;
+	}
+
+	for(UINT i = 0; i < (UINT)mTextures.size(); ++i)
+	{
+		if(mTextures[i].ResidentMip != startMips[i])
+			mSink.SetResidentMips(i, mTextures[i].ResidentMip);
+	}
+
+	++mFrame;
+}
+
+UINT TextureStreamer::TextureCount()const
+{
+	return (UINT)mTextures.size();
+}
+
+UINT TextureStreamer::GetResidentMip(UINT texture)const
+{
+	return mTextures[texture].ResidentMip;
+}
+
+UINT TextureStreamer::GetWantedMip(UINT texture)const
+{
+	return mTextures[texture].WantedMip;
+}
+
+UINT64 TextureStreamer::GetResidentBytes()const
+{
+	return mResidentBytes;
+}
+
+int TextureStreamer::FindEvictionVictim(int keep)const
+{
+	int victim = -1;
+	for(int i = 0; i < (int)mTextures.size(); ++i)
+	{
+		const StreamingTexture& tex = mTextures[i];
+		if(i == keep || tex.ResidentMip >= tex.TailMip)
+			continue;
+
+		// To make room for another texture, one in use this frame only gives up
+		// detail it has beyond what it needs.
+		bool usedThisFrame = tex.LastUsedFrame == mFrame;
+		if(keep >= 0 && usedThisFrame && tex.ResidentMip >= tex.WantedMip)
+			continue;
+
+		// Least recently used first, then smallest on screen.
+		if(victim < 0 ||
+			tex.LastUsedFrame < mTextures[victim].LastUsedFrame ||
+			(tex.LastUsedFrame == mTextures[victim].LastUsedFrame && tex.ScreenSize < mTextures[victim].ScreenSize))
+		{
+			victim = i;
+		}
+	}
+
+	return victim;
+}
+
+void TextureStreamer::EvictFinestMip(StreamingTexture& tex)
+{
+	mResidentBytes -= tex.MipBytes[tex.ResidentMip];
+	tex.ResidentMip++;
+}
@@ -0,0 +1,107 @@
+//***************************************************************************************
+// TextureStreamer.h
+//
+// Decides which mips of each texture should be in video memory.  When a texture
+// is added its mip tail (the mips no larger than a few dozen texels) is made
+// resident at once, so it can be drawn right away.  After that, every frame the
+// app reports the distance and screen size of the objects drawn with each
+// texture, and Update streams in finer mips one level at a time, most needed
+// first, until each texture has the detail its largest use can show.  Resident
+// mips are kept under a memory budget by dropping the finest mip of the least
+// recently used textures.
+//
+// The streamer only keeps the books; a TextureUploadSink does the actual loading
+// and evicting, so the scheduling can be driven without a device.
+//***************************************************************************************
+
+#pragma once
+
+#include "TextureCatalog.h"
+
+class TextureUploadSink
+{
+public:
+	virtual ~TextureUploadSink() = default;
+
+	// Makes mips [firstMip, mip count) of texture the resident ones, loading finer
+	// mips if firstMip went down and releasing them if it went up.  Called at most
+	// once per texture per TextureStreamer::Update.
+	virtual void SetResidentMips(UINT texture, UINT firstMip) = 0;
+};
+
+class TextureStreamer
+{
+public:
+	// Mips whose width and height are both at most mipTailSize make up a
+	// texture's tail.  Tails are never evicted, so the budget only limits the
+	// mips above them.
+	TextureStreamer(TextureUploadSink& sink, UINT64 budgetBytes, UINT mipTailSize = 64);
+	TextureStreamer(const TextureStreamer& rhs) = delete;
+	TextureStreamer& operator=(const TextureStreamer& rhs) = delete;
+	~TextureStreamer() = default;
+
+	// Adds a texture and makes its mip tail resident before returning.  The
+	// entry must outlive the streamer.  Returns the index used by the sink.
+	UINT AddTexture(const TextureCatalogEntry& entry);
+
+	void SetBudget(UINT64 budgetBytes);
+	UINT64 GetBudget()const;
+
+	// Caps the bytes of mips streamed in by one Update, so a burst of requests
+	// is spread over several frames.  There is no cap by default.
+	void SetUploadLimit(UINT64 bytesPerUpdate);
+
+	// Reports that texture is drawn this frame on an object at distance from the
+	// eye whose projection is screenSize pixels across.  Call it for every object
+	// drawn with the texture; the nearest and largest use counts.
+	void RequestTexture(UINT texture, float distance, float screenSize);
+
+	// Evicts down to the budget, then streams in one finer mip for each texture
+	// requested since the last Update that needs more detail.  Textures go in
+	// order of priority, (missing mips) * screenSize / (1 + distance).  Ends the
+	// frame, so requests made after it count toward the next Update.
+	void Update();
+
+	UINT TextureCount()const;
+	UINT GetResidentMip(UINT texture)const;
+	UINT GetWantedMip(UINT texture)const;
+	UINT64 GetResidentBytes()const;
+
+private:
+	struct StreamingTexture
+	{
+		const TextureCatalogEntry* Entry = nullptr;
+
+		// Bytes of each mip level, summed over the array slices.
+		std::vector<UINT64> MipBytes;
+
+		UINT TailMip = 0;
+		UINT ResidentMip = 0;
+		UINT WantedMip = 0;
+
+		// Nearest distance and largest screen size requested in LastUsedFrame.
+		float Distance = 0.0f;
+		float ScreenSize = 0.0f;
+		float Priority = 0.0f;
+		UINT64 LastUsedFrame = 0;
+	};
+
+	// Picks the texture whose finest resident mip should go first to make room
+	// for mips of texture keep, or returns -1 if none can go.  When keep is -1
+	// (over budget) textures used this frame may lose mips as well.
+	int FindEvictionVictim(int keep)const;
+	void EvictFinestMip(StreamingTexture& tex);
+
+private:
+	TextureUploadSink& mSink;
+
+	std::vector<StreamingTexture> mTextures;
+
+	UINT64 mBudget = 0;
+	UINT64 mUploadLimit = ~0ull;
+	UINT64 mResidentBytes = 0;
+	UINT mMipTailSize = 64;
+
+	// Frame that requests are currently counted toward.
+	UINT64 mFrame = 1;
+};
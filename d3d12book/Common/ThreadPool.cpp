@@ -0,0 +1,151 @@
+//***************************************************************************************
+// ThreadPool.cpp
+//***************************************************************************************
+
+#include "ThreadPool.h"
+
+namespace
+{
+	// Identifies which pool (if any) owns the current thread, and its slot in it.
+	thread_local const ThreadPool* tlsPool = nullptr;
+	thread_local UINT tlsThreadIndex = 0;
+
+	struct ParallelForState
+	{
+		std::atomic<UINT> NextChunk{ 0 };
+		std::atomic<UINT> ChunksDone{ 0 };
+		std::mutex DoneMutex;
+		std::condition_variable DoneCV;
+	};
+}
+
+ThreadPool::ThreadPool(int workerCount)
+{
+	if(workerCount < 0)
+	{
+		int hw = (int)std::thread::hardware_concurrency();
+		workerCount = hw > 1 ? hw - 1 : 0;
+	}
+
+	for(int i = 0; i < workerCount; ++i)
+		mWorkers.emplace_back(&ThreadPool::WorkerMain, this, (UINT)(i + 1));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mQueueMutex);
+		mQuit = true;
+	}
+	mQueueCV.notify_all();
+
+	for(auto& t : mWorkers)
+		t.join();
+}
+
+UINT ThreadPool::ThreadCount()const
+{
+	return (UINT)mWorkers.size() + 1;
+}
+
+UINT ThreadPool::CurrentThreadIndex()const
+{
+	return tlsPool == this ? tlsThreadIndex : 0;
+}
+
+void ThreadPool::ParallelFor(UINT count, UINT grainSize,
+	const std::function<void(UINT begin, UINT end, UINT threadIndex)>& func)
+{
+	if(count == 0)
+		return;
+
+	grainSize = grainSize > 0 ? grainSize : 1;
+	const UINT numChunks = (count + grainSize - 1) / grainSize;
+
+	if(numChunks == 1 || mWorkers.empty())
+	{
+		func(0, count, CurrentThreadIndex());
+		return;
+	}
+
+	auto state = std::make_shared<ParallelForState>();
+
+	// Every participant pulls chunks until none are left.  Helpers that get
+	// scheduled after all chunks were claimed simply fall through.
+	auto runChunks = [this, state, numChunks, count, grainSize, &func]()
+	{
+		UINT chunk;
+		while((chunk = state->NextChunk.fetch_add(1)) < numChunks)
+		{
+			UINT begin = chunk * grainSize;
+			UINT end = begin + grainSize < count ? begin + grainSize : count;
+			func(begin, end, CurrentThreadIndex());
+
+			if(state->ChunksDone.fetch_add(1) + 1 == numChunks)
+			{
+				std::lock_guard<std::mutex> lock(state->DoneMutex);
+				state->DoneCV.notify_all();
+			}
+		}
+	};
+
+	UINT helpers = numChunks - 1 < (UINT)mWorkers.size() ? numChunks - 1 : (UINT)mWorkers.size();
+	{
+		std::lock_guard<std::mutex> lock(mQueueMutex);
+		for(UINT i = 0; i < helpers; ++i)
+			mQueue.push_back(runChunks);
+	}
+	mQueueCV.notify_all();
+
+	runChunks();
+
+	// Chunks claimed by other threads are already running, so this wait always
+	// terminates even when ParallelFor is nested inside a worker.
+	std::unique_lock<std::mutex> lock(state->DoneMutex);
+	state->DoneCV.wait(lock, [&]() { return state->ChunksDone.load() == numChunks; });
+}
+
+ThreadPool& ThreadPool::Default()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::Enqueue(std::function<void()> task)
+{
+	// Without workers nobody would ever drain the queue.
+	if(mWorkers.empty())
+	{
+		task();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mQueueMutex);
+		mQueue.push_back(std::move(task));
+	}
+	mQueueCV.notify_one();
+}
+
+void ThreadPool::WorkerMain(UINT threadIndex)
+{
+	tlsPool = this;
+	tlsThreadIndex = threadIndex;
+
+	for(;;)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mQueueMutex);
+			mQueueCV.wait(lock, [this]() { return mQuit || !mQueue.empty(); });
+
+			if(mQuit && mQueue.empty())
+				return;
+
+			task = std::move(mQueue.front());
+			mQueue.pop_front();
+		}
+
+		task();
+	}
+}
@@ -0,0 +1,496 @@
+//***************************************************************************************
+// TriangleBvh.cpp
+//***************************************************************************************
+
+#include "TriangleBvh.h"
+#include "BvhHelper.h"
+#include <algorithm>
+
+using namespace DirectX;
+
+namespace
+{
+	// Leaves hold up to one TrianglePacket; testing it costs about as much as
+	// testing a single triangle, so no split of four or fewer can pay off.
+	const UINT MaxLeafSize = 4;
+
+	// Candidate split planes per axis are the boundaries between these bins.
+	const UINT SahBinCount = 12;
+
+	// Nodes this deep become leaves, which also bounds the traversal stack.
+	const UINT BvhMaxDepth = 64;
+
+	float HalfArea(const XMFLOAT3& vMin, const XMFLOAT3& vMax)
+	{
+		float dx = vMax.x - vMin.x;
+		float dy = vMax.y - vMin.y;
+		float dz = vMax.z - vMin.z;
+		return dx*dy + dy*dz + dz*dx;
+	}
+
+	float GetAxis(const XMFLOAT3& v, int axis)
+	{
+		return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+	}
+
+	const XMFLOAT3& GetPosition(const void* positions, UINT vertexStride, UINT vertex)
+	{
+		return *reinterpret_cast<const XMFLOAT3*>(static_cast<const BYTE*>(positions) + (size_t)vertex * vertexStride);
+	}
+
+	struct Bin
+	{
+		UINT Count = 0;
+		XMFLOAT3 BoundsMin = XMFLOAT3(+MathHelper::Infinity, +MathHelper::Infinity, +MathHelper::Infinity);
+		XMFLOAT3 BoundsMax = XMFLOAT3(-MathHelper::Infinity, -MathHelper::Infinity, -MathHelper::Infinity);
+
+		void Grow(const XMFLOAT3& vMin, const XMFLOAT3& vMax)
+		{
+			BoundsMin.x = MathHelper::Min(BoundsMin.x, vMin.x);
+			BoundsMin.y = MathHelper::Min(BoundsMin.y, vMin.y);
+			BoundsMin.z = MathHelper::Min(BoundsMin.z, vMin.z);
+			BoundsMax.x = MathHelper::Max(BoundsMax.x, vMax.x);
+			BoundsMax.y = MathHelper::Max(BoundsMax.y, vMax.y);
+			BoundsMax.z = MathHelper::Max(BoundsMax.z, vMax.z);
+		}
+	};
+}
+
+void TriangleBvh::Build(const void* positions, UINT vertexStride,
+	const std::uint16_t* indices, UINT startIndex, UINT indexCount, INT baseVertex)
+{
+	BuildFromIndices(positions, vertexStride, indices, startIndex, indexCount, baseVertex);
+}
+
+void TriangleBvh::Build(const void* positions, UINT vertexStride,
+	const std::uint32_t* indices, UINT startIndex, UINT indexCount, INT baseVertex)
+{
+	BuildFromIndices(positions, vertexStride, indices, startIndex, indexCount, baseVertex);
+}
+
+template<typename Index>
+void TriangleBvh::BuildFromIndices(const void* positions, UINT vertexStride,
+	const Index* indices, UINT startIndex, UINT indexCount, INT baseVertex)
+{
+	Clear();
+
+	const UINT triCount = indexCount / 3;
+	if(triCount == 0)
+		return;
+
+	mTriangleCount = triCount;
+
+	std::vector<BuildTriangle> tris(triCount);
+	for(UINT i = 0; i < triCount; ++i)
+	{
+		BuildTriangle& tri = tris[i];
+		tri.Triangle = startIndex / 3 + i;
+
+		XMVECTOR vMin = XMVectorReplicate(+MathHelper::Infinity);
+		XMVECTOR vMax = XMVectorReplicate(-MathHelper::Infinity);
+		for(int k = 0; k < 3; ++k)
+		{
+			tri.Vertices[k] = (UINT)(indices[startIndex + 3 * i + k] + baseVertex);
+
+			XMVECTOR P = XMLoadFloat3(&GetPosition(positions, vertexStride, tri.Vertices[k]));
+			vMin = XMVectorMin(vMin, P);
+			vMax = XMVectorMax(vMax, P);
+		}
+
+		XMStoreFloat3(&tri.BoundsMin, vMin);
+		XMStoreFloat3(&tri.BoundsMax, vMax);
+		XMStoreFloat3(&tri.Centroid, XMVectorScale(XMVectorAdd(vMin, vMax), 0.5f));
+	}
+
+	// A binary tree with one triangle per leaf has 2n - 1 nodes, so the node
+	// array never reallocates during the build.
+	mNodes.reserve(2 * triCount);
+	mPackets.reserve(triCount);
+	mTriangles.reserve(4 * triCount);
+
+	mNodes.emplace_back();
+	BuildNode(tris, positions, vertexStride, 0, 0, triCount, 0);
+}
+
+void TriangleBvh::Clear()
+{
+	mNodes.clear();
+	mPackets.clear();
+	mTriangles.clear();
+	mTriangleCount = 0;
+}
+
+bool TriangleBvh::Empty()const
+{
+	return mNodes.empty();
+}
+
+UINT TriangleBvh::TriangleCount()const
+{
+	return mTriangleCount;
+}
+
+UINT TriangleBvh::NodeCount()const
+{
+	return (UINT)mNodes.size();
+}
+
+BoundingBox TriangleBvh::GetBounds()const
+{
+	BoundingBox bounds(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f));
+	if(!mNodes.empty())
+		BoundingBox::CreateFromPoints(bounds, XMLoadFloat3(&mNodes[0].BoundsMin), XMLoadFloat3(&mNodes[0].BoundsMax));
+
+	return bounds;
+}
+
+void TriangleBvh::BuildNode(std::vector<BuildTriangle>& tris, const void* positions, UINT vertexStride,
+	UINT node, UINT first, UINT count, UINT depth)
+{
+	Bin bounds;
+	Bin centroidBounds;
+	for(UINT i = first; i < first + count; ++i)
+	{
+		bounds.Grow(tris[i].BoundsMin, tris[i].BoundsMax);
+		centroidBounds.Grow(tris[i].Centroid, tris[i].Centroid);
+	}
+
+	mNodes[node].BoundsMin = bounds.BoundsMin;
+	mNodes[node].BoundsMax = bounds.BoundsMax;
+
+	if(count <= MaxLeafSize || depth + 1 >= BvhMaxDepth)
+	{
+		MakeLeaf(tris, positions, vertexStride, node, first, count);
+		return;
+	}
+
+	// Find the cheapest bin boundary over all three axes.  The cost of a split
+	// is proportional to the expected number of triangle tests, A_L*N_L + A_R*N_R.
+	int bestAxis = -1;
+	UINT bestSplit = 0;
+	float bestCost = MathHelper::Infinity;
+
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		float cMin = GetAxis(centroidBounds.BoundsMin, axis);
+		float cExtent = GetAxis(centroidBounds.BoundsMax, axis) - cMin;
+		if(cExtent <= 0.0f)
+			continue;
+
+		Bin bins[SahBinCount];
+		float binScale = SahBinCount / cExtent;
+		for(UINT i = first; i < first + count; ++i)
+		{
+			UINT b = MathHelper::Min((UINT)((GetAxis(tris[i].Centroid, axis) - cMin) * binScale), SahBinCount - 1);
+			bins[b].Count++;
+			bins[b].Grow(tris[i].BoundsMin, tris[i].BoundsMax);
+		}
+
+		// Sweep from the right to get the cost of everything above each boundary,
+		// then from the left to finish the cost of each split.
+		float rightCost[SahBinCount];
+		Bin right;
+		for(UINT b = SahBinCount - 1; b > 0; --b)
+		{
+			right.Count += bins[b].Count;
+			right.Grow(bins[b].BoundsMin, bins[b].BoundsMax);
+			rightCost[b] = right.Count > 0 ? HalfArea(right.BoundsMin, right.BoundsMax) * right.Count : 0.0f;
+		}
+
+		Bin left;
+		for(UINT b = 0; b < SahBinCount - 1; ++b)
+		{
+			left.Count += bins[b].Count;
+			left.Grow(bins[b].BoundsMin, bins[b].BoundsMax);
+
+			if(left.Count == 0 || left.Count == count)
+				continue;
+
+			float cost = HalfArea(left.BoundsMin, left.BoundsMax) * left.Count + rightCost[b + 1];
+			if(cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = b;
+			}
+		}
+	}
+
+	UINT leftCount = count / 2;
+	if(bestAxis >= 0)
+	{
+		float cMin = GetAxis(centroidBounds.BoundsMin, bestAxis);
+		float binScale = SahBinCount / (GetAxis(centroidBounds.BoundsMax, bestAxis) - cMin);
+
+		auto mid = std::partition(tris.begin() + first, tris.begin() + first + count,
+			[&](const BuildTriangle& tri)
+		{
+			UINT b = MathHelper::Min((UINT)((GetAxis(tri.Centroid, bestAxis) - cMin) * binScale), SahBinCount - 1);
+			return b <= bestSplit;
+		});
+
+		leftCount = (UINT)(mid - (tris.begin() + first));
+	}
+
+	// All centroids coincide; any split is as good as another.
+	if(leftCount == 0 || leftCount == count)
+		leftCount = count / 2;
+
+	// Siblings are allocated together.
+	UINT left = (UINT)mNodes.size();
+	mNodes.emplace_back();
+	mNodes.emplace_back();
+	mNodes[node].First = left;
+	mNodes[node].Count = 0;
+
+	BuildNode(tris, positions, vertexStride, left, first, leftCount, depth + 1);
+	BuildNode(tris, positions, vertexStride, left + 1, first + leftCount, count - leftCount, depth + 1);
+}
+
+void TriangleBvh::MakeLeaf(std::vector<BuildTriangle>& tris, const void* positions, UINT vertexStride,
+	UINT node, UINT first, UINT count)
+{
+	mNodes[node].First = (UINT)mPackets.size();
+	mNodes[node].Count = count;
+
+	for(UINT i = 0; i < count; i += 4)
+	{
+		TrianglePacket packet;
+		packet.Clear();
+		for(UINT lane = 0; lane < 4; ++lane)
+		{
+			if(i + lane >= count)
+			{
+				mTriangles.push_back(0);
+				continue;
+			}
+
+			const BuildTriangle& tri = tris[first + i + lane];
+			packet.Set(lane,
+				XMLoadFloat3(&GetPosition(positions, vertexStride, tri.Vertices[0])),
+				XMLoadFloat3(&GetPosition(positions, vertexStride, tri.Vertices[1])),
+				XMLoadFloat3(&GetPosition(positions, vertexStride, tri.Vertices[2])));
+			mTriangles.push_back(tri.Triangle);
+		}
+		mPackets.push_back(packet);
+	}
+}
+
+bool TriangleBvh::Intersects(FXMVECTOR origin, FXMVECTOR dir, float& dist, UINT& triangle)const
+{
+	if(mNodes.empty())
+		return false;
+
+	XMFLOAT3 o, invDir;
+	XMStoreFloat3(&o, origin);
+	XMStoreFloat3(&invDir, XMVectorReciprocal(dir));
+
+	float closest = dist;
+	UINT closestIndex = 0;
+	bool hit = false;
+
+	auto enterNode = [&](const Node& n)
+	{
+		return BvhHelper::EnterBox(n.BoundsMin, n.BoundsMax, o, invDir, closest);
+	};
+
+	struct StackEntry
+	{
+		UINT Node;
+		float Distance;
+	};
+	StackEntry stack[BvhMaxDepth + 1];
+	UINT stackSize = 0;
+
+	float rootDistance = enterNode(mNodes[0]);
+	if(rootDistance < MathHelper::Infinity)
+		stack[stackSize++] = { 0, rootDistance };
+
+	while(stackSize > 0)
+	{
+		StackEntry entry = stack[--stackSize];
+
+		// A hit found since this node was pushed may already be nearer.
+		if(entry.Distance >= closest)
+			continue;
+
+		const Node& node = mNodes[entry.Node];
+		if(node.Count == 0)
+		{
+			UINT nearChild = node.First;
+			UINT farChild = node.First + 1;
+			float nearDistance = enterNode(mNodes[nearChild]);
+			float farDistance = enterNode(mNodes[farChild]);
+			if(farDistance < nearDistance)
+			{
+				std::swap(nearChild, farChild);
+				std::swap(nearDistance, farDistance);
+			}
+
+			// Push the far child first so the near one is visited next.
+			if(farDistance < MathHelper::Infinity)
+				stack[stackSize++] = { farChild, farDistance };
+			if(nearDistance < MathHelper::Infinity)
+				stack[stackSize++] = { nearChild, nearDistance };
+			continue;
+		}
+
+		UINT packetCount = (node.Count + 3) / 4;
+		for(UINT i = node.First; i < node.First + packetCount; ++i)
+		{
+			UINT lane = 0;
+			if(IntersectTrianglePacket(origin, dir, mPackets[i], closest, lane))
+			{
+				closestIndex = 4 * i + lane;
+				hit = true;
+			}
+		}
+	}
+
+	if(hit)
+	{
+		dist = closest;
+		triangle = mTriangles[closestIndex];
+	}
+
+	return hit;
+}
+
+UINT TriangleBvh::IntersectPacket(const RayPacket& rays, XMFLOAT4& dist, UINT triangle[4])const
+{
+	if(mNodes.empty())
+		return 0;
+
+	XMVECTOR ox = XMLoadFloat4(&rays.OriginX);
+	XMVECTOR oy = XMLoadFloat4(&rays.OriginY);
+	XMVECTOR oz = XMLoadFloat4(&rays.OriginZ);
+	XMVECTOR invDx = XMVectorReciprocal(XMLoadFloat4(&rays.DirX));
+	XMVECTOR invDy = XMVectorReciprocal(XMLoadFloat4(&rays.DirY));
+	XMVECTOR invDz = XMVectorReciprocal(XMLoadFloat4(&rays.DirZ));
+
+	UINT hitMask = 0;
+
+	// Slab test of all four rays; returns the smallest entry distance of the rays
+	// that enter the box before their closest hit, or infinity if none does.
+	auto enterNode = [&](const Node& n)
+	{
+		XMVECTOR tx0, tx1, ty0, ty1, tz0, tz1;
+		BvhHelper::SlabInterval(XMVectorReplicate(n.BoundsMin.x), XMVectorReplicate(n.BoundsMax.x), ox, invDx, tx0, tx1);
+		BvhHelper::SlabInterval(XMVectorReplicate(n.BoundsMin.y), XMVectorReplicate(n.BoundsMax.y), oy, invDy, ty0, ty1);
+		BvhHelper::SlabInterval(XMVectorReplicate(n.BoundsMin.z), XMVectorReplicate(n.BoundsMax.z), oz, invDz, tz0, tz1);
+
+		XMVECTOR tNear = XMVectorMax(XMVectorMax(tx0, ty0), XMVectorMax(tz0, XMVectorZero()));
+		XMVECTOR tFar = XMVectorMin(XMVectorMin(tx1, ty1), tz1);
+
+		XMVECTOR enters = XMVectorAndInt(XMVectorLessOrEqual(tNear, tFar), XMVectorLess(tNear, XMLoadFloat4(&dist)));
+		tNear = XMVectorSelect(XMVectorReplicate(MathHelper::Infinity), tNear, enters);
+
+		XMFLOAT4 t;
+		XMStoreFloat4(&t, tNear);
+		return MathHelper::Min(MathHelper::Min(t.x, t.y), MathHelper::Min(t.z, t.w));
+	};
+
+	auto furthestDist = [&]()
+	{
+		return MathHelper::Max(MathHelper::Max(dist.x, dist.y), MathHelper::Max(dist.z, dist.w));
+	};
+
+	struct StackEntry
+	{
+		UINT Node;
+		float Distance;
+	};
+	StackEntry stack[BvhMaxDepth + 1];
+	UINT stackSize = 0;
+
+	float rootDistance = enterNode(mNodes[0]);
+	if(rootDistance < MathHelper::Infinity)
+		stack[stackSize++] = { 0, rootDistance };
+
+	while(stackSize > 0)
+	{
+		StackEntry entry = stack[--stackSize];
+
+		// Every ray already has a hit nearer than this node.
+		if(entry.Distance >= furthestDist())
+			continue;
+
+		const Node& node = mNodes[entry.Node];
+		if(node.Count == 0)
+		{
+			UINT nearChild = node.First;
+			UINT farChild = node.First + 1;
+			float nearDistance = enterNode(mNodes[nearChild]);
+			float farDistance = enterNode(mNodes[farChild]);
+			if(farDistance < nearDistance)
+			{
+				std::swap(nearChild, farChild);
+				std::swap(nearDistance, farDistance);
+			}
+
+			if(farDistance < MathHelper::Infinity)
+				stack[stackSize++] = { farChild, farDistance };
+			if(nearDistance < MathHelper::Infinity)
+				stack[stackSize++] = { nearChild, nearDistance };
+			continue;
+		}
+
+		for(UINT i = 0; i < node.Count; ++i)
+		{
+			UINT packet = node.First + i / 4;
+			UINT lane = i % 4;
+
+			UINT mask = IntersectRayPacket(rays, mPackets[packet], lane, dist);
+			for(UINT r = 0; r < 4; ++r)
+			{
+				if(mask & (1u << r))
+					triangle[r] = mTriangles[4 * packet + lane];
+			}
+			hitMask |= mask;
+		}
+	}
+
+	return hitMask;
+}
+
+bool TriangleBvh::IntersectsAny(FXMVECTOR origin, FXMVECTOR dir, float maxDist)const
+{
+	if(mNodes.empty())
+		return false;
+
+	XMFLOAT3 o, invDir;
+	XMStoreFloat3(&o, origin);
+	XMStoreFloat3(&invDir, XMVectorReciprocal(dir));
+
+	// Order does not matter here, so children are pushed as they come.
+	UINT stack[BvhMaxDepth + 1];
+	UINT stackSize = 0;
+
+	if(BvhHelper::EnterBox(mNodes[0].BoundsMin, mNodes[0].BoundsMax, o, invDir, maxDist) < MathHelper::Infinity)
+		stack[stackSize++] = 0;
+
+	while(stackSize > 0)
+	{
+		const Node& node = mNodes[stack[--stackSize]];
+		if(node.Count == 0)
+		{
+			for(UINT child = node.First; child <= node.First + 1; ++child)
+			{
+				if(BvhHelper::EnterBox(mNodes[child].BoundsMin, mNodes[child].BoundsMax, o, invDir, maxDist) < MathHelper::Infinity)
+					stack[stackSize++] = child;
+			}
+			continue;
+		}
+
+		UINT packetCount = (node.Count + 3) / 4;
+		for(UINT i = node.First; i < node.First + packetCount; ++i)
+		{
+			float dist = maxDist;
+			UINT lane = 0;
+			if(IntersectTrianglePacket(origin, dir, mPackets[i], dist, lane))
+				return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,100 @@
+//***************************************************************************************
+// TriangleBvh.h
+//
+// Bounding volume hierarchy over the triangles of a mesh, for ray queries such
+// as picking.  It is built once from the CPU copies of the vertex and index
+// buffers, splitting each node where the binned surface area heuristic is
+// cheapest, and keeps its own copy of the triangle positions in leaf order so a
+// query never touches the mesh buffers.
+//
+// Closest-hit queries visit the nearer child first and skip every node that is
+// entered beyond the closest hit found so far, which on typical meshes makes
+// the cost grow with the log of the triangle count instead of linearly.  Leaves
+// hold up to four triangles as one TrianglePacket, tested in a single call.
+//***************************************************************************************
+
+#pragma once
+
+#include "MathHelper.h"
+#include "RayTriangleSimd.h"
+#include <DirectXCollision.h>
+#include <vector>
+
+class TriangleBvh
+{
+public:
+	// Builds over the triangles of indices[startIndex, startIndex + indexCount),
+	// with baseVertex added to every index.  positions points at the position of
+	// vertex 0 and vertexStride is the size of a vertex in bytes.
+	void Build(const void* positions, UINT vertexStride,
+		const std::uint16_t* indices, UINT startIndex, UINT indexCount, INT baseVertex);
+	void Build(const void* positions, UINT vertexStride,
+		const std::uint32_t* indices, UINT startIndex, UINT indexCount, INT baseVertex);
+
+	void Clear();
+
+	bool Empty()const;
+	UINT TriangleCount()const;
+	UINT NodeCount()const;
+
+	// Box around every triangle, in the space the mesh was built in.
+	DirectX::BoundingBox GetBounds()const;
+
+	// Finds the nearest triangle hit by the ray nearer than dist, in the space
+	// the mesh was built in, and sets dist to its distance.  Distances are in
+	// units of dir's length, so a ray transformed into mesh space keeps the same
+	// distances if dir is not renormalized.  triangle is the index of the
+	// triangle in the whole index buffer, so its first index is at 3*triangle.
+	bool Intersects(DirectX::FXMVECTOR origin, DirectX::FXMVECTOR dir, float& dist, UINT& triangle)const;
+
+	// Returns true as soon as any triangle is hit nearer than maxDist, for
+	// visibility and shadow queries that do not need the nearest hit.
+	bool IntersectsAny(DirectX::FXMVECTOR origin, DirectX::FXMVECTOR dir, float maxDist)const;
+
+	// Intersects() for four rays at once, which pays off when they are coherent
+	// (close origins and directions) because they then visit mostly the same
+	// nodes.  dist is the maximum distance of each ray on input and the hit
+	// distance on output; bit i of the result is set if ray i hit, and
+	// triangle[i] is valid only then.
+	UINT IntersectPacket(const RayPacket& rays, DirectX::XMFLOAT4& dist, UINT triangle[4])const;
+
+private:
+	struct BuildTriangle
+	{
+		DirectX::XMFLOAT3 BoundsMin;
+		DirectX::XMFLOAT3 BoundsMax;
+		DirectX::XMFLOAT3 Centroid;
+		UINT Triangle;
+		UINT Vertices[3];
+	};
+
+	// Count = 0 marks an interior node whose children are First and First + 1;
+	// a leaf holds Count triangles, four per packet starting at packet First.
+	struct Node
+	{
+		DirectX::XMFLOAT3 BoundsMin;
+		UINT First = 0;
+		DirectX::XMFLOAT3 BoundsMax;
+		UINT Count = 0;
+	};
+
+	template<typename Index>
+	void BuildFromIndices(const void* positions, UINT vertexStride,
+		const Index* indices, UINT startIndex, UINT indexCount, INT baseVertex);
+
+	void BuildNode(std::vector<BuildTriangle>& tris, const void* positions, UINT vertexStride,
+		UINT node, UINT first, UINT count, UINT depth);
+
+	void MakeLeaf(std::vector<BuildTriangle>& tris, const void* positions, UINT vertexStride,
+		UINT node, UINT first, UINT count);
+
+private:
+	std::vector<Node> mNodes;
+
+	// Leaf triangles, and the index buffer triangle in each packet lane.  Unused
+	// lanes hold degenerate triangles.
+	std::vector<TrianglePacket> mPackets;
+	std::vector<UINT> mTriangles;
+
+	UINT mTriangleCount = 0;
+};
@@ -28,6 +28,7 @@
 #include "d3dx12.h"
 #include "DDSTextureLoader.h"
 #include "MathHelper.h"
+#include "TriangleBvh.h"
 
 extern const int gNumFrameResources;
 
@@ -184,6 +185,10 @@ struct MeshGeometry
 	// the Submeshes individually.
 	std::unordered_map<std::string, SubmeshGeometry> DrawArgs;
 
+	// Optional triangle BVHs over the system memory copies, keyed like DrawArgs,
+	// for ray queries such as picking.
+	std::unordered_map<std::string, TriangleBvh> TriangleBvhs;
+
 	D3D12_VERTEX_BUFFER_VIEW VertexBufferView()const
 	{
 		D3D12_VERTEX_BUFFER_VIEW vbv;
@@ -0,0 +1,275 @@
+//***************************************************************************************
+// BlockCompressorTests.cpp
+//
+// Encodes repository textures to every format BlockCompressor writes, logging the
+// PSNR and throughput of each, then saves them with their mips the way a tool
+// would and loads the files back through CreateDDSTextureFromFile12 on a
+// Direct3D 12 device (WARP if there is no hardware one).
+//***************************************************************************************
+
+#include "CommonTests.h"
+#include "../../Common/DDSTextureLoader.h"
+#include "../../Common/MipGenerator.h"
+#include "../../Common/ThreadPool.h"
+#include <d3d12.h>
+#include <dxgi1_4.h>
+#include <wrl.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+
+#pragma comment(lib, "D3D12.lib")
+#pragma comment(lib, "dxgi.lib")
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	struct CompressCase
+	{
+		const wchar_t* Filename;
+		DXGI_FORMAT Format;
+		double MinPsnr;
+	};
+
+	// WoodCrate01.dds was BC3 to begin with, so its colors already fit 4x4
+	// palettes and it keeps a high PSNR in every color format.  bricks_nmap.dds
+	// holds an uncompressed tangent-space normal map, which is what BC5 is for.
+	const CompressCase gCompressCases[] =
+	{
+		{ L"WoodCrate01.dds", DXGI_FORMAT_BC1_UNORM, 50.0 },
+		{ L"WoodCrate01.dds", DXGI_FORMAT_BC3_UNORM, 50.0 },
+		{ L"WoodCrate01.dds", DXGI_FORMAT_BC4_UNORM, 42.0 },
+		{ L"WoodCrate01.dds", DXGI_FORMAT_BC7_UNORM, 48.0 },
+		{ L"bricks_nmap.dds", DXGI_FORMAT_BC5_UNORM, 38.0 }
+	};
+
+	const char* FormatName(DXGI_FORMAT format)
+	{
+		switch(format)
+		{
+		case DXGI_FORMAT_BC1_UNORM: return "BC1";
+		case DXGI_FORMAT_BC3_UNORM: return "BC3";
+		case DXGI_FORMAT_BC4_UNORM: return "BC4";
+		case DXGI_FORMAT_BC5_UNORM: return "BC5";
+		case DXGI_FORMAT_BC7_UNORM: return "BC7";
+		default: return "?";
+		}
+	}
+
+	// A smooth gradient that BC1 cannot reproduce exactly, so it loses a little.
+	ImageRGBA8 MakeGradient(UINT width, UINT height)
+	{
+		ImageRGBA8 image;
+		image.Width = width;
+		image.Height = height;
+		image.Texels.resize((size_t)width*height*4);
+		for(UINT y = 0; y < height; ++y)
+		{
+			for(UINT x = 0; x < width; ++x)
+			{
+				uint8_t* texel = &image.Texels[((size_t)y*width + x)*4];
+				texel[0] = (uint8_t)(x*7 + y*3);
+				texel[1] = (uint8_t)(x*y);
+				texel[2] = (uint8_t)(255 - y*5);
+				texel[3] = 255;
+			}
+		}
+		return image;
+	}
+
+	std::string Narrow(const std::wstring& s)
+	{
+		return std::string(s.begin(), s.end());
+	}
+
+	// A device with a queue and command list to record texture uploads on.
+	struct UploadContext
+	{
+		ComPtr<ID3D12Device> Device;
+		ComPtr<ID3D12CommandQueue> Queue;
+		ComPtr<ID3D12CommandAllocator> Allocator;
+		ComPtr<ID3D12GraphicsCommandList> CommandList;
+		ComPtr<ID3D12Fence> Fence;
+		UINT64 FenceValue = 0;
+	};
+
+	bool CreateUploadContext(UploadContext& context)
+	{
+		ComPtr<IDXGIFactory4> factory;
+		if(FAILED(CreateDXGIFactory1(IID_PPV_ARGS(&factory))))
+			return false;
+
+		// Fall back to WARP, so the test also runs without a Direct3D 12 GPU.
+		if(FAILED(D3D12CreateDevice(nullptr, D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&context.Device))))
+		{
+			ComPtr<IDXGIAdapter> warpAdapter;
+			if(FAILED(factory->EnumWarpAdapter(IID_PPV_ARGS(&warpAdapter))) ||
+				FAILED(D3D12CreateDevice(warpAdapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&context.Device))))
+			{
+				return false;
+			}
+		}
+
+		D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+		queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+		queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+
+		return SUCCEEDED(context.Device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&context.Queue))) &&
+			SUCCEEDED(context.Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT,
+				IID_PPV_ARGS(&context.Allocator))) &&
+			SUCCEEDED(context.Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT,
+				context.Allocator.Get(), nullptr, IID_PPV_ARGS(&context.CommandList))) &&
+			SUCCEEDED(context.CommandList->Close()) &&
+			SUCCEEDED(context.Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&context.Fence)));
+	}
+
+	// Loads filename with CreateDDSTextureFromFile12, runs the upload and waits
+	// for it.  Returns the texture's description.
+	bool ReloadTexture(UploadContext& context, const std::wstring& filename, D3D12_RESOURCE_DESC& desc)
+	{
+		if(FAILED(context.Allocator->Reset()) ||
+			FAILED(context.CommandList->Reset(context.Allocator.Get(), nullptr)))
+		{
+			return false;
+		}
+
+		ComPtr<ID3D12Resource> texture;
+		ComPtr<ID3D12Resource> uploadHeap;
+		HRESULT hr = CreateDDSTextureFromFile12(context.Device.Get(), context.CommandList.Get(),
+			filename.c_str(), texture, uploadHeap);
+
+		if(FAILED(context.CommandList->Close()) || FAILED(hr))
+			return false;
+
+		ID3D12CommandList* cmdsLists[] = { context.CommandList.Get() };
+		context.Queue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+
+		// The upload heap has to outlive the copy.
+		context.FenceValue++;
+		if(FAILED(context.Queue->Signal(context.Fence.Get(), context.FenceValue)))
+			return false;
+
+		if(context.Fence->GetCompletedValue() < context.FenceValue)
+		{
+			HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
+			context.Fence->SetEventOnCompletion(context.FenceValue, eventHandle);
+			WaitForSingleObject(eventHandle, INFINITE);
+			CloseHandle(eventHandle);
+		}
+
+		desc = texture->GetDesc();
+		return context.Device->GetDeviceRemovedReason() == S_OK;
+	}
+
+	bool ReadFile(const std::wstring& filename, std::vector<uint8_t>& data)
+	{
+		std::ifstream fin(filename, std::ios::binary);
+		if(!fin)
+			return false;
+
+		data.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+		return true;
+	}
+}
+
+void RunBlockCompressorTests(TestReport& report)
+{
+	report.BeginSuite("BlockCompressor");
+
+	ThreadPool& threadPool = ThreadPool::Default();
+
+	UploadContext context;
+	bool haveDevice = report.Check(CreateUploadContext(context), "a Direct3D 12 device is available");
+
+	for(const CompressCase& test : gCompressCases)
+	{
+		std::string name = Narrow(test.Filename) + " as " + FormatName(test.Format);
+
+		ImageRGBA8 image;
+		if(!report.Check(MipGenerator::LoadDDSImage(std::wstring(L"../../Textures/") + test.Filename, image),
+			Narrow(test.Filename) + " loads"))
+		{
+			continue;
+		}
+
+		std::vector<uint8_t> blocks;
+		BlockCompressionStats stats;
+		if(!report.Check(BlockCompressor::Compress(image, test.Format, blocks, threadPool, &stats), name + " compresses"))
+			continue;
+
+		report.Log() << name << ": " << stats.Psnr << " dB, " << stats.MPixelsPerSecond << " MPix/s" << std::endl;
+		report.Check(stats.Psnr >= test.MinPsnr, name + " keeps a PSNR of at least " + std::to_string((int)test.MinPsnr) + " dB");
+		report.Check(stats.MPixelsPerSecond > 0.0, name + " reports its throughput");
+
+		//
+		// Written with mips as a tool would, the file describes what was written
+		// and holds the blocks Compress returned as its top mip.
+		//
+
+		std::vector<ImageRGBA8> mips;
+		MipGenerator::GenerateMips(image, MipFilter::Box, false, mips, threadPool);
+
+		const std::wstring outFilename = L"BlockCompressorTest.dds";
+		if(!report.Check(MipGenerator::SaveDDSTexture(outFilename, mips, test.Format, false, threadPool),
+			name + " is saved"))
+		{
+			continue;
+		}
+
+		std::vector<uint8_t> data;
+		const DDS_HEADER* header = nullptr;
+		size_t bitOffset = 0;
+		DDS_TEXTURE_DESC desc;
+		bool fileMatches = ReadFile(outFilename, data) &&
+			ParseDDSHeader(data.data(), data.size(), &header, &bitOffset) == DDS_RESULT_OK &&
+			GetDDSTextureDesc(header, &desc) == DDS_RESULT_OK &&
+			desc.format == test.Format && desc.width == image.Width && desc.height == image.Height &&
+			desc.mipCount == mips.size() &&
+			data.size() - bitOffset >= blocks.size() &&
+			std::equal(blocks.begin(), blocks.end(), data.begin() + bitOffset);
+		report.Check(fileMatches, name + " is written with its mips and the compressed blocks");
+
+		//
+		// The loader takes the file as written.
+		//
+
+		if(haveDevice)
+		{
+			D3D12_RESOURCE_DESC textureDesc;
+			bool reloaded = ReloadTexture(context, outFilename, textureDesc);
+			report.Check(reloaded && textureDesc.Format == test.Format && textureDesc.Width == image.Width &&
+				textureDesc.Height == image.Height && textureDesc.MipLevels == mips.size(),
+				name + " loads through CreateDDSTextureFromFile12");
+		}
+
+		DeleteFileW(outFilename.c_str());
+	}
+
+	//
+	// Texels BC1 makes transparent lose their color by design, so they do not
+	// count toward its PSNR: an image whose right half is cut out rates the same
+	// as its left half alone.
+	//
+	{
+		ImageRGBA8 half = MakeGradient(16, 32);
+		ImageRGBA8 cutOut = MakeGradient(32, 32);
+		for(UINT y = 0; y < cutOut.Height; ++y)
+		{
+			for(UINT x = half.Width; x < cutOut.Width; ++x)
+				cutOut.Texels[((size_t)y*cutOut.Width + x)*4 + 3] = 0;
+		}
+
+		std::vector<uint8_t> blocks;
+		BlockCompressionStats halfStats;
+		BlockCompressionStats cutOutStats;
+		bool compressed = BlockCompressor::Compress(half, DXGI_FORMAT_BC1_UNORM, blocks, threadPool, &halfStats) &&
+			BlockCompressor::Compress(cutOut, DXGI_FORMAT_BC1_UNORM, blocks, threadPool, &cutOutStats);
+
+		report.Log() << "BC1 gradient: " << halfStats.Psnr << " dB, with a cut-out half " << cutOutStats.Psnr << " dB" << std::endl;
+		report.Check(compressed && std::isfinite(halfStats.Psnr) && fabs(cutOutStats.Psnr - halfStats.Psnr) < 1e-6,
+			"BC1 PSNR leaves out the texels it makes transparent");
+	}
+}
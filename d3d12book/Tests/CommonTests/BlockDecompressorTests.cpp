@@ -0,0 +1,720 @@
+//***************************************************************************************
+// BlockDecompressorTests.cpp
+//
+// Decodes every subresource of the repository's BC1, BC2 and BC3 textures as the
+// loader lays them out and compares texels and channel means with values taken
+// from an integer reference decoder.  The Direct3D spec lets a decoder be one step
+// off per channel, so texels may differ by 1 and means by as much.
+//
+// There are no BC4, BC5 or BC7 files in the repository, so those formats, and BC1
+// and BC3 again, are checked by round trips through BlockCompressor.
+//
+// Single blocks of every BC6H and BC7 mode, reserved ones included, and of BC4 and
+// BC5 SNORM are checked against known answers.  The BC7 and SNORM texels come from
+// Pillow's BCn decoder, give or take its rounding of SNORM palettes.  Pillow gets
+// BC6H_SF16 wrong, so the BC6H halves come from a decoder written out from the
+// format's documentation, which agrees with Pillow on BC6H_UF16 blocks of all 14
+// modes.
+//***************************************************************************************
+
+#include "CommonTests.h"
+#include "../../Common/BlockDecompressor.h"
+#include "../../Common/ThreadPool.h"
+#include <DirectXPackedVector.h>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <limits>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	struct KnownTexel
+	{
+		UINT X;
+		UINT Y;
+		uint8_t Rgba[4];
+	};
+
+	struct DDSFileCase
+	{
+		const char* Filename;
+		DXGI_FORMAT Format;
+		UINT Width;
+		UINT Height;
+		UINT ArraySize;
+		UINT MipCount;
+
+		// Of the top mip of the first slice.
+		float Mean[4];
+		KnownTexel Texels[4];
+
+		// The single texel of the last subresource.
+		uint8_t LastTexel[4];
+	};
+
+	const DDSFileCase gFileCases[] =
+	{
+		{ "stone.dds", DXGI_FORMAT_BC1_UNORM, 512, 512, 1, 1,
+			{ 111.29f, 106.93f, 94.23f, 255.0f },
+			{ { 0, 0, { 115, 108, 96, 255 } }, { 256, 256, { 132, 130, 115, 255 } },
+			  { 128, 384, { 123, 117, 107, 255 } }, { 511, 511, { 123, 119, 107, 255 } } },
+			{ 115, 108, 96, 255 } },
+		{ "water1.dds", DXGI_FORMAT_BC1_UNORM, 256, 256, 1, 9,
+			{ 59.74f, 114.39f, 158.36f, 255.0f },
+			{ { 0, 0, { 41, 101, 148, 255 } }, { 128, 128, { 33, 73, 156, 255 } },
+			  { 64, 192, { 49, 113, 148, 255 } }, { 255, 255, { 52, 106, 151, 255 } } },
+			{ 63, 116, 162, 255 } },
+		{ "tree01S.dds", DXGI_FORMAT_BC2_UNORM, 208, 256, 1, 1,
+			{ 20.68f, 25.53f, 15.12f, 102.90f },
+			{ { 0, 0, { 0, 0, 0, 0 } }, { 104, 128, { 35, 38, 24, 255 } },
+			  { 52, 192, { 8, 12, 8, 17 } }, { 207, 255, { 0, 0, 0, 0 } } },
+			{ 0, 0, 0, 0 } },
+		{ "tree35S.dds", DXGI_FORMAT_BC2_UNORM, 228, 336, 1, 1,
+			{ 39.75f, 43.16f, 25.15f, 104.57f },
+			{ { 0, 0, { 0, 0, 0, 0 } }, { 114, 168, { 66, 81, 41, 221 } },
+			  { 57, 252, { 52, 68, 30, 238 } }, { 227, 335, { 0, 0, 0, 0 } } },
+			{ 0, 0, 0, 0 } },
+		{ "WoodCrate01.dds", DXGI_FORMAT_BC3_UNORM, 512, 512, 1, 10,
+			{ 141.65f, 135.56f, 122.86f, 255.0f },
+			{ { 0, 0, { 165, 169, 159, 255 } }, { 256, 256, { 175, 169, 151, 255 } },
+			  { 128, 384, { 137, 129, 121, 255 } }, { 511, 511, { 107, 116, 107, 255 } } },
+			{ 143, 136, 123, 255 } },
+		{ "WireFence.dds", DXGI_FORMAT_BC3_UNORM, 512, 512, 1, 10,
+			{ 71.22f, 71.16f, 70.43f, 80.79f },
+			{ { 0, 0, { 99, 100, 99, 0 } }, { 256, 256, { 99, 100, 99, 0 } },
+			  { 128, 384, { 49, 48, 49, 127 } }, { 511, 511, { 99, 100, 99, 0 } } },
+			{ 74, 73, 74, 81 } },
+		{ "treearray.dds", DXGI_FORMAT_BC3_UNORM, 512, 512, 3, 10,
+			{ 12.77f, 14.74f, 7.79f, 41.72f },
+			{ { 0, 0, { 0, 0, 0, 0 } }, { 256, 256, { 90, 91, 90, 255 } },
+			  { 128, 384, { 0, 0, 0, 0 } }, { 511, 511, { 0, 0, 0, 0 } } },
+			{ 49, 69, 25, 76 } },
+	};
+
+	// A block of each BC6H mode, numbered as in the documentation, with the halves
+	// of the texels it decodes to as BC6H_UF16 and as BC6H_SF16.
+	struct Bc6hCase
+	{
+		const char* Name;
+		uint8_t Block[16];
+		uint16_t UnsignedTexels[16][3];
+		uint16_t SignedTexels[16][3];
+	};
+
+	const Bc6hCase gBc6hCases[] =
+	{
+		{ "mode 1", { 0x7C, 0xDB, 0x44, 0x5D, 0xA3, 0xE4, 0x3E, 0xB1, 0x79, 0xC4, 0xF8, 0x54, 0x15, 0x89, 0x51, 0x39 },
+			{ { 0x582B, 0x4E58, 0x3432 }, { 0x5720, 0x4D8F, 0x345F }, { 0x5860, 0x4E7F, 0x342A }, { 0x5923, 0x4EC8, 0x333E },
+			  { 0x582B, 0x4E58, 0x3432 }, { 0x5789, 0x4DDD, 0x344E }, { 0x5881, 0x4DAB, 0x3390 }, { 0x58EF, 0x4E6C, 0x3358 },
+			  { 0x57BD, 0x4E05, 0x3445 }, { 0x5818, 0x4CF4, 0x33C4 }, { 0x58B5, 0x4E07, 0x3376 }, { 0x58EF, 0x4E6C, 0x3358 },
+			  { 0x5881, 0x4DAB, 0x3390 }, { 0x584C, 0x4D50, 0x33AA }, { 0x598C, 0x4F7F, 0x330A }, { 0x5818, 0x4CF4, 0x33C4 } },
+			{ { 0xC7E6, 0xDB8D, 0x6865 }, { 0xC9FD, 0xDD1F, 0x68BF }, { 0xC77D, 0xDB3F, 0x6854 }, { 0xC5F6, 0xDAAD, 0x667D },
+			  { 0xC7E6, 0xDB8D, 0x6865 }, { 0xC92B, 0xDC82, 0x689C }, { 0xC73B, 0xDCE6, 0x6720 }, { 0xC65E, 0xDB64, 0x66B1 },
+			  { 0xC8C3, 0xDC33, 0x688A }, { 0xC80D, 0xDE55, 0x6789 }, { 0xC6D3, 0xDC2F, 0x66EC }, { 0xC65E, 0xDB64, 0x66B1 },
+			  { 0xC73B, 0xDCE6, 0x6720 }, { 0xC7A4, 0xDD9D, 0x6754 }, { 0xC525, 0xD93F, 0x6615 }, { 0xC80D, 0xDE55, 0x6789 } } },
+		{ "mode 2", { 0xAD, 0x8E, 0x15, 0xEE, 0x27, 0x58, 0xD3, 0x19, 0xFA, 0x58, 0x51, 0x38, 0x30, 0x11, 0xF8, 0xDD },
+			{ { 0x71D4, 0x2A24, 0x73C4 }, { 0x749D, 0x3C3E, 0x6AB6 }, { 0x71D4, 0x2A24, 0x73C4 }, { 0x7528, 0x3FC9, 0x68F1 },
+			  { 0x725F, 0x2DAE, 0x71FE }, { 0x71D4, 0x2A24, 0x73C4 }, { 0x7528, 0x3FC9, 0x68F1 }, { 0x6833, 0x3087, 0x6F49 },
+			  { 0x71D4, 0x2A24, 0x73C4 }, { 0x6D49, 0x1D08, 0x72AD }, { 0x6EEC, 0x16C4, 0x73C4 }, { 0x64EE, 0x3D0F, 0x6D1B },
+			  { 0x634C, 0x4354, 0x6C04 }, { 0x6691, 0x36CB, 0x6E32 }, { 0x6A04, 0x2990, 0x707F }, { 0x6A04, 0x2990, 0x707F } },
+			{ { 0x9648, 0x5448, 0x9268 }, { 0x90B6, 0xBB27, 0xA482 }, { 0x9648, 0x5448, 0x9268 }, { 0x8F9F, 0xD737, 0xA80D },
+			  { 0x9531, 0x3837, 0x95F2 }, { 0x9648, 0x5448, 0x9268 }, { 0x8F9F, 0xD737, 0xA80D }, { 0xA989, 0xAF70, 0x9B5E },
+			  { 0x9648, 0x5448, 0x9268 }, { 0x9F5D, 0x16EA, 0x9496 }, { 0x9C18, 0x2D88, 0x9268 }, { 0xB013, 0xDCAA, 0x9FBA },
+			  { 0xB358, 0xF348, 0xA1E8 }, { 0xACCE, 0xC60D, 0x9D8C }, { 0xA5E7, 0x964F, 0x98F2 }, { 0xA5E7, 0x964F, 0x98F2 } } },
+		{ "mode 3", { 0x42, 0xFC, 0x9A, 0xE4, 0x9B, 0x6D, 0xA2, 0x16, 0xEA, 0xED, 0xF6, 0x10, 0xB1, 0x9A, 0xD3, 0x55 },
+			{ { 0x7A1A, 0x50C4, 0x1E28 }, { 0x79E9, 0x50FB, 0x1E8B }, { 0x7999, 0x5115, 0x1E3B }, { 0x79C2, 0x5108, 0x1E64 },
+			  { 0x7A36, 0x50BD, 0x1E2E }, { 0x7A1A, 0x50C4, 0x1E28 }, { 0x79DC, 0x50FF, 0x1E7E }, { 0x79A6, 0x5111, 0x1E48 },
+			  { 0x79A5, 0x50DE, 0x1E0D }, { 0x7A1A, 0x50C4, 0x1E28 }, { 0x79E9, 0x50FB, 0x1E8B }, { 0x79C2, 0x5108, 0x1E64 },
+			  { 0x7989, 0x50E5, 0x1E07 }, { 0x79A5, 0x50DE, 0x1E0D }, { 0x79FE, 0x50CA, 0x1E21 }, { 0x7999, 0x5115, 0x1E3B } },
+			{ { 0x83E9, 0xD696, 0x3C50 }, { 0x844C, 0xD628, 0x3D17 }, { 0x84EC, 0xD5F3, 0x3C77 }, { 0x849A, 0xD60E, 0x3CC9 },
+			  { 0x83B1, 0xD6A4, 0x3C5D }, { 0x83E9, 0xD696, 0x3C50 }, { 0x8466, 0xD61F, 0x3CFD }, { 0x84D2, 0xD5FB, 0x3C91 },
+			  { 0x84D3, 0xD661, 0x3C1A }, { 0x83E9, 0xD696, 0x3C50 }, { 0x844C, 0xD628, 0x3D17 }, { 0x849A, 0xD60E, 0x3CC9 },
+			  { 0x850B, 0xD654, 0x3C0E }, { 0x84D3, 0xD661, 0x3C1A }, { 0x8422, 0xD68A, 0x3C43 }, { 0x84EC, 0xD5F3, 0x3C77 } } },
+		{ "mode 4", { 0xE6, 0x71, 0x45, 0xE7, 0xB1, 0x94, 0x75, 0x20, 0x45, 0x9F, 0x35, 0x88, 0x94, 0x1F, 0x69, 0xAE },
+			{ { 0x753D, 0x657C, 0x0EBE }, { 0x7557, 0x65B1, 0x0EBE }, { 0x7530, 0x6562, 0x0EBE }, { 0x753D, 0x655C, 0x0E5E },
+			  { 0x7566, 0x65CE, 0x0EBE }, { 0x752B, 0x65B8, 0x0E6C }, { 0x753D, 0x655C, 0x0E5E }, { 0x7519, 0x6610, 0x0E79 },
+			  { 0x7511, 0x663B, 0x0E80 }, { 0x7546, 0x6531, 0x0E58 }, { 0x753D, 0x655C, 0x0E5E }, { 0x753D, 0x655C, 0x0E5E },
+			  { 0x7535, 0x6588, 0x0E65 }, { 0x7519, 0x6610, 0x0E79 }, { 0x7522, 0x65E4, 0x0E73 }, { 0x753D, 0x655C, 0x0E5E } },
+			{ { 0x8DA4, 0xAD25, 0x1D7C }, { 0x8D70, 0xACBC, 0x1D7C }, { 0x8DBE, 0xAD59, 0x1D7C }, { 0x8DA3, 0xAD65, 0x1CBD },
+			  { 0x8D52, 0xAC82, 0x1D7C }, { 0x8DC8, 0xACAD, 0x1CD9 }, { 0x8DA3, 0xAD65, 0x1CBD }, { 0x8DEB, 0xABFE, 0x1CF3 },
+			  { 0x8DFC, 0xABA7, 0x1D00 }, { 0x8D91, 0xADBC, 0x1CB1 }, { 0x8DA3, 0xAD65, 0x1CBD }, { 0x8DA3, 0xAD65, 0x1CBD },
+			  { 0x8DB4, 0xAD0D, 0x1CCB }, { 0x8DEB, 0xABFE, 0x1CF3 }, { 0x8DD9, 0xAC55, 0x1CE6 }, { 0x8DA3, 0xAD65, 0x1CBD } } },
+		{ "mode 5", { 0xCA, 0x88, 0xD1, 0xAC, 0x20, 0x7F, 0x92, 0xD3, 0x84, 0x4C, 0x17, 0xDB, 0x5E, 0xC2, 0x84, 0x26 },
+			{ { 0x044D, 0x576D, 0x434C }, { 0x0450, 0x575D, 0x4294 }, { 0x043C, 0x5763, 0x4287 }, { 0x0471, 0x5787, 0x438A },
+			  { 0x0471, 0x5787, 0x438A }, { 0x03FF, 0x5778, 0x425E }, { 0x03D8, 0x5785, 0x4244 }, { 0x0456, 0x5773, 0x435B },
+			  { 0x0456, 0x5773, 0x435B }, { 0x0463, 0x5756, 0x42A1 }, { 0x0429, 0x576A, 0x427A }, { 0x0456, 0x5773, 0x435B },
+			  { 0x0444, 0x5766, 0x433C }, { 0x03FF, 0x5778, 0x425E }, { 0x0450, 0x575D, 0x4294 }, { 0x044D, 0x576D, 0x434C } },
+			{ { 0x089A, 0xC944, 0xF186 }, { 0x08A0, 0xC963, 0xF2F5 }, { 0x0879, 0xC957, 0xF30F }, { 0x08E2, 0xC90F, 0xF109 },
+			  { 0x08E2, 0xC90F, 0xF109 }, { 0x07FE, 0xC92E, 0xF361 }, { 0x07B0, 0xC914, 0xF395 }, { 0x08AC, 0xC938, 0xF168 },
+			  { 0x08AC, 0xC938, 0xF168 }, { 0x08C7, 0xC971, 0xF2DB }, { 0x0852, 0xC949, 0xF329 }, { 0x08AC, 0xC938, 0xF168 },
+			  { 0x0889, 0xC952, 0xF1A5 }, { 0x07FE, 0xC92E, 0xF361 }, { 0x08A0, 0xC963, 0xF2F5 }, { 0x089A, 0xC944, 0xF186 } } },
+		{ "mode 6", { 0x0E, 0x5B, 0x02, 0xE7, 0x96, 0xAE, 0x69, 0x79, 0xFA, 0xCA, 0xD9, 0xA7, 0xD4, 0x89, 0xCD, 0xF8 },
+			{ { 0x337A, 0x01F9, 0x5904 }, { 0x31FF, 0x035A, 0x5789 }, { 0x310B, 0x043D, 0x5695 }, { 0x33F4, 0x0188, 0x597E },
+			  { 0x3250, 0x259D, 0x5758 }, { 0x3296, 0x364D, 0x573E }, { 0x3329, 0x5988, 0x5707 }, { 0x31C5, 0x043D, 0x578D },
+			  { 0x3296, 0x364D, 0x573E }, { 0x33B5, 0x7AE9, 0x56D3 }, { 0x32E3, 0x48D8, 0x5721 }, { 0x32E3, 0x48D8, 0x5721 },
+			  { 0x320A, 0x14ED, 0x5772 }, { 0x33B5, 0x7AE9, 0x56D3 }, { 0x31C5, 0x043D, 0x578D }, { 0x32E3, 0x48D8, 0x5721 } },
+			{ { 0x66F5, 0x03F3, 0xC672 }, { 0x63FE, 0x06B4, 0xC969 }, { 0x6216, 0x087A, 0xCB52 }, { 0x67E9, 0x0310, 0xC57E },
+			  { 0x64A1, 0x0557, 0xC9CA }, { 0x652C, 0x03C6, 0xC9FE }, { 0x6653, 0x0078, 0xCA6D }, { 0x638A, 0x087A, 0xC962 },
+			  { 0x652C, 0x03C6, 0xC9FE }, { 0x676A, 0x82AA, 0xCAD6 }, { 0x65C7, 0x0209, 0xCA39 }, { 0x65C7, 0x0209, 0xCA39 },
+			  { 0x6415, 0x06E8, 0xC996 }, { 0x676A, 0x82AA, 0xCAD6 }, { 0x638A, 0x087A, 0xC962 }, { 0x65C7, 0x0209, 0xCA39 } } },
+		{ "mode 7", { 0x32, 0x29, 0xB9, 0x92, 0x19, 0xD6, 0x23, 0x41, 0x60, 0xCF, 0x3E, 0x56, 0x08, 0xA1, 0x84, 0x0C },
+			{ { 0x2436, 0x370D, 0x6202 }, { 0x2436, 0x370D, 0x6202 }, { 0x2471, 0x36E6, 0x6229 }, { 0x24A5, 0x36C3, 0x624C },
+			  { 0x2402, 0x3730, 0x61DF }, { 0x239A, 0x3776, 0x619A }, { 0x23CE, 0x3753, 0x61BC }, { 0x2471, 0x36E6, 0x6229 },
+			  { 0x1BDA, 0x3CCA, 0x6292 }, { 0x2471, 0x36E6, 0x6229 }, { 0x2402, 0x3730, 0x61DF }, { 0x2402, 0x3730, 0x61DF },
+			  { 0x1BDA, 0x3CCA, 0x6292 }, { 0x1EFC, 0x3B38, 0x62B4 }, { 0x2436, 0x370D, 0x6202 }, { 0x239A, 0x3776, 0x619A } },
+			{ { 0x486D, 0x6E1A, 0xB4F2 }, { 0x486D, 0x6E1A, 0xB4F2 }, { 0x48E2, 0x6DCD, 0xB4A5 }, { 0x494A, 0x6D87, 0xB45F },
+			  { 0x4805, 0x6E60, 0xB538 }, { 0x4734, 0x6EEC, 0xB5C4 }, { 0x479C, 0x6EA6, 0xB57E }, { 0x48E2, 0x6DCD, 0xB4A5 },
+			  { 0x37B4, 0x7994, 0xB3D4 }, { 0x48E2, 0x6DCD, 0xB4A5 }, { 0x4805, 0x6E60, 0xB538 }, { 0x4805, 0x6E60, 0xB538 },
+			  { 0x37B4, 0x7994, 0xB3D4 }, { 0x3DF8, 0x7671, 0xB38E }, { 0x486D, 0x6E1A, 0xB4F2 }, { 0x4734, 0x6EEC, 0xB5C4 } } },
+		{ "mode 8", { 0xF6, 0xDA, 0x14, 0xA5, 0x3C, 0xAE, 0xED, 0x43, 0x87, 0x6B, 0x77, 0x93, 0x6B, 0xC4, 0xD2, 0x64 },
+			{ { 0x68DC, 0x12CE, 0x2870 }, { 0x6BC6, 0x0AE6, 0x2B5A }, { 0x6833, 0x1DE1, 0x23B1 }, { 0x6904, 0x1E8F, 0x245F },
+			  { 0x68DC, 0x12CE, 0x2870 }, { 0x6406, 0x1A66, 0x2036 }, { 0x6833, 0x1DE1, 0x23B1 }, { 0x69D0, 0x1038, 0x2964 },
+			  { 0x6A57, 0x0EC7, 0x29EB }, { 0x69D6, 0x1F3E, 0x250E }, { 0x6762, 0x1D32, 0x2302 }, { 0x68DC, 0x12CE, 0x2870 },
+			  { 0x65A8, 0x1BC2, 0x2192 }, { 0x6904, 0x1E8F, 0x245F }, { 0x68DC, 0x12CE, 0x2870 }, { 0x69D0, 0x1038, 0x2964 } },
+			{ { 0xA73F, 0x259D, 0x50E0 }, { 0xA16C, 0x15CC, 0x56B4 }, { 0xA891, 0x3BC2, 0x4762 }, { 0xA6EE, 0x3D1F, 0x48BF },
+			  { 0xA73F, 0x259D, 0x50E0 }, { 0xB0EC, 0x34CC, 0x406C }, { 0xA891, 0x3BC2, 0x4762 }, { 0xA557, 0x2070, 0x52C8 },
+			  { 0xA448, 0x1D8F, 0x53D7 }, { 0xA54C, 0x3E7C, 0x4A1C }, { 0xAA33, 0x3A65, 0x4605 }, { 0xA73F, 0x259D, 0x50E0 },
+			  { 0xADA7, 0x3785, 0x4325 }, { 0xA6EE, 0x3D1F, 0x48BF }, { 0xA73F, 0x259D, 0x50E0 }, { 0xA557, 0x2070, 0x52C8 } } },
+		{ "mode 9", { 0x7A, 0x16, 0x67, 0x1F, 0x5C, 0x0D, 0xC6, 0xC7, 0x04, 0x11, 0x71, 0xAA, 0xA3, 0x91, 0x02, 0x4E },
+			{ { 0x56F2, 0x6406, 0x0782 }, { 0x5C46, 0x5C46, 0x0EC6 }, { 0x5A06, 0x5F8B, 0x0BB5 }, { 0x5871, 0x61D8, 0x098D },
+			  { 0x5AC6, 0x5E74, 0x0CBA }, { 0x5931, 0x60C1, 0x0A92 }, { 0x5A06, 0x5F8B, 0x0BB5 }, { 0x5B86, 0x5D5D, 0x0DC0 },
+			  { 0x56F2, 0x6406, 0x0782 }, { 0x57B1, 0x62EF, 0x0887 }, { 0x5AC6, 0x5E74, 0x0CBA }, { 0x57EA, 0x5F2E, 0x0A6A },
+			  { 0x56F2, 0x6406, 0x0782 }, { 0x5B86, 0x5D5D, 0x0DC0 }, { 0x57EA, 0x5F50, 0x0BB5 }, { 0x57EA, 0x5F50, 0x0BB5 } },
+			{ { 0xCB14, 0xB0EC, 0x0F04 }, { 0xC06C, 0xC06C, 0x1D8C }, { 0xC4EA, 0xB9E2, 0x176A }, { 0xC814, 0xB548, 0x131A },
+			  { 0xC36B, 0xBC10, 0x1975 }, { 0xC695, 0xB776, 0x1525 }, { 0xC4EA, 0xB9E2, 0x176A }, { 0xC1EB, 0xBE3E, 0x1B80 },
+			  { 0xCB14, 0xB0EC, 0x0F04 }, { 0xC994, 0xB31A, 0x110F }, { 0xC36B, 0xBC10, 0x1975 }, { 0xC924, 0xBA9C, 0x14D4 },
+			  { 0xCB14, 0xB0EC, 0x0F04 }, { 0xC1EB, 0xBE3E, 0x1B80 }, { 0xC924, 0xBA56, 0x176A }, { 0xC924, 0xBA56, 0x176A } } },
+		{ "mode 10", { 0x5E, 0xDA, 0x58, 0x8A, 0xA5, 0xAF, 0x84, 0xE4, 0x7F, 0x16, 0x4D, 0x28, 0x6E, 0x32, 0xED, 0xFD },
+			{ { 0x3FA2, 0x5619, 0x0DED }, { 0x49ED, 0x5277, 0x0F23 }, { 0x23D8, 0x5FE8, 0x0AA8 }, { 0x365F, 0x595E, 0x0CD6 },
+			  { 0x2D1B, 0x5CA3, 0x0BBF }, { 0x5C74, 0x4BED, 0x1151 }, { 0x5331, 0x4F32, 0x103A }, { 0x2D1B, 0x5CA3, 0x0BBF },
+			  { 0x2D1B, 0x5CA3, 0x0BBF }, { 0x3FA2, 0x5619, 0x0DED }, { 0x365F, 0x595E, 0x0CD6 }, { 0x6C0F, 0x300B, 0x5C87 },
+			  { 0x65B8, 0x48A8, 0x1268 }, { 0x5331, 0x4F32, 0x103A }, { 0x5638, 0x5DF8, 0x3168 }, { 0x6C0F, 0x300B, 0x5C87 } },
+			{ { 0x1502, 0xCFAE, 0x1BDA }, { 0x023D, 0xD6F2, 0x1E46 }, { 0x47B0, 0xBC10, 0x1550 }, { 0x25E7, 0xC924, 0x19AC },
+			  { 0x36CB, 0xC29A, 0x177E }, { 0x9F8B, 0xE406, 0x22A2 }, { 0x8EA7, 0xDD7C, 0x2074 }, { 0x36CB, 0xC29A, 0x177E },
+			  { 0x36CB, 0xC29A, 0x177E }, { 0x1502, 0xCFAE, 0x1BDA }, { 0x25E7, 0xC924, 0x19AC }, { 0xA4DF, 0x8A2C, 0x2653 },
+			  { 0xB070, 0xEA90, 0x24D0 }, { 0x8EA7, 0xDD7C, 0x2074 }, { 0xCF70, 0xBFF0, 0x62D0 }, { 0xA4DF, 0x8A2C, 0x2653 } } },
+		{ "mode 11", { 0x03, 0x2D, 0x80, 0x0D, 0x3D, 0x94, 0xE6, 0xB5, 0xFE, 0x4E, 0xB2, 0x96, 0x06, 0x26, 0x7E, 0x67 },
+			{ { 0x3BF1, 0x6003, 0x3E39 }, { 0x4E68, 0x635B, 0x2C04 }, { 0x4C3C, 0x62F6, 0x2E28 }, { 0x34E2, 0x5EBB, 0x452F },
+			  { 0x308A, 0x5DF2, 0x4977 }, { 0x452D, 0x61AF, 0x351E }, { 0x39C5, 0x5F9E, 0x405D }, { 0x404A, 0x60CC, 0x39F0 },
+			  { 0x39C5, 0x5F9E, 0x405D }, { 0x2BA7, 0x5D0F, 0x4E49 }, { 0x39C5, 0x5F9E, 0x405D }, { 0x308A, 0x5DF2, 0x4977 },
+			  { 0x4C3C, 0x62F6, 0x2E28 }, { 0x3BF1, 0x6003, 0x3E39 }, { 0x3BF1, 0x6003, 0x3E39 }, { 0x39C5, 0x5F9E, 0x405D } },
+			{ { 0x0386, 0xB837, 0x876E }, { 0xDB6D, 0xB187, 0x5809 }, { 0xD041, 0xB250, 0x4CCD }, { 0x27D5, 0xBAC6, 0xABEF },
+			  { 0x3E2C, 0xBC59, 0xC265 }, { 0xABF3, 0xB4DF, 0x284D }, { 0x0EB2, 0xB901, 0x92A9 }, { 0x92D0, 0xB6A4, 0x0F07 },
+			  { 0x0EB2, 0xB901, 0x92A9 }, { 0x574F, 0xBE1F, 0xDBAB }, { 0x0EB2, 0xB901, 0x92A9 }, { 0x3E2C, 0xBC59, 0xC265 },
+			  { 0xD041, 0xB250, 0x4CCD }, { 0x0386, 0xB837, 0x876E }, { 0x0386, 0xB837, 0x876E }, { 0x0EB2, 0xB901, 0x92A9 } } },
+		{ "mode 12", { 0x67, 0x59, 0x8A, 0x27, 0x39, 0xDA, 0x06, 0x85, 0x9A, 0x48, 0xD3, 0xA6, 0x55, 0xE7, 0x60, 0x53 },
+			{ { 0x65A5, 0x30D0, 0x2CBB }, { 0x62AB, 0x31AE, 0x49B6 }, { 0x635E, 0x317A, 0x42E4 }, { 0x6658, 0x309C, 0x25E9 },
+			  { 0x670C, 0x3067, 0x1F17 }, { 0x5FB2, 0x328D, 0x66B1 }, { 0x64C5, 0x3111, 0x3541 }, { 0x61CB, 0x31F0, 0x523C },
+			  { 0x65A5, 0x30D0, 0x2CBB }, { 0x65A5, 0x30D0, 0x2CBB }, { 0x6412, 0x3146, 0x3C12 }, { 0x5ED1, 0x32CE, 0x6F37 },
+			  { 0x6952, 0x2FBD, 0x08EE }, { 0x64C5, 0x3111, 0x3541 }, { 0x670C, 0x3067, 0x1F17 }, { 0x65A5, 0x30D0, 0x2CBB } },
+			{ { 0xACD3, 0x61A0, 0x080C }, { 0xB2C7, 0x635D, 0x001A }, { 0xB161, 0x62F4, 0x01F8 }, { 0xAB6D, 0x6138, 0x09EB },
+			  { 0xAA06, 0x60CF, 0x0BC9 }, { 0xB8BA, 0x651A, 0x87D7 }, { 0xAE94, 0x6223, 0x05B5 }, { 0xB487, 0x63E0, 0x823B },
+			  { 0xACD3, 0x61A0, 0x080C }, { 0xACD3, 0x61A0, 0x080C }, { 0xAFFA, 0x628C, 0x03D7 }, { 0xBA7B, 0x659C, 0x8A2D },
+			  { 0xA57A, 0x5F7B, 0x11DC }, { 0xAE94, 0x6223, 0x05B5 }, { 0xAA06, 0x60CF, 0x0BC9 }, { 0xACD3, 0x61A0, 0x080C } } },
+		{ "mode 13", { 0x0B, 0x25, 0x88, 0xD5, 0xD0, 0xF8, 0x7A, 0x48, 0x20, 0xCE, 0x1D, 0x50, 0xD9, 0x61, 0xB6, 0xCF },
+			{ { 0x65F9, 0x74BF, 0x0339 }, { 0x6616, 0x7493, 0x142F }, { 0x66B6, 0x7395, 0x744B }, { 0x669A, 0x73C2, 0x6355 },
+			  { 0x66A7, 0x73AE, 0x6ADF }, { 0x6606, 0x74AC, 0x0AC3 }, { 0x65F9, 0x74BF, 0x0339 }, { 0x663C, 0x7457, 0x2ACC },
+			  { 0x6671, 0x7403, 0x4AD6 }, { 0x66A7, 0x73AE, 0x6ADF }, { 0x6606, 0x74AC, 0x0AC3 }, { 0x664B, 0x743F, 0x3438 },
+			  { 0x664B, 0x743F, 0x3438 }, { 0x668E, 0x73D6, 0x5BCB }, { 0x66C3, 0x7382, 0x7BD5 }, { 0x669A, 0x73C2, 0x6355 } },
+			{ { 0xAC1B, 0x8E8F, 0x0672 }, { 0xABE2, 0x8EE8, 0x057C }, { 0xAAA1, 0x90E3, 0x0008 }, { 0xAADA, 0x908A, 0x00FE },
+			  { 0xAAC0, 0x90B2, 0x0091 }, { 0xAC02, 0x8EB7, 0x0605 }, { 0xAC1B, 0x8E8F, 0x0672 }, { 0xAB97, 0x8F60, 0x0434 },
+			  { 0xAB2C, 0x9008, 0x0263 }, { 0xAAC0, 0x90B2, 0x0091 }, { 0xAC02, 0x8EB7, 0x0605 }, { 0xAB78, 0x8F91, 0x03AB },
+			  { 0xAB78, 0x8F91, 0x03AB }, { 0xAAF3, 0x9062, 0x016C }, { 0xAA88, 0x910B, 0x8064 }, { 0xAADA, 0x908A, 0x00FE } } },
+		{ "mode 14", { 0x8F, 0x4E, 0x7E, 0x1E, 0x28, 0x2A, 0xEF, 0xC5, 0x55, 0x81, 0x32, 0x07, 0x3B, 0x31, 0xC8, 0x7E },
+			{ { 0x1490, 0x72C9, 0x0D96 }, { 0x1491, 0x72C9, 0x0D96 }, { 0x1490, 0x72CA, 0x0D97 }, { 0x1491, 0x72C8, 0x0D95 },
+			  { 0x1490, 0x72C9, 0x0D96 }, { 0x1490, 0x72C9, 0x0D96 }, { 0x1491, 0x72C8, 0x0D96 }, { 0x1490, 0x72CA, 0x0D97 },
+			  { 0x1492, 0x72C7, 0x0D95 }, { 0x1490, 0x72C9, 0x0D96 }, { 0x1490, 0x72CA, 0x0D97 }, { 0x1490, 0x72C9, 0x0D96 },
+			  { 0x1491, 0x72C8, 0x0D95 }, { 0x1492, 0x72C7, 0x0D95 }, { 0x1492, 0x72C6, 0x0D94 }, { 0x1491, 0x72C8, 0x0D96 } },
+			{ { 0x2921, 0x926C, 0x1B2D }, { 0x2922, 0x926D, 0x1B2C }, { 0x2920, 0x926B, 0x1B2E }, { 0x2923, 0x926F, 0x1B2B },
+			  { 0x2921, 0x926C, 0x1B2D }, { 0x2921, 0x926C, 0x1B2D }, { 0x2922, 0x926E, 0x1B2C }, { 0x2920, 0x926B, 0x1B2E },
+			  { 0x2924, 0x9270, 0x1B2A }, { 0x2921, 0x926C, 0x1B2D }, { 0x2920, 0x926B, 0x1B2E }, { 0x2921, 0x926C, 0x1B2D },
+			  { 0x2923, 0x926F, 0x1B2B }, { 0x2924, 0x9271, 0x1B2A }, { 0x2925, 0x9272, 0x1B29 }, { 0x2922, 0x926E, 0x1B2C } } }
+	};
+
+
+	// The first byte of a BC6H block with each of the reserved mode values.
+	const uint8_t gBc6hReservedModes[] = { 0x13, 0x17, 0x1B, 0x1F };
+
+	// Modes 4 and 5 are also stored with the alpha channel rotated into a color
+	// channel, and mode 4 with the index sets swapped.  Mode 8 is reserved and
+	// decodes to transparent black, as it does in DirectXTex.
+	struct Bc7Case
+	{
+		const char* Name;
+		uint8_t Block[16];
+		uint8_t Texels[16][4];
+	};
+
+	const Bc7Case gBc7Cases[] =
+	{
+		{ "mode 0", { 0xD1, 0x1E, 0x4B, 0xB3, 0x75, 0x73, 0x22, 0x52, 0xFE, 0x1B, 0x27, 0xD1, 0xAC, 0xAC, 0x99, 0x37 },
+			{ { 99, 214, 16, 255 }, { 120, 207, 35, 255 }, { 120, 207, 35, 255 }, { 141, 200, 53, 255 },
+			  { 161, 193, 72, 255 }, { 226, 172, 129, 255 }, { 141, 200, 53, 255 }, { 120, 207, 35, 255 },
+			  { 114, 170, 127, 255 }, { 120, 174, 95, 255 }, { 114, 170, 127, 255 }, { 96, 160, 224, 255 },
+			  { 163, 38, 236, 255 }, { 156, 24, 222, 255 }, { 158, 29, 227, 255 }, { 173, 57, 255, 255 } } },
+		{ "mode 1", { 0xDA, 0xAB, 0x69, 0xCE, 0x61, 0x3C, 0x66, 0xA6, 0x12, 0x81, 0x51, 0xC5, 0x46, 0x60, 0xC7, 0xE3 },
+			{ { 175, 135, 155, 255 }, { 190, 112, 112, 255 }, { 168, 129, 85, 255 }, { 169, 153, 123, 255 },
+			  { 163, 172, 90, 255 }, { 161, 181, 74, 255 }, { 160, 135, 77, 255 }, { 168, 129, 85, 255 },
+			  { 153, 141, 68, 255 }, { 163, 172, 90, 255 }, { 161, 181, 74, 255 }, { 175, 124, 94, 255 },
+			  { 183, 117, 103, 255 }, { 205, 100, 129, 255 }, { 175, 135, 155, 255 }, { 155, 199, 42, 255 } } },
+		{ "mode 2", { 0x94, 0xDB, 0x18, 0x17, 0x08, 0x7D, 0x58, 0x48, 0xFC, 0x22, 0x06, 0x43, 0x73, 0xC0, 0xC4, 0xD5 },
+			{ { 107, 214, 189, 255 }, { 24, 57, 66, 255 }, { 80, 162, 149, 255 }, { 0, 74, 8, 255 },
+			  { 24, 99, 99, 255 }, { 24, 99, 99, 255 }, { 135, 38, 121, 255 }, { 5, 126, 40, 255 },
+			  { 51, 109, 106, 255 }, { 107, 214, 189, 255 }, { 51, 109, 106, 255 }, { 16, 231, 107, 255 },
+			  { 135, 38, 121, 255 }, { 135, 38, 121, 255 }, { 135, 38, 121, 255 }, { 5, 126, 40, 255 } } },
+		{ "mode 3", { 0xE8, 0x7F, 0xCD, 0xD7, 0xE2, 0xB5, 0xD3, 0x10, 0x22, 0x5B, 0xEE, 0x89, 0x3A, 0x99, 0xCC, 0x14 },
+			{ { 190, 174, 144, 255 }, { 205, 59, 91, 255 }, { 163, 61, 161, 255 }, { 190, 174, 144, 255 },
+			  { 195, 136, 127, 255 }, { 200, 97, 108, 255 }, { 163, 61, 161, 255 }, { 200, 97, 108, 255 },
+			  { 174, 26, 220, 255 }, { 139, 133, 39, 255 }, { 174, 26, 220, 255 }, { 205, 59, 91, 255 },
+			  { 174, 26, 220, 255 }, { 163, 61, 161, 255 }, { 163, 61, 161, 255 }, { 190, 174, 144, 255 } } },
+		{ "mode 4", { 0x10, 0x0F, 0x85, 0x64, 0xC0, 0x0A, 0xC5, 0xBD, 0xCD, 0xBE, 0x4F, 0x25, 0xF6, 0xF3, 0x9F, 0xE2 },
+			{ { 104, 30, 33, 128 }, { 123, 8, 49, 159 }, { 85, 52, 16, 96 }, { 66, 74, 0, 143 },
+			  { 85, 52, 16, 143 }, { 66, 74, 0, 111 }, { 104, 30, 33, 96 }, { 66, 74, 0, 65 },
+			  { 85, 52, 16, 128 }, { 104, 30, 33, 80 }, { 85, 52, 16, 65 }, { 104, 30, 33, 65 },
+			  { 66, 74, 0, 159 }, { 66, 74, 0, 96 }, { 104, 30, 33, 174 }, { 66, 74, 0, 65 } } },
+		{ "mode 5", { 0x20, 0xF0, 0x1F, 0x32, 0xD6, 0x27, 0xFC, 0x95, 0xDF, 0x8B, 0xA8, 0x12, 0xBA, 0x4B, 0x64, 0x1B },
+			{ { 193, 130, 171, 160 }, { 126, 98, 8, 196 }, { 158, 113, 88, 229 }, { 126, 98, 8, 196 },
+			  { 193, 130, 171, 229 }, { 193, 130, 171, 196 }, { 225, 145, 251, 127 }, { 193, 130, 171, 160 },
+			  { 225, 145, 251, 127 }, { 193, 130, 171, 160 }, { 193, 130, 171, 196 }, { 193, 130, 171, 160 },
+			  { 193, 130, 171, 229 }, { 158, 113, 88, 196 }, { 225, 145, 251, 160 }, { 225, 145, 251, 127 } } },
+		{ "mode 6", { 0x40, 0x7F, 0xED, 0x6E, 0xC5, 0x45, 0x8B, 0x9B, 0xDF, 0x83, 0x26, 0xBA, 0x19, 0xCB, 0x45, 0xC3 },
+			{ { 185, 208, 136, 100 }, { 128, 182, 156, 67 }, { 223, 226, 123, 122 }, { 175, 204, 140, 94 },
+			  { 194, 212, 133, 105 }, { 232, 230, 120, 127 }, { 155, 195, 147, 83 }, { 146, 191, 150, 77 },
+			  { 166, 200, 143, 89 }, { 244, 235, 116, 134 }, { 146, 191, 150, 77 }, { 137, 186, 153, 72 },
+			  { 205, 217, 129, 111 }, { 214, 221, 126, 117 }, { 223, 226, 123, 122 }, { 137, 186, 153, 72 } } },
+		{ "mode 7", { 0x80, 0xB5, 0x5B, 0xD4, 0x17, 0xBD, 0x2E, 0x97, 0x1D, 0x14, 0xE5, 0x76, 0xF9, 0xCA, 0x0E, 0x0F },
+			{ { 117, 44, 231, 44 }, { 89, 211, 146, 81 }, { 243, 186, 0, 219 }, { 191, 124, 161, 150 },
+			  { 108, 99, 203, 56 }, { 191, 124, 161, 150 }, { 218, 155, 78, 186 }, { 108, 99, 203, 56 },
+			  { 243, 186, 0, 219 }, { 191, 124, 161, 150 }, { 117, 44, 231, 44 }, { 98, 156, 174, 69 },
+			  { 243, 186, 0, 219 }, { 108, 99, 203, 56 }, { 117, 44, 231, 44 }, { 166, 93, 239, 117 } } },
+		{ "mode 4, rotation 1, index selection 1", { 0xB0, 0x0F, 0x85, 0x64, 0xC0, 0x0A, 0xC5, 0xBD, 0xCD, 0xBE, 0x4F, 0x25, 0xF6, 0xF3, 0x9F, 0xE2 },
+			{ { 138, 36, 28, 99 }, { 174, 17, 42, 115 }, { 101, 55, 14, 82 }, { 65, 27, 35, 107 },
+			  { 101, 27, 35, 107 }, { 65, 46, 21, 90 }, { 138, 55, 14, 82 }, { 65, 74, 0, 66 },
+			  { 101, 36, 28, 99 }, { 138, 65, 7, 74 }, { 101, 74, 0, 66 }, { 138, 74, 0, 66 },
+			  { 65, 17, 42, 115 }, { 65, 55, 14, 82 }, { 138, 8, 49, 123 }, { 65, 74, 0, 66 } } },
+		{ "mode 4, rotation 3", { 0x70, 0x0F, 0x85, 0x64, 0xC0, 0x0A, 0xC5, 0xBD, 0xCD, 0xBE, 0x4F, 0x25, 0xF6, 0xF3, 0x9F, 0xE2 },
+			{ { 104, 30, 128, 33 }, { 123, 8, 159, 49 }, { 85, 52, 96, 16 }, { 66, 74, 143, 0 },
+			  { 85, 52, 143, 16 }, { 66, 74, 111, 0 }, { 104, 30, 96, 33 }, { 66, 74, 65, 0 },
+			  { 85, 52, 128, 16 }, { 104, 30, 80, 33 }, { 85, 52, 65, 16 }, { 104, 30, 65, 33 },
+			  { 66, 74, 159, 0 }, { 66, 74, 96, 0 }, { 104, 30, 174, 33 }, { 66, 74, 65, 0 } } },
+		{ "mode 5, rotation 2", { 0xA0, 0xF0, 0x1F, 0x32, 0xD6, 0x27, 0xFC, 0x95, 0xDF, 0x8B, 0xA8, 0x12, 0xBA, 0x4B, 0x64, 0x1B },
+			{ { 193, 160, 171, 130 }, { 126, 196, 8, 98 }, { 158, 229, 88, 113 }, { 126, 196, 8, 98 },
+			  { 193, 229, 171, 130 }, { 193, 196, 171, 130 }, { 225, 127, 251, 145 }, { 193, 160, 171, 130 },
+			  { 225, 127, 251, 145 }, { 193, 160, 171, 130 }, { 193, 196, 171, 130 }, { 193, 160, 171, 130 },
+			  { 193, 229, 171, 130 }, { 158, 196, 88, 113 }, { 225, 160, 251, 145 }, { 225, 127, 251, 145 } } },
+		{ "reserved mode 8", { 0x00, 0xAA, 0xF2, 0x37, 0x40, 0xDA, 0x1F, 0x42, 0xF8, 0xBF, 0xA8, 0x0D, 0xEF, 0x92, 0xD5, 0x6D },
+			{ { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 },
+			  { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 },
+			  { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 },
+			  { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 } } }
+	};
+
+
+	// BC4 blocks take only the first 8 bytes, and decode to red alone.
+	struct SnormCase
+	{
+		const char* Name;
+		DXGI_FORMAT Format;
+		uint8_t Block[16];
+		float Texels[16][2];
+	};
+
+	const SnormCase gSnormCases[] =
+	{
+		{ "BC4_SNORM with eight values", DXGI_FORMAT_BC4_SNORM, { 0x7F, 0x80, 0x88, 0xC6, 0xFA, 0x88, 0xC6, 0xFA, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+			{ { 1.0f, 0.0f }, { -1.0f, 0.0f }, { 0.7142857f, 0.0f }, { 0.4285714f, 0.0f },
+			  { 0.1428571f, 0.0f }, { -0.1428571f, 0.0f }, { -0.4285714f, 0.0f }, { -0.7142857f, 0.0f },
+			  { 1.0f, 0.0f }, { -1.0f, 0.0f }, { 0.7142857f, 0.0f }, { 0.4285714f, 0.0f },
+			  { 0.1428571f, 0.0f }, { -0.1428571f, 0.0f }, { -0.4285714f, 0.0f }, { -0.7142857f, 0.0f } } },
+		{ "BC4_SNORM with six values, -1 and 1", DXGI_FORMAT_BC4_SNORM, { 0x9C, 0x32, 0x77, 0x39, 0x05, 0x77, 0x39, 0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+			{ { 1.0f, 0.0f }, { -1.0f, 0.0f }, { 0.1574803f, 0.0f }, { -0.07874016f, 0.0f },
+			  { -0.3149606f, 0.0f }, { -0.5511811f, 0.0f }, { 0.3937008f, 0.0f }, { -0.7874016f, 0.0f },
+			  { 1.0f, 0.0f }, { -1.0f, 0.0f }, { 0.1574803f, 0.0f }, { -0.07874016f, 0.0f },
+			  { -0.3149606f, 0.0f }, { -0.5511811f, 0.0f }, { 0.3937008f, 0.0f }, { -0.7874016f, 0.0f } } },
+		{ "BC5_SNORM", DXGI_FORMAT_BC5_SNORM, { 0x9C, 0x32, 0x77, 0x39, 0x05, 0x77, 0x39, 0x05, 0x7F, 0x80, 0x88, 0xC6, 0xFA, 0x88, 0xC6, 0xFA },
+			{ { 1.0f, 1.0f }, { -1.0f, -1.0f }, { 0.1574803f, 0.7142857f }, { -0.07874016f, 0.4285714f },
+			  { -0.3149606f, 0.1428571f }, { -0.5511811f, -0.1428571f }, { 0.3937008f, -0.4285714f }, { -0.7874016f, -0.7142857f },
+			  { 1.0f, 1.0f }, { -1.0f, -1.0f }, { 0.1574803f, 0.7142857f }, { -0.07874016f, 0.4285714f },
+			  { -0.3149606f, 0.1428571f }, { -0.5511811f, -0.1428571f }, { 0.3937008f, -0.4285714f }, { -0.7874016f, -0.7142857f } } },
+		{ "BC5_SNORM with equal endpoints", DXGI_FORMAT_BC5_SNORM, { 0xC0, 0xC0, 0x37, 0x52, 0x4E, 0x1A, 0x1B, 0xF8, 0x7F, 0x80, 0x88, 0xC6, 0xFA, 0x88, 0xC6, 0xFA },
+			{ { 1.0f, 1.0f }, { -1.0f, -1.0f }, { -0.503937f, 0.7142857f }, { -0.503937f, 0.4285714f },
+			  { -0.503937f, 0.1428571f }, { -0.503937f, -0.1428571f }, { -0.503937f, -0.4285714f }, { -0.503937f, -0.7142857f },
+			  { -0.503937f, 1.0f }, { -0.503937f, -1.0f }, { -0.503937f, 0.7142857f }, { -0.503937f, 0.4285714f },
+			  { -0.503937f, 0.1428571f }, { -0.503937f, -0.1428571f }, { -1.0f, -0.4285714f }, { 1.0f, -0.7142857f } } }
+	};
+
+	bool ReadFile(const std::string& filename, std::vector<uint8_t>& data)
+	{
+		std::ifstream fin(filename, std::ios::binary);
+		if(!fin)
+			return false;
+
+		data.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+		return true;
+	}
+
+	bool NearlyEqual(const uint8_t* a, const uint8_t* b, UINT channels)
+	{
+		for(UINT c = 0; c < channels; ++c)
+		{
+			if(abs((int)a[c] - (int)b[c]) > 1)
+				return false;
+		}
+		return true;
+	}
+
+	// Whether the texels are the given halves, with alpha 1.
+	bool MatchesHalves(const XMFLOAT4 texels[16], const uint16_t halves[16][3])
+	{
+		for(UINT i = 0; i < 16; ++i)
+		{
+			const float channels[3] = { texels[i].x, texels[i].y, texels[i].z };
+			for(UINT c = 0; c < 3; ++c)
+			{
+				if(channels[c] != XMConvertHalfToFloat(halves[i][c]))
+					return false;
+			}
+
+			if(texels[i].w != 1.0f)
+				return false;
+		}
+		return true;
+	}
+
+	// Peak signal-to-noise ratio over the first channels of each texel.
+	double Psnr(const ImageRGBA8& a, const ImageRGBA8& b, UINT channels)
+	{
+		double error = 0.0;
+		for(size_t i = 0; i < a.Texels.size(); i += 4)
+		{
+			for(UINT c = 0; c < channels; ++c)
+			{
+				double d = (double)a.Texels[i + c] - (double)b.Texels[i + c];
+				error += d*d;
+			}
+		}
+
+		double mse = error / (a.Texels.size() / 4 * channels);
+		return mse > 0.0 ? 10.0*log10(255.0*255.0 / mse) : std::numeric_limits<double>::infinity();
+	}
+
+	// Compresses image to format and decodes it again.
+	bool RoundTrip(const ImageRGBA8& image, DXGI_FORMAT format, ImageRGBA8& decoded,
+		BlockCompressionStats& stats, ThreadPool& threadPool)
+	{
+		std::vector<uint8_t> blocks;
+		if(!BlockCompressor::Compress(image, format, blocks, threadPool, &stats))
+			return false;
+
+		DDS_TEXTURE_DESC desc = {};
+		desc.dimension = DDS_DIMENSION_TEXTURE2D;
+		desc.width = image.Width;
+		desc.height = image.Height;
+		desc.depth = 1;
+		desc.arraySize = 1;
+		desc.mipCount = 1;
+		desc.format = format;
+
+		std::vector<DDS_SUBRESOURCE_LAYOUT> layouts;
+		if(GetDDSSubresourceLayouts(desc, layouts) != blocks.size())
+			return false;
+
+		std::vector<ImageRGBA8> images;
+		if(!BlockDecompressor::Decode(format, blocks.data(), layouts, images, threadPool))
+			return false;
+
+		decoded = images[0];
+		return true;
+	}
+
+	ImageRGBA8 MakeSolidImage(UINT width, UINT height, const uint8_t rgba[4])
+	{
+		ImageRGBA8 image;
+		image.Width = width;
+		image.Height = height;
+		image.Texels.resize((size_t)width*height*4);
+		for(size_t i = 0; i < image.Texels.size(); ++i)
+			image.Texels[i] = rgba[i % 4];
+		return image;
+	}
+
+	void TestDDSFile(TestReport& report, const DDSFileCase& test, ThreadPool& threadPool)
+	{
+		std::string name = test.Filename;
+
+		std::vector<uint8_t> data;
+		if(!report.Check(ReadFile("../../Textures/" + name, data), name + " loads"))
+			return;
+
+		const DDS_HEADER* header = nullptr;
+		size_t bitOffset = 0;
+		DDS_TEXTURE_DESC desc;
+		if(!report.Check(ParseDDSHeader(data.data(), data.size(), &header, &bitOffset) == DDS_RESULT_OK &&
+			GetDDSTextureDesc(header, &desc) == DDS_RESULT_OK, name + " has a valid header"))
+		{
+			return;
+		}
+
+		report.Check(desc.format == test.Format && desc.width == test.Width && desc.height == test.Height &&
+			desc.arraySize == test.ArraySize && desc.mipCount == test.MipCount,
+			name + " has the expected format and size");
+
+		std::vector<DDS_SUBRESOURCE_LAYOUT> layouts;
+		uint64_t bitSize = GetDDSSubresourceLayouts(desc, layouts);
+		if(!report.Check(bitSize == data.size() - bitOffset, name + " holds exactly the bit data its layouts span"))
+			return;
+
+		const uint8_t* bitData = data.data() + bitOffset;
+		std::vector<ImageRGBA8> images;
+		std::vector<ImageRGBA32F> floatImages;
+		if(!report.Check(BlockDecompressor::Decode(desc.format, bitData, layouts, images, threadPool) &&
+			BlockDecompressor::Decode(desc.format, bitData, layouts, floatImages, threadPool),
+			name + " decodes"))
+		{
+			return;
+		}
+
+		bool sizesMatch = images.size() == layouts.size() && floatImages.size() == layouts.size();
+		UINT roundingMismatches = 0;
+		for(size_t i = 0; sizesMatch && i < layouts.size(); ++i)
+		{
+			sizesMatch = images[i].Width == layouts[i].width && images[i].Height == layouts[i].height &&
+				images[i].Texels.size() == (size_t)layouts[i].width*layouts[i].height*4 &&
+				floatImages[i].Texels.size() == (size_t)layouts[i].width*layouts[i].height;
+
+			for(size_t t = 0; sizesMatch && t < floatImages[i].Texels.size(); ++t)
+			{
+				const XMFLOAT4& f = floatImages[i].Texels[t];
+				float channels[4] = { f.x, f.y, f.z, f.w };
+				for(UINT c = 0; c < 4; ++c)
+				{
+					if(fabsf(channels[c]*255.0f - images[i].Texels[t*4 + c]) > 0.5f + 1e-3f)
+						++roundingMismatches;
+				}
+			}
+		}
+		if(!report.Check(sizesMatch, name + " decodes every subresource at its size"))
+			return;
+
+		report.Check(roundingMismatches == 0, name + " decodes to 8 bits as the rounded float texels");
+
+		const ImageRGBA8& top = images[0];
+		double sums[4] = {};
+		for(size_t i = 0; i < top.Texels.size(); ++i)
+			sums[i % 4] += top.Texels[i];
+
+		bool meansMatch = true;
+		for(UINT c = 0; c < 4; ++c)
+			meansMatch = meansMatch && fabs(sums[c] / (top.Texels.size() / 4) - test.Mean[c]) <= 1.0;
+		report.Check(meansMatch, name + " decodes to the expected channel means");
+
+		bool texelsMatch = true;
+		for(const KnownTexel& known : test.Texels)
+			texelsMatch = texelsMatch && NearlyEqual(&top.Texels[((size_t)known.Y*top.Width + known.X)*4], known.Rgba, 4);
+		report.Check(texelsMatch, name + " decodes the known texels of its top mip");
+
+		report.Check(NearlyEqual(images.back().Texels.data(), test.LastTexel, 4),
+			name + " decodes the known texel of its last subresource");
+	}
+}
+
+void RunBlockDecompressorTests(TestReport& report)
+{
+	report.BeginSuite("BlockDecompressor");
+
+	ThreadPool& threadPool = ThreadPool::Default();
+
+	for(const DDSFileCase& test : gFileCases)
+		TestDDSFile(report, test, threadPool);
+
+	//
+	// Known answers.  The spec defines BC6H and BC7 texels to the bit; the SNORM
+	// palettes are checked to well within a step.
+	//
+	{
+		XMFLOAT4 texels[16];
+		for(const Bc6hCase& test : gBc6hCases)
+		{
+			std::string name = std::string("BC6H ") + test.Name;
+
+			BlockDecompressor::DecodeBlock(DXGI_FORMAT_BC6H_UF16, test.Block, texels);
+			report.Check(MatchesHalves(texels, test.UnsignedTexels), name + " decodes as BC6H_UF16");
+
+			BlockDecompressor::DecodeBlock(DXGI_FORMAT_BC6H_SF16, test.Block, texels);
+			report.Check(MatchesHalves(texels, test.SignedTexels), name + " decodes as BC6H_SF16");
+		}
+
+		bool reservedBlack = true;
+		for(uint8_t mode : gBc6hReservedModes)
+		{
+			uint8_t block[16];
+			std::fill(block, block + 16, (uint8_t)0xA5);
+			block[0] = mode;
+
+			for(DXGI_FORMAT format : { DXGI_FORMAT_BC6H_UF16, DXGI_FORMAT_BC6H_SF16 })
+			{
+				BlockDecompressor::DecodeBlock(format, block, texels);
+				for(const XMFLOAT4& texel : texels)
+					reservedBlack = reservedBlack && texel.x == 0.0f && texel.y == 0.0f && texel.z == 0.0f && texel.w == 1.0f;
+			}
+		}
+		report.Check(reservedBlack, "BC6H blocks of the reserved modes decode to black");
+
+		for(const Bc7Case& test : gBc7Cases)
+		{
+			BlockDecompressor::DecodeBlock(DXGI_FORMAT_BC7_UNORM, test.Block, texels);
+
+			bool matches = true;
+			for(UINT i = 0; i < 16; ++i)
+			{
+				const float channels[4] = { texels[i].x, texels[i].y, texels[i].z, texels[i].w };
+				for(UINT c = 0; c < 4; ++c)
+					matches = matches && fabsf(channels[c]*255.0f - test.Texels[i][c]) < 1e-3f;
+			}
+			report.Check(matches, std::string("BC7 ") + test.Name + " decodes to the known texels");
+		}
+
+		for(const SnormCase& test : gSnormCases)
+		{
+			BlockDecompressor::DecodeBlock(test.Format, test.Block, texels);
+
+			bool matches = true;
+			for(UINT i = 0; i < 16; ++i)
+			{
+				matches = matches && fabsf(texels[i].x - test.Texels[i][0]) < 1e-5f &&
+					fabsf(texels[i].y - test.Texels[i][1]) < 1e-5f && texels[i].z == 0.0f && texels[i].w == 1.0f;
+			}
+			report.Check(matches, std::string(test.Name) + " decodes to the known texels");
+		}
+	}
+
+	//
+	// A color each format stores exactly comes back unchanged, including in the
+	// blocks that stick out past the edges of an odd-sized image.
+	//
+	{
+		const uint8_t color[4] = { 255, 65, 33, 255 };
+		ImageRGBA8 solid = MakeSolidImage(13, 7, color);
+
+		struct ExactCase
+		{
+			DXGI_FORMAT Format;
+			UINT Channels;
+		};
+		const ExactCase cases[] =
+		{
+			{ DXGI_FORMAT_BC1_UNORM, 4 },
+			{ DXGI_FORMAT_BC3_UNORM, 4 },
+			{ DXGI_FORMAT_BC4_UNORM, 1 },
+			{ DXGI_FORMAT_BC5_UNORM, 2 },
+			{ DXGI_FORMAT_BC7_UNORM, 4 }
+		};
+
+		for(const ExactCase& exact : cases)
+		{
+			ImageRGBA8 decoded;
+			BlockCompressionStats stats;
+			bool ok = RoundTrip(solid, exact.Format, decoded, stats, threadPool) &&
+				decoded.Width == solid.Width && decoded.Height == solid.Height;
+
+			for(size_t i = 0; ok && i < solid.Texels.size(); i += 4)
+			{
+				for(UINT c = 0; c < exact.Channels; ++c)
+					ok = ok && decoded.Texels[i + c] == solid.Texels[i + c];
+			}
+
+			report.Check(ok, "a solid 13x7 image round-trips exactly through format " + std::to_string(exact.Format));
+		}
+	}
+
+	//
+	// Real textures: what the compressor reports matches what the decoder reads.
+	//
+	{
+		std::vector<uint8_t> data;
+		const DDS_HEADER* header = nullptr;
+		size_t bitOffset = 0;
+		DDS_TEXTURE_DESC desc;
+		std::vector<DDS_SUBRESOURCE_LAYOUT> layouts;
+		std::vector<ImageRGBA8> images;
+		if(!report.Check(ReadFile("../../Textures/stone.dds", data) &&
+			ParseDDSHeader(data.data(), data.size(), &header, &bitOffset) == DDS_RESULT_OK &&
+			GetDDSTextureDesc(header, &desc) == DDS_RESULT_OK &&
+			GetDDSSubresourceLayouts(desc, layouts) == data.size() - bitOffset &&
+			BlockDecompressor::Decode(desc.format, data.data() + bitOffset, layouts, images, threadPool),
+			"stone.dds decodes for the round trips"))
+		{
+			return;
+		}
+		const ImageRGBA8& stone = images[0];
+
+		// bricks_nmap.dds is B8G8R8A8, so its top mip only needs swizzling.
+		ImageRGBA8 normals;
+		if(!report.Check(ReadFile("../../Textures/bricks_nmap.dds", data) &&
+			ParseDDSHeader(data.data(), data.size(), &header, &bitOffset) == DDS_RESULT_OK &&
+			GetDDSTextureDesc(header, &desc) == DDS_RESULT_OK &&
+			desc.format == DXGI_FORMAT_B8G8R8A8_UNORM &&
+			GetDDSSubresourceLayouts(desc, layouts) == data.size() - bitOffset,
+			"bricks_nmap.dds loads for the round trips"))
+		{
+			return;
+		}
+
+		normals.Width = layouts[0].width;
+		normals.Height = layouts[0].height;
+		normals.Texels.assign(data.begin() + bitOffset, data.begin() + bitOffset + layouts[0].slicePitch);
+		for(size_t i = 0; i < normals.Texels.size(); i += 4)
+			std::swap(normals.Texels[i], normals.Texels[i + 2]);
+
+		// Its alpha holds heights, which would make BC1 drop texels.
+		ImageRGBA8 opaqueNormals = normals;
+		for(size_t i = 3; i < opaqueNormals.Texels.size(); i += 4)
+			opaqueNormals.Texels[i] = 255;
+
+		struct TextureCase
+		{
+			const char* Name;
+			const ImageRGBA8* Image;
+			DXGI_FORMAT Format;
+			UINT Channels;
+			double MinPsnr;
+		};
+		const TextureCase cases[] =
+		{
+			{ "bricks_nmap.dds as BC1", &opaqueNormals, DXGI_FORMAT_BC1_UNORM, 3, 28.0 },
+			{ "stone.dds as BC4", &stone, DXGI_FORMAT_BC4_UNORM, 1, 40.0 },
+			{ "bricks_nmap.dds as BC5", &normals, DXGI_FORMAT_BC5_UNORM, 2, 38.0 }
+		};
+
+		for(const TextureCase& test : cases)
+		{
+			std::string name = test.Name;
+
+			ImageRGBA8 decoded;
+			BlockCompressionStats stats;
+			if(!report.Check(RoundTrip(*test.Image, test.Format, decoded, stats, threadPool), name + " round-trips"))
+				continue;
+
+			double psnr = Psnr(*test.Image, decoded, test.Channels);
+			report.Log() << name << ": " << psnr << " dB" << std::endl;
+			report.Check(psnr >= test.MinPsnr, name + " keeps a PSNR of at least " + std::to_string((int)test.MinPsnr) + " dB");
+			report.Check(fabs(psnr - stats.Psnr) < 0.05, name + " decodes to the PSNR the compressor reports");
+		}
+
+		// stone.dds was BC1 to begin with, so encoding it again finds palettes that
+		// hold its colors to within the rounding of the interpolated entries.  The
+		// compressor's PSNR is not compared here: it measures against its integer
+		// palettes, which are that one step away from the decoder's.
+		ImageRGBA8 decoded;
+		BlockCompressionStats stats;
+		if(report.Check(RoundTrip(stone, DXGI_FORMAT_BC1_UNORM, decoded, stats, threadPool), "stone.dds as BC1 round-trips"))
+		{
+			double psnr = Psnr(stone, decoded, 3);
+			report.Log() << "stone.dds as BC1: " << psnr << " dB" << std::endl;
+			report.Check(psnr >= 50.0, "stone.dds loses next to nothing when encoded as BC1 again");
+		}
+	}
+}
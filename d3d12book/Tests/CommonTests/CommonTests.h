@@ -0,0 +1,18 @@
+﻿//***************************************************************************************
+// CommonTests.h
+//
+// Test suites for the Common code, and the sample code built on it, that runs
+// without a window.  Each one records its checks in the report.
+//***************************************************************************************
+
+#pragma once
+
+#include "TestReport.h"
+
+void RunBlockCompressorTests(TestReport& report);
+void RunBlockDecompressorTests(TestReport& report);
+void RunCpuSkinnerTests(TestReport& report);
+void RunMipGeneratorTests(TestReport& report);
+void RunOcclusionCullerTests(TestReport& report);
+void RunSceneRayQueryTests(TestReport& report);
+void RunTextureStreamerTests(TestReport& report);
@@ -0,0 +1,180 @@
+//***************************************************************************************
+// CpuSkinnerTests.cpp
+//
+// Skins a small hand-built mesh, three blocks long, with a palette of made-up bone
+// transforms and compares every position and normal with a scalar reference that
+// blends the four transformed points the way the SKINNED vertex shader path does.
+//***************************************************************************************
+
+#include "CommonTests.h"
+#include "../../Chapter 23 Character Animation/SkinnedMesh/CpuSkinner.h"
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	const UINT gBoneCount = 5;
+	const UINT gVertexCount = 2*CpuSkinner::BlockSize + 22;
+
+	// Vertices of the last block are the only ones bone 4 influences.
+	const UINT gLastBlockBone = 4;
+
+	std::vector<M3DLoader::SkinnedVertex> MakeMesh()
+	{
+		std::vector<M3DLoader::SkinnedVertex> vertices(gVertexCount);
+		for(UINT i = 0; i < gVertexCount; ++i)
+		{
+			M3DLoader::SkinnedVertex& v = vertices[i];
+			v.Pos = XMFLOAT3(0.1f*(i % 7) - 0.3f, 0.05f*(i % 11), 0.2f*(i % 3) - 0.2f);
+			v.Normal = XMFLOAT3(0.0f, 0.6f, 0.8f);
+
+			// Up to four influences; the last weight is implied.
+			const float weights[4][3] =
+			{
+				{ 1.0f, 0.0f, 0.0f },
+				{ 0.5f, 0.5f, 0.0f },
+				{ 0.2f, 0.3f, 0.4f },
+				{ 0.1f, 0.2f, 0.3f }
+			};
+			const float* w = weights[i % 4];
+			v.BoneWeights = XMFLOAT3(w[0], w[1], w[2]);
+
+			bool lastBlock = i >= 2*CpuSkinner::BlockSize;
+			for(UINT j = 0; j < 4; ++j)
+				v.BoneIndices[j] = (BYTE)(lastBlock && j == 0 ? gLastBlockBone : (i + j) % gLastBlockBone);
+		}
+		return vertices;
+	}
+
+	// Scale, rotation and translation that differ from bone to bone.
+	std::vector<BoneTransform3x4> MakePalette(float angle)
+	{
+		std::vector<BoneTransform3x4> palette(gBoneCount);
+		for(UINT i = 0; i < gBoneCount; ++i)
+		{
+			XMMATRIX M = XMMatrixScaling(1.0f + 0.1f*i, 1.0f + 0.1f*i, 1.0f + 0.1f*i) *
+				XMMatrixRotationRollPitchYaw(angle*i, 0.3f*i, -0.2f*angle) *
+				XMMatrixTranslation(0.5f*i, -0.25f*i, angle);
+			StoreBoneTransform(&palette[i], M);
+		}
+		return palette;
+	}
+
+	// The four transformed points and normals, blended one at a time.  Bone
+	// indices past the palette are skipped along with their weight.
+	void ReferenceSkin(const M3DLoader::SkinnedVertex& v, const std::vector<BoneTransform3x4>& palette,
+		XMFLOAT3& position, XMFLOAT3& normal)
+	{
+		const float w[4] = { v.BoneWeights.x, v.BoneWeights.y, v.BoneWeights.z,
+			1.0f - v.BoneWeights.x - v.BoneWeights.y - v.BoneWeights.z };
+
+		float p[3] = {};
+		float n[3] = {};
+		for(UINT j = 0; j < 4; ++j)
+		{
+			if(v.BoneIndices[j] >= palette.size())
+				continue;
+
+			// The rows are the columns of the bone matrix.
+			const BoneTransform3x4& bone = palette[v.BoneIndices[j]];
+			for(UINT r = 0; r < 3; ++r)
+			{
+				const XMFLOAT4& row = bone.Rows[r];
+				p[r] += w[j]*(row.x*v.Pos.x + row.y*v.Pos.y + row.z*v.Pos.z + row.w);
+				n[r] += w[j]*(row.x*v.Normal.x + row.y*v.Normal.y + row.z*v.Normal.z);
+			}
+		}
+
+		position = XMFLOAT3(p[0], p[1], p[2]);
+		normal = XMFLOAT3(n[0], n[1], n[2]);
+	}
+
+	bool Near(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		const float tolerance = 1e-4f;
+		return fabsf(a.x - b.x) <= tolerance && fabsf(a.y - b.y) <= tolerance && fabsf(a.z - b.z) <= tolerance;
+	}
+
+	bool MatchesReference(const CpuSkinner& skinner, const std::vector<M3DLoader::SkinnedVertex>& vertices,
+		const std::vector<BoneTransform3x4>& palette)
+	{
+		if(skinner.Positions().size() != vertices.size() || skinner.Normals().size() != vertices.size())
+			return false;
+
+		for(size_t i = 0; i < vertices.size(); ++i)
+		{
+			XMFLOAT3 position, normal;
+			ReferenceSkin(vertices[i], palette, position, normal);
+			if(!Near(skinner.Positions()[i], position) || !Near(skinner.Normals()[i], normal))
+				return false;
+		}
+		return true;
+	}
+}
+
+void RunCpuSkinnerTests(TestReport& report)
+{
+	report.BeginSuite("CpuSkinner");
+
+	ThreadPool& threadPool = ThreadPool::Default();
+	std::vector<M3DLoader::SkinnedVertex> vertices = MakeMesh();
+
+	//
+	// Every vertex matches the reference, and after a change to one bone only the
+	// blocks it influences are skinned again, still matching.
+	//
+	{
+		CpuSkinner skinner;
+		report.Check(skinner.Build(vertices.data(), gVertexCount, gBoneCount), "a valid mesh builds");
+		report.Check(skinner.VertexCount() == gVertexCount && skinner.BlockCount() == 3,
+			"vertices are split into blocks of " + std::to_string(CpuSkinner::BlockSize));
+
+		std::vector<BoneTransform3x4> palette = MakePalette(0.4f);
+		skinner.Skin(palette.data(), true, &threadPool);
+		report.Check(skinner.LastSkinnedBlockCount() == 3, "the first Skin computes every block");
+		report.Check(MatchesReference(skinner, vertices, palette), "positions and normals match the scalar reference");
+
+		palette[gLastBlockBone].Rows[1].w += 0.5f;
+		skinner.Skin(palette.data(), true, &threadPool);
+		report.Check(skinner.LastSkinnedBlockCount() == 1, "a bone that moved is only skinned where it has weight");
+		report.Check(MatchesReference(skinner, vertices, palette), "skipped blocks still match the reference");
+
+		palette = MakePalette(-1.1f);
+		skinner.Skin(palette.data(), false, &threadPool);
+		report.Check(skinner.LastSkinnedBlockCount() == 3 && MatchesReference(skinner, vertices, palette),
+			"a new pose matches the reference");
+	}
+
+	//
+	// Bone indices come from the file unchecked.  Ones past the palette are
+	// dropped: with no weight the mesh is still valid, with weight it is not, and
+	// either way Skin stays inside the palette.
+	//
+	{
+		std::vector<M3DLoader::SkinnedVertex> unweighted = vertices;
+		unweighted[5].BoneWeights = XMFLOAT3(0.5f, 0.5f, 0.0f);
+		unweighted[5].BoneIndices[2] = 200;
+		unweighted[5].BoneIndices[3] = gBoneCount;
+
+		std::vector<M3DLoader::SkinnedVertex> weighted = vertices;
+		weighted[2*CpuSkinner::BlockSize + 1].BoneIndices[1] = 255;
+		weighted[7].BoneIndices[3] = gBoneCount;
+
+		std::vector<BoneTransform3x4> palette = MakePalette(0.7f);
+
+		CpuSkinner skinner;
+		report.Check(skinner.Build(unweighted.data(), gVertexCount, gBoneCount),
+			"indices past the palette with no weight are accepted");
+		skinner.Skin(palette.data(), false, &threadPool);
+		report.Check(MatchesReference(skinner, unweighted, palette), "unweighted indices past the palette are ignored");
+
+		report.Check(!skinner.Build(weighted.data(), gVertexCount, gBoneCount),
+			"indices past the palette with weight are reported");
+		skinner.Skin(palette.data(), false, &threadPool);
+		report.Check(MatchesReference(skinner, weighted, palette), "weighted indices past the palette are dropped");
+
+		report.Check(!skinner.Build(vertices.data(), gVertexCount, CpuSkinner::MaxBones + 1) &&
+			skinner.VertexCount() == 0, "more than MaxBones bones are refused");
+	}
+}
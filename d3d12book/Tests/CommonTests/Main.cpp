@@ -0,0 +1,25 @@
+﻿//***************************************************************************************
+// Main.cpp
+//
+// Runs every suite and returns the number of failed checks, so the exit code is 0
+// only if all of them passed.  Run it from this directory; the texture tests read
+// the repository's textures from ../../Textures and write a scratch DDS file here.
+//***************************************************************************************
+
+#include "CommonTests.h"
+
+int main()
+{
+	TestReport report(std::cout);
+
+	RunOcclusionCullerTests(report);
+	RunSceneRayQueryTests(report);
+	RunTextureStreamerTests(report);
+	RunBlockCompressorTests(report);
+	RunBlockDecompressorTests(report);
+	RunMipGeneratorTests(report);
+	RunCpuSkinnerTests(report);
+
+	report.PrintSummary();
+	return (int)report.FailureCount();
+}
@@ -0,0 +1,180 @@
+//***************************************************************************************
+// MipGeneratorTests.cpp
+//
+// Checks the shape of the chains MipGenerator builds and what its filters do to
+// images whose mips are known in advance: a constant image, and a checkerboard of
+// black and white, which averages to gray in linear light, not to texel value 128.
+//***************************************************************************************
+
+#include "CommonTests.h"
+#include "../../Common/MathHelper.h"
+#include "../../Common/MipGenerator.h"
+#include "../../Common/ThreadPool.h"
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	ImageRGBA8 MakeImage(UINT width, UINT height)
+	{
+		ImageRGBA8 image;
+		image.Width = width;
+		image.Height = height;
+		image.Texels.resize((size_t)width*height*4);
+		return image;
+	}
+
+	// One-texel checkerboard of black and white, with opaque texels on the white
+	// squares and transparent ones on the black.
+	ImageRGBA8 MakeCheckerboard(UINT width, UINT height)
+	{
+		ImageRGBA8 image = MakeImage(width, height);
+		for(UINT y = 0; y < height; ++y)
+		{
+			for(UINT x = 0; x < width; ++x)
+			{
+				uint8_t v = ((x + y) % 2) ? 255 : 0;
+				uint8_t* texel = &image.Texels[((size_t)y*width + x)*4];
+				texel[0] = texel[1] = texel[2] = texel[3] = v;
+			}
+		}
+		return image;
+	}
+
+	// The sRGB transfer function, written out rather than taken from DirectXMath.
+	float LinearToSrgb(float c)
+	{
+		return c <= 0.0031308f ? 12.92f*c : 1.055f*powf(c, 1.0f / 2.4f) - 0.055f;
+	}
+
+	// Whether every texel of every mip is within tolerance of rgba.
+	bool AllTexelsNear(const std::vector<ImageRGBA8>& mips, size_t firstMip, const int rgba[4], int tolerance)
+	{
+		for(size_t i = firstMip; i < mips.size(); ++i)
+		{
+			const std::vector<uint8_t>& texels = mips[i].Texels;
+			for(size_t t = 0; t < texels.size(); ++t)
+			{
+				if(abs((int)texels[t] - rgba[t % 4]) > tolerance)
+					return false;
+			}
+		}
+		return true;
+	}
+}
+
+void RunMipGeneratorTests(TestReport& report)
+{
+	report.BeginSuite("MipGenerator");
+
+	ThreadPool& threadPool = ThreadPool::Default();
+	const MipFilter filters[] = { MipFilter::Box, MipFilter::Kaiser };
+	const char* filterNames[] = { "Box", "Kaiser" };
+
+	//
+	// Each level halves the one above, rounding down, until both sides are 1.
+	//
+	{
+		struct SizeCase
+		{
+			UINT Width;
+			UINT Height;
+			UINT LevelCount;
+		};
+		const SizeCase cases[] =
+		{
+			{ 512, 512, 10 },
+			{ 256, 64, 9 },
+			{ 13, 5, 4 },
+			{ 1, 7, 3 },
+			{ 1, 1, 1 }
+		};
+
+		for(const SizeCase& test : cases)
+		{
+			std::vector<ImageRGBA8> mips;
+			MipGenerator::GenerateMips(MakeImage(test.Width, test.Height), MipFilter::Box, false, mips, threadPool);
+
+			bool sizesMatch = mips.size() == test.LevelCount;
+			UINT width = test.Width;
+			UINT height = test.Height;
+			for(size_t i = 0; sizesMatch && i < mips.size(); ++i)
+			{
+				sizesMatch = mips[i].Width == width && mips[i].Height == height &&
+					mips[i].Texels.size() == (size_t)width*height*4;
+
+				width = MathHelper::Max(width / 2, 1u);
+				height = MathHelper::Max(height / 2, 1u);
+			}
+
+			std::string size = std::to_string(test.Width) + "x" + std::to_string(test.Height);
+			report.Check(sizesMatch, size + " has " + std::to_string(test.LevelCount) + " levels of the right sizes");
+		}
+	}
+
+	//
+	// Filtering a constant image gives back the same constant, edges included.
+	//
+	for(UINT f = 0; f < 2; ++f)
+	{
+		for(bool srgb : { false, true })
+		{
+			const int color[4] = { 200, 90, 17, 128 };
+			ImageRGBA8 image = MakeImage(37, 20);
+			for(size_t t = 0; t < image.Texels.size(); ++t)
+				image.Texels[t] = (uint8_t)color[t % 4];
+
+			std::vector<ImageRGBA8> mips;
+			MipGenerator::GenerateMips(image, filters[f], srgb, mips, threadPool);
+
+			std::string name = std::string(filterNames[f]) + (srgb ? " sRGB" : "");
+			report.Check(AllTexelsNear(mips, 1, color, 0), name + " keeps a constant image constant in every mip");
+		}
+	}
+
+	//
+	// Black and white average to half the light.  Stored as sRGB that is texel
+	// value 188, not 128; alpha is averaged as is either way.  The Kaiser filter
+	// only comes close to the average, as a one-texel checkerboard is right at the
+	// limit of what it passes, but its sRGB chain must still be its linear chain
+	// carried through the transfer function.
+	//
+	{
+		const int srgbGray = (int)(LinearToSrgb(0.5f)*255.0f + 0.5f);
+		const int linearGray[4] = { 128, 128, 128, 128 };
+		const int srgbAverage[4] = { srgbGray, srgbGray, srgbGray, 128 };
+		report.Log() << "half of white in sRGB is " << srgbGray << std::endl;
+
+		std::vector<ImageRGBA8> mips;
+		MipGenerator::GenerateMips(MakeCheckerboard(16, 16), MipFilter::Box, false, mips, threadPool);
+		report.Check(AllTexelsNear(mips, 1, linearGray, 1), "Box averages black and white to 128 without sRGB");
+
+		MipGenerator::GenerateMips(MakeCheckerboard(16, 16), MipFilter::Box, true, mips, threadPool);
+		report.Check(AllTexelsNear(mips, 1, srgbAverage, 1), "Box averages black and white in linear light with sRGB");
+
+		for(UINT f = 0; f < 2; ++f)
+		{
+			std::vector<ImageRGBA8> linearMips;
+			std::vector<ImageRGBA8> srgbMips;
+			MipGenerator::GenerateMips(MakeCheckerboard(16, 16), filters[f], false, linearMips, threadPool);
+			MipGenerator::GenerateMips(MakeCheckerboard(16, 16), filters[f], true, srgbMips, threadPool);
+
+			bool matches = linearMips.size() == srgbMips.size();
+			for(size_t i = 1; matches && i < linearMips.size(); ++i)
+			{
+				const std::vector<uint8_t>& linear = linearMips[i].Texels;
+				const std::vector<uint8_t>& srgb = srgbMips[i].Texels;
+				for(size_t t = 0; matches && t < linear.size(); ++t)
+				{
+					int expected = linear[t];
+					if(t % 4 != 3)
+						expected = (int)(LinearToSrgb(linear[t] / 255.0f)*255.0f + 0.5f);
+					matches = abs((int)srgb[t] - expected) <= 1;
+				}
+			}
+
+			report.Check(matches, std::string(filterNames[f]) + " filters sRGB texels in linear light");
+		}
+	}
+}
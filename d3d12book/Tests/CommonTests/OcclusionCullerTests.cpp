@@ -0,0 +1,181 @@
+//***************************************************************************************
+// OcclusionCullerTests.cpp
+//
+// A 10x5 wall faces a camera at the origin looking down +z, 10 units away.  With a
+// 90 degree vertical field of view and a 256x128 buffer it covers exactly the
+// pixels [96, 160) x [48, 80), which are whole 8x8 tiles, so the depth buffer
+// and the tiles can be checked texel for texel before boxes are tested against
+// them.
+//***************************************************************************************
+
+#include "CommonTests.h"
+#include "../../Common/OcclusionCuller.h"
+
+using namespace DirectX;
+
+namespace
+{
+	const float gNear = 1.0f;
+	const float gFar = 100.0f;
+	const float gWallZ = 10.0f;
+
+	// Pixels covered by the wall.
+	const UINT gWallX0 = 96;
+	const UINT gWallX1 = 160;
+	const UINT gWallY0 = 48;
+	const UINT gWallY1 = 80;
+
+	const XMFLOAT3 gWallVertices[4] =
+	{
+		XMFLOAT3(-5.0f, +2.5f, gWallZ),
+		XMFLOAT3(+5.0f, +2.5f, gWallZ),
+		XMFLOAT3(+5.0f, -2.5f, gWallZ),
+		XMFLOAT3(-5.0f, -2.5f, gWallZ)
+	};
+
+	// Clockwise as seen from the camera, so the wall faces it.
+	const std::uint16_t gWallIndices[6] = { 0, 1, 2, 0, 2, 3 };
+	const std::uint16_t gWallBackIndices[6] = { 0, 2, 1, 0, 3, 2 };
+
+	XMMATRIX CameraViewProj()
+	{
+		XMMATRIX view = XMMatrixLookAtLH(XMVectorZero(), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f),
+			XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		XMMATRIX proj = XMMatrixPerspectiveFovLH(0.5f*XM_PI, 2.0f, gNear, gFar);
+		return XMMatrixMultiply(view, proj);
+	}
+
+	// Depth buffer value of a point at view depth z.
+	float ProjectedDepth(float z)
+	{
+		return gFar / (gFar - gNear) * (1.0f - gNear / z);
+	}
+
+	bool IsInsideWall(UINT x, UINT y)
+	{
+		return x >= gWallX0 && x < gWallX1 && y >= gWallY0 && y < gWallY1;
+	}
+
+	bool IsOccluded(OcclusionCuller& culler, const XMFLOAT3& center, const XMFLOAT3& extents)
+	{
+		return culler.IsOccluded(BoundingBox(center, extents));
+	}
+}
+
+void RunOcclusionCullerTests(TestReport& report)
+{
+	report.BeginSuite("OcclusionCuller");
+
+	OcclusionCuller culler(256, 128);
+	const UINT width = culler.Width();
+	const UINT height = culler.Height();
+	const UINT tilesX = width / OcclusionCuller::TileSize;
+	const UINT tilesY = height / OcclusionCuller::TileSize;
+
+	XMMATRIX viewProj = CameraViewProj();
+	const float wallDepth = ProjectedDepth(gWallZ);
+
+	//
+	// The wall fills its pixels with its depth, and only those.
+	//
+
+	culler.BeginFrame(viewProj);
+	culler.RenderOccluder(gWallVertices, sizeof(XMFLOAT3), gWallIndices, 6, XMMatrixIdentity());
+
+	report.Check(culler.GetStats().OccluderTriangles == 2, "both wall triangles are rasterized");
+
+	const std::vector<float>& depth = culler.GetDepthBuffer();
+	UINT wrongPixels = 0;
+	for(UINT y = 0; y < height; ++y)
+	{
+		for(UINT x = 0; x < width; ++x)
+		{
+			float expected = IsInsideWall(x, y) ? wallDepth : 1.0f;
+			if(fabsf(depth[y*width + x] - expected) > 1e-5f)
+				++wrongPixels;
+		}
+	}
+	report.Check(wrongPixels == 0, "depth buffer holds the wall depth exactly where the wall is");
+
+	const std::vector<float>& tiles = culler.GetTileMaxDepths();
+	report.Check(tiles.size() == tilesX*tilesY, "one max depth per 8x8 tile");
+
+	UINT wrongTiles = 0;
+	for(UINT ty = 0; ty < tilesY; ++ty)
+	{
+		for(UINT tx = 0; tx < tilesX; ++tx)
+		{
+			bool covered = IsInsideWall(tx*OcclusionCuller::TileSize, ty*OcclusionCuller::TileSize);
+			float expected = covered ? wallDepth : 1.0f;
+			if(fabsf(tiles[ty*tilesX + tx] - expected) > 1e-5f)
+				++wrongTiles;
+		}
+	}
+	report.Check(wrongTiles == 0, "tiles covered by the wall hold its depth, the others 1");
+
+	//
+	// Boxes against the wall.
+	//
+
+	report.Check(IsOccluded(culler, XMFLOAT3(0.0f, 0.0f, 20.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)),
+		"box fully behind the wall is occluded");
+	report.Check(IsOccluded(culler, XMFLOAT3(9.0f, 4.4f, 20.0f), XMFLOAT3(0.4f, 0.4f, 0.4f)),
+		"box behind a corner of the wall is occluded");
+	report.Check(!IsOccluded(culler, XMFLOAT3(10.0f, 0.0f, 20.0f), XMFLOAT3(2.0f, 1.0f, 1.0f)),
+		"box partially behind the wall is visible");
+	report.Check(!IsOccluded(culler, XMFLOAT3(0.0f, 0.0f, 5.0f), XMFLOAT3(0.5f, 0.5f, 0.5f)),
+		"box in front of the wall is visible");
+	report.Check(!IsOccluded(culler, XMFLOAT3(0.0f, 0.0f, 9.5f), XMFLOAT3(1.0f, 1.0f, 1.0f)),
+		"box cutting through the wall is visible");
+	report.Check(!IsOccluded(culler, XMFLOAT3(-15.0f, 0.0f, 20.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)),
+		"box beside the wall is visible");
+	report.Check(!IsOccluded(culler, XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)),
+		"box crossing the near plane is visible");
+	report.Check(!IsOccluded(culler, XMFLOAT3(0.0f, 0.0f, -20.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)),
+		"box behind the camera is not reported occluded");
+
+	const OcclusionStats& stats = culler.GetStats();
+	report.Check(stats.OccludeesTested == 8, "every tested box is counted");
+	report.Check(stats.OccludeesCulled == 2, "only the occluded boxes are counted as culled");
+
+	//
+	// A new frame starts empty.
+	//
+
+	culler.BeginFrame(viewProj);
+	report.Check(culler.GetStats().OccluderTriangles == 0 && culler.GetStats().OccludeesTested == 0 &&
+		culler.GetStats().OccludeesCulled == 0, "BeginFrame resets the statistics");
+	report.Check(!IsOccluded(culler, XMFLOAT3(0.0f, 0.0f, 20.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)),
+		"BeginFrame clears the depth buffer");
+
+	//
+	// Facing and the near plane.
+	//
+
+	culler.BeginFrame(viewProj);
+	culler.RenderOccluder(gWallVertices, sizeof(XMFLOAT3), gWallBackIndices, 6, XMMatrixIdentity());
+	report.Check(culler.GetStats().OccluderTriangles == 0, "back faces are not rasterized");
+	report.Check(!IsOccluded(culler, XMFLOAT3(0.0f, 0.0f, 20.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)),
+		"the back of a one-sided wall hides nothing");
+
+	culler.RenderOccluder(gWallVertices, sizeof(XMFLOAT3), gWallBackIndices, 6, XMMatrixIdentity(), true);
+	report.Check(culler.GetStats().OccluderTriangles == 2, "back faces of a two-sided wall are rasterized");
+	report.Check(IsOccluded(culler, XMFLOAT3(0.0f, 0.0f, 20.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)),
+		"the back of a two-sided wall hides the box behind it");
+
+	// The same wall tilted back and pulled in until its bottom edge is behind
+	// the camera; every triangle has a vertex there.
+	culler.BeginFrame(viewProj);
+	XMMATRIX tilt = XMMatrixTranslation(0.0f, 0.0f, -gWallZ) * XMMatrixRotationX(0.25f*XM_PI) *
+		XMMatrixTranslation(0.0f, 0.0f, 1.5f);
+	culler.RenderOccluder(gWallVertices, sizeof(XMFLOAT3), gWallIndices, 6, tilt, true);
+	report.Check(culler.GetStats().OccluderTriangles == 0, "triangles crossing the near plane are skipped");
+
+	UINT writtenPixels = 0;
+	for(float d : culler.GetDepthBuffer())
+	{
+		if(d < 1.0f)
+			++writtenPixels;
+	}
+	report.Check(writtenPixels == 0, "skipped triangles leave the depth buffer clear");
+}
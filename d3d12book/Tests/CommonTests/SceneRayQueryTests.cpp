@@ -0,0 +1,246 @@
+//***************************************************************************************
+// SceneRayQueryTests.cpp
+//
+// Scatters scaled and rotated instances of the Picking demo's car and checks
+// SceneRayQuery's closest and any hits against testing every triangle of every
+// instance with TriangleTests::Intersects.  Rays that run along a face of a
+// bounding box, where the slab test divides zero by zero, are checked on their own.
+//***************************************************************************************
+
+#include "CommonTests.h"
+#include "../../Common/BvhHelper.h"
+#include "../../Common/SceneRayQuery.h"
+
+using namespace DirectX;
+
+namespace
+{
+	const UINT gInstanceCount = 60;
+	const UINT gRayCount = 3000;
+
+	// Reads the positions and indices of a mesh in the book's text model format.
+	bool LoadTextMesh(const std::string& filename, std::vector<XMFLOAT3>& positions, std::vector<std::uint32_t>& indices)
+	{
+		std::ifstream fin(filename);
+		if(!fin)
+			return false;
+
+		UINT vcount = 0;
+		UINT tcount = 0;
+		std::string ignore;
+
+		fin >> ignore >> vcount;
+		fin >> ignore >> tcount;
+		fin >> ignore >> ignore >> ignore >> ignore;
+
+		positions.resize(vcount);
+		for(UINT i = 0; i < vcount; ++i)
+		{
+			XMFLOAT3 normal;
+			fin >> positions[i].x >> positions[i].y >> positions[i].z;
+			fin >> normal.x >> normal.y >> normal.z;
+		}
+
+		fin >> ignore;
+		fin >> ignore;
+		fin >> ignore;
+
+		indices.resize(3*tcount);
+		for(UINT i = 0; i < 3*tcount; ++i)
+			fin >> indices[i];
+
+		return (bool)fin;
+	}
+
+	struct BruteForceScene
+	{
+		const std::vector<XMFLOAT3>* Positions = nullptr;
+		const std::vector<std::uint32_t>* Indices = nullptr;
+		std::vector<XMFLOAT4X4> WorldToLocal;
+
+		// Distance to the triangle along the ray in instance's local space, or
+		// infinity if it is missed.
+		float TriangleDistance(const RayQuery& ray, UINT instance, UINT triangle)const
+		{
+			XMMATRIX toLocal = XMLoadFloat4x4(&WorldToLocal[instance]);
+			XMVECTOR origin = XMVector3TransformCoord(XMLoadFloat3(&ray.Origin), toLocal);
+			XMVECTOR dir = XMVector3TransformNormal(XMLoadFloat3(&ray.Direction), toLocal);
+
+			const std::vector<XMFLOAT3>& p = *Positions;
+			const std::vector<std::uint32_t>& i = *Indices;
+			float t = 0.0f;
+			if(!TriangleTests::Intersects(origin, dir, XMLoadFloat3(&p[i[3*triangle + 0]]),
+				XMLoadFloat3(&p[i[3*triangle + 1]]), XMLoadFloat3(&p[i[3*triangle + 2]]), t))
+			{
+				return MathHelper::Infinity;
+			}
+
+			return t;
+		}
+
+		RayHit ClosestHit(const RayQuery& ray)const
+		{
+			RayHit hit;
+			hit.Distance = ray.MaxDistance;
+
+			UINT triangleCount = (UINT)Indices->size() / 3;
+			for(UINT instance = 0; instance < (UINT)WorldToLocal.size(); ++instance)
+			{
+				for(UINT triangle = 0; triangle < triangleCount; ++triangle)
+				{
+					float t = TriangleDistance(ray, instance, triangle);
+					if(t < hit.Distance)
+					{
+						hit.Instance = instance;
+						hit.Triangle = triangle;
+						hit.Distance = t;
+					}
+				}
+			}
+
+			if(hit.Instance == RayHit::NoHit)
+				hit.Distance = MathHelper::Infinity;
+
+			return hit;
+		}
+	};
+
+	bool NearlyEqual(float a, float b)
+	{
+		return fabsf(a - b) <= 1e-4f*MathHelper::Max(1.0f, fabsf(a));
+	}
+}
+
+void RunSceneRayQueryTests(TestReport& report)
+{
+	report.BeginSuite("SceneRayQuery");
+
+	std::vector<XMFLOAT3> positions;
+	std::vector<std::uint32_t> indices;
+	if(!report.Check(LoadTextMesh("../../Chapter 17 Picking/Picking/Models/car.txt", positions, indices),
+		"car.txt loads"))
+	{
+		return;
+	}
+
+	TriangleBvh bvh;
+	bvh.Build(positions.data(), sizeof(XMFLOAT3), indices.data(), 0, (UINT)indices.size(), 0);
+
+	BruteForceScene reference;
+	reference.Positions = &positions;
+	reference.Indices = &indices;
+
+	SceneRayQuery scene;
+	srand(3);
+	for(UINT i = 0; i < gInstanceCount; ++i)
+	{
+		XMMATRIX world =
+			XMMatrixScaling(MathHelper::RandF(0.5f, 2.0f), MathHelper::RandF(0.5f, 2.0f), MathHelper::RandF(0.5f, 2.0f)) *
+			XMMatrixRotationY(MathHelper::RandF(0.0f, 2.0f*MathHelper::Pi)) *
+			XMMatrixTranslation(MathHelper::RandF(-40.0f, 40.0f), MathHelper::RandF(0.0f, 5.0f), MathHelper::RandF(-40.0f, 40.0f));
+
+		scene.AddInstance(&bvh, world);
+
+		XMVECTOR det = XMMatrixDeterminant(world);
+		XMFLOAT4X4 toLocal;
+		XMStoreFloat4x4(&toLocal, XMMatrixInverse(&det, world));
+		reference.WorldToLocal.push_back(toLocal);
+	}
+
+	// Move one instance after the hierarchy could have been built.
+	XMMATRIX moved = XMMatrixTranslation(0.0f, 0.0f, 0.0f);
+	scene.SetWorld(5, moved);
+	XMStoreFloat4x4(&reference.WorldToLocal[5], moved);
+
+	report.Check(scene.InstanceCount() == gInstanceCount, "every instance is added");
+
+	// Rays from above the scene toward points on the ground among the cars.
+	// Every other ray is a line of sight test that ends at its target.
+	std::vector<RayQuery> rays(gRayCount);
+	for(UINT i = 0; i < gRayCount; ++i)
+	{
+		XMFLOAT3 target(MathHelper::RandF(-40.0f, 40.0f), MathHelper::RandF(0.0f, 3.0f), MathHelper::RandF(-40.0f, 40.0f));
+		rays[i].Origin = XMFLOAT3(MathHelper::RandF(-50.0f, 50.0f), MathHelper::RandF(1.0f, 10.0f), MathHelper::RandF(-50.0f, 50.0f));
+		rays[i].Direction = XMFLOAT3(target.x - rays[i].Origin.x, target.y - rays[i].Origin.y, target.z - rays[i].Origin.z);
+		rays[i].MaxDistance = (i % 2) ? 1.0f : MathHelper::Infinity;
+	}
+
+	ThreadPool& threadPool = ThreadPool::Default();
+
+	std::vector<RayHit> hits(gRayCount);
+	std::vector<std::uint8_t> occluded(gRayCount);
+	scene.ClosestHit(rays.data(), gRayCount, hits.data(), threadPool);
+	scene.AnyHit(rays.data(), gRayCount, occluded.data(), threadPool);
+
+	UINT hitCount = 0;
+	UINT closestMismatches = 0;
+	UINT anyMismatches = 0;
+	for(UINT i = 0; i < gRayCount; ++i)
+	{
+		RayHit expected = reference.ClosestHit(rays[i]);
+		bool isHit = expected.Instance != RayHit::NoHit;
+		if(isHit)
+			++hitCount;
+
+		// Where two triangles are hit at the same distance either may be
+		// reported, so check that the one returned is hit there.
+		bool same = hits[i].Instance == expected.Instance;
+		if(isHit && hits[i].Instance != RayHit::NoHit)
+		{
+			same = NearlyEqual(expected.Distance, hits[i].Distance) &&
+				NearlyEqual(hits[i].Distance, reference.TriangleDistance(rays[i], hits[i].Instance, hits[i].Triangle));
+		}
+
+		if(!same)
+			++closestMismatches;
+
+		if(isHit != (occluded[i] != 0))
+			++anyMismatches;
+	}
+
+	report.Log() << hitCount << " of " << gRayCount << " rays hit" << std::endl;
+	report.Check(hitCount > gRayCount / 10 && hitCount < gRayCount, "the rays both hit and miss the cars");
+	report.Check(closestMismatches == 0, "ClosestHit agrees with brute force");
+	report.Check(anyMismatches == 0, "AnyHit agrees with brute force");
+
+	//
+	// A ray parallel to a box face that starts on it gives 0*inf = NaN in the
+	// slab test.  It still runs along the box, and a triangle with an edge on
+	// that face is hit.
+	//
+	{
+		const XMFLOAT3 boxMin(0.0f, -1.0f, 2.0f);
+		const XMFLOAT3 boxMax(1.0f, 1.0f, 3.0f);
+		XMFLOAT3 invDir;
+		XMStoreFloat3(&invDir, XMVectorReciprocal(XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f)));
+		report.Check(BvhHelper::EnterBox(boxMin, boxMax, XMFLOAT3(0.0f, 0.0f, -5.0f), invDir, MathHelper::Infinity) == 7.0f,
+			"a ray along the low face of a box enters it");
+		report.Check(BvhHelper::EnterBox(boxMin, boxMax, XMFLOAT3(1.0f, 1.0f, -5.0f), invDir, MathHelper::Infinity) == 7.0f,
+			"a ray along the high faces of a box enters it");
+		report.Check(BvhHelper::EnterBox(boxMin, boxMax, XMFLOAT3(0.0f, 0.0f, 2.5f), invDir, MathHelper::Infinity) == 0.0f,
+			"a ray along a face from inside the box enters it at once");
+
+		const XMFLOAT3 edgeTriangle[3] = { XMFLOAT3(0.0f, -1.0f, 2.0f), XMFLOAT3(0.0f, 1.0f, 2.0f), XMFLOAT3(1.0f, 0.0f, 2.0f) };
+		const std::uint32_t edgeIndices[3] = { 0, 1, 2 };
+		TriangleBvh edgeBvh;
+		edgeBvh.Build(edgeTriangle, sizeof(XMFLOAT3), edgeIndices, 0, 3, 0);
+
+		XMVECTOR origin = XMVectorSet(0.0f, 0.0f, -5.0f, 1.0f);
+		XMVECTOR dir = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+
+		float dist = MathHelper::Infinity;
+		UINT triangle = 0;
+		report.Check(edgeBvh.Intersects(origin, dir, dist, triangle) && dist == 7.0f,
+			"Intersects hits the edge a ray runs along");
+		report.Check(edgeBvh.IntersectsAny(origin, dir, MathHelper::Infinity),
+			"IntersectsAny hits the edge a ray runs along");
+
+		RayPacket packet;
+		for(UINT lane = 0; lane < 4; ++lane)
+			packet.Set(lane, origin, dir);
+		XMFLOAT4 packetDist(MathHelper::Infinity, MathHelper::Infinity, MathHelper::Infinity, MathHelper::Infinity);
+		UINT packetTriangles[4];
+		report.Check(edgeBvh.IntersectPacket(packet, packetDist, packetTriangles) == 0xf && packetDist.x == 7.0f,
+			"IntersectPacket hits the edge a ray runs along");
+	}
+}
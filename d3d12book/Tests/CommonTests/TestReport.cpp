@@ -0,0 +1,48 @@
+//***************************************************************************************
+// TestReport.cpp
+//***************************************************************************************
+
+#include "TestReport.h"
+
+TestReport::TestReport(std::ostream& out)
+	: mOut(out)
+{
+}
+
+void TestReport::BeginSuite(const std::string& name)
+{
+	mSuite = name;
+	mOut << name << std::endl;
+}
+
+bool TestReport::Check(bool passed, const std::string& description)
+{
+	++mCheckCount;
+	if(!passed)
+	{
+		++mFailureCount;
+		mOut << "  FAILED: " << description << std::endl;
+	}
+
+	return passed;
+}
+
+std::ostream& TestReport::Log()
+{
+	return mOut << "  ";
+}
+
+UINT TestReport::CheckCount()const
+{
+	return mCheckCount;
+}
+
+UINT TestReport::FailureCount()const
+{
+	return mFailureCount;
+}
+
+void TestReport::PrintSummary()
+{
+	mOut << mCheckCount << " checks, " << mFailureCount << " failed" << std::endl;
+}
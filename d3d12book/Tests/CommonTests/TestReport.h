@@ -0,0 +1,42 @@
+//***************************************************************************************
+// TestReport.h
+//
+// Counts the checks made by the test suites and prints the ones that fail.
+//***************************************************************************************
+
+#pragma once
+
+#include <windows.h>
+#include <iostream>
+#include <string>
+
+class TestReport
+{
+public:
+	explicit TestReport(std::ostream& out);
+	TestReport(const TestReport& rhs) = delete;
+	TestReport& operator=(const TestReport& rhs) = delete;
+	~TestReport() = default;
+
+	// Starts a group of checks; failures are printed under its name.
+	void BeginSuite(const std::string& name);
+
+	// Records one check and prints description if it failed.  Returns passed.
+	bool Check(bool passed, const std::string& description);
+
+	// For measurements that are printed but not checked.
+	std::ostream& Log();
+
+	UINT CheckCount()const;
+	UINT FailureCount()const;
+
+	// Prints the number of checks and failures.
+	void PrintSummary();
+
+private:
+	std::ostream& mOut;
+	std::string mSuite;
+
+	UINT mCheckCount = 0;
+	UINT mFailureCount = 0;
+};
@@ -0,0 +1,257 @@
+//***************************************************************************************
+// TextureStreamerTests.cpp
+//
+// Drives TextureStreamer frame by frame with a sink that only records what it is
+// told, using 256x256 R8G8B8A8 textures with full mip chains.  Their mip tail
+// starts at the 64x64 mip, level 2.
+//***************************************************************************************
+
+#include "CommonTests.h"
+#include "../../Common/TextureStreamer.h"
+
+using namespace DirectX;
+
+namespace
+{
+	const UINT gTextureSize = 256;
+	const UINT gTailMip = 2;
+
+	class FakeUploadSink : public TextureUploadSink
+	{
+	public:
+		struct Call
+		{
+			UINT Frame;
+			UINT Texture;
+			UINT FirstMip;
+		};
+
+		virtual void SetResidentMips(UINT texture, UINT firstMip)override
+		{
+			Call call = { Frame, texture, firstMip };
+			Calls.push_back(call);
+
+			if(texture >= ResidentMips.size())
+				ResidentMips.resize(texture + 1, ~0u);
+			ResidentMips[texture] = firstMip;
+		}
+
+		// Number of calls made in frame.
+		UINT CallCount(UINT frame)const
+		{
+			UINT count = 0;
+			for(const Call& call : Calls)
+			{
+				if(call.Frame == frame)
+					++count;
+			}
+			return count;
+		}
+
+		UINT Frame = 0;
+		std::vector<Call> Calls;
+		std::vector<UINT> ResidentMips;
+	};
+
+	TextureCatalogEntry MakeEntry(const std::wstring& name)
+	{
+		TextureCatalogEntry entry;
+		entry.Name = name;
+		entry.Desc.dimension = DDS_DIMENSION_TEXTURE2D;
+		entry.Desc.width = gTextureSize;
+		entry.Desc.height = gTextureSize;
+		entry.Desc.depth = 1;
+		entry.Desc.arraySize = 1;
+		entry.Desc.mipCount = 9;
+		entry.Desc.format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		entry.FileSize = GetDDSSubresourceLayouts(entry.Desc, entry.Subresources);
+		return entry;
+	}
+
+	UINT64 MipBytes(UINT mip)
+	{
+		UINT size = gTextureSize >> mip;
+		return (UINT64)size*size*4;
+	}
+
+	UINT64 TailBytes()
+	{
+		UINT64 bytes = 0;
+		for(UINT mip = gTailMip; mip < 9; ++mip)
+			bytes += MipBytes(mip);
+		return bytes;
+	}
+
+	// Runs the Update that ends a frame and returns the frame number its sink
+	// calls are recorded under.  Calls made by AddTexture are in frame 0.
+	UINT EndFrame(TextureStreamer& streamer, FakeUploadSink& sink)
+	{
+		sink.Frame++;
+		streamer.Update();
+		return sink.Frame;
+	}
+
+	bool SinkMatches(const TextureStreamer& streamer, const FakeUploadSink& sink)
+	{
+		if(sink.ResidentMips.size() != streamer.TextureCount())
+			return false;
+
+		for(UINT i = 0; i < streamer.TextureCount(); ++i)
+		{
+			if(sink.ResidentMips[i] != streamer.GetResidentMip(i))
+				return false;
+		}
+
+		return true;
+	}
+}
+
+void RunTextureStreamerTests(TestReport& report)
+{
+	report.BeginSuite("TextureStreamer");
+
+	std::vector<TextureCatalogEntry> entries;
+	for(UINT i = 0; i < 4; ++i)
+		entries.push_back(MakeEntry(L"texture" + std::to_wstring(i) + L".dds"));
+
+	//
+	// Adding a texture makes its tail resident; requests stream in one mip per
+	// texture per Update.
+	//
+	{
+		FakeUploadSink sink;
+		TextureStreamer streamer(sink, 64*1024*1024);
+
+		UINT texture = streamer.AddTexture(entries[0]);
+		report.Check(sink.Calls.size() == 1 && sink.Calls[0].Texture == texture && sink.Calls[0].FirstMip == gTailMip,
+			"AddTexture makes the mip tail resident before returning");
+		report.Check(streamer.GetResidentMip(texture) == gTailMip, "the tail starts at the first mip of at most 64x64");
+		report.Check(streamer.GetResidentBytes() == TailBytes(), "resident bytes count the tail");
+
+		UINT frame = EndFrame(streamer, sink);
+		report.Check(sink.CallCount(frame) == 0, "nothing streams in for a texture nobody requested");
+
+		streamer.RequestTexture(texture, 1.0f, (float)gTextureSize);
+		frame = EndFrame(streamer, sink);
+		report.Check(streamer.GetWantedMip(texture) == 0, "a texture drawn at its full size wants mip 0");
+		report.Check(streamer.GetResidentMip(texture) == 1 && sink.CallCount(frame) == 1,
+			"one finer mip is streamed in per Update");
+
+		streamer.RequestTexture(texture, 1.0f, (float)gTextureSize);
+		EndFrame(streamer, sink);
+		report.Check(streamer.GetResidentMip(texture) == 0, "the next Update streams in the next mip");
+
+		streamer.RequestTexture(texture, 1.0f, (float)gTextureSize);
+		frame = EndFrame(streamer, sink);
+		report.Check(sink.CallCount(frame) == 0, "a texture with all the detail it needs is left alone");
+		report.Check(streamer.GetResidentBytes() == TailBytes() + MipBytes(0) + MipBytes(1),
+			"resident bytes count the streamed mips");
+		report.Check(SinkMatches(streamer, sink), "the sink saw every change");
+	}
+
+	//
+	// Priority: missing mips * screen size / (1 + distance).
+	//
+	{
+		FakeUploadSink sink;
+		TextureStreamer streamer(sink, 64*1024*1024);
+		streamer.SetUploadLimit(1);
+
+		UINT farTexture = streamer.AddTexture(entries[0]);
+		UINT nearTexture = streamer.AddTexture(entries[1]);
+		sink.Calls.clear();
+
+		// farTexture misses 2 mips: 2*256/11 = 46.5.  nearTexture covers 128
+		// pixels, so it wants mip 1 and misses 1 mip: 1*128/2 = 64.
+		for(UINT frame = 0; frame < 3; ++frame)
+		{
+			streamer.RequestTexture(farTexture, 10.0f, 256.0f);
+			streamer.RequestTexture(nearTexture, 1.0f, 128.0f);
+			EndFrame(streamer, sink);
+		}
+
+		report.Check(sink.Calls.size() == 3, "a limit below one mip still lets one mip through per Update");
+		report.Check(sink.Calls.size() == 3 &&
+			sink.Calls[0].Texture == nearTexture && sink.Calls[0].FirstMip == 1 &&
+			sink.Calls[1].Texture == farTexture && sink.Calls[1].FirstMip == 1 &&
+			sink.Calls[2].Texture == farTexture && sink.Calls[2].FirstMip == 0,
+			"textures stream in in order of priority");
+
+		// Two uses in one frame: the nearest distance and largest size count.
+		streamer.RequestTexture(nearTexture, 50.0f, 16.0f);
+		streamer.RequestTexture(nearTexture, 1.0f, 256.0f);
+		EndFrame(streamer, sink);
+		report.Check(streamer.GetWantedMip(nearTexture) == 0 && streamer.GetResidentMip(nearTexture) == 0,
+			"the largest use of a texture in a frame decides its mip");
+	}
+
+	//
+	// The per-Update upload limit spreads a burst over several frames.
+	//
+	{
+		FakeUploadSink sink;
+		TextureStreamer streamer(sink, 64*1024*1024);
+		streamer.SetUploadLimit(2*MipBytes(1));
+
+		for(UINT i = 0; i < 3; ++i)
+			streamer.AddTexture(entries[i]);
+
+		// All three want mip 0 but only two mip 1s fit in the first Update.
+		for(UINT i = 0; i < 3; ++i)
+			streamer.RequestTexture(i, 1.0f, 256.0f);
+		UINT64 before = streamer.GetResidentBytes();
+		UINT frame = EndFrame(streamer, sink);
+		report.Check(sink.CallCount(frame) == 2, "only as many mips as fit in the limit are streamed in");
+		report.Check(streamer.GetResidentBytes() - before <= 2*MipBytes(1), "an Update uploads no more than the limit");
+
+		for(UINT i = 0; i < 3; ++i)
+			streamer.RequestTexture(i, 1.0f, 256.0f);
+		frame = EndFrame(streamer, sink);
+		report.Check(sink.CallCount(frame) == 1 && streamer.GetResidentMip(2) == 1,
+			"the texture left out streams in on the next Update");
+		report.Check(SinkMatches(streamer, sink), "the sink saw every change");
+	}
+
+	//
+	// Eviction when the budget shrinks: least recently used first, tails never.
+	//
+	{
+		FakeUploadSink sink;
+		TextureStreamer streamer(sink, 64*1024*1024);
+
+		UINT recent = streamer.AddTexture(entries[0]);
+		UINT old = streamer.AddTexture(entries[1]);
+
+		for(UINT frame = 0; frame < 2; ++frame)
+		{
+			streamer.RequestTexture(recent, 1.0f, 256.0f);
+			streamer.RequestTexture(old, 1.0f, 256.0f);
+			EndFrame(streamer, sink);
+		}
+
+		// Only recent is drawn from now on.
+		streamer.RequestTexture(recent, 1.0f, 256.0f);
+		EndFrame(streamer, sink);
+
+		const UINT64 fullBytes = TailBytes() + MipBytes(0) + MipBytes(1);
+		report.Check(streamer.GetResidentBytes() == 2*fullBytes, "both textures are fully resident");
+
+		streamer.SetBudget(fullBytes + TailBytes());
+		streamer.RequestTexture(recent, 1.0f, 256.0f);
+		EndFrame(streamer, sink);
+		report.Check(streamer.GetResidentMip(old) == gTailMip && streamer.GetResidentMip(recent) == 0,
+			"a smaller budget evicts the least recently used texture");
+		report.Check(streamer.GetResidentBytes() <= streamer.GetBudget(), "resident bytes fit the new budget");
+
+		streamer.SetBudget(0);
+		EndFrame(streamer, sink);
+		report.Check(streamer.GetResidentMip(old) == gTailMip && streamer.GetResidentMip(recent) == gTailMip,
+			"a budget below the tails evicts everything above them");
+		report.Check(streamer.GetResidentBytes() == 2*TailBytes(), "tails stay resident whatever the budget");
+
+		streamer.RequestTexture(recent, 1.0f, 256.0f);
+		EndFrame(streamer, sink);
+		report.Check(streamer.GetResidentMip(recent) == gTailMip, "nothing streams in while the tails fill the budget");
+		report.Check(SinkMatches(streamer, sink), "the sink saw every change");
+	}
+}